@@ -1,12 +1,17 @@
 
 SUBDIRS := \
 	atomic \
+	callcount \
+	counter \
 	csum \
+	inet6 \
 	malloc \
 	mbuf \
 	mib \
 	mutex \
 	panic \
 	phash \
+	random \
+	time \
 	uma \
 
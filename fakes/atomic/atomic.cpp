@@ -4,16 +4,16 @@ extern "C" {
 #include <kern_include/machine/atomic.h>
 }
 
+// These may be called from multiple threads (e.g. by a multi-queue benchmark
+// freeing mbufs with shared external storage), so they must really be atomic.
 void
 atomic_add_int(volatile u_int *p, u_int v)
 {
-	*p += v;
+	__atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
 }
 
 u_int
 atomic_fetchadd_int(volatile u_int *p, u_int v)
 {
-	u_int val = *p;
-	*p += v;
-	return val;
+	return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST);
 }
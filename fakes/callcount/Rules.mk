@@ -0,0 +1,5 @@
+
+LIB := fake_callcount
+
+SRCS := \
+	callcount.cpp \
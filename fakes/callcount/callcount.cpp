@@ -0,0 +1,274 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/CallCounts.h"
+
+#include "sysunit/Initializer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <dlfcn.h>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	// The counters updated by a single thread.  The owning thread updates
+	// calls with a plain load and store rather than an atomic
+	// read-modify-write, so Reset(), which stores to it from another
+	// thread, may only run while the owning thread is not counting calls;
+	// otherwise a concurrent increment can be lost.
+	struct ThreadCounts
+	{
+		std::array<std::atomic<uint64_t>, FAKE_NUM_CALLS> calls;
+
+		std::mutex siteLock;
+		std::array<std::unordered_map<const void *, uint64_t>, FAKE_NUM_CALLS> sites;
+
+		ThreadCounts();
+		~ThreadCounts();
+
+		void AddTo(SysUnit::CallCounts & counts);
+		void Reset();
+	};
+
+	struct Registry
+	{
+		std::mutex lock;
+		std::vector<ThreadCounts *> threads;
+
+		// The counts from threads that have exited.
+		SysUnit::CallCounts retired;
+	};
+
+	std::atomic<bool> trackSites(false);
+
+	Registry & GetRegistry()
+	{
+		static Registry registry;
+
+		return registry;
+	}
+
+	ThreadCounts & GetThreadCounts()
+	{
+		thread_local ThreadCounts counts;
+
+		return counts;
+	}
+
+	ThreadCounts::ThreadCounts()
+	{
+		for (auto & c : calls)
+			c.store(0, std::memory_order_relaxed);
+
+		Registry & reg = GetRegistry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+		reg.threads.push_back(this);
+	}
+
+	ThreadCounts::~ThreadCounts()
+	{
+		Registry & reg = GetRegistry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+
+		AddTo(reg.retired);
+		reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+	}
+
+	void ThreadCounts::AddTo(SysUnit::CallCounts & counts)
+	{
+		std::lock_guard<std::mutex> guard(siteLock);
+
+		for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+			counts.calls[i] += calls[i].load(std::memory_order_relaxed);
+			for (const auto & [site, count] : sites[i])
+				counts.sites[i][site] += count;
+		}
+	}
+
+	void ThreadCounts::Reset()
+	{
+		std::lock_guard<std::mutex> guard(siteLock);
+
+		for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+			calls[i].store(0, std::memory_order_relaxed);
+			sites[i].clear();
+		}
+	}
+
+	void PrintCallSite(std::ostream & out, const void * site)
+	{
+		Dl_info info;
+
+		out << site;
+		if (dladdr(site, &info) != 0 && info.dli_sname != NULL) {
+			out << " <" << info.dli_sname << "+"
+			    << (static_cast<const char *>(site) -
+			       static_cast<const char *>(info.dli_saddr))
+			    << ">";
+		}
+	}
+
+	class CallCountInit : public SysUnit::Initializer
+	{
+	public:
+		void SetUp() override
+		{
+			SysUnit::ResetCallCounts();
+		}
+
+		void TearDown() override
+		{
+			if (getenv("SYSUNIT_CALL_COUNTS") != NULL)
+				SysUnit::PrintCallCounts(std::cout, SysUnit::GetCallCounts());
+		}
+	};
+
+	CallCountInit callCountInit;
+}
+
+extern "C" const char *
+fake_call_name(enum fake_call call)
+{
+	switch (call) {
+	case FAKE_CALL_UMA_ZALLOC:
+		return "uma_zalloc";
+	case FAKE_CALL_UMA_ZFREE:
+		return "uma_zfree";
+	case FAKE_CALL_KMALLOC:
+		return "kmalloc";
+	case FAKE_CALL_KFREE:
+		return "kfree";
+	case FAKE_CALL_M_FREEM:
+		return "m_freem";
+	case FAKE_CALL_MTX_LOCK:
+		return "mtx_lock";
+	case FAKE_CALL_MTX_UNLOCK:
+		return "mtx_unlock";
+	case FAKE_CALL_GETMICROTIME:
+		return "getmicrotime";
+	case FAKE_CALL_IN_CKSUM_HDR:
+		return "in_cksum_hdr";
+	case FAKE_CALL_IN_CKSUM_SKIP:
+		return "in_cksum_skip";
+	case FAKE_CALL_IN6_CKSUM:
+		return "in6_cksum";
+	case FAKE_CALL_HASHINIT:
+		return "hashinit";
+	case FAKE_NUM_CALLS:
+		break;
+	}
+	return "unknown";
+}
+
+extern "C" void
+fake_count_call(enum fake_call call, const void *site)
+{
+	ThreadCounts & counts = GetThreadCounts();
+	auto & c = counts.calls[call];
+
+	c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	if (trackSites.load(std::memory_order_relaxed)) {
+		std::lock_guard<std::mutex> guard(counts.siteLock);
+		counts.sites[call][site]++;
+	}
+}
+
+namespace SysUnit
+{
+	CallCounts GetCallCounts()
+	{
+		Registry & reg = GetRegistry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+		CallCounts counts(reg.retired);
+
+		for (auto * thread : reg.threads)
+			thread->AddTo(counts);
+
+		return counts;
+	}
+
+	void ResetCallCounts()
+	{
+		Registry & reg = GetRegistry();
+		std::lock_guard<std::mutex> guard(reg.lock);
+
+		reg.retired = CallCounts();
+		for (auto * thread : reg.threads)
+			thread->Reset();
+	}
+
+	void TrackCallSites(bool enable)
+	{
+		trackSites.store(enable, std::memory_order_relaxed);
+	}
+
+	void PrintCallCounts(std::ostream & out, const CallCounts & counts,
+	    uint64_t items)
+	{
+		auto flags = out.flags();
+		auto precision = out.precision();
+
+		out << std::fixed << std::setprecision(3);
+		for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+			if (counts.calls[i] == 0)
+				continue;
+
+			out << std::left << std::setw(16)
+			    << fake_call_name(static_cast<fake_call>(i))
+			    << std::right << std::setw(12) << counts.calls[i];
+			if (items != 0)
+				out << std::setw(12) << double(counts.calls[i]) / items
+				    << "/item";
+			out << "\n";
+
+			std::vector<std::pair<const void *, uint64_t>> sites(
+			    counts.sites[i].begin(), counts.sites[i].end());
+			std::sort(sites.begin(), sites.end(),
+			    [] (const auto & l, const auto & r)
+			    {
+				    return l.second > r.second;
+			    });
+
+			for (const auto & [site, count] : sites) {
+				out << "    " << std::setw(12) << count << "  ";
+				PrintCallSite(out, site);
+				out << "\n";
+			}
+		}
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+}
@@ -0,0 +1,5 @@
+
+LIB := fake_counter
+
+SRCS := \
+	counter.cpp \
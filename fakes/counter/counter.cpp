@@ -0,0 +1,108 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/counter.h"
+
+#include <stdint.h>
+
+/*
+ * counter(9) for userland.  The kernel's counter_u64_add() is an inline
+ * function that adds to %gs:(c - &__pcpu[0]), the slot of the counter for
+ * the current CPU.  Userland threads run with a %gs base of 0, so handing out
+ * each counter as &__pcpu[0] plus the address of its storage makes the
+ * unmodified inline add to that storage.
+ *
+ * There is one slot per counter rather than one per CPU, and the inline add
+ * is not atomic, so concurrent updates from several threads may be lost.
+ * Counters are statistics, so tests should only check them from a single
+ * thread.
+ */
+
+typedef uint64_t *counter_u64_t;
+
+extern "C" {
+	// Only the address of __pcpu is used.  The kernel declares it as
+	// an array of struct pcpu, which the fakes never look inside.
+	alignas(64) char __pcpu[64];
+}
+
+static uint64_t *
+counter_storage(counter_u64_t c)
+{
+
+	return (reinterpret_cast<uint64_t *>(
+	    reinterpret_cast<uintptr_t>(c) - reinterpret_cast<uintptr_t>(__pcpu)));
+}
+
+extern "C" counter_u64_t
+counter_u64_alloc(int flags)
+{
+	uint64_t *storage = new uint64_t(0);
+
+	return (reinterpret_cast<counter_u64_t>(
+	    reinterpret_cast<uintptr_t>(storage) + reinterpret_cast<uintptr_t>(__pcpu)));
+}
+
+extern "C" void
+counter_u64_free(counter_u64_t c)
+{
+
+	delete counter_storage(c);
+}
+
+extern "C" void
+counter_u64_zero(counter_u64_t c)
+{
+
+	*counter_storage(c) = 0;
+}
+
+extern "C" uint64_t
+counter_u64_fetch(counter_u64_t c)
+{
+
+	return (*counter_storage(c));
+}
+
+extern "C" void
+fake_counter_array_alloc(counter_u64_t *counters, size_t n)
+{
+
+	for (size_t i = 0; i < n; ++i)
+		counters[i] = counter_u64_alloc(0);
+}
+
+extern "C" void
+fake_counter_array_free(counter_u64_t *counters, size_t n)
+{
+
+	for (size_t i = 0; i < n; ++i) {
+		counter_u64_free(counters[i]);
+		counters[i] = NULL;
+	}
+}
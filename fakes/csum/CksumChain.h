@@ -0,0 +1,223 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FAKES_CSUM_CKSUM_CHAIN_H
+#define FAKES_CSUM_CKSUM_CHAIN_H
+
+#include "fake/mbuf.h"
+
+#include "pktgen/MbufUniquePtr.h"
+
+#include <algorithm>
+#include <random>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+// Builds the mbuf chains that the checksum tests and benchmarks run over.  The
+// checksum routines handle each mbuf boundary, odd-length mbuf and misaligned
+// mbuf specially, so the same data is checksummed over chains of every shape.
+namespace CksumChain
+{
+	enum class Shape
+	{
+		// A single mbuf.
+		CONTIGUOUS,
+
+		// Two mbufs of (nearly) equal length.
+		HALVES,
+
+		// Mbufs of MCLBYTES, as a driver receiving into clusters
+		// would produce.
+		CLUSTERS,
+
+		// 64-byte mbufs.
+		SMALL,
+
+		// A 1-byte mbuf followed by the rest, so that every word of
+		// the second mbuf straddles the boundary.
+		ODD_FIRST,
+
+		// Mbufs of 1, 3, 5, 7... bytes, all odd.
+		ODD,
+
+		// One byte per mbuf.
+		BYTES,
+
+		// Every mbuf with data is followed by an empty one.
+		EMPTY_MBUFS,
+
+		// Random lengths, with each mbuf's data at a random alignment.
+		RANDOM,
+	};
+
+	const Shape ALL_SHAPES[] = {
+		Shape::CONTIGUOUS,
+		Shape::HALVES,
+		Shape::CLUSTERS,
+		Shape::SMALL,
+		Shape::ODD_FIRST,
+		Shape::ODD,
+		Shape::BYTES,
+		Shape::EMPTY_MBUFS,
+		Shape::RANDOM,
+	};
+
+	inline const char * GetName(Shape shape)
+	{
+		switch (shape) {
+		case Shape::CONTIGUOUS:
+			return "contiguous";
+		case Shape::HALVES:
+			return "halves";
+		case Shape::CLUSTERS:
+			return "clusters";
+		case Shape::SMALL:
+			return "small";
+		case Shape::ODD_FIRST:
+			return "odd_first";
+		case Shape::ODD:
+			return "odd";
+		case Shape::BYTES:
+			return "bytes";
+		case Shape::EMPTY_MBUFS:
+			return "empty_mbufs";
+		case Shape::RANDOM:
+			return "random";
+		}
+
+		return "unknown";
+	}
+
+	// A chain of mbufs: the length of each mbuf's data and its offset
+	// from the start of the mbuf's buffer.
+	struct Layout
+	{
+		std::vector<size_t> lens;
+		std::vector<size_t> aligns;
+	};
+
+	// Split len bytes into mbufs of the given shape, each starting align
+	// bytes into its buffer.  The same seed always gives the same layout.
+	inline Layout GetLayout(Shape shape, size_t len, size_t align,
+	    uint64_t seed = 1)
+	{
+		std::mt19937_64 rng(seed);
+		Layout layout;
+		size_t left = len;
+
+		auto add = [&layout, &left, align] (size_t n)
+			{
+				n = std::min(n, left);
+				layout.lens.push_back(n);
+				layout.aligns.push_back(align);
+				left -= n;
+			};
+
+		switch (shape) {
+		case Shape::CONTIGUOUS:
+			add(len);
+			break;
+		case Shape::HALVES:
+			add(len / 2);
+			break;
+		case Shape::CLUSTERS:
+			while (left > MCLBYTES)
+				add(MCLBYTES);
+			break;
+		case Shape::SMALL:
+			while (left > 64)
+				add(64);
+			break;
+		case Shape::ODD_FIRST:
+			add(1);
+			break;
+		case Shape::ODD:
+			for (size_t n = 1; left > n; n += 2)
+				add(n);
+			break;
+		case Shape::BYTES:
+			while (left > 1)
+				add(1);
+			break;
+		case Shape::EMPTY_MBUFS:
+			while (left > 100) {
+				add(100);
+				add(0);
+			}
+			break;
+		case Shape::RANDOM:
+			// std::uniform_int_distribution is implementation-
+			// defined, so take the remainder by hand to get the same
+			// layout from every standard library.
+			while (left > 0) {
+				add(rng() % 200);
+				layout.aligns.back() = rng() % 8;
+			}
+			break;
+		}
+
+		// The last mbuf takes whatever is left.
+		if (left > 0 || layout.lens.empty())
+			add(left);
+
+		return layout;
+	}
+
+	// Copy len bytes of data into a chain with the given layout.
+	inline PktGen::MbufUniquePtr Build(const uint8_t * data, size_t len,
+	    const Layout & layout)
+	{
+		PktGen::MbufUniquePtr head;
+		struct mbuf ** tail = nullptr;
+		size_t off = 0;
+
+		for (size_t i = 0; i < layout.lens.size(); ++i) {
+			size_t segLen = layout.lens.at(i);
+			size_t align = layout.aligns.at(i);
+			struct mbuf * m = alloc_mbuf(segLen + align);
+
+			m->m_data += align;
+			m->m_len = segLen;
+			memcpy(m->m_data, data + off, segLen);
+			off += segLen;
+
+			if (!head) {
+				head.reset(m);
+				m->m_pkthdr.len = len;
+			} else
+				*tail = m;
+			tail = &m->m_next;
+		}
+
+		return head;
+	}
+}
+
+#endif
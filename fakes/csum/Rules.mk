@@ -5,3 +5,40 @@ SRCS := \
 	in_cksum.c \
 	in6_cksum.c \
 	in6_scope.c \
+	counted_cksum.c \
+	fast_cksum.cpp \
+
+TESTS := \
+	cksum \
+	fast_cksum \
+
+TEST_CKSUM_LIBS := \
+	fake_callcount \
+	fake_csum \
+	fake_malloc \
+	fake_mbuf \
+	fake_atomic \
+	fake_mib \
+	fake_panic \
+	fake_uma \
+	sysunit_init \
+
+TEST_CKSUM_STDLIBS := \
+	gmock \
+
+TEST_FAST_CKSUM_LIBS := \
+	$(TEST_CKSUM_LIBS) \
+
+TEST_FAST_CKSUM_STDLIBS := \
+	$(TEST_CKSUM_STDLIBS) \
+
+BENCHES := \
+	cksum \
+
+BENCH_CKSUM_LIBS := \
+	$(TEST_CKSUM_LIBS) \
+	sysunit_bench \
+
+BENCH_CKSUM_STDLIBS := \
+	$(TEST_CKSUM_STDLIBS) \
+
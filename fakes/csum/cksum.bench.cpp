@@ -0,0 +1,359 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "CksumChain.h"
+
+#include "fake/csum.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/in_systm.h>
+#include <kern_include/netinet/ip.h>
+#include <kern_include/netinet/ip6.h>
+
+// machine/in_cksum.h and netinet6/in6.h only declare these for the kernel.
+u_short in_cksum_skip(struct mbuf *m, int len, int skip);
+u_int in_cksum_hdr(const struct ip *ip);
+u_short in_pseudo(u_int32_t a, u_int32_t b, u_int32_t c);
+int in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off, u_int32_t len);
+int in6_cksum_pseudo(struct ip6_hdr *ip6, uint32_t len, uint8_t nxt,
+    uint16_t csum);
+}
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/PerfCounters.h"
+
+#include <chrono>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using CksumChain::Shape;
+using PktGen::MbufUniquePtr;
+
+namespace
+{
+	// Each iteration checksums this many chains (or headers), so that the
+	// timer isn't measuring a single call.
+	const size_t CALLS_PER_ITERATION = 1024;
+
+	// Chains are built over this many different buffers, round-robin, so
+	// that short chains aren't all served from one hot cache line.
+	const size_t NUM_CHAINS = 16;
+
+	enum class Func
+	{
+		// in_cksum_skip() over a whole chain, as for a UDP or TCP
+		// payload.
+		SKIP,
+
+		// in6_cksum() over a chain starting with an IPv6 header.
+		IN6,
+
+		// in_cksum_hdr() on a 20-byte IPv4 header.
+		HDR,
+
+		// in_pseudo() on an IPv4 pseudo-header.
+		PSEUDO,
+
+		// in6_cksum_pseudo() on an IPv6 header.
+		IN6_PSEUDO,
+	};
+
+	const char * GetName(Func func)
+	{
+		switch (func) {
+		case Func::SKIP:
+			return "in_cksum_skip";
+		case Func::IN6:
+			return "in6_cksum";
+		case Func::HDR:
+			return "in_cksum_hdr";
+		case Func::PSEUDO:
+			return "in_pseudo";
+		case Func::IN6_PSEUDO:
+			return "in6_cksum_pseudo";
+		}
+
+		return "unknown";
+	}
+
+	struct CksumBenchConfig
+	{
+		Func func;
+
+		// Only used by SKIP and IN6, which walk a chain.  len does not
+		// include the IPv6 header.
+		Shape shape;
+		size_t len;
+		size_t align;
+
+		// If set, run the fast_ versions of SKIP and IN6 from fake_csum
+		// with the given implementation, rather than the kernel's.
+		bool fast = false;
+		enum fake_cksum_impl impl = FAKE_CKSUM_SCALAR;
+
+		bool WalksChain() const
+		{
+			return func == Func::SKIP || func == Func::IN6;
+		}
+
+		std::string Name() const
+		{
+			std::ostringstream name;
+
+			if (fast)
+				name << "fast_" << GetName(func) << "/"
+				    << fake_cksum_impl_name(impl);
+			else
+				name << GetName(func);
+			if (WalksChain()) {
+				name << "/" << CksumChain::GetName(shape)
+				    << "/len=" << len;
+				if (align != 0)
+					name << "/align=" << align;
+			}
+			return name.str();
+		}
+	};
+
+	class CksumBenchmark : public SysUnit::Benchmark
+	{
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		CksumBenchConfig config;
+		std::mt19937_64 rng;
+
+		std::vector<MbufUniquePtr> chains;
+		std::vector<struct ip> ipHeaders;
+		std::vector<struct ip6_hdr> ip6Headers;
+
+		uint64_t calls;
+		uint64_t bytes;
+		uint64_t wallNs;
+
+		// Keeps the compiler from discarding the checksums.
+		volatile uint32_t sink;
+
+		std::vector<uint8_t> GetData(size_t len)
+		{
+			std::vector<uint8_t> data(len);
+
+			for (auto & b : data)
+				b = rng();
+			return data;
+		}
+
+		template <typename T>
+		T GetRandom()
+		{
+			T t;
+			auto data = GetData(sizeof(t));
+
+			memcpy(&t, data.data(), sizeof(t));
+			return t;
+		}
+
+		void BuildChain()
+		{
+			size_t hdrLen = 0;
+
+			if (config.func == Func::IN6)
+				hdrLen = sizeof(struct ip6_hdr);
+
+			auto data = GetData(hdrLen + config.len);
+			auto layout = CksumChain::GetLayout(config.shape, config.len,
+			    config.align, chains.size() + 1);
+
+			// Keep the IPv6 header contiguous, as in6_cksum()
+			// requires.
+			layout.lens.front() += hdrLen;
+			if (hdrLen != 0)
+				data.at(0) = IPV6_VERSION;
+
+			chains.push_back(CksumChain::Build(data.data(), data.size(),
+			    layout));
+		}
+
+		uint32_t RunOnce(size_t i)
+		{
+			struct mbuf * m;
+
+			switch (config.func) {
+			case Func::SKIP:
+				m = chains[i % chains.size()].get();
+				if (config.fast)
+					return fast_in_cksum_skip(m, config.len, 0);
+				return in_cksum_skip(m, config.len, 0);
+			case Func::IN6:
+				m = chains[i % chains.size()].get();
+				if (config.fast)
+					return fast_in6_cksum(m, IPPROTO_UDP,
+					    sizeof(struct ip6_hdr), config.len);
+				return in6_cksum(m, IPPROTO_UDP,
+				    sizeof(struct ip6_hdr), config.len);
+			case Func::HDR:
+				return in_cksum_hdr(&ipHeaders[i % ipHeaders.size()]);
+			case Func::PSEUDO: {
+				const struct ip & ip = ipHeaders[i % ipHeaders.size()];
+				return in_pseudo(ip.ip_src.s_addr, ip.ip_dst.s_addr,
+				    htonl(IPPROTO_UDP + ip.ip_len));
+			}
+			case Func::IN6_PSEUDO: {
+				struct ip6_hdr & ip6 = ip6Headers[i % ip6Headers.size()];
+				return in6_cksum_pseudo(&ip6, ip6.ip6_plen,
+				    IPPROTO_UDP, 0);
+			}
+			}
+
+			return 0;
+		}
+
+	public:
+		explicit CksumBenchmark(const CksumBenchConfig & c)
+		  : config(c),
+		    rng(1),
+		    calls(0),
+		    bytes(0),
+		    wallNs(0),
+		    sink(0)
+		{
+		}
+
+		void BenchSetUp() override
+		{
+			if (config.fast)
+				fake_cksum_set_impl(config.impl);
+
+			for (size_t i = 0; i < NUM_CHAINS; ++i) {
+				if (config.WalksChain())
+					BuildChain();
+
+				auto ip = GetRandom<struct ip>();
+				ip.ip_v = IPVERSION;
+				ip.ip_hl = sizeof(ip) >> 2;
+				ipHeaders.push_back(ip);
+
+				auto ip6 = GetRandom<struct ip6_hdr>();
+				ip6.ip6_vfc = IPV6_VERSION;
+				ip6Headers.push_back(ip6);
+			}
+		}
+
+		size_t Iteration() override
+		{
+			SysUnit::PerfScope scope("cksum", CALLS_PER_ITERATION);
+
+			auto start = Clock::now();
+			for (size_t i = 0; i < CALLS_PER_ITERATION; ++i)
+				sink += RunOnce(i);
+			auto end = Clock::now();
+
+			wallNs += std::chrono::duration_cast<
+			    std::chrono::nanoseconds>(end - start).count();
+			calls += CALLS_PER_ITERATION;
+			if (config.WalksChain())
+				bytes += CALLS_PER_ITERATION * config.len;
+
+			return CALLS_PER_ITERATION;
+		}
+
+		void BenchTearDown() override
+		{
+			if (wallNs != 0) {
+				SetCounter("Mops", 1000.0 * calls / wallNs);
+				if (config.WalksChain())
+					SetCounter("GB/s", double(bytes) / wallNs);
+			}
+
+			chains.clear();
+			ipHeaders.clear();
+			ip6Headers.clear();
+		}
+	};
+
+	void RegisterCksumBenchmark(const CksumBenchConfig & config)
+	{
+		std::string name = "cksum/" + config.Name();
+
+		SysUnit::RegisterBenchmark(name,
+		    [config] () -> std::unique_ptr<SysUnit::Benchmark>
+			{
+				return std::make_unique<CksumBenchmark>(config);
+			});
+	}
+
+	void RegisterCksumBenchmarks()
+	{
+		// Throughput over chains of every shape.  The BYTES shape is
+		// a pathological worst case and is only run on short chains.
+		for (Func func : {Func::SKIP, Func::IN6})
+		for (Shape shape : CksumChain::ALL_SHAPES)
+		for (size_t len : {64, 576, 1500, 9000, 65535}) {
+			if (shape == Shape::BYTES && len > 1500)
+				continue;
+
+			RegisterCksumBenchmark(CksumBenchConfig{func, shape, len, 0});
+		}
+
+		// The cost of misaligned data, for a single mbuf and for a
+		// chain of clusters.
+		for (Shape shape : {Shape::CONTIGUOUS, Shape::CLUSTERS})
+		for (size_t align : {1, 2, 4})
+			RegisterCksumBenchmark(CksumBenchConfig{Func::SKIP, shape,
+			    9000, align});
+
+		// The fast routines, with every implementation the CPU
+		// supports.
+		for (int i = 0; i < FAKE_CKSUM_NUM_IMPLS; ++i) {
+			auto impl = static_cast<enum fake_cksum_impl>(i);
+
+			if (!fake_cksum_impl_supported(impl))
+				continue;
+
+			for (Func func : {Func::SKIP, Func::IN6})
+			for (Shape shape : {Shape::CONTIGUOUS, Shape::CLUSTERS,
+			    Shape::SMALL, Shape::ODD_FIRST, Shape::RANDOM})
+			for (size_t len : {64, 576, 1500, 9000, 65535}) {
+				CksumBenchConfig config{func, shape, len, 0};
+
+				config.fast = true;
+				config.impl = impl;
+				RegisterCksumBenchmark(config);
+			}
+		}
+
+		for (Func func : {Func::HDR, Func::PSEUDO, Func::IN6_PSEUDO})
+			RegisterCksumBenchmark(CksumBenchConfig{func,
+			    Shape::CONTIGUOUS, 0, 0});
+	}
+
+	SYSUNIT_BENCHMARK_FAMILY(RegisterCksumBenchmarks);
+}
@@ -0,0 +1,285 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "CksumChain.h"
+
+#include "pktgen/Checksum.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/in_systm.h>
+#include <kern_include/netinet/ip.h>
+#include <kern_include/netinet/ip6.h>
+
+// machine/in_cksum.h and netinet6/in6.h only declare these for the kernel.
+u_short in_cksum_skip(struct mbuf *m, int len, int skip);
+u_int in_cksum_hdr(const struct ip *ip);
+u_short in_pseudo(u_int32_t a, u_int32_t b, u_int32_t c);
+int in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off, u_int32_t len);
+int in6_cksum_pseudo(struct ip6_hdr *ip6, uint32_t len, uint8_t nxt,
+    uint16_t csum);
+}
+
+#include <gtest/gtest.h>
+
+#include "sysunit/TestSuite.h"
+
+#include <array>
+#include <random>
+#include <vector>
+
+using namespace testing;
+using CksumChain::Shape;
+using PktGen::MbufUniquePtr;
+using PktGen::internal::InetChecksumAdd;
+using PktGen::internal::InetChecksumFinish;
+
+// The routines under test are checked against the checksum implementation in
+// pktgen, which works in host byte order.  The kernel's routines return sums
+// and checksums as they are stored in a packet.
+class CksumTestSuite : public SysUnit::TestSuite
+{
+public:
+	std::mt19937_64 rng;
+
+	void TestCaseSetUp() override
+	{
+		rng.seed(1);
+	}
+
+	std::vector<uint8_t> GetData(size_t len)
+	{
+		std::vector<uint8_t> data(len);
+
+		for (auto & b : data)
+			b = rng();
+		return data;
+	}
+
+	static uint16_t RefCksum(const uint8_t * data, size_t len)
+	{
+		return htons(InetChecksumFinish(InetChecksumAdd(0, data, len)));
+	}
+
+	// in6_cksum() leaves out the scope zone ID that the kernel embeds in
+	// the second word of link-local and interface-local addresses.
+	static struct in6_addr ClearEmbeddedScope(struct in6_addr addr)
+	{
+		uint8_t * a = addr.s6_addr;
+
+		if ((a[0] == 0xfe && (a[1] & 0xc0) == 0x80) ||
+		    (a[0] == 0xff && ((a[1] & 0x0f) == 0x01 || (a[1] & 0x0f) == 0x02)))
+			a[2] = a[3] = 0;
+		return addr;
+	}
+
+	// The unfolded sum of the IPv6 pseudo-header, in host byte order.
+	static uint32_t RefIn6PseudoSum(const struct ip6_hdr * ip6, uint32_t len,
+	    uint8_t nxt)
+	{
+		struct in6_addr src = ClearEmbeddedScope(ip6->ip6_src);
+		struct in6_addr dst = ClearEmbeddedScope(ip6->ip6_dst);
+		uint8_t ph[8] = {
+			uint8_t(len >> 24), uint8_t(len >> 16), uint8_t(len >> 8),
+			uint8_t(len), 0, 0, 0, nxt
+		};
+		uint32_t sum;
+
+		sum = InetChecksumAdd(0, &src, sizeof(src));
+		sum = InetChecksumAdd(sum, &dst, sizeof(dst));
+		return InetChecksumAdd(sum, ph, sizeof(ph));
+	}
+
+	struct ip6_hdr GetIpv6Header(bool scoped)
+	{
+		struct ip6_hdr ip6;
+		auto bytes = GetData(sizeof(ip6));
+
+		memcpy(&ip6, bytes.data(), sizeof(ip6));
+		ip6.ip6_vfc = IPV6_VERSION;
+		if (scoped) {
+			ip6.ip6_src.s6_addr[0] = 0xfe;
+			ip6.ip6_src.s6_addr[1] = 0x80;
+			ip6.ip6_dst.s6_addr[0] = 0xff;
+			ip6.ip6_dst.s6_addr[1] = 0x02;
+		}
+		return ip6;
+	}
+};
+
+TEST_F(CksumTestSuite, TestCksumSkip)
+{
+	const size_t lens[] = {
+		0, 1, 2, 3, 4, 5, 7, 8, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+		127, 128, 129, 255, 256, 257, 1499, 1500, 1501, 4096, 9000, 65535
+	};
+	const size_t skips[] = { 0, 1, 2, 3, 14, 20, 54 };
+
+	for (size_t len : lens) {
+		auto data = GetData(len);
+
+		for (Shape shape : CksumChain::ALL_SHAPES)
+		for (size_t align : {0, 1, 2, 3, 7}) {
+			// A chain of one-byte mbufs is slow to build, and long
+			// ones add nothing.
+			if (shape == Shape::BYTES && len > 4096)
+				continue;
+
+			SCOPED_TRACE(testing::Message() << "len " << len << " shape "
+			    << CksumChain::GetName(shape) << " align " << align);
+
+			auto m = CksumChain::Build(data.data(), len,
+			    CksumChain::GetLayout(shape, len, align));
+
+			for (size_t skip : skips) {
+				if (skip > len)
+					continue;
+
+				SCOPED_TRACE(skip);
+				EXPECT_EQ(in_cksum_skip(m.get(), len, skip),
+				    RefCksum(&data[skip], len - skip));
+
+				// Stop short of the end of the chain.
+				if (skip < len)
+					EXPECT_EQ(in_cksum_skip(m.get(), len - 1, skip),
+					    RefCksum(&data[skip], len - 1 - skip));
+			}
+		}
+	}
+}
+
+TEST_F(CksumTestSuite, TestCksumSkipRandom)
+{
+	for (uint64_t seed = 1; seed <= 1000; ++seed) {
+		size_t len = rng() % 9001;
+		size_t skip = rng() % (len + 1);
+		size_t end = skip + rng() % (len - skip + 1);
+		auto data = GetData(len);
+
+		SCOPED_TRACE(testing::Message() << "seed " << seed << " len "
+		    << len << " skip " << skip << " end " << end);
+
+		auto m = CksumChain::Build(data.data(), len,
+		    CksumChain::GetLayout(Shape::RANDOM, len, 0, seed));
+		EXPECT_EQ(in_cksum_skip(m.get(), end, skip),
+		    RefCksum(&data[skip], end - skip));
+	}
+}
+
+TEST_F(CksumTestSuite, TestCksumHdr)
+{
+	for (int i = 0; i < 1000; ++i) {
+		auto data = GetData(sizeof(struct ip));
+		struct ip ip;
+
+		memcpy(&ip, data.data(), sizeof(ip));
+		ip.ip_v = IPVERSION;
+		ip.ip_hl = sizeof(ip) >> 2;
+
+		SCOPED_TRACE(i);
+		EXPECT_EQ(in_cksum_hdr(&ip), RefCksum(
+		    reinterpret_cast<const uint8_t *>(&ip), sizeof(ip)));
+
+		// A header with a correct checksum sums to zero.
+		ip.ip_sum = 0;
+		ip.ip_sum = RefCksum(reinterpret_cast<const uint8_t *>(&ip),
+		    sizeof(ip));
+		EXPECT_EQ(in_cksum_hdr(&ip), 0);
+	}
+}
+
+TEST_F(CksumTestSuite, TestInPseudo)
+{
+	std::vector<std::array<uint32_t, 3>> args = {
+		{0, 0, 0},
+		{0xffffffff, 0xffffffff, 0xffffffff},
+		{0xffff0000, 0x0000ffff, 0},
+		{0x0000ffff, 0x00000001, 0},
+	};
+
+	for (int i = 0; i < 1000; ++i)
+		args.push_back({uint32_t(rng()), uint32_t(rng()), uint32_t(rng())});
+
+	for (const auto & a : args) {
+		uint32_t sum = 0;
+
+		for (uint32_t x : a)
+			sum = InetChecksumAdd(sum, &x, sizeof(x));
+
+		SCOPED_TRACE(testing::Message() << std::hex << a[0] << " "
+		    << a[1] << " " << a[2]);
+		EXPECT_EQ(in_pseudo(a[0], a[1], a[2]), htons(sum));
+	}
+}
+
+TEST_F(CksumTestSuite, TestIn6CksumPseudo)
+{
+	for (int i = 0; i < 1000; ++i) {
+		bool scoped = (i % 2) != 0;
+		struct ip6_hdr ip6 = GetIpv6Header(scoped);
+		uint32_t len = rng();
+		uint8_t nxt = rng();
+		uint16_t csum = rng();
+
+		SCOPED_TRACE(i);
+
+		uint32_t sum = RefIn6PseudoSum(&ip6, len, nxt);
+		sum = InetChecksumAdd(sum, ntohs(csum));
+		EXPECT_EQ(in6_cksum_pseudo(&ip6, len, nxt, csum), htons(sum));
+	}
+}
+
+TEST_F(CksumTestSuite, TestIn6Cksum)
+{
+	for (size_t len : {0, 1, 8, 9, 1232, 1233, 9000})
+	for (size_t extLen : {0, 8})
+	for (bool scoped : {false, true})
+	for (Shape shape : CksumChain::ALL_SHAPES) {
+		struct ip6_hdr ip6 = GetIpv6Header(scoped);
+		size_t off = sizeof(ip6) + extLen;
+		auto data = GetData(off + len);
+
+		SCOPED_TRACE(testing::Message() << "len " << len << " ext "
+		    << extLen << " shape " << CksumChain::GetName(shape)
+		    << (scoped ? " scoped" : ""));
+
+		// in6_cksum() reads the addresses from the start of the
+		// chain, so the IPv6 header must not be split.
+		memcpy(data.data(), &ip6, sizeof(ip6));
+		auto layout = CksumChain::GetLayout(shape,
+		    data.size() - sizeof(ip6), 0);
+		layout.lens.front() += sizeof(ip6);
+
+		auto m = CksumChain::Build(data.data(), data.size(), layout);
+		uint32_t sum = RefIn6PseudoSum(&ip6, len, IPPROTO_UDP);
+		sum = InetChecksumAdd(sum, &data[off], len);
+
+		EXPECT_EQ(in6_cksum(m.get(), IPPROTO_UDP, off, len),
+		    htons(InetChecksumFinish(sum)));
+	}
+}
@@ -0,0 +1,98 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#define _KERNEL_UT 1
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/mbuf.h>
+#include <netinet/in.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip.h>
+#include <machine/in_cksum.h>
+
+#include <fake/callcount.h>
+#include <fake/csum.h>
+
+/*
+ * Counting wrappers for the checksum routines.  in_cksum.c and in6_cksum.c are
+ * unmodified kernel sources, so instead of counting calls there, tests that
+ * want checksum calls counted redirect the code under test to these with
+ * WRAPFUNCS, e.g. in_cksum_hdr=counted_in_cksum_hdr.  The linker then
+ * resolves the __real_ symbols to the original routines.
+ *
+ * The counted_fast_ wrappers instead call through to the vectorized routines
+ * in fast_cksum.cpp, for benchmarks that count checksums.
+ */
+
+u_int __real_in_cksum_hdr(const struct ip *ip);
+u_short __real_in_cksum_skip(struct mbuf *m, int len, int skip);
+int __real_in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off,
+    u_int32_t len);
+
+u_int
+counted_in_cksum_hdr(const struct ip *ip)
+{
+
+	FAKE_COUNT_CALL(FAKE_CALL_IN_CKSUM_HDR);
+	return (__real_in_cksum_hdr(ip));
+}
+
+u_short
+counted_in_cksum_skip(struct mbuf *m, int len, int skip)
+{
+
+	FAKE_COUNT_CALL(FAKE_CALL_IN_CKSUM_SKIP);
+	return (__real_in_cksum_skip(m, len, skip));
+}
+
+int
+counted_in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off, u_int32_t len)
+{
+
+	FAKE_COUNT_CALL(FAKE_CALL_IN6_CKSUM);
+	return (__real_in6_cksum(m, nxt, off, len));
+}
+
+u_short
+counted_fast_in_cksum_skip(struct mbuf *m, int len, int skip)
+{
+
+	FAKE_COUNT_CALL(FAKE_CALL_IN_CKSUM_SKIP);
+	return (fast_in_cksum_skip(m, len, skip));
+}
+
+int
+counted_fast_in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off,
+    u_int32_t len)
+{
+
+	FAKE_COUNT_CALL(FAKE_CALL_IN6_CKSUM);
+	return (fast_in6_cksum(m, nxt, off, len));
+}
@@ -0,0 +1,367 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+extern "C" {
+#define _KERNEL_UT 1
+
+#include <kern_include/sys/types.h>
+#include <kern_include/sys/param.h>
+#include <kern_include/sys/systm.h>
+#include <kern_include/sys/mbuf.h>
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/ip6.h>
+
+// netinet6/in6.h only declares this for the kernel.
+int in6_cksum_pseudo(struct ip6_hdr *ip6, uint32_t len, uint8_t nxt,
+    uint16_t csum);
+}
+
+#include "fake/csum.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FAKE_CKSUM_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
+
+/*
+ * Every implementation sums a buffer as whole 32-bit words in memory order,
+ * into 64-bit accumulators that can't overflow for any buffer an mbuf can
+ * hold.  Because 2^16 is 1 modulo 0xffff, folding that sum down to 16 bits
+ * gives the same one's complement sum as adding the buffer's 16-bit words,
+ * and as that sum doesn't depend on the byte order of the words either
+ * (RFC 1071), the results are identical to the kernel's.
+ */
+
+namespace
+{
+	typedef uint64_t (*CksumBufFunc)(const uint8_t *, size_t);
+
+	// Fold a partial sum down to 16 bits, adding each carry back in.  Only
+	// a sum of zero folds to zero.
+	inline uint16_t Fold(uint64_t sum)
+	{
+		sum = (sum >> 32) + (sum & 0xffffffff);
+		sum = (sum >> 32) + (sum & 0xffffffff);
+		sum = (sum >> 16) + (sum & 0xffff);
+		sum = (sum >> 16) + (sum & 0xffff);
+		return (sum);
+	}
+
+	uint64_t CksumBufScalar(const uint8_t *p, size_t len)
+	{
+		uint64_t sum = 0;
+		uint64_t v;
+
+		while (len >= sizeof(v)) {
+			memcpy(&v, p, sizeof(v));
+			sum += (v >> 32) + (v & 0xffffffff);
+			p += sizeof(v);
+			len -= sizeof(v);
+		}
+
+		// The rest of v is zero, which pads an odd last byte out to a
+		// whole word.
+		v = 0;
+		memcpy(&v, p, len);
+		return (sum + (v >> 32) + (v & 0xffffffff));
+	}
+
+#ifdef FAKE_CKSUM_X86
+	// Each 16-byte load is widened into two vectors of 64-bit lanes, by
+	// interleaving its 32-bit words with zeroes.
+	__attribute__((target("sse2")))
+	uint64_t CksumBufSse2(const uint8_t *p, size_t len)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i acc[4] = { zero, zero, zero, zero };
+		uint64_t lanes[2];
+
+		while (len >= 32) {
+			__m128i v0 = _mm_loadu_si128((const __m128i *)p);
+			__m128i v1 = _mm_loadu_si128((const __m128i *)(p + 16));
+
+			acc[0] = _mm_add_epi64(acc[0], _mm_unpacklo_epi32(v0, zero));
+			acc[1] = _mm_add_epi64(acc[1], _mm_unpackhi_epi32(v0, zero));
+			acc[2] = _mm_add_epi64(acc[2], _mm_unpacklo_epi32(v1, zero));
+			acc[3] = _mm_add_epi64(acc[3], _mm_unpackhi_epi32(v1, zero));
+			p += 32;
+			len -= 32;
+		}
+
+		acc[0] = _mm_add_epi64(_mm_add_epi64(acc[0], acc[1]),
+		    _mm_add_epi64(acc[2], acc[3]));
+		_mm_storeu_si128((__m128i *)lanes, acc[0]);
+		return (lanes[0] + lanes[1] + CksumBufScalar(p, len));
+	}
+
+	__attribute__((target("avx2")))
+	uint64_t CksumBufAvx2(const uint8_t *p, size_t len)
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i acc[4] = { zero, zero, zero, zero };
+		uint64_t lanes[4];
+
+		while (len >= 64) {
+			__m256i v0 = _mm256_loadu_si256((const __m256i *)p);
+			__m256i v1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+
+			acc[0] = _mm256_add_epi64(acc[0],
+			    _mm256_unpacklo_epi32(v0, zero));
+			acc[1] = _mm256_add_epi64(acc[1],
+			    _mm256_unpackhi_epi32(v0, zero));
+			acc[2] = _mm256_add_epi64(acc[2],
+			    _mm256_unpacklo_epi32(v1, zero));
+			acc[3] = _mm256_add_epi64(acc[3],
+			    _mm256_unpackhi_epi32(v1, zero));
+			p += 64;
+			len -= 64;
+		}
+
+		acc[0] = _mm256_add_epi64(_mm256_add_epi64(acc[0], acc[1]),
+		    _mm256_add_epi64(acc[2], acc[3]));
+		_mm256_storeu_si256((__m256i *)lanes, acc[0]);
+		return (lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+		    CksumBufScalar(p, len));
+	}
+#endif
+
+#ifdef __aarch64__
+	// vpadalq_u32() adds pairs of 32-bit words into 64-bit lanes.
+	uint64_t CksumBufNeon(const uint8_t *p, size_t len)
+	{
+		uint64x2_t acc0 = vdupq_n_u64(0);
+		uint64x2_t acc1 = vdupq_n_u64(0);
+
+		while (len >= 32) {
+			acc0 = vpadalq_u32(acc0, vreinterpretq_u32_u8(vld1q_u8(p)));
+			acc1 = vpadalq_u32(acc1,
+			    vreinterpretq_u32_u8(vld1q_u8(p + 16)));
+			p += 32;
+			len -= 32;
+		}
+
+		return (vaddvq_u64(vaddq_u64(acc0, acc1)) +
+		    CksumBufScalar(p, len));
+	}
+#endif
+
+	CksumBufFunc GetCksumBuf(enum fake_cksum_impl impl)
+	{
+		switch (impl) {
+		case FAKE_CKSUM_SCALAR:
+			return (CksumBufScalar);
+#ifdef FAKE_CKSUM_X86
+		case FAKE_CKSUM_SSE2:
+			return (CksumBufSse2);
+		case FAKE_CKSUM_AVX2:
+			return (CksumBufAvx2);
+#endif
+#ifdef __aarch64__
+		case FAKE_CKSUM_NEON:
+			return (CksumBufNeon);
+#endif
+		default:
+			return (nullptr);
+		}
+	}
+
+	enum fake_cksum_impl GetDefaultImpl()
+	{
+		const char *name = getenv("SYSUNIT_CKSUM_IMPL");
+		int i;
+
+		if (name != nullptr) {
+			for (i = 0; i < FAKE_CKSUM_NUM_IMPLS; ++i) {
+				auto impl = static_cast<enum fake_cksum_impl>(i);
+
+				if (strcmp(name, fake_cksum_impl_name(impl)) == 0 &&
+				    fake_cksum_impl_supported(impl))
+					return (impl);
+			}
+
+			fprintf(stderr, "SYSUNIT_CKSUM_IMPL: %s is not supported "
+			    "on this CPU; using the default\n", name);
+		}
+
+		for (i = FAKE_CKSUM_NUM_IMPLS - 1; i > 0; --i) {
+			auto impl = static_cast<enum fake_cksum_impl>(i);
+
+			if (fake_cksum_impl_supported(impl))
+				return (impl);
+		}
+
+		return (FAKE_CKSUM_SCALAR);
+	}
+
+	uint64_t CksumBufResolve(const uint8_t *p, size_t len);
+
+	/*
+	 * The implementation is chosen on the first checksum rather than by a
+	 * static constructor, so that it is chosen even for checksums that
+	 * other static constructors calculate.  Benchmarks may checksum from
+	 * several threads at once, so these are atomic.
+	 */
+	std::atomic<CksumBufFunc> cksumBuf{CksumBufResolve};
+	std::atomic<enum fake_cksum_impl> cksumImpl{FAKE_CKSUM_SCALAR};
+
+	uint64_t CksumBufResolve(const uint8_t *p, size_t len)
+	{
+		fake_cksum_set_impl(GetDefaultImpl());
+		return (cksumBuf.load(std::memory_order_relaxed)(p, len));
+	}
+
+	/*
+	 * The folded sum of the len bytes of the chain that follow the first
+	 * skip bytes.
+	 */
+	uint16_t SumChain(struct mbuf *m, int len, int skip)
+	{
+		CksumBufFunc func = cksumBuf.load(std::memory_order_relaxed);
+		uint64_t sum = 0;
+		bool odd = false;
+
+		for (; skip > 0 && m != nullptr; m = m->m_next) {
+			if (m->m_len > skip)
+				break;
+			skip -= m->m_len;
+		}
+
+		for (; m != nullptr && len > 0; m = m->m_next) {
+			int mlen = std::min(m->m_len - skip, len);
+			uint16_t s;
+
+			s = Fold(func(mtod(m, const uint8_t *) + skip, mlen));
+
+			// The bytes of an mbuf that starts at an odd offset
+			// into the data are on the wrong side of every word.
+			if (odd)
+				s = __builtin_bswap16(s);
+
+			sum += s;
+			odd ^= (mlen & 1) != 0;
+			len -= mlen;
+			skip = 0;
+		}
+
+		if (len > 0)
+			printf("cksum: out of data\n");
+
+		return (Fold(sum));
+	}
+}
+
+const char *
+fake_cksum_impl_name(enum fake_cksum_impl impl)
+{
+	switch (impl) {
+	case FAKE_CKSUM_SCALAR:
+		return ("scalar");
+	case FAKE_CKSUM_SSE2:
+		return ("sse2");
+	case FAKE_CKSUM_AVX2:
+		return ("avx2");
+	case FAKE_CKSUM_NEON:
+		return ("neon");
+	case FAKE_CKSUM_NUM_IMPLS:
+		break;
+	}
+
+	return ("unknown");
+}
+
+int
+fake_cksum_impl_supported(enum fake_cksum_impl impl)
+{
+
+	if (GetCksumBuf(impl) == nullptr)
+		return (0);
+
+#ifdef FAKE_CKSUM_X86
+	__builtin_cpu_init();
+	if (impl == FAKE_CKSUM_SSE2)
+		return (__builtin_cpu_supports("sse2"));
+	if (impl == FAKE_CKSUM_AVX2)
+		return (__builtin_cpu_supports("avx2"));
+#endif
+
+	// The scalar loop runs anywhere, and every arm64 CPU has NEON.
+	return (1);
+}
+
+enum fake_cksum_impl
+fake_cksum_get_impl(void)
+{
+
+	if (cksumBuf.load() == CksumBufResolve)
+		fake_cksum_set_impl(GetDefaultImpl());
+
+	return (cksumImpl.load());
+}
+
+void
+fake_cksum_set_impl(enum fake_cksum_impl impl)
+{
+
+	if (!fake_cksum_impl_supported(impl))
+		panic("%s: %s is not supported", __func__,
+		    fake_cksum_impl_name(impl));
+
+	cksumImpl.store(impl);
+	cksumBuf.store(GetCksumBuf(impl));
+}
+
+u_short
+fast_in_cksum_skip(struct mbuf *m, int len, int skip)
+{
+
+	return (~SumChain(m, len - skip, skip) & 0xffff);
+}
+
+int
+fast_in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off, u_int32_t len)
+{
+	uint64_t sum;
+
+	if ((u_int32_t)m->m_pkthdr.len < off + len)
+		panic("%s: mbuf len (%d) < off(%u)+len(%u)", __func__,
+		    m->m_pkthdr.len, off, len);
+
+	sum = in6_cksum_pseudo(mtod(m, struct ip6_hdr *), len, nxt, 0);
+	sum += SumChain(m, len, off);
+	return (~Fold(sum) & 0xffff);
+}
@@ -0,0 +1,212 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "CksumChain.h"
+
+#include "fake/csum.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/ip6.h>
+
+// machine/in_cksum.h and netinet6/in6.h only declare these for the kernel.
+u_short in_cksum_skip(struct mbuf *m, int len, int skip);
+int in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off, u_int32_t len);
+}
+
+#include <gtest/gtest.h>
+
+#include "sysunit/TestSuite.h"
+
+#include <random>
+#include <vector>
+
+using namespace testing;
+using CksumChain::Shape;
+
+// Every implementation of the fast checksum routines must give exactly the
+// same results as the kernel's routines in in_cksum.c and in6_cksum.c.
+class FastCksumTestSuite : public SysUnit::TestSuite
+{
+public:
+	std::mt19937_64 rng;
+	std::vector<enum fake_cksum_impl> impls;
+
+	void TestCaseSetUp() override
+	{
+		rng.seed(1);
+
+		for (int i = 0; i < FAKE_CKSUM_NUM_IMPLS; ++i) {
+			auto impl = static_cast<enum fake_cksum_impl>(i);
+
+			if (fake_cksum_impl_supported(impl))
+				impls.push_back(impl);
+		}
+	}
+
+	std::vector<uint8_t> GetData(size_t len)
+	{
+		std::vector<uint8_t> data(len);
+
+		for (auto & b : data)
+			b = rng();
+		return data;
+	}
+
+	void CheckCksumSkip(struct mbuf * m, int len, int skip)
+	{
+		u_short expected = in_cksum_skip(m, len, skip);
+
+		for (auto impl : impls) {
+			SCOPED_TRACE(fake_cksum_impl_name(impl));
+
+			fake_cksum_set_impl(impl);
+			EXPECT_EQ(fast_in_cksum_skip(m, len, skip), expected);
+		}
+	}
+};
+
+TEST_F(FastCksumTestSuite, TestImpls)
+{
+	ASSERT_TRUE(fake_cksum_impl_supported(FAKE_CKSUM_SCALAR));
+	ASSERT_FALSE(fake_cksum_impl_supported(FAKE_CKSUM_NUM_IMPLS));
+
+	for (auto impl : impls) {
+		fake_cksum_set_impl(impl);
+		EXPECT_EQ(fake_cksum_get_impl(), impl);
+	}
+}
+
+TEST_F(FastCksumTestSuite, TestCksumSkip)
+{
+	const size_t lens[] = {
+		0, 1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65,
+		127, 128, 129, 1500, 4096, 9000, 65535
+	};
+
+	for (size_t len : lens) {
+		auto data = GetData(len);
+
+		for (Shape shape : CksumChain::ALL_SHAPES)
+		for (size_t align : {0, 1, 2, 3, 7}) {
+			if (shape == Shape::BYTES && len > 4096)
+				continue;
+
+			SCOPED_TRACE(testing::Message() << "len " << len << " shape "
+			    << CksumChain::GetName(shape) << " align " << align);
+
+			auto m = CksumChain::Build(data.data(), len,
+			    CksumChain::GetLayout(shape, len, align));
+
+			for (size_t skip : {0, 1, 14, 33}) {
+				if (skip > len)
+					continue;
+
+				SCOPED_TRACE(skip);
+				CheckCksumSkip(m.get(), len, skip);
+				if (skip < len)
+					CheckCksumSkip(m.get(), len - 1, skip);
+			}
+		}
+	}
+}
+
+TEST_F(FastCksumTestSuite, TestCksumSkipRandom)
+{
+	for (uint64_t seed = 1; seed <= 1000; ++seed) {
+		size_t len = rng() % 9001;
+		size_t skip = rng() % (len + 1);
+		size_t end = skip + rng() % (len - skip + 1);
+		auto data = GetData(len);
+
+		SCOPED_TRACE(testing::Message() << "seed " << seed << " len "
+		    << len << " skip " << skip << " end " << end);
+
+		auto m = CksumChain::Build(data.data(), len,
+		    CksumChain::GetLayout(Shape::RANDOM, len, 0, seed));
+		CheckCksumSkip(m.get(), end, skip);
+	}
+}
+
+// All-zero data sums to zero and all-ones data to 0xffff, which a one's
+// complement sum otherwise never gives.  Long runs of all-ones data also
+// carry out of every word of the accumulators.
+TEST_F(FastCksumTestSuite, TestCksumSkipExtremes)
+{
+	for (uint8_t fill : {0x00, 0xff})
+	for (size_t len : {1, 2, 63, 64, 65535}) {
+		std::vector<uint8_t> data(len, fill);
+
+		for (Shape shape : {Shape::CONTIGUOUS, Shape::ODD_FIRST,
+		    Shape::CLUSTERS}) {
+			SCOPED_TRACE(testing::Message() << "fill " << int(fill)
+			    << " len " << len << " shape "
+			    << CksumChain::GetName(shape));
+
+			auto m = CksumChain::Build(data.data(), len,
+			    CksumChain::GetLayout(shape, len, 0));
+			CheckCksumSkip(m.get(), len, 0);
+		}
+	}
+}
+
+TEST_F(FastCksumTestSuite, TestIn6Cksum)
+{
+	for (size_t len : {0, 1, 8, 9, 1232, 1233, 9000})
+	for (bool scoped : {false, true})
+	for (Shape shape : CksumChain::ALL_SHAPES) {
+		struct ip6_hdr ip6;
+		auto data = GetData(sizeof(ip6) + len);
+
+		SCOPED_TRACE(testing::Message() << "len " << len << " shape "
+		    << CksumChain::GetName(shape) << (scoped ? " scoped" : ""));
+
+		memcpy(&ip6, data.data(), sizeof(ip6));
+		ip6.ip6_vfc = IPV6_VERSION;
+		if (scoped) {
+			ip6.ip6_src.s6_addr[0] = 0xfe;
+			ip6.ip6_src.s6_addr[1] = 0x80;
+		}
+		memcpy(data.data(), &ip6, sizeof(ip6));
+
+		// Keep the IPv6 header contiguous, as in6_cksum() requires.
+		auto layout = CksumChain::GetLayout(shape, len, 0);
+		layout.lens.front() += sizeof(ip6);
+
+		auto m = CksumChain::Build(data.data(), data.size(), layout);
+		int expected = in6_cksum(m.get(), IPPROTO_TCP, sizeof(ip6), len);
+
+		for (auto impl : impls) {
+			SCOPED_TRACE(fake_cksum_impl_name(impl));
+
+			fake_cksum_set_impl(impl);
+			EXPECT_EQ(fast_in6_cksum(m.get(), IPPROTO_TCP, sizeof(ip6),
+			    len), expected);
+		}
+	}
+}
@@ -0,0 +1,5 @@
+
+LIB := fake_inet6
+
+SRCS := \
+	ip6_prevhdr.c \
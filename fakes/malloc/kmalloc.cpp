@@ -8,6 +8,9 @@ extern "C" {
 #include <kern_include/sys/malloc.h>
 }
 
+#include "fake/callcount.h"
+
+#include <new>
 #include <string.h>
 
 void
@@ -22,10 +25,24 @@ malloc_uninit(void *data)
 	MPASS(false);
 }
 
+/*
+ * Programs that link fake_malloc are linked with --wrap=malloc and --wrap=free
+ * (see MALLOC_WRAPFUNCS in Defaults.mk), so these also receive the malloc(3)
+ * and free(3) calls made by the statically linked userland code, such as
+ * gtest.  Memory therefore comes from libc's allocator, reached through the
+ * __real_ symbols, so that it doesn't matter which of the two allocated it.
+ */
+extern "C" void *__real_malloc(size_t size);
+extern "C" void __real_free(void *mem);
+
 extern "C" void *
 kmalloc(size_t size, struct malloc_type *mtp, int flags)
 {
-	void * mem = ::operator new(size);
+	FAKE_COUNT_CALL(FAKE_CALL_KMALLOC);
+
+	void * mem = __real_malloc(size);
+	if (mem == NULL)
+		throw std::bad_alloc();
 
 	if (flags & M_ZERO)
 		memset(mem, 0, size);
@@ -36,7 +53,9 @@ kmalloc(size_t size, struct malloc_type *mtp, int flags)
 extern "C" void
 kfree(void *mem, struct malloc_type *mtp)
 {
-	::operator delete(mem);
+	FAKE_COUNT_CALL(FAKE_CALL_KFREE);
+
+	__real_free(mem);
 }
 
 
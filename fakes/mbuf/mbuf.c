@@ -38,6 +38,7 @@
 #include <kern_include/vm/uma.h>
 #include <kern_include/vm/uma_dbg.h>
 
+#include <fake/callcount.h>
 #include <fake/mbuf.h>
 
 uma_zone_t zone_mbuf;
@@ -71,6 +72,8 @@ m_tag_delete_chain(struct mbuf *m, struct m_tag *t)
 void
 m_freem(struct mbuf *m)
 {
+	FAKE_COUNT_CALL(FAKE_CALL_M_FREEM);
+
 	while (m != NULL) {
 		m = m_free(m);
 	}
@@ -46,5 +46,6 @@ SYSCTL_ROOT_NODE(OID_AUTO, clock, CTLFLAG_RW, 0,
 #endif
 
 SYSCTL_NODE(_net, OID_AUTO,  inet,  CTLFLAG_RD, 0, "");
+SYSCTL_NODE(_net_inet, OID_AUTO,  ip,  CTLFLAG_RD, 0, "");
 SYSCTL_NODE(_net_inet, OID_AUTO,  tcp,  CTLFLAG_RD, 0, "");
 SYSCTL_NODE(_kern, OID_AUTO,  ipc,  CTLFLAG_RD, 0, "");
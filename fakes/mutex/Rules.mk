@@ -1,5 +1,5 @@
 
 LIB := fake_mutex
 
-SRCS := mutex.c
+SRCS := mutex.cpp
 
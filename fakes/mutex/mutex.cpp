@@ -10,23 +10,119 @@ extern "C" {
 #include <kern_include/sys/_mutex.h>
 }
 
+#include "fake/callcount.h"
+#include "fake/panic.h"
+
 #undef _KERNEL
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #define	mtxlock2mtx(c)	(__containerof(c, struct mtx, mtx_lock))
 
 #define MTX_UNOWNED 0
 
+// The mtx_assert() conditions, from sys/lock.h.
+#define	LA_UNLOCKED	0x00000000
+#define	LA_XLOCKED	0x00000004
+
+// The lock word holds the address of a per-thread token while the mutex is
+// owned, standing in for the kernel's curthread pointer.
+static thread_local char curthread_token;
+
+#define CURTHREAD ((uintptr_t)&curthread_token)
+
+/*
+ * While a statement passed to EXPECT_KERNEL_PANIC runs, the mutexes that this
+ * thread acquires are recorded, so that the ones that a panic leaves locked
+ * can be released.  Otherwise the next attempt to lock one would trip the
+ * recursion check, or spin forever without INVARIANTS.  Locks are only
+ * recorded while armed, to keep the common path cheap.
+ */
+static thread_local std::vector<volatile uintptr_t *> mtx_panic_held;
+static thread_local std::vector<size_t> mtx_panic_marks;
+
+static void
+mtx_panic_record(volatile uintptr_t *c)
+{
+	if (!mtx_panic_marks.empty())
+		mtx_panic_held.push_back(c);
+}
+
+static void
+mtx_panic_forget(volatile uintptr_t *c)
+{
+	auto it = std::find(mtx_panic_held.rbegin(), mtx_panic_held.rend(), c);
+
+	if (it != mtx_panic_held.rend())
+		mtx_panic_held.erase(std::next(it).base());
+}
+
+class MutexPanicCleanup : public SysUnit::PanicCleanup
+{
+public:
+	void OnArm() override
+	{
+		mtx_panic_marks.push_back(mtx_panic_held.size());
+	}
+
+	void OnDisarm() override
+	{
+		mtx_panic_marks.pop_back();
+
+		// Locks still held once the outermost statement has returned
+		// belong to the test, and are no longer tracked.
+		if (mtx_panic_marks.empty())
+			mtx_panic_held.clear();
+	}
+
+	void OnPanic() override
+	{
+		size_t mark = mtx_panic_marks.back();
+
+		mtx_panic_marks.pop_back();
+
+		for (size_t i = mark; i < mtx_panic_held.size(); ++i) {
+			volatile uintptr_t *c = mtx_panic_held[i];
+
+			if (*c == CURTHREAD)
+				__atomic_store_n(c, MTX_UNOWNED, __ATOMIC_RELEASE);
+		}
+		mtx_panic_held.resize(mark);
+		if (mtx_panic_marks.empty())
+			mtx_panic_held.clear();
+	}
+};
+
+static MutexPanicCleanup mutexPanicCleanup;
+
 extern "C" void 
 __mtx_lock_sleep(volatile uintptr_t *c, int opts, const char *file,
 	    int line)
 {
 	struct mtx *m;
+	uintptr_t expected;
+
+	FAKE_COUNT_CALL(FAKE_CALL_MTX_LOCK);
 
 	m = mtxlock2mtx(c);
 
-	ASSERT_EQ(m->mtx_lock, MTX_UNOWNED);
-	m->mtx_lock++;
+#ifdef INVARIANTS
+	ASSERT_NE(m->mtx_lock, CURTHREAD) << "Recursed on mutex at " << file
+	    << ":" << line;
+#endif
+
+	for (;;) {
+		expected = MTX_UNOWNED;
+		if (__atomic_compare_exchange_n(&m->mtx_lock, &expected,
+		    CURTHREAD, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			break;
+		std::this_thread::yield();
+	}
+
+	mtx_panic_record(c);
 }
 
 extern "C" void
@@ -35,8 +131,75 @@ __mtx_unlock_sleep(volatile uintptr_t *c, int opts, const char *file,
 {
 	struct mtx *m;
 
+	FAKE_COUNT_CALL(FAKE_CALL_MTX_UNLOCK);
+
+	m = mtxlock2mtx(c);
+
+#ifdef INVARIANTS
+	ASSERT_EQ(m->mtx_lock, CURTHREAD) << "Unlocking mutex not owned at "
+	    << file << ":" << line;
+#endif
+
+	__atomic_store_n(&m->mtx_lock, MTX_UNOWNED, __ATOMIC_RELEASE);
+	mtx_panic_forget(c);
+}
+
+extern "C" void
+_mtx_init(volatile uintptr_t *c, const char *name, const char *type, int opts)
+{
+	struct mtx *m;
+
+	m = mtxlock2mtx(c);
+	m->lock_object.lo_name = name;
+	m->lock_object.lo_flags = opts;
+	m->mtx_lock = MTX_UNOWNED;
+}
+
+extern "C" void
+_mtx_destroy(volatile uintptr_t *c)
+{
+#ifdef INVARIANTS
+	struct mtx *m;
+
+	m = mtxlock2mtx(c);
+	ASSERT_EQ(m->mtx_lock, MTX_UNOWNED) << "Destroying mutex "
+	    << m->lock_object.lo_name << " while it is owned";
+#endif
+}
+
+extern "C" int
+_mtx_trylock_flags_(volatile uintptr_t *c, int opts, const char *file,
+	    int line)
+{
+	struct mtx *m;
+	uintptr_t expected;
+
 	m = mtxlock2mtx(c);
 
-	ASSERT_NE(m->mtx_lock, MTX_UNOWNED);
-	m->mtx_lock--;
+	expected = MTX_UNOWNED;
+	if (!__atomic_compare_exchange_n(&m->mtx_lock, &expected, CURTHREAD,
+	    false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return (0);
+
+	FAKE_COUNT_CALL(FAKE_CALL_MTX_LOCK);
+	mtx_panic_record(c);
+	return (1);
+}
+
+extern "C" void
+__mtx_assert(const volatile uintptr_t *c, int what, const char *file,
+	    int line)
+{
+#ifdef INVARIANTS
+	uintptr_t owner;
+
+	owner = *c;
+	if (what & LA_XLOCKED) {
+		ASSERT_EQ(owner, CURTHREAD) << "Mutex not owned at " << file
+		    << ":" << line;
+	} else if (what == LA_UNLOCKED) {
+		ASSERT_NE(owner, CURTHREAD) << "Mutex owned at " << file
+		    << ":" << line;
+	}
+#endif
 }
@@ -0,0 +1,177 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/panic.h"
+
+extern "C" {
+#include <kern_include/sys/types.h>
+#include <kern_include/sys/param.h>
+#include <kern_include/sys/systm.h>
+#include <kern_include/sys/lock.h>
+#include <kern_include/sys/mutex.h>
+#include <kern_include/vm/uma.h>
+}
+
+#include <gtest/gtest-spi.h>
+#include <gtest/gtest.h>
+
+class KernelPanicTestSuite : public ::testing::Test
+{
+protected:
+	uma_zone_t zone;
+
+	void SetUp() override
+	{
+		zone = uma_zcreate("KernelPanicTest", 64, NULL, NULL, NULL, NULL,
+		    UMA_ALIGN_PTR, 0);
+	}
+
+	void TearDown() override
+	{
+		// uma_zdestroy() reports a failure for any item that is still
+		// allocated, including items abandoned by a recovered panic.
+		uma_zdestroy(zone);
+	}
+};
+
+static void
+AllocAndPanic(uma_zone_t zone, int count)
+{
+	int i;
+
+	for (i = 0; i < count; ++i)
+		(void)uma_zalloc(zone, M_NOWAIT);
+
+	panic("abandoned %d items", count);
+}
+
+TEST_F(KernelPanicTestSuite, TestPanicCaught)
+{
+	EXPECT_KERNEL_PANIC(panic("bad state %d", 5), "bad state 5");
+	ASSERT_KERNEL_PANIC(panic("bad state"), "^bad");
+}
+
+// KASSERTs are compiled out of the bench profile.
+#ifdef INVARIANTS
+static void
+CheckPositive(int value)
+{
+	KASSERT(value > 0, ("%s: value %d is not positive", __func__, value));
+}
+
+TEST_F(KernelPanicTestSuite, TestKassertCaught)
+{
+	EXPECT_KERNEL_PANIC(CheckPositive(-1), "value -1 is not positive");
+
+	// A KASSERT that holds must not be mistaken for a panic.
+	CheckPositive(1);
+}
+#endif
+
+TEST_F(KernelPanicTestSuite, TestNoPanic)
+{
+	EXPECT_NONFATAL_FAILURE(EXPECT_KERNEL_PANIC((void)0, "."),
+	    "it returned normally");
+}
+
+TEST_F(KernelPanicTestSuite, TestMessageMismatch)
+{
+	EXPECT_NONFATAL_FAILURE(EXPECT_KERNEL_PANIC(panic("wrong"), "right"),
+	    "panic: wrong");
+}
+
+TEST_F(KernelPanicTestSuite, TestNested)
+{
+	int inner = 0;
+
+	EXPECT_KERNEL_PANIC({
+		EXPECT_KERNEL_PANIC(panic("inner"), "inner");
+		inner++;
+		panic("outer");
+	}, "outer");
+
+	EXPECT_EQ(inner, 1);
+}
+
+TEST_F(KernelPanicTestSuite, TestAllocationsReclaimed)
+{
+	void *before, *after;
+
+	before = uma_zalloc(zone, M_NOWAIT);
+	ASSERT_NE(before, nullptr);
+
+	EXPECT_KERNEL_PANIC(AllocAndPanic(zone, 3), "abandoned 3 items");
+
+	// Only the items allocated by the panicking statement are reclaimed.
+	after = uma_zalloc(zone, M_NOWAIT);
+	ASSERT_NE(after, nullptr);
+
+	uma_zfree(zone, after);
+	uma_zfree(zone, before);
+}
+
+TEST_F(KernelPanicTestSuite, TestReclaimedItemFreed)
+{
+	void *item = NULL;
+
+	EXPECT_KERNEL_PANIC({
+		item = uma_zalloc(zone, M_NOWAIT);
+		panic("after alloc");
+	}, "after alloc");
+
+	// The test may still free an item that the panic abandoned.
+	ASSERT_NE(item, nullptr);
+	uma_zfree(zone, item);
+}
+
+static void
+LockAndPanic(struct mtx *mtx)
+{
+	mtx_lock(mtx);
+	panic("locked %s", mtx->lock_object.lo_name);
+}
+
+TEST_F(KernelPanicTestSuite, TestMutexReleased)
+{
+	struct mtx held, abandoned;
+
+	mtx_init(&held, "held", NULL, MTX_DEF);
+	mtx_init(&abandoned, "abandoned", NULL, MTX_DEF);
+
+	mtx_lock(&held);
+	EXPECT_KERNEL_PANIC(LockAndPanic(&abandoned), "locked abandoned");
+
+	// Only the mutex locked by the panicking statement is released.
+	mtx_assert(&held, MA_OWNED);
+	mtx_lock(&abandoned);
+
+	mtx_unlock(&abandoned);
+	mtx_unlock(&held);
+	mtx_destroy(&abandoned);
+	mtx_destroy(&held);
+}
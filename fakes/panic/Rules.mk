@@ -3,3 +3,12 @@ LIB := fake_panic
 
 SRCS := \
 	panic.cpp \
+
+TESTS := \
+	KernelPanic \
+
+TEST_KERNELPANIC_LIBS := \
+	fake_callcount \
+	fake_mutex \
+	fake_panic \
+	fake_uma \
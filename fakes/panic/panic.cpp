@@ -1,6 +1,13 @@
 
 #define _KERNEL_UT 1
 
+#include "fake/panic.h"
+
+#include <regex>
+#include <setjmp.h>
+#include <string>
+#include <vector>
+
 extern "C" {
 #include <kern_include/sys/types.h>
 #include <kern_include/sys/systm.h>
@@ -11,6 +18,90 @@ extern "C" {
 #include <stdarg.h>
 #include <stdlib.h>
 
+namespace
+{
+	// A point that a panic can be unwound to.  These form a stack, so
+	// EXPECT_KERNEL_PANIC can be nested.
+	struct PanicRecovery
+	{
+		jmp_buf env;
+		std::string message;
+		PanicRecovery * prev;
+	};
+
+	thread_local PanicRecovery * panicRecovery;
+
+	std::vector<SysUnit::PanicCleanup *> & GetCleanupList()
+	{
+		static std::vector<SysUnit::PanicCleanup *> cleanupList;
+
+		return cleanupList;
+	}
+
+	std::string FormatMessage(const char *fmt, va_list ap)
+	{
+		va_list copy;
+
+		va_copy(copy, ap);
+		int len = vsnprintf(NULL, 0, fmt, copy);
+		va_end(copy);
+
+		if (len < 0)
+			return fmt;
+
+		std::string message(len + 1, '\0');
+		vsnprintf(&message[0], message.size(), fmt, ap);
+		message.resize(len);
+		return message;
+	}
+}
+
+namespace SysUnit
+{
+	PanicCleanup::PanicCleanup()
+	{
+		GetCleanupList().push_back(this);
+	}
+
+	namespace internal
+	{
+		testing::AssertionResult CheckKernelPanic(
+		    const std::function<void()> & statement, const char * regex,
+		    const char * statementText)
+		{
+			PanicRecovery recovery;
+
+			recovery.prev = panicRecovery;
+			panicRecovery = &recovery;
+			for (auto * cleanup : GetCleanupList())
+				cleanup->OnArm();
+
+			if (setjmp(recovery.env) == 0) {
+				statement();
+
+				panicRecovery = recovery.prev;
+				for (auto * cleanup : GetCleanupList())
+					cleanup->OnDisarm();
+
+				return testing::AssertionFailure()
+				    << "Expected: " << statementText << " panics\n"
+				    << "  Actual: it returned normally";
+			}
+
+			// vpanic() has already popped the recovery point and
+			// run the cleanup hooks.
+			if (!std::regex_search(recovery.message,
+			    std::regex(regex, std::regex::extended)))
+				return testing::AssertionFailure()
+				    << "Expected: " << statementText
+				    << " panics with a message matching \"" << regex << "\"\n"
+				    << "  Actual: panic: " << recovery.message;
+
+			return testing::AssertionSuccess();
+		}
+	}
+}
+
 void
 kassert_panic(const char *fmt, ...)
 {
@@ -32,7 +123,19 @@ panic(const char *fmt, ...)
 void
 vpanic(const char *fmt, va_list ap)
 {
+	PanicRecovery * recovery = panicRecovery;
+
+	if (recovery != NULL) {
+		panicRecovery = recovery->prev;
+		recovery->message = FormatMessage(fmt, ap);
+
+		for (auto * cleanup : GetCleanupList())
+			cleanup->OnPanic();
+
+		longjmp(recovery->env, 1);
+	}
+
 	fprintf(stderr, "panic: ");
 	vfprintf(stderr, fmt, ap);
 	abort();
-}
\ No newline at end of file
+}
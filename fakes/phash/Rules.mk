@@ -3,3 +3,5 @@ LIB := fake_phash
 
 SRCS := \
 	subr_hash.c \
+	counted_hash.c \
+	jenkins_hash.c \
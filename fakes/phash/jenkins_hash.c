@@ -0,0 +1 @@
+../../freebsd/sys/libkern/jenkins_hash.c
\ No newline at end of file
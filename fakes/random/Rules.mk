@@ -0,0 +1,5 @@
+
+LIB := fake_random
+
+SRCS := \
+	arc4random.cpp \
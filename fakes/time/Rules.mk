@@ -0,0 +1,7 @@
+
+LIB := fake_time
+
+SRCS := \
+	microtime.cpp \
+	timeval.cpp \
+
@@ -0,0 +1 @@
+../../mock/time/timeval.cpp
\ No newline at end of file
@@ -2,13 +2,37 @@
 extern "C" {
 #define _KERNEL_UT 1
 #include <kern_include/sys/types.h>
+#include <kern_include/sys/queue.h>
 #include <kern_include/sys/systm.h>
+#include <kern_include/sys/malloc.h>
 #include <kern_include/vm/uma.h>
 #include <kern_include/vm/uma_dbg.h>
 }
 
+#include "fake/callcount.h"
+#include "fake/panic.h"
+#include "fake/uma.h"
+
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+ * Every item is preceded by a header that links it into its zone's list of
+ * allocated items.  Items are appended in allocation order, so the items
+ * allocated since a given point in time always form a suffix of the list.
+ */
+struct alignas(16) uma_item
+{
+	TAILQ_ENTRY(uma_item) link;
+	uint64_t seq;
+	bool reclaimed;
+};
+
+TAILQ_HEAD(uma_item_list, uma_item);
+
 struct uma_zone
 {
 	const char *name;
@@ -17,12 +41,88 @@ struct uma_zone
 	uma_dtor dtor;
 	uma_init init;
 	uma_fini fini;
+	LIST_ENTRY(uma_zone) link;
+
+	/*
+	 * Zones may be shared by multiple threads (e.g. by a multi-queue
+	 * benchmark), so the allocation state is protected by a lock.
+	 */
+	std::mutex lock;
 	size_t alloced;
+	size_t max;
+	struct uma_item_list items;
+	struct uma_item_list reclaimed;
 };
 
+static std::mutex uma_zones_lock;
+static LIST_HEAD(, uma_zone) uma_zones = LIST_HEAD_INITIALIZER(uma_zones);
+static std::atomic<uint64_t> uma_alloc_seq;
+
+/*
+ * With INVARIANTS, every item is followed by a redzone that is checked for
+ * overflows when the item is freed.
+ */
+#ifdef INVARIANTS
 static const char overflow_pattern[] = "sysunit redzone";
 
 static const size_t OVERFLOW_PATTERN_SIZE = sizeof(overflow_pattern);
+#else
+static const size_t OVERFLOW_PATTERN_SIZE = 0;
+#endif
+
+static struct uma_item *
+mem_to_item(void *mem)
+{
+	return (reinterpret_cast<struct uma_item *>(mem) - 1);
+}
+
+/*
+ * When EXPECT_KERNEL_PANIC recovers from a panic, the items that were
+ * allocated while the panicking statement ran are moved onto the zone's
+ * reclaimed list.  They no longer count as allocated, so they are not
+ * reported as leaks, but they remain valid until the zone is destroyed in
+ * case the test still holds pointers to them.
+ */
+static thread_local std::vector<uint64_t> uma_panic_marks;
+
+class UmaPanicCleanup : public SysUnit::PanicCleanup
+{
+public:
+	void OnArm() override
+	{
+		uma_panic_marks.push_back(uma_alloc_seq);
+	}
+
+	void OnDisarm() override
+	{
+		uma_panic_marks.pop_back();
+	}
+
+	void OnPanic() override
+	{
+		struct uma_zone *zone;
+		struct uma_item *item;
+		uint64_t mark;
+
+		mark = uma_panic_marks.back();
+		uma_panic_marks.pop_back();
+
+		std::lock_guard<std::mutex> zonesGuard(uma_zones_lock);
+		LIST_FOREACH(zone, &uma_zones, link) {
+			std::lock_guard<std::mutex> guard(zone->lock);
+
+			while ((item = TAILQ_LAST(&zone->items, uma_item_list)) != NULL &&
+			    item->seq >= mark) {
+				TAILQ_REMOVE(&zone->items, item, link);
+				TAILQ_INSERT_TAIL(&zone->reclaimed, item, link);
+				item->reclaimed = true;
+				zone->alloced--;
+			}
+		}
+	}
+};
+
+static UmaPanicCleanup umaPanicCleanup;
 
 uma_zone_t
 uma_zcreate(const char *name, size_t size, uma_ctor ctor,
@@ -38,6 +138,12 @@ uma_zcreate(const char *name, size_t size, uma_ctor ctor,
 	zone->init = uminit;
 	zone->fini = fini;
 	zone->alloced = 0;
+	zone->max = 0;
+	TAILQ_INIT(&zone->items);
+	TAILQ_INIT(&zone->reclaimed);
+
+	std::lock_guard<std::mutex> guard(uma_zones_lock);
+	LIST_INSERT_HEAD(&uma_zones, zone, link);
 
 	return (zone);
 }
@@ -45,10 +151,23 @@ uma_zcreate(const char *name, size_t size, uma_ctor ctor,
 void
 uma_zdestroy(uma_zone_t zone)
 {
+	struct uma_item *item;
+
 	EXPECT_EQ(zone->alloced, 0) << "Leaked memory from uma zone " << zone->name;
+
+	while ((item = TAILQ_FIRST(&zone->reclaimed)) != NULL) {
+		TAILQ_REMOVE(&zone->reclaimed, item, link);
+		::operator delete(item);
+	}
+
+	uma_zones_lock.lock();
+	LIST_REMOVE(zone, link);
+	uma_zones_lock.unlock();
+
 	delete zone;
 }
 
+#ifdef INVARIANTS
 static void
 fill_redzone(void *mem, size_t objSize)
 {
@@ -70,15 +189,43 @@ verify_redzone(uma_zone_t zone, void *mem)
 		    "Found memory corruption following allocation from zone " << zone->name;
 	}
 }
+#endif
 
 void *
 uma_zalloc_arg(uma_zone_t zone, void * arg, int flags)
 {
-	void * mem = ::operator new(zone->size + OVERFLOW_PATTERN_SIZE);
-	if (mem == NULL)
-		return (NULL);
+	FAKE_COUNT_CALL(FAKE_CALL_UMA_ZALLOC);
+
+	struct uma_item * item = static_cast<struct uma_item *>(
+	    ::operator new(sizeof(*item) + zone->size + OVERFLOW_PATTERN_SIZE));
+
+	item->reclaimed = false;
+
+	/*
+	 * A zone at its limit fails M_NOWAIT allocations, as the real one
+	 * does.  The real one would sleep on an M_WAITOK allocation until
+	 * another thread freed an item, which the fake doesn't support.  The
+	 * limit is checked in the same critical section that accounts for
+	 * the new item, so that concurrent allocations can't overshoot it.
+	 */
+	zone->lock.lock();
+	if (zone->max != 0 && zone->alloced >= zone->max) {
+		zone->lock.unlock();
+		::operator delete(item);
+		if (flags & M_NOWAIT)
+			return (NULL);
+		panic("M_WAITOK allocation from uma zone %s, which is at its limit of %zu items",
+		    zone->name, zone->max);
+	}
+	item->seq = uma_alloc_seq++;
+	TAILQ_INSERT_TAIL(&zone->items, item, link);
+	zone->alloced++;
+	zone->lock.unlock();
 
+	void * mem = item + 1;
+#ifdef INVARIANTS
 	fill_redzone(mem, zone->size);
+#endif
 
 	if (zone->init != NULL)
 		zone->init(mem, zone->size, flags);
@@ -86,17 +233,28 @@ uma_zalloc_arg(uma_zone_t zone, void * arg, int flags)
 	if (zone->ctor != NULL)
 		zone->ctor(mem, zone->size, arg, flags);
 
-	zone->alloced++;
-
 	return (mem);
 }
 
 void
 uma_zfree_arg(uma_zone_t zone, void *mem, void *arg)
 {
-	EXPECT_GT(zone->alloced, 0) << "Unexpected uma_zfree_arg call on uma zone "
-	   << zone-> name << " (possibly due to double free)";
-	zone->alloced--;
+	FAKE_COUNT_CALL(FAKE_CALL_UMA_ZFREE);
+
+	struct uma_item * item = mem_to_item(mem);
+
+	zone->lock.lock();
+	if (item->reclaimed) {
+		TAILQ_REMOVE(&zone->reclaimed, item, link);
+	} else {
+#ifdef INVARIANTS
+		EXPECT_GT(zone->alloced, 0) << "Unexpected uma_zfree_arg call on uma zone "
+		   << zone-> name << " (possibly due to double free)";
+#endif
+		zone->alloced--;
+		TAILQ_REMOVE(&zone->items, item, link);
+	}
+	zone->lock.unlock();
 
 	if (zone->dtor != NULL)
 		zone->dtor(mem, zone->size, arg);
@@ -104,9 +262,55 @@ uma_zfree_arg(uma_zone_t zone, void *mem, void *arg)
 	if (zone->fini != NULL)
 		zone->fini(mem, zone->size);
 
+#ifdef INVARIANTS
 	verify_redzone(zone, mem);
+#endif
+
+	::operator delete(item);
+}
+
+int
+uma_zone_set_max(uma_zone_t zone, int nitems)
+{
+	std::lock_guard<std::mutex> guard(zone->lock);
+
+	zone->max = nitems;
+	return (nitems);
+}
+
+int
+uma_zone_get_max(uma_zone_t zone)
+{
+	std::lock_guard<std::mutex> guard(zone->lock);
+
+	return (zone->max);
+}
+
+int
+uma_zone_get_cur(uma_zone_t zone)
+{
+	std::lock_guard<std::mutex> guard(zone->lock);
+
+	return (zone->alloced);
+}
+
+void
+uma_zone_set_warning(uma_zone_t zone, const char *warning)
+{
+}
+
+uma_zone_t
+fake_uma_find_zone(const char *name)
+{
+	struct uma_zone *zone;
+
+	std::lock_guard<std::mutex> guard(uma_zones_lock);
+	LIST_FOREACH(zone, &uma_zones, link) {
+		if (strcmp(zone->name, name) == 0)
+			return (zone);
+	}
 
-	::operator delete(mem);
+	return (NULL);
 }
 
 static const uint32_t uma_junk = 0xdeadc0de;
@@ -0,0 +1,78 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FAKE_CALL_COUNTS_H
+#define FAKE_CALL_COUNTS_H
+
+#include "fake/callcount.h"
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <stdint.h>
+
+namespace SysUnit
+{
+	// A snapshot of the number of calls made to each fake kernel API,
+	// summed over every thread.
+	struct CallCounts
+	{
+		std::array<uint64_t, FAKE_NUM_CALLS> calls{};
+
+		// The number of calls from each call site.  Only filled in
+		// while call site tracking is enabled.
+		std::array<std::map<const void *, uint64_t>, FAKE_NUM_CALLS> sites;
+
+		uint64_t operator[](fake_call call) const
+		{
+			return calls[call];
+		}
+	};
+
+	// Counters are reset when the Initializers are set up, so by default
+	// the counts cover a single test or benchmark repetition.
+	CallCounts GetCallCounts();
+
+	// Counts are kept per thread and are not synchronized with the threads
+	// that update them, so this should only be called while the code
+	// under test is idle.
+	void ResetCallCounts();
+
+	// Recording call sites requires a map lookup on every call, so it
+	// is disabled by default.
+	void TrackCallSites(bool enable);
+
+	// Print the number of calls to every API that was called, and per
+	// item averages if items is non-zero.  If the SYSUNIT_CALL_COUNTS
+	// environment variable is set, this report is printed after every
+	// test.
+	void PrintCallCounts(std::ostream & out, const CallCounts & counts,
+	    uint64_t items = 0);
+}
+
+#endif
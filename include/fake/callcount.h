@@ -0,0 +1,70 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FAKE_CALLCOUNT_H
+#define FAKE_CALLCOUNT_H
+
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/*
+ * The kernel APIs whose calls are counted by the fakes.  When adding an entry,
+ * also add its name to fake_call_name() in fakes/callcount.
+ */
+enum fake_call {
+	FAKE_CALL_UMA_ZALLOC,
+	FAKE_CALL_UMA_ZFREE,
+	FAKE_CALL_KMALLOC,
+	FAKE_CALL_KFREE,
+	FAKE_CALL_M_FREEM,
+	FAKE_CALL_MTX_LOCK,
+	FAKE_CALL_MTX_UNLOCK,
+	FAKE_CALL_GETMICROTIME,
+	FAKE_CALL_IN_CKSUM_HDR,
+	FAKE_CALL_IN_CKSUM_SKIP,
+	FAKE_CALL_IN6_CKSUM,
+	FAKE_CALL_HASHINIT,
+	FAKE_NUM_CALLS
+};
+
+const char *fake_call_name(enum fake_call call);
+
+/*
+ * Count one call of the given API, made from the given call site.  Fakes
+ * should use FAKE_COUNT_CALL(), which records the fake's return address as
+ * the call site.
+ */
+void fake_count_call(enum fake_call call, const void *site);
+
+#define FAKE_COUNT_CALL(call) \
+	fake_count_call((call), __builtin_return_address(0))
+
+__END_DECLS
+
+#endif
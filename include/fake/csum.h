@@ -0,0 +1,72 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FAKE_CSUM_H
+#define FAKE_CSUM_H
+
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+#define _KERNEL_UT 1
+#include <kern_include/sys/types.h>
+
+struct mbuf;
+
+/*
+ * fake_csum provides vectorized versions of the kernel's checksum loops,
+ * in_cksum_skip() and in6_cksum(), for programs that checksum enough data for
+ * the portable C in in_cksum.c to dominate their run time.  A program selects
+ * them with WRAPFUNCS, e.g. in_cksum_skip=fast_in_cksum_skip.  Their results
+ * are bit for bit the same as the kernel's.
+ */
+u_short fast_in_cksum_skip(struct mbuf *m, int len, int skip);
+int fast_in6_cksum(struct mbuf *m, u_int8_t nxt, u_int32_t off,
+    u_int32_t len);
+
+/*
+ * The implementations of the inner loop that sums a buffer.  By default the
+ * last one that the CPU supports is used; setting SYSUNIT_CKSUM_IMPL in the
+ * environment to the name of an implementation overrides that.
+ */
+enum fake_cksum_impl {
+	FAKE_CKSUM_SCALAR,
+	FAKE_CKSUM_SSE2,
+	FAKE_CKSUM_AVX2,
+	FAKE_CKSUM_NEON,
+	FAKE_CKSUM_NUM_IMPLS
+};
+
+const char *fake_cksum_impl_name(enum fake_cksum_impl impl);
+int fake_cksum_impl_supported(enum fake_cksum_impl impl);
+enum fake_cksum_impl fake_cksum_get_impl(void);
+void fake_cksum_set_impl(enum fake_cksum_impl impl);
+
+__END_DECLS
+
+#endif
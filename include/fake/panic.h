@@ -0,0 +1,91 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef FAKE_PANIC_H
+#define FAKE_PANIC_H
+
+#include <gtest/gtest.h>
+
+#include <functional>
+
+namespace SysUnit
+{
+	// Fakes that track resources owned by the code under test subclass
+	// PanicCleanup so that they can clean up after a panic is recovered
+	// by EXPECT_KERNEL_PANIC.  Instances must have static storage
+	// duration, like Initializers.
+	class PanicCleanup
+	{
+	public:
+		PanicCleanup();
+		virtual ~PanicCleanup() = default;
+
+		// Called before the statement passed to EXPECT_KERNEL_PANIC
+		// is run.  Calls can be nested.
+		virtual void OnArm() = 0;
+
+		// Called after the statement returned without panicking.
+		virtual void OnDisarm() = 0;
+
+		// Called after the statement panicked, before control returns
+		// to EXPECT_KERNEL_PANIC.  Anything acquired since the matching
+		// OnArm() call may have been abandoned partway through
+		// initialization, so it should be reclaimed rather than being
+		// reported as leaked.
+		virtual void OnPanic() = 0;
+	};
+
+	namespace internal
+	{
+		testing::AssertionResult CheckKernelPanic(
+		    const std::function<void()> & statement, const char * regex,
+		    const char * statementText);
+	}
+}
+
+// Expect that statement calls panic() (including through KASSERT or MPASS)
+// with a message matching the (extended) regex.  The panic is unwound with
+// longjmp() back to this macro, so the test continues in the same process.
+// Because the unwinding skips destructors, statement should not create C++
+// objects with non-trivial destructors.
+#define SYSUNIT_TEST_KERNEL_PANIC_(statement, regex, fail) \
+	GTEST_AMBIGUOUS_ELSE_BLOCKER_ \
+	if (::testing::AssertionResult sysunit_panic_result = \
+	    ::SysUnit::internal::CheckKernelPanic([&]() { statement; }, \
+	    (regex), #statement)) \
+		; \
+	else \
+		fail(sysunit_panic_result.message())
+
+#define EXPECT_KERNEL_PANIC(statement, regex) \
+	SYSUNIT_TEST_KERNEL_PANIC_(statement, regex, GTEST_NONFATAL_FAILURE_)
+
+#define ASSERT_KERNEL_PANIC(statement, regex) \
+	SYSUNIT_TEST_KERNEL_PANIC_(statement, regex, GTEST_FATAL_FAILURE_)
+
+#endif
@@ -0,0 +1,104 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef MOCK_CAPTURE_IFNET_H
+#define MOCK_CAPTURE_IFNET_H
+
+#include <kern_include/sys/types.h>
+#include <kern_include/net/if.h>
+#include <kern_include/net/if_var.h>
+
+#include <vector>
+
+namespace SysUnit
+{
+// An ifnet that records every packet passed to if_input() instead of checking
+// it against a gmock expectation.  This allows the packets delivered by a
+// long-running test to be verified in a single pass once the test completes
+// (see pktgen/PacketStream.h).  The captured mbufs are freed when the
+// CaptureIfnet is destroyed.
+//
+// In COUNT mode packets are counted and freed immediately instead of being
+// logged, so that a benchmark can run for an arbitrary number of packets.
+class CaptureIfnet
+{
+public:
+	enum class Mode
+	{
+		LOG,
+		COUNT,
+	};
+
+private:
+	struct ifnet ifn;
+	std::vector<struct mbuf *> log;
+	Mode mode;
+	uint64_t packets;
+	uint64_t bytes;
+
+	static void IfInput(struct ifnet *, struct mbuf *);
+
+public:
+	CaptureIfnet(const char * driver, int unit, Mode mode = Mode::LOG);
+	~CaptureIfnet();
+
+	CaptureIfnet(const CaptureIfnet &) = delete;
+	CaptureIfnet & operator=(const CaptureIfnet &) = delete;
+
+	const std::vector<struct mbuf *> & GetLog() const
+	{
+		return log;
+	}
+
+	// Free all captured packets and empty the log.
+	void Clear();
+
+	uint64_t GetPacketCount() const
+	{
+		return packets;
+	}
+
+	uint64_t GetByteCount() const
+	{
+		return bytes;
+	}
+
+	void ResetCounts()
+	{
+		packets = 0;
+		bytes = 0;
+	}
+
+	struct ifnet * GetIfp()
+	{
+		return &ifn;
+	}
+};
+}
+
+#endif
@@ -0,0 +1,63 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef MOCK_ICMP6_H
+#define MOCK_ICMP6_H
+
+#include "sysunit/GlobalMock.h"
+
+struct mbuf;
+
+namespace SysUnit
+{
+// Mocks icmp6_error().  The mbuf is freed after the mock is called, as
+// icmp6_error() consumes it.
+class MockIcmp6 : public GlobalMock<MockIcmp6>
+{
+public:
+	MOCK_METHOD4(icmp6_error, void(struct mbuf *, int, int, int));
+
+	static void ExpectIcmp6Error(int type, int code)
+	{
+		EXPECT_CALL(MockObj(), icmp6_error(testing::_, type, code, testing::_))
+		  .Times(1)
+		  .RetiresOnSaturation();
+	}
+
+	// Allow any number of ICMPv6 errors of any type.  This is intended
+	// for benchmarks, where the errors are not interesting.
+	static void AllowIcmp6Error()
+	{
+		EXPECT_CALL(MockObj(), icmp6_error(testing::_, testing::_,
+		    testing::_, testing::_))
+		  .Times(testing::AnyNumber());
+	}
+};
+}
+
+#endif
@@ -45,6 +45,15 @@ public:
 		  .WillOnce(testing::SetArgPointee<0>(tv))
 		  .RetiresOnSaturation();
 	}
+
+	// Allow any number of calls to getmicrotime(), all of which will
+	// return the same time.  This is intended for long-running tests where
+	// the number of calls is not interesting.
+	static void AllowGetMicrotime(const struct timeval &tv)
+	{
+		EXPECT_CALL(MockObj(), getmicrotime(testing::_))
+		  .WillRepeatedly(testing::SetArgPointee<0>(tv));
+	}
 };
 }
 
@@ -0,0 +1,82 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_CHECKSUM_H
+#define PKTGEN_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace PktGen::internal
+{
+	// A straightforward implementation of the Internet checksum (RFC 1071),
+	// kept independent of the kernel's in_cksum so that packets generated
+	// for a test do not depend on the code under test being correct.
+	//
+	// The partial sum is accumulated over the bytes of buf taken as
+	// big-endian 16-bit words.  An odd trailing byte is padded with zero,
+	// so buffers must be added in an order that keeps every buffer but the
+	// last an even number of bytes long.
+	inline uint32_t InetChecksumAdd(uint32_t sum, const void * buf, size_t len)
+	{
+		const uint8_t * p = static_cast<const uint8_t *>(buf);
+
+		while (len > 1) {
+			sum += (p[0] << 8) | p[1];
+			sum = (sum & 0xffff) + (sum >> 16);
+			p += 2;
+			len -= 2;
+		}
+
+		if (len != 0) {
+			sum += p[0] << 8;
+			sum = (sum & 0xffff) + (sum >> 16);
+		}
+
+		return sum;
+	}
+
+	inline uint32_t InetChecksumAdd(uint32_t sum, uint32_t x)
+	{
+		sum += (x >> 16) + (x & 0xffff);
+		sum = (sum & 0xffff) + (sum >> 16);
+		return (sum & 0xffff) + (sum >> 16);
+	}
+
+	// Fold a partial sum into the value stored in a checksum field, in
+	// host byte order.
+	inline uint16_t InetChecksumFinish(uint32_t sum)
+	{
+		while (sum >> 16)
+			sum = (sum & 0xffff) + (sum >> 16);
+
+		return ~sum & 0xffff;
+	}
+}
+
+#endif
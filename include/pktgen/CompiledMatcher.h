@@ -0,0 +1,129 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_COMPILED_MATCHER_H
+#define PKTGEN_COMPILED_MATCHER_H
+
+#include "fake/mbuf.h"
+
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+
+#include <gmock/gmock-matchers.h>
+
+#include <stdint.h>
+#include <tuple>
+#include <vector>
+
+namespace PktGen::internal
+{
+	// The expected contents of a packet, flattened into a byte image and a
+	// mask of the bits in the image that the packet must match.  The mbuf
+	// header fields that the per-header matchers check are recorded in the
+	// same way.
+	struct CompiledPacket
+	{
+		std::vector<uint8_t> image;
+		std::vector<uint8_t> mask;
+
+		int csumFlags;
+		int csumMask;
+		int mbufFlags;
+		int mbufFlagsMask;
+		uint16_t vtag;
+		bool checkVtag;
+		uint8_t hashType;
+		bool checkHashType;
+		uint32_t flowid;
+		bool checkFlowid;
+
+		explicit CompiledPacket(const mbuf * m);
+
+		// Mark len bytes starting at off as not being significant.
+		void IgnoreBytes(size_t off, size_t len);
+	};
+
+	class CompiledMatcher : public testing::MatcherInterface<mbuf*>
+	{
+	private:
+		CompiledPacket packet;
+
+		// The field-by-field matcher for the same template.  This is
+		// only consulted to explain a mismatch.
+		testing::Matcher<mbuf*> detailed;
+
+		bool MatchMbufHeader(const mbuf *m) const;
+		bool MatchData(const mbuf *m) const;
+		void ExplainMismatch(const mbuf *m,
+		    testing::MatchResultListener* listener) const;
+
+	public:
+		CompiledMatcher(CompiledPacket && p,
+		    const testing::Matcher<mbuf*> & d);
+
+		virtual bool MatchAndExplain(mbuf*,
+                    testing::MatchResultListener* listener) const override;
+
+		virtual void DescribeTo(::std::ostream* os) const override;
+	};
+
+	// Returns true if (a ^ b) & mask is 0 for all len bytes.
+	bool MaskedEqual(const uint8_t *a, const uint8_t *b,
+	    const uint8_t *mask, size_t len);
+}
+
+namespace PktGen
+{
+	// Match an mbuf against a packet template, like PacketMatcher().  The
+	// template is compiled once into a byte image and a don't-care mask
+	// (covering fields such as ip_sum that the code under test is allowed
+	// to rewrite), so matching a packet is a masked compare over the mbuf
+	// chain.  The per-field explanation is only generated when the packet
+	// does not match.
+	//
+	// Unlike PacketMatcher(), the packet length must be exactly the length
+	// of the template.
+	template <typename... Headers>
+	auto CompiledPacketMatcher(const internal::PacketTemplateWrapper<Headers...> & wrapper)
+	{
+		MbufUniquePtr m(wrapper.Generate());
+		internal::CompiledPacket packet(m.get());
+
+		std::apply([&packet] (const auto &... header)
+			{
+				size_t off = 0;
+				((CompilePacketMask(header, packet, off),
+				    off += header.GetLen()), ...);
+			}, wrapper.Unwrap());
+
+		return testing::MakeMatcher(new internal::CompiledMatcher(
+		    std::move(packet), PacketMatcher(wrapper)));
+	}
+}
+
+#endif
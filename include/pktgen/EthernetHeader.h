@@ -48,6 +48,8 @@ namespace PktGen::internal
 		EtherAddr src;
 		uint16_t ethertype;
 		uint16_t mbVlan;
+		uint8_t hashType;
+		uint32_t flowid;
 		size_t outerMtu;
 		size_t localMtu;
 		size_t payloadLength;
@@ -58,11 +60,27 @@ namespace PktGen::internal
 	public:
 		const static auto LAYER = LayerVal::L2;
 
-		typedef DefaultOutwardFieldSetter OutwardFieldSetter;
+		// An Ethernet frame inside a tunnel is bridged through it.
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const EthernetTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				if constexpr (Header::LAYER == LayerVal::TUNNEL)
+					PktGen::ethertype(ETHERTYPE_TRANSETHER)(h);
+			}
+		};
+
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
 
 		EthernetTemplate()
 		  : ethertype(0),
 		    mbVlan(0),
+		    hashType(M_HASHTYPE_NONE),
+		    flowid(0),
 		    outerMtu(DEFAULT_MTU),
 		    localMtu(DEFAULT_MTU),
 		    payloadLength(0)
@@ -89,6 +107,16 @@ namespace PktGen::internal
 			return mbVlan;
 		}
 
+		uint8_t GetHashType() const
+		{
+			return hashType;
+		}
+
+		uint32_t GetFlowid() const
+		{
+			return flowid;
+		}
+
 		void SetSrc(const EtherAddr & a)
 		{
 			src = a;
@@ -109,6 +137,16 @@ namespace PktGen::internal
 			mbVlan = v;
 		}
 
+		void SetHashType(uint8_t t)
+		{
+			hashType = t;
+		}
+
+		void SetFlowid(uint32_t id)
+		{
+			flowid = id;
+		}
+
 		void FillPacket(mbuf * m, size_t offset) const
 		{
 			auto * eh = GetMbufHeader<struct ether_header>(m, offset);
@@ -121,6 +159,9 @@ namespace PktGen::internal
 				m->m_pkthdr.ether_vtag = mbVlan;
 				m->m_flags |= M_VLANTAG;
 			}
+
+			M_HASHTYPE_SET(m, hashType);
+			m->m_pkthdr.flowid = flowid;
 		}
 
 		size_t GetLen() const
@@ -177,6 +218,9 @@ namespace PktGen::internal
 			    src.GetAddr()[0], src.GetAddr()[1], src.GetAddr()[2],
 			    src.GetAddr()[3], src.GetAddr()[4], src.GetAddr()[5]);
 			PrintIndent(depth + 1, "etype : %#x", ethertype);
+			if (hashType != M_HASHTYPE_NONE)
+				PrintIndent(depth + 1, "hash : type %d flowid %#x",
+				    hashType, flowid);
 			PrintIndent(depth, "}");
 		}
 	};
@@ -37,6 +37,8 @@ struct mbuf;
 
 namespace PktGen::internal
 {
+	struct CompiledPacket;
+
 	class EthernetMatcher : public testing::MatcherInterface<mbuf*>
 	{
 	private:
@@ -56,6 +58,8 @@ namespace PktGen::internal
 	{
 		return EthernetMatcher(t, off);
 	}
+
+	void CompilePacketMask(const EthernetTemplate &, CompiledPacket &, size_t off);
 }
 
 #endif
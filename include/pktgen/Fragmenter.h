@@ -0,0 +1,463 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_FRAGMENTER_H
+#define PKTGEN_FRAGMENTER_H
+
+#include "pktgen/Ipv4Header.h"
+#include "pktgen/Ipv6ExtHeader.h"
+#include "pktgen/Layer.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PacketPayloadTemplate.h"
+
+#include <algorithm>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace PktGen::internal
+{
+	// Describes how a datagram is cut into fragments and in what order
+	// the fragments are sent.  A plan is built up with the fragment
+	// fields below and is applied by Fragment().
+	class FragmentPlan
+	{
+	public:
+		// The bytes [start, end) of the fragmentable part of the
+		// datagram.
+		struct Range
+		{
+			size_t start;
+			size_t end;
+		};
+
+	private:
+		size_t overlap;
+		size_t firstLen;
+		std::vector<size_t> duplicates;
+		std::vector<size_t> drops;
+		bool reverse;
+		std::optional<uint64_t> seed;
+		std::optional<uint32_t> id;
+
+		static size_t RoundUp(size_t x)
+		{
+			return (x + 7) & ~size_t(7);
+		}
+
+		static bool Contains(const std::vector<size_t> & list, size_t i)
+		{
+			return std::find(list.begin(), list.end(), i) != list.end();
+		}
+
+	public:
+		FragmentPlan()
+		  : overlap(0),
+		    firstLen(0),
+		    reverse(false)
+		{
+		}
+
+		void SetOverlap(size_t x)
+		{
+			overlap = RoundUp(x);
+		}
+
+		void SetFirstLen(size_t x)
+		{
+			firstLen = std::max(RoundUp(x), size_t(8));
+		}
+
+		void AddDuplicate(size_t i)
+		{
+			duplicates.push_back(i);
+		}
+
+		void AddDrop(size_t i)
+		{
+			drops.push_back(i);
+		}
+
+		void SetReverse(bool x)
+		{
+			reverse = x;
+		}
+
+		void SetSeed(uint64_t x)
+		{
+			seed = x;
+		}
+
+		const std::optional<uint32_t> & GetId() const
+		{
+			return id;
+		}
+
+		void SetId(uint32_t x)
+		{
+			id = x;
+		}
+
+		// Cut len bytes into fragments that carry at most maxData
+		// bytes each, and return them in order of their offset.
+		std::vector<Range> GetRanges(size_t len, size_t maxData) const
+		{
+			std::vector<Range> ranges;
+			size_t start = 0;
+
+			maxData &= ~size_t(7);
+			if (maxData == 0)
+				throw std::runtime_error("MTU too small to fragment");
+
+			while (true) {
+				size_t fragLen = maxData;
+				if (ranges.empty() && firstLen != 0)
+					fragLen = std::min(firstLen, maxData);
+
+				size_t end = std::min(start + fragLen, len);
+				ranges.push_back({start, end});
+				if (end == len)
+					break;
+
+				if (end - start <= overlap)
+					throw std::runtime_error("Fragment overlap too large");
+				start = end - overlap;
+			}
+
+			return ranges;
+		}
+
+		// Returns the indices into the list returned by GetRanges()
+		// of the fragments to send, in the order that they are sent.
+		std::vector<size_t> GetOrder(size_t count) const
+		{
+			std::vector<size_t> order;
+
+			for (auto i : duplicates) {
+				if (i >= count)
+					throw std::runtime_error("Duplicated fragment does not exist");
+			}
+			for (auto i : drops) {
+				if (i >= count)
+					throw std::runtime_error("Dropped fragment does not exist");
+			}
+
+			for (size_t i = 0; i < count; ++i) {
+				if (Contains(drops, i))
+					continue;
+
+				order.push_back(i);
+				if (Contains(duplicates, i))
+					order.push_back(i);
+			}
+
+			if (reverse)
+				std::reverse(order.begin(), order.end());
+
+			// std::shuffle() and the standard distributions are
+			// implementation-defined, so shuffle by hand to get
+			// the same order from every standard library.
+			if (seed) {
+				std::mt19937_64 rng(*seed);
+
+				for (size_t i = order.size(); i > 1; --i)
+					std::swap(order[i - 1], order[rng() % i]);
+			}
+
+			return order;
+		}
+	};
+
+	// The index of the outermost L3 header of a template.
+	template <typename Tuple, std::size_t Index = 0>
+	constexpr std::size_t FindFragmentedLayer()
+	{
+		if constexpr (Index == std::tuple_size_v<Tuple>) {
+			static_assert(Index != std::tuple_size_v<Tuple>,
+			    "Only IP packets can be fragmented");
+			return Index;
+		} else if constexpr (std::tuple_element_t<Index, Tuple>::LAYER == LayerVal::L3)
+			return Index;
+		else
+			return FindFragmentedLayer<Tuple, Index + 1>();
+	}
+
+	// The index of the last header of the unfragmentable part of a
+	// datagram, given the index of its IP header.  Extension headers that
+	// immediately follow the IP header are treated as unfragmentable and
+	// are repeated in every fragment.
+	template <typename Tuple, std::size_t Index>
+	constexpr std::size_t FindUnfragmentableEnd()
+	{
+		if constexpr (Index + 1 < std::tuple_size_v<Tuple>) {
+			if constexpr (std::tuple_element_t<Index + 1, Tuple>::LAYER == LayerVal::EXTENSION)
+				return FindUnfragmentableEnd<Tuple, Index + 1>();
+			else
+				return Index;
+		} else
+			return Index;
+	}
+
+	template <std::size_t... Indices, typename... Headers>
+	auto FragmentPrefixImpl(std::index_sequence<Indices...>,
+	    const std::tuple<Headers...> & headers)
+	{
+		return std::make_tuple(std::get<Indices>(headers)...);
+	}
+
+	template <std::size_t... Indices, typename... Headers>
+	size_t FragmentPrefixLenImpl(std::index_sequence<Indices...>,
+	    const std::tuple<Headers...> & headers)
+	{
+		return (std::get<Indices>(headers).GetLen() + ... + 0);
+	}
+
+	// Build the template of a single fragment: the unfragmentable
+	// headers of the datagram (followed by an IPv6 fragment header), and
+	// then the raw bytes of the fragment.
+	template <std::size_t Unfragmentable, typename... Headers>
+	auto MakeFragment(const std::tuple<Headers...> & headers, uint32_t id,
+	    const FragmentPlan::Range & range, PayloadVector && data, bool more)
+	{
+		typedef std::tuple<Headers...> Tuple;
+		constexpr std::size_t l3 = FindFragmentedLayer<Tuple>();
+		typedef std::tuple_element_t<l3, Tuple> L3Template;
+
+		auto prefix = FragmentPrefixImpl(
+		    std::make_index_sequence<Unfragmentable + 1>(), headers);
+		PayloadTemplate payload;
+		PktGen::payload(std::move(data))(payload);
+
+		if constexpr (L3Template::GetIpProto() == IPPROTO_IPV4) {
+			auto & ip = std::get<l3>(prefix);
+			uint16_t flags = ip.GetOff() & ~(IP_MF | IP_OFFMASK);
+
+			ip.SetOff(flags | (range.start / 8));
+			ip.SetMoreFragments(more);
+			return PacketTemplateWrapper(std::tuple_cat(prefix,
+			    std::make_tuple(payload)));
+		} else {
+			Ipv6ExtTemplate frag(IPPROTO_FRAGMENT);
+
+			frag.SetProto(std::get<Unfragmentable>(prefix).GetProto());
+			frag.SetOff(range.start);
+			frag.SetMoreFragments(more);
+			frag.SetId(id);
+			return PacketTemplateWrapper(std::tuple_cat(prefix,
+			    std::make_tuple(frag, payload)));
+		}
+	}
+
+	// The fragments of a datagram, in the order that they are to be
+	// sent, along with the datagram that reassembling them produces.
+	template <typename... Headers>
+	class FragmentList
+	{
+	private:
+		typedef std::tuple<Headers...> Tuple;
+		typedef PacketTemplateWrapper<Headers...> Original;
+
+		static constexpr std::size_t L3_INDEX = FindFragmentedLayer<Tuple>();
+		static constexpr std::size_t UNFRAGMENTABLE =
+		    FindUnfragmentableEnd<Tuple, L3_INDEX>();
+		static constexpr bool IS_IPV6 =
+		    std::tuple_element_t<L3_INDEX, Tuple>::GetIpProto() == IPPROTO_IPV6;
+
+		typedef decltype(MakeFragment<UNFRAGMENTABLE>(std::declval<Tuple>(),
+		    0, FragmentPlan::Range(), PayloadVector(), false)) FragmentType;
+
+		Original original;
+		size_t mtu;
+		FragmentPlan plan;
+		std::vector<FragmentType> fragments;
+
+		static Original SetIpv4Id(const Original & t, const FragmentPlan & p)
+		{
+			if constexpr (!IS_IPV6) {
+				if (p.GetId()) {
+					Tuple headers(t.Unwrap());
+
+					std::get<L3_INDEX>(headers).SetId(*p.GetId());
+					return Original(headers);
+				}
+			}
+
+			return t;
+		}
+
+	public:
+		typedef typename std::vector<FragmentType>::const_iterator const_iterator;
+
+		FragmentList(const Original & t, size_t fragMtu, const FragmentPlan & p)
+		  : original(SetIpv4Id(t, p)),
+		    mtu(fragMtu),
+		    plan(p)
+		{
+			const auto & headers = original.Unwrap();
+			auto m = original.Generate();
+			size_t hdrLen = FragmentPrefixLenImpl(
+			    std::make_index_sequence<UNFRAGMENTABLE + 1>(), headers);
+			size_t ipLen = FragmentPrefixLenImpl(
+			    std::make_index_sequence<L3_INDEX>(), headers);
+			size_t dataLen = m->m_len - hdrLen;
+			const uint8_t * data = GetMbufHeader<uint8_t>(m, hdrLen);
+
+			// The length of the IP header and the unfragmentable
+			// extension headers.
+			ipLen = hdrLen - ipLen;
+			if (IS_IPV6)
+				ipLen += sizeof(struct ip6_frag);
+			if (mtu <= ipLen)
+				throw std::runtime_error("MTU too small to fragment");
+
+			auto ranges = plan.GetRanges(dataLen, mtu - ipLen);
+			uint32_t id = plan.GetId().value_or(0);
+			for (auto i : plan.GetOrder(ranges.size())) {
+				const auto & r = ranges.at(i);
+
+				fragments.push_back(MakeFragment<UNFRAGMENTABLE>(
+				    headers, id, r,
+				    PayloadVector(data + r.start, data + r.end),
+				    r.end != dataLen));
+			}
+		}
+
+		size_t size() const
+		{
+			return fragments.size();
+		}
+
+		const FragmentType & at(size_t i) const
+		{
+			return fragments.at(i);
+		}
+
+		const_iterator begin() const
+		{
+			return fragments.begin();
+		}
+
+		const_iterator end() const
+		{
+			return fragments.end();
+		}
+
+		// The datagram that the receiver is expected to pass up once
+		// it has reassembled the fragments.
+		const Original & Reassembled() const
+		{
+			return original;
+		}
+
+		// The fragments of a datagram that carries the same data as
+		// this one under the next fragment id.
+		FragmentList Next() const
+		{
+			FragmentPlan next(plan);
+
+			if (next.GetId())
+				next.SetId(*next.GetId() + 1);
+			else if (IS_IPV6)
+				next.SetId(1);
+			return FragmentList(original.Retransmission(), mtu, next);
+		}
+	};
+}
+
+namespace PktGen
+{
+	// Fragment fields, passed to Fragment() to change how the datagram
+	// is fragmented.
+
+	// Each fragment after the first starts x bytes (rounded up to a
+	// multiple of 8) before the end of the previous fragment.  The
+	// overlapping bytes are identical in both fragments.
+	auto inline fragOverlap(size_t x)
+	{
+		return [x] (auto & p) { p.SetOverlap(x); };
+	}
+
+	// The first fragment carries only x bytes (rounded up to a multiple
+	// of 8), so that it can split the transport header.
+	auto inline tinyFirstFragment(size_t x = 8)
+	{
+		return [x] (auto & p) { p.SetFirstLen(x); };
+	}
+
+	// Send the i-th fragment (counting in order of offset) twice in a
+	// row.
+	auto inline duplicateFragment(size_t i)
+	{
+		return [i] (auto & p) { p.AddDuplicate(i); };
+	}
+
+	// Never send the i-th fragment, so that the datagram can never be
+	// reassembled.
+	auto inline dropFragment(size_t i)
+	{
+		return [i] (auto & p) { p.AddDrop(i); };
+	}
+
+	auto inline reverseFragments(bool x = true)
+	{
+		return [x] (auto & p) { p.SetReverse(x); };
+	}
+
+	// Send the fragments in a pseudo-random order derived from seed.
+	// The order depends only on the seed and the number of fragments.
+	auto inline shuffleFragments(uint64_t seed)
+	{
+		return [seed] (auto & p) { p.SetSeed(seed); };
+	}
+
+	// The fragment id.  For IPv4 this overrides ip_id of the template;
+	// for IPv6 it defaults to 0.
+	auto inline fragmentId(uint32_t x)
+	{
+		return [x] (auto & p) { p.SetId(x); };
+	}
+
+	// Cut an IPv4 or IPv6 datagram, including all of its upper layers,
+	// into fragments of at most mtu bytes, counted from the start of the
+	// IP header.  Every header in front of the outermost IP header is
+	// repeated in each fragment.
+	template <typename... Headers, typename... Fields>
+	auto Fragment(const internal::PacketTemplateWrapper<Headers...> & t,
+	    size_t mtu, const Fields &... f)
+	{
+		internal::FragmentPlan plan;
+
+		(f(plan), ...);
+		return internal::FragmentList<Headers...>(t, mtu, plan);
+	}
+}
+
+#endif
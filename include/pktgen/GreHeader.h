@@ -0,0 +1,256 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_GRE_HEADER_H
+#define PKTGEN_GRE_HEADER_H
+
+#include "fake/mbuf.h"
+
+extern "C" {
+#include <kern_include/sys/types.h>
+#include <kern_include/netinet/in.h>
+}
+
+#include "pktgen/Checksum.h"
+#include "pktgen/FieldPropagator.h"
+#include "pktgen/Layer.h"
+#include "pktgen/L2Fields.h"
+#include "pktgen/L3Fields.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PrintIndent.h"
+#include "pktgen/TunnelFields.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace PktGen::internal
+{
+	// The fixed part of a GRE header (RFC 2784).  The optional checksum,
+	// key and sequence number words (RFC 2890) follow it in that order.
+	struct gre_hdr
+	{
+		uint16_t flags;
+		uint16_t proto;
+	};
+
+	class GreTemplate
+	{
+	private:
+		uint16_t ethertype;
+		bool checksumPresent;
+		std::optional<uint32_t> key;
+		std::optional<uint32_t> seq;
+		size_t outerMtu;
+		size_t localMtu;
+		size_t payloadLength;
+
+		typedef GreTemplate SelfType;
+
+	public:
+		static const auto LAYER = LayerVal::TUNNEL;
+
+		static constexpr uint16_t FLAG_CHECKSUM = 0x8000;
+		static constexpr uint16_t FLAG_KEY = 0x2000;
+		static constexpr uint16_t FLAG_SEQ = 0x1000;
+
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const GreTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				proto(t.GetIpProto())(h);
+			}
+		};
+
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
+		GreTemplate()
+		  : ethertype(0),
+		    checksumPresent(false),
+		    outerMtu(DEFAULT_MTU),
+		    localMtu(DEFAULT_MTU),
+		    payloadLength(0)
+		{
+		}
+
+		uint16_t GetEthertype() const
+		{
+			return ethertype;
+		}
+
+		void SetEthertype(uint16_t t)
+		{
+			ethertype = t;
+		}
+
+		bool GetChecksumPresent() const
+		{
+			return checksumPresent;
+		}
+
+		void SetChecksumPresent(bool x)
+		{
+			checksumPresent = x;
+		}
+
+		const std::optional<uint32_t> & GetKey() const
+		{
+			return key;
+		}
+
+		void SetKey(uint32_t x)
+		{
+			key = x;
+		}
+
+		const std::optional<uint32_t> & GetSeq() const
+		{
+			return seq;
+		}
+
+		void SetSeq(uint32_t x)
+		{
+			seq = x;
+		}
+
+		uint16_t GetFlags() const
+		{
+			return (checksumPresent ? FLAG_CHECKSUM : 0) |
+			    (key ? FLAG_KEY : 0) | (seq ? FLAG_SEQ : 0);
+		}
+
+		constexpr static uint8_t GetIpProto()
+		{
+			return IPPROTO_GRE;
+		}
+
+		size_t GetLen() const
+		{
+			size_t len = sizeof(struct gre_hdr);
+
+			if (checksumPresent)
+				len += sizeof(uint32_t);
+			if (key)
+				len += sizeof(uint32_t);
+			if (seq)
+				len += sizeof(uint32_t);
+			return len;
+		}
+
+		size_t GetPayloadLength() const
+		{
+			return payloadLength;
+		}
+
+		void SetPayloadLength(size_t len)
+		{
+			payloadLength = len;
+		}
+
+		size_t GetMtu() const
+		{
+			return std::min(localMtu, outerMtu);
+		}
+
+		void SetMtu(size_t x)
+		{
+			localMtu = x;
+		}
+
+		void SetOuterMtu(size_t x)
+		{
+			outerMtu = x;
+		}
+
+		SelfType Next() const
+		{
+			SelfType copy(*this);
+
+			if (seq)
+				copy.seq = *seq + 1;
+			return copy;
+		}
+
+		SelfType Retransmission() const
+		{
+			return Next();
+		}
+
+		// The checksum covers the GRE header, with the checksum field
+		// zeroed, and the encapsulated packet.
+		uint16_t ComputeChecksum(const uint8_t * gre) const
+		{
+			size_t skip = sizeof(struct gre_hdr) + sizeof(uint32_t);
+			uint32_t sum;
+
+			sum = InetChecksumAdd(0,
+			    (uint32_t(GetFlags()) << 16) | ethertype);
+			sum = InetChecksumAdd(sum, gre + skip,
+			    GetLen() - skip + GetPayloadLength());
+			return InetChecksumFinish(sum);
+		}
+
+		void FillPacket(mbuf * m, size_t offset) const
+		{
+			auto * gre = GetMbufHeader<struct gre_hdr>(m, offset);
+			auto * opt = reinterpret_cast<uint32_t *>(gre + 1);
+
+			gre->flags = hton(GetFlags());
+			gre->proto = hton(ethertype);
+
+			uint32_t * sumWord = nullptr;
+			if (checksumPresent)
+				sumWord = opt++;
+			if (key)
+				*opt++ = hton(*key);
+			if (seq)
+				*opt++ = hton(*seq);
+
+			// The encapsulated packet has already been filled in.
+			if (sumWord != nullptr)
+				*sumWord = hton(uint32_t(ComputeChecksum(
+				    reinterpret_cast<const uint8_t *>(gre))) << 16);
+		}
+
+		void print(int depth) const
+		{
+			PrintIndent(depth, "GRE : {");
+			PrintIndent(depth + 1, "proto : %#x", ethertype);
+			if (key)
+				PrintIndent(depth + 1, "key : %u", *key);
+			if (seq)
+				PrintIndent(depth + 1, "seq : %u", *seq);
+			PrintIndent(depth, "}");
+		}
+	};
+}
+
+#endif
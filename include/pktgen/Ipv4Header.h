@@ -38,6 +38,7 @@ extern "C" {
 #include <kern_include/netinet/ip.h>
 }
 
+#include "pktgen/Checksum.h"
 #include "pktgen/FieldPropagator.h"
 #include "pktgen/Ipv4Addr.h"
 #include "pktgen/Layer.h"
@@ -47,8 +48,137 @@ extern "C" {
 #include "pktgen/PacketParsing.h"
 #include "pktgen/PrintIndent.h"
 
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 namespace PktGen::internal
 {
+	struct Ipv4SourceRoute
+	{
+		bool strict;
+		std::vector<Ipv4Addr> hops;
+	};
+
+	// An option with a type and length octet that pktgen has no typed
+	// builder for.  data does not include the type and length.
+	struct Ipv4RawOption
+	{
+		uint8_t type;
+		std::vector<uint8_t> data;
+	};
+
+	// The options carried in an IPv4 header.  The typed options are
+	// written first, in the order of the members below, followed by any
+	// raw options.  The list is padded with IPOPT_EOL to a 32-bit boundary.
+	struct Ipv4Options
+	{
+		static constexpr size_t MAX_LEN = 40;
+
+		// Offset of the first slot of a record route, source route
+		// or timestamp option, counting from 1 as ip_dooptions() does.
+		static constexpr uint8_t SLOT_OFF = 4;
+		static constexpr uint8_t TS_SLOT_OFF = 5;
+
+		std::optional<uint16_t> routerAlert;
+		std::optional<Ipv4SourceRoute> sourceRoute;
+		std::optional<uint8_t> recordRouteSlots;
+		std::optional<uint8_t> timestampSlots;
+		std::vector<Ipv4RawOption> raw;
+
+		bool Empty() const
+		{
+			return !routerAlert && !sourceRoute && !recordRouteSlots &&
+			    !timestampSlots && raw.empty();
+		}
+
+		size_t GetLen() const
+		{
+			size_t len = 0;
+
+			if (routerAlert)
+				len += 4;
+			if (sourceRoute)
+				len += 3 + sourceRoute->hops.size() * sizeof(struct in_addr);
+			if (recordRouteSlots)
+				len += 3 + *recordRouteSlots * sizeof(struct in_addr);
+			if (timestampSlots)
+				len += 4 + *timestampSlots * sizeof(uint32_t);
+			for (const auto & opt : raw)
+				len += 2 + opt.data.size();
+
+			len = (len + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+			if (len > MAX_LEN)
+				throw std::runtime_error("IPv4 options too long");
+
+			return len;
+		}
+
+		void Fill(uint8_t * opt) const
+		{
+			uint8_t * end = opt + GetLen();
+
+			if (routerAlert) {
+				*opt++ = IPOPT_RA;
+				*opt++ = 4;
+				opt = Put(opt, *routerAlert);
+			}
+
+			if (sourceRoute) {
+				*opt++ = sourceRoute->strict ? IPOPT_SSRR : IPOPT_LSRR;
+				*opt++ = 3 + sourceRoute->hops.size() * sizeof(struct in_addr);
+				*opt++ = SLOT_OFF;
+				for (const auto & hop : sourceRoute->hops) {
+					struct in_addr a = hop.GetAddr();
+					memcpy(opt, &a, sizeof(a));
+					opt += sizeof(a);
+				}
+			}
+
+			if (recordRouteSlots) {
+				size_t slotLen = *recordRouteSlots * sizeof(struct in_addr);
+
+				*opt++ = IPOPT_RR;
+				*opt++ = 3 + slotLen;
+				*opt++ = SLOT_OFF;
+				memset(opt, 0, slotLen);
+				opt += slotLen;
+			}
+
+			// Only the timestamp is recorded in each slot.
+			if (timestampSlots) {
+				size_t slotLen = *timestampSlots * sizeof(uint32_t);
+
+				*opt++ = IPOPT_TS;
+				*opt++ = 4 + slotLen;
+				*opt++ = TS_SLOT_OFF;
+				*opt++ = 0;
+				memset(opt, 0, slotLen);
+				opt += slotLen;
+			}
+
+			for (const auto & o : raw) {
+				*opt++ = o.type;
+				*opt++ = 2 + o.data.size();
+				memcpy(opt, o.data.data(), o.data.size());
+				opt += o.data.size();
+			}
+
+			memset(opt, IPOPT_EOL, end - opt);
+		}
+
+	private:
+		template <typename T>
+		static uint8_t * Put(uint8_t * opt, T x)
+		{
+			x = hton(x);
+			memcpy(opt, &x, sizeof(x));
+			return opt + sizeof(x);
+		}
+	};
+
 	class Ipv4Template
 	{
 	private:
@@ -63,6 +193,7 @@ namespace PktGen::internal
 		uint16_t checksum;
 		Ipv4Addr src;
 		Ipv4Addr dst;
+		Ipv4Options options;
 
 		size_t outerMtu;
 		size_t localMtu;
@@ -71,6 +202,18 @@ namespace PktGen::internal
 
 		typedef Ipv4Template SelfType;
 
+		// Apply a change to the options, recomputing ip_hl and ip_len
+		// so that the payload is unaffected.
+		template <typename Func>
+		void UpdateOptions(Func f)
+		{
+			size_t payLen = GetPayloadLength();
+
+			f(options);
+			headerLen = GetLen() / sizeof(uint32_t);
+			SetPayloadLength(payLen);
+		}
+
 	public:
 		static const auto LAYER = LayerVal::L3;
 
@@ -82,17 +225,23 @@ namespace PktGen::internal
 				DefaultOutwardFieldSetter setter;
 
 				setter(h, t);
-				ethertype(GetEthertype())(h);
+				if constexpr (Header::LAYER == LayerVal::L3 ||
+				    Header::LAYER == LayerVal::EXTENSION)
+					PktGen::proto(GetIpProto())(h);
+				else
+					ethertype(GetEthertype())(h);
 			}
 		};
 
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
 		Ipv4Template()
 		  : headerLen(sizeof(struct ip) / sizeof(uint32_t)),
 		    version(4),
 		    tos(0),
 		    id(0),
 		    off(0),
-		    ipLen(GetLen()),
+		    ipLen(sizeof(struct ip)),
 		    ttl(255),
 		    proto(0),
 		    checksum(0),
@@ -153,6 +302,14 @@ namespace PktGen::internal
 			off = o;
 		}
 
+		void SetMoreFragments(bool x)
+		{
+			if (x)
+				off |= IP_MF;
+			else
+				off &= ~IP_MF;
+		}
+
 		uint16_t GetIpLen() const
 		{
 			return ipLen;
@@ -208,6 +365,49 @@ namespace PktGen::internal
 			dst = a;
 		}
 
+		const Ipv4Options & GetOptions() const
+		{
+			return options;
+		}
+
+		void SetRouterAlert(uint16_t x)
+		{
+			UpdateOptions([x] (auto & o) { o.routerAlert = x; });
+		}
+
+		void SetSourceRoute(const std::vector<std::string> & hops,
+		    bool strict)
+		{
+			Ipv4SourceRoute route{strict, {}};
+
+			for (const auto & hop : hops)
+				route.hops.emplace_back(hop.c_str());
+			UpdateOptions([&route] (auto & o) { o.sourceRoute = route; });
+		}
+
+		void SetRecordRoute(uint8_t slots)
+		{
+			UpdateOptions([slots] (auto & o) { o.recordRouteSlots = slots; });
+		}
+
+		void SetIpTimestamp(uint8_t slots)
+		{
+			UpdateOptions([slots] (auto & o) { o.timestampSlots = slots; });
+		}
+
+		void AddRawOption(uint8_t type, const std::vector<uint8_t> & data)
+		{
+			UpdateOptions([&] (auto & o)
+				{
+					o.raw.push_back(Ipv4RawOption{type, data});
+				});
+		}
+
+		void ClearOptions()
+		{
+			UpdateOptions([] (auto & o) { o = Ipv4Options(); });
+		}
+
 		bool GetChecksumVerified() const
 		{
 			return checksumVerified;
@@ -260,6 +460,25 @@ namespace PktGen::internal
 			return ETHERTYPE_IP;
 		}
 
+		// The protocol number of this header when it is tunnelled
+		// directly in another IP header.
+		constexpr static uint8_t GetIpProto()
+		{
+			return IPPROTO_IPV4;
+		}
+
+		// The sum of the addresses in the pseudo-header covered by
+		// the checksum of an encapsulated transport header.
+		uint32_t GetPseudoHeaderSum() const
+		{
+			struct in_addr srcAddr = src.GetAddr();
+			struct in_addr dstAddr = dst.GetAddr();
+			uint32_t sum;
+
+			sum = InetChecksumAdd(0, &srcAddr, sizeof(srcAddr));
+			return InetChecksumAdd(sum, &dstAddr, sizeof(dstAddr));
+		}
+
 		void FillPacket(mbuf * m, size_t offset) const
 		{
 			auto * ip = GetMbufHeader<struct ip>(m, offset);
@@ -276,6 +495,7 @@ namespace PktGen::internal
 			ip->ip_sum = hton(checksum);
 			ip->ip_src = src.GetAddr();
 			ip->ip_dst = dst.GetAddr();
+			options.Fill(reinterpret_cast<uint8_t *>(ip + 1));
 
 			if (checksumVerified) {
 				m->m_pkthdr.csum_flags |= CSUM_L3_CALC;
@@ -287,7 +507,7 @@ namespace PktGen::internal
 
 		size_t GetLen() const
 		{
-			return sizeof(struct ip);
+			return sizeof(struct ip) + options.GetLen();
 		}
 
 		Ipv4Template Next() const
@@ -309,6 +529,9 @@ namespace PktGen::internal
 			PrintIndent(depth + 1, "ip_len : %d", ipLen);
 			PrintIndent(depth + 1, "hl : %d", headerLen);
 			PrintIndent(depth + 1, "id : %d", id);
+			if (!options.Empty())
+				PrintIndent(depth + 1, "options : %zd bytes",
+				    options.GetLen());
 			PrintIndent(depth, "}");
 		}
 	};
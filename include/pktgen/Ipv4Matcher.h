@@ -37,6 +37,8 @@ struct mbuf;
 
 namespace PktGen::internal
 {
+	struct CompiledPacket;
+
 	class Ipv4Matcher : public testing::MatcherInterface<mbuf*>
 	{
 	private:
@@ -56,6 +58,8 @@ namespace PktGen::internal
 	{
 		return Ipv4Matcher(t, off);
 	}
+
+	void CompilePacketMask(const Ipv4Template &, CompiledPacket &, size_t off);
 }
 
 #endif
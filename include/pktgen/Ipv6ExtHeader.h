@@ -0,0 +1,397 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_IPV6_EXT_HEADER_H
+#define PKTGEN_IPV6_EXT_HEADER_H
+
+#include "fake/mbuf.h"
+
+extern "C" {
+#include <kern_include/sys/types.h>
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/ip6.h>
+}
+
+#include "pktgen/FieldPropagator.h"
+#include "pktgen/Ipv6Addr.h"
+#include "pktgen/Layer.h"
+#include "pktgen/L3Fields.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PrintIndent.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace PktGen::internal
+{
+	// An option in a hop-by-hop or destination options header that
+	// pktgen has no typed builder for.  data does not include the type
+	// and length.
+	struct Ipv6RawOption
+	{
+		uint8_t type;
+		std::vector<uint8_t> data;
+	};
+
+	// An IPv6 extension header (RFC 8200 section 4).  The kind of header
+	// is given by its protocol number, which the template sets as the
+	// next header of whatever precedes it.  Options are laid out with
+	// the router alert first, then any raw options, padded with Pad1 or
+	// PadN to a multiple of 8 octets.
+	class Ipv6ExtTemplate
+	{
+	private:
+		uint8_t type;
+		uint8_t nxt;
+
+		// Hop-by-hop and destination options.
+		std::optional<uint16_t> routerAlert;
+		std::vector<Ipv6RawOption> rawOptions;
+
+		// Routing header.
+		uint8_t routingType;
+		std::optional<uint8_t> segmentsLeft;
+		std::vector<Ipv6Addr> route;
+
+		// Fragment header.  offlg is in host byte order.
+		uint16_t offlg;
+		uint32_t fragId;
+
+		uint32_t pseudoHeaderSum;
+		size_t outerMtu;
+		size_t localMtu;
+		size_t payloadLength;
+
+		typedef Ipv6ExtTemplate SelfType;
+
+		bool HasOptions() const
+		{
+			return type == IPPROTO_HOPOPTS || type == IPPROTO_DSTOPTS;
+		}
+
+		void CheckType(bool valid, const char * what) const
+		{
+			if (!valid)
+				throw std::runtime_error(std::string(what) +
+				    " is not valid in this extension header");
+		}
+
+		size_t GetOptionsLen() const
+		{
+			size_t len = 0;
+
+			if (routerAlert)
+				len += 4;
+			for (const auto & opt : rawOptions)
+				len += 2 + opt.data.size();
+			return len;
+		}
+
+	public:
+		static const auto LAYER = LayerVal::EXTENSION;
+
+		static constexpr uint16_t FRAG_MORE = 0x0001;
+		static constexpr uint16_t FRAG_OFF_MASK = 0xfff8;
+
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const Ipv6ExtTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				PktGen::proto(t.GetType())(h);
+			}
+		};
+
+		// Pass the pseudo-header through to the transport header, as
+		// it is formed from the enclosing IPv6 header.
+		struct InwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(const Header & h, Ipv6ExtTemplate & t) const
+			{
+				DefaultInwardFieldSetter setter;
+
+				setter(h, t);
+				if constexpr (Header::LAYER == LayerVal::L3 ||
+				    Header::LAYER == LayerVal::EXTENSION)
+					t.SetPseudoHeaderSum(h.GetPseudoHeaderSum());
+			}
+		};
+
+		explicit Ipv6ExtTemplate(uint8_t t)
+		  : type(t),
+		    nxt(IPPROTO_NONE),
+		    routingType(0),
+		    offlg(0),
+		    fragId(0),
+		    pseudoHeaderSum(0),
+		    outerMtu(DEFAULT_MTU),
+		    localMtu(DEFAULT_MTU),
+		    payloadLength(0)
+		{
+		}
+
+		uint8_t GetType() const
+		{
+			return type;
+		}
+
+		uint8_t GetProto() const
+		{
+			return nxt;
+		}
+
+		void SetProto(uint8_t x)
+		{
+			nxt = x;
+		}
+
+		const std::optional<uint16_t> & GetRouterAlert() const
+		{
+			return routerAlert;
+		}
+
+		void SetRouterAlert(uint16_t x)
+		{
+			CheckType(HasOptions(), "Router alert");
+			routerAlert = x;
+		}
+
+		void AddRawOption(uint8_t optType, const std::vector<uint8_t> & data)
+		{
+			CheckType(HasOptions(), "An option");
+			rawOptions.push_back(Ipv6RawOption{optType, data});
+		}
+
+		uint8_t GetRoutingType() const
+		{
+			return routingType;
+		}
+
+		void SetRoutingType(uint8_t x)
+		{
+			CheckType(type == IPPROTO_ROUTING, "Routing type");
+			routingType = x;
+		}
+
+		// Unless set explicitly, no segments have been visited yet.
+		uint8_t GetSegmentsLeft() const
+		{
+			return segmentsLeft.value_or(route.size());
+		}
+
+		void SetSegmentsLeft(uint8_t x)
+		{
+			CheckType(type == IPPROTO_ROUTING, "Segments left");
+			segmentsLeft = x;
+		}
+
+		const std::vector<Ipv6Addr> & GetRoute() const
+		{
+			return route;
+		}
+
+		void SetSourceRoute(const std::vector<std::string> & hops,
+		    bool strict)
+		{
+			CheckType(type == IPPROTO_ROUTING && !strict,
+			    "Source route");
+
+			route.clear();
+			for (const auto & hop : hops)
+				route.emplace_back(hop.c_str());
+		}
+
+		uint16_t GetOff() const
+		{
+			return offlg;
+		}
+
+		void SetOff(uint16_t x)
+		{
+			CheckType(type == IPPROTO_FRAGMENT, "Fragment offset");
+			offlg = x;
+		}
+
+		void SetMoreFragments(bool x)
+		{
+			CheckType(type == IPPROTO_FRAGMENT, "More fragments");
+			if (x)
+				offlg |= FRAG_MORE;
+			else
+				offlg &= ~FRAG_MORE;
+		}
+
+		uint32_t GetId() const
+		{
+			return fragId;
+		}
+
+		void SetId(uint32_t x)
+		{
+			CheckType(type == IPPROTO_FRAGMENT, "Fragment id");
+			fragId = x;
+		}
+
+		uint32_t GetPseudoHeaderSum() const
+		{
+			return pseudoHeaderSum;
+		}
+
+		void SetPseudoHeaderSum(uint32_t x)
+		{
+			pseudoHeaderSum = x;
+		}
+
+		size_t GetLen() const
+		{
+			switch (type) {
+			case IPPROTO_FRAGMENT:
+				return sizeof(struct ip6_frag);
+			case IPPROTO_ROUTING:
+				return sizeof(struct ip6_rthdr0) +
+				    route.size() * sizeof(struct in6_addr);
+			default:
+				return (2 + GetOptionsLen() + 7) & ~size_t(7);
+			}
+		}
+
+		size_t GetPayloadLength() const
+		{
+			return payloadLength;
+		}
+
+		void SetPayloadLength(size_t len)
+		{
+			payloadLength = len;
+		}
+
+		size_t GetMtu() const
+		{
+			return std::min(localMtu, outerMtu);
+		}
+
+		void SetMtu(size_t x)
+		{
+			localMtu = x;
+		}
+
+		void SetOuterMtu(size_t x)
+		{
+			outerMtu = x;
+		}
+
+		SelfType Next() const
+		{
+			return *this;
+		}
+
+		SelfType Retransmission() const
+		{
+			return *this;
+		}
+
+		// Write the options area of a hop-by-hop or destination options
+		// header, which starts after the next header and length octets.
+		void FillOptions(uint8_t * opt) const
+		{
+			uint8_t * end = opt + GetLen() - 2;
+
+			if (routerAlert) {
+				uint16_t ra = hton(*routerAlert);
+
+				*opt++ = IP6OPT_ROUTER_ALERT;
+				*opt++ = sizeof(ra);
+				memcpy(opt, &ra, sizeof(ra));
+				opt += sizeof(ra);
+			}
+
+			for (const auto & o : rawOptions) {
+				*opt++ = o.type;
+				*opt++ = o.data.size();
+				memcpy(opt, o.data.data(), o.data.size());
+				opt += o.data.size();
+			}
+
+			if (end - opt == 1) {
+				*opt = IP6OPT_PAD1;
+			} else if (opt != end) {
+				opt[0] = IP6OPT_PADN;
+				opt[1] = end - opt - 2;
+				memset(opt + 2, 0, end - opt - 2);
+			}
+		}
+
+		void FillPacket(mbuf * m, size_t offset) const
+		{
+			auto * ext = GetMbufHeader<struct ip6_ext>(m, offset);
+
+			ext->ip6e_nxt = nxt;
+			if (type == IPPROTO_FRAGMENT) {
+				auto * frag = GetMbufHeader<struct ip6_frag>(m, offset);
+
+				frag->ip6f_reserved = 0;
+				frag->ip6f_offlg = hton(offlg);
+				frag->ip6f_ident = hton(fragId);
+				return;
+			}
+
+			ext->ip6e_len = GetLen() / 8 - 1;
+			if (type == IPPROTO_ROUTING) {
+				auto * rh = GetMbufHeader<struct ip6_rthdr0>(m, offset);
+				auto * addr = reinterpret_cast<struct in6_addr *>(rh + 1);
+
+				rh->ip6r0_type = routingType;
+				rh->ip6r0_segleft = GetSegmentsLeft();
+				rh->ip6r0_reserved = 0;
+				for (const auto & hop : route)
+					*addr++ = hop.GetAddr();
+			} else {
+				FillOptions(reinterpret_cast<uint8_t *>(ext + 1));
+			}
+		}
+
+		void print(int depth) const
+		{
+			PrintIndent(depth, "IPv6 ext : {");
+			PrintIndent(depth + 1, "type : %d", type);
+			PrintIndent(depth + 1, "nxt : %d", nxt);
+			PrintIndent(depth + 1, "len : %zd", GetLen());
+			PrintIndent(depth, "}");
+		}
+	};
+}
+
+#endif
@@ -38,6 +38,7 @@ extern "C" {
 #include <kern_include/netinet/ip6.h>
 }
 
+#include "pktgen/Checksum.h"
 #include "pktgen/FieldPropagator.h"
 #include "pktgen/Ipv6Addr.h"
 #include "pktgen/Layer.h"
@@ -77,10 +78,16 @@ namespace PktGen::internal
 				DefaultOutwardFieldSetter setter;
 
 				setter(h, t);
-				ethertype(GetEthertype())(h);
+				if constexpr (Header::LAYER == LayerVal::L3 ||
+				    Header::LAYER == LayerVal::EXTENSION)
+					PktGen::proto(GetIpProto())(h);
+				else
+					ethertype(GetEthertype())(h);
 			}
 		};
 
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
 		Ipv6Template()
 		  : ipv6_version(6),
 		    ipv6_class(0),
@@ -200,6 +207,25 @@ namespace PktGen::internal
 			return ETHERTYPE_IPV6;
 		}
 
+		// The protocol number of this header when it is tunnelled
+		// directly in another IP header.
+		constexpr static uint8_t GetIpProto()
+		{
+			return IPPROTO_IPV6;
+		}
+
+		// The sum of the addresses in the pseudo-header covered by
+		// the checksum of an encapsulated transport header.
+		uint32_t GetPseudoHeaderSum() const
+		{
+			struct in6_addr srcAddr = ipv6_src.GetAddr();
+			struct in6_addr dstAddr = ipv6_dst.GetAddr();
+			uint32_t sum;
+
+			sum = InetChecksumAdd(0, &srcAddr, sizeof(srcAddr));
+			return InetChecksumAdd(sum, &dstAddr, sizeof(dstAddr));
+		}
+
 		void FillPacket(mbuf * m, size_t offset) const
 		{
 			auto * ip6 = GetMbufHeader<ip6_hdr>(m, offset);
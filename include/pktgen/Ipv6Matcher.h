@@ -37,6 +37,8 @@ struct mbuf;
 
 namespace PktGen::internal
 {
+	struct CompiledPacket;
+
 	class Ipv6Matcher : public testing::MatcherInterface<mbuf*>
 	{
 	private:
@@ -56,6 +58,8 @@ namespace PktGen::internal
 	{
 		return Ipv6Matcher(t, off);
 	}
+
+	void CompilePacketMask(const Ipv6Template &, CompiledPacket &, size_t off);
 }
 
 #endif
@@ -42,6 +42,41 @@ namespace PktGen
 	{
 		return [t] (auto & h) { h.SetMbufVlan(t); };
 	}
+
+	// Fields of an in-band 802.1Q tag.  tpid() sets the ethertype that
+	// introduces the tag; use ETHERTYPE_QINQ for the outer tag of a QinQ
+	// stack.
+	auto inline vid(uint16_t x)
+	{
+		return [x] (auto & h) { h.SetVid(x); };
+	}
+
+	auto inline pcp(uint8_t x)
+	{
+		return [x] (auto & h) { h.SetPcp(x); };
+	}
+
+	auto inline dei(bool x = true)
+	{
+		return [x] (auto & h) { h.SetDei(x); };
+	}
+
+	auto inline tpid(uint16_t x)
+	{
+		return [x] (auto & h) { h.SetTpid(x); };
+	}
+
+	// The RSS hash type (M_HASHTYPE_*) that the NIC reported for the
+	// packet, and the hash itself, which goes in m_pkthdr.flowid.
+	auto inline hashType(uint8_t t)
+	{
+		return [t] (auto & h) { h.SetHashType(t); };
+	}
+
+	auto inline flowid(uint32_t id)
+	{
+		return [id] (auto & h) { h.SetFlowid(id); };
+	}
 }
 
 #endif
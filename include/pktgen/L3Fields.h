@@ -31,6 +31,9 @@
 
 #include "pktgen/CommonFields.h"
 
+#include <string>
+#include <vector>
+
 namespace PktGen
 {
 	auto inline ipVersion(uint8_t x)
@@ -48,7 +51,7 @@ namespace PktGen
 		return [x](auto & h) { h.SetTos(x); };
 	}
 
-	auto inline id(uint16_t x)
+	auto inline id(uint32_t x)
 	{
 		return [x](auto & h) { h.SetId(x); };
 	}
@@ -66,6 +69,11 @@ namespace PktGen
 		return [x] (auto & h) { h.SetOff(x); } ;
 	}
 
+	auto inline moreFragments(bool x = true)
+	{
+		return [x] (auto & h) { h.SetMoreFragments(x); };
+	}
+
 	auto inline ttl(uint8_t x)
 	{
 		return [x](auto & h) { h.SetTtl(x); };
@@ -90,6 +98,55 @@ namespace PktGen
 	{
 		return ttl(x);
 	}
+
+	// IPv4 options, or the options of an IPv6 hop-by-hop or destination
+	// options header.
+	auto inline routerAlert(uint16_t x = 0)
+	{
+		return [x] (auto & h) { h.SetRouterAlert(x); };
+	}
+
+	auto inline ipOption(uint8_t type, std::vector<uint8_t> data)
+	{
+		return [type, data] (auto & h) { h.AddRawOption(type, data); };
+	}
+
+	auto inline recordRoute(uint8_t slots)
+	{
+		return [slots] (auto & h) { h.SetRecordRoute(slots); };
+	}
+
+	auto inline ipTimestamp(uint8_t slots)
+	{
+		return [slots] (auto & h) { h.SetIpTimestamp(slots); };
+	}
+
+	auto inline noIpOptions()
+	{
+		return [] (auto & h) { h.ClearOptions(); };
+	}
+
+	// A loose source route in IPv4, or the addresses of an IPv6 routing
+	// header.
+	auto inline sourceRoute(std::vector<std::string> hops)
+	{
+		return [hops] (auto & h) { h.SetSourceRoute(hops, false); };
+	}
+
+	auto inline strictSourceRoute(std::vector<std::string> hops)
+	{
+		return [hops] (auto & h) { h.SetSourceRoute(hops, true); };
+	}
+
+	auto inline routingType(uint8_t x)
+	{
+		return [x] (auto & h) { h.SetRoutingType(x); };
+	}
+
+	auto inline segmentsLeft(uint8_t x)
+	{
+		return [x] (auto & h) { h.SetSegmentsLeft(x); };
+	}
 }
 
 #endif
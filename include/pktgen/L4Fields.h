@@ -31,8 +31,19 @@
 
 #include "pktgen/CommonFields.h"
 
+#include <initializer_list>
+#include <stdint.h>
+#include <vector>
+
 namespace PktGen
 {
+	// A SACK block, covering sequence numbers [start, end).
+	struct TcpSackBlock
+	{
+		uint32_t start;
+		uint32_t end;
+	};
+
 	auto inline seq(uint32_t x)
 	{
 		return [x](auto & h) { h.SetSeq(x); };
@@ -72,6 +83,44 @@ namespace PktGen
 	{
 		return [x](auto & h) { h.SetUrgentPointer(x); };
 	}
+
+	auto inline mss(uint16_t x)
+	{
+		return [x](auto & h) { h.SetMss(x); };
+	}
+
+	auto inline wscale(uint8_t x)
+	{
+		return [x](auto & h) { h.SetWindowScale(x); };
+	}
+
+	auto inline sackPermitted(bool permitted = true)
+	{
+		return [permitted](auto & h) { h.SetSackPermitted(permitted); };
+	}
+
+	// Add a timestamp option.  Each call to Next() advances TSval by
+	// tsvalIncr(), which defaults to 1.
+	auto inline timestamp(uint32_t val, uint32_t ecr)
+	{
+		return [val, ecr](auto & h) { h.SetTimestamp(val, ecr); };
+	}
+
+	auto inline tsvalIncr(uint32_t x)
+	{
+		return [x](auto & h) { h.SetTsvalIncr(x); };
+	}
+
+	auto inline noTimestamp()
+	{
+		return [](auto & h) { h.ClearTimestamp(); };
+	}
+
+	auto inline sack(std::initializer_list<TcpSackBlock> blocks)
+	{
+		std::vector<TcpSackBlock> v(blocks);
+		return [v](auto & h) { h.SetSackBlocks(v); };
+	}
 }
 
 #endif
@@ -36,8 +36,11 @@ namespace PktGen::internal
 	enum class LayerVal
 	{
 		L2,
+		VLAN,
 		L3,
+		EXTENSION,
 		L4,
+		TUNNEL,
 		PAYLOAD
 	};
 
@@ -63,12 +66,21 @@ namespace PktGen
 		template <int Nesting>
 		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L2, Nesting> L2;
 
+		template <int Nesting>
+		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::VLAN, Nesting> VLAN;
+
 		template <int Nesting>
 		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L3, Nesting> L3;
 
+		template <int Nesting>
+		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::EXTENSION, Nesting> EXTENSION;
+
 		template <int Nesting>
 		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L4, Nesting> L4;
 
+		template <int Nesting>
+		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::TUNNEL, Nesting> TUNNEL;
+
 		template <int Nesting>
 		const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::PAYLOAD, Nesting> PAYLOAD;
 	}
@@ -76,17 +88,26 @@ namespace PktGen
 	namespace Layer
 	{
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L2, 1> L2;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::VLAN, 1> VLAN;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L3, 1> L3;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::EXTENSION, 1> EXTENSION;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L4, 1> L4;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::TUNNEL, 1> TUNNEL;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::PAYLOAD, 1> PAYLOAD;
 
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L2, 1> OUTER_L2;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::VLAN, 1> OUTER_VLAN;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L3, 1> OUTER_L3;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::EXTENSION, 1> OUTER_EXTENSION;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L4, 1> OUTER_L4;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::TUNNEL, 1> OUTER_TUNNEL;
 
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L2, -1> INNER_L2;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::VLAN, -1> INNER_VLAN;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L3, -1> INNER_L3;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::EXTENSION, -1> INNER_EXTENSION;
 		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::L4, -1> INNER_L4;
+		extern const PktGen::internal::LayerImpl<PktGen::internal::LayerVal::TUNNEL, -1> INNER_TUNNEL;
 	}
 }
 
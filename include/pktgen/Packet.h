@@ -37,6 +37,7 @@
 #include "pktgen/PayloadLength.h"
 
 #include <algorithm>
+#include <array>
 #include <memory>
 #include <stdio.h>
 #include <string.h>
@@ -206,7 +207,7 @@ namespace PktGen::internal
 		template <typename First, typename Second, typename...Rest>
 		static void PropagateInwards(First & first, Second & second, Rest &... rest)
 		{
-			DefaultInwardFieldSetter setter;
+			typename Second::InwardFieldSetter setter;
 			setter(first, second);
 
 			PropagateInwards(second, rest...);
@@ -233,12 +234,19 @@ namespace PktGen::internal
 			PropagateOutwardFieldSetters();
 		}
 
-		template <typename Header>
-		static void FillFromHeader(struct mbuf *m, const Header & header,
-		    size_t & offset)
+		typedef std::array<size_t, sizeof...(Headers)> OffsetArray;
+
+		// Headers are filled from the innermost outwards, so that a
+		// header whose checksum covers its payload sees the payload
+		// already in place.
+		template <std::size_t Index = sizeof...(Headers)>
+		void FillHeaders(struct mbuf *m, const OffsetArray & offsets) const
 		{
-			header.FillPacket(m, offset);
-			offset += header.GetLen();
+			if constexpr (Index > 0) {
+				std::get<Index - 1>(headers).FillPacket(m,
+				    offsets[Index - 1]);
+				FillHeaders<Index - 1>(m, offsets);
+			}
 		}
 
 	public:
@@ -276,13 +284,16 @@ namespace PktGen::internal
 			m->m_pkthdr.len = len;
 			m->m_len = len;
 
-			std::apply( [&m] (const auto &... header)
+			OffsetArray offsets;
+			std::apply( [&offsets] (const auto &... header)
 				{
-					size_t offset = 0;
-					(FillFromHeader(m.get(), header, offset), ...);
+					size_t i = 0, offset = 0;
+					((offsets[i++] = offset, offset += header.GetLen()), ...);
 				},
 				headers);
 
+			FillHeaders(m.get(), offsets);
+
 			return m;
 		}
 
@@ -78,7 +78,7 @@ namespace PktGen
 		}
 	};
 
-	auto MakePacketMatcherTupleImpl(size_t off)
+	inline auto MakePacketMatcherTupleImpl(size_t off)
 	{
 		return std::tuple<>();
 	}
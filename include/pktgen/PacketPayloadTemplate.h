@@ -36,53 +36,125 @@
 #include "pktgen/Layer.h"
 #include "pktgen/PacketParsing.h"
 #include "pktgen/PayloadLength.h"
+#include "pktgen/PayloadSource.h"
 #include "pktgen/PrintIndent.h"
 
+#include <memory>
+#include <stdexcept>
 #include <stdint.h>
 #include <vector>
 
 namespace PktGen::internal
 {
-	typedef std::vector<uint8_t> PayloadVector;
+	// A contiguous range of bytes taken from a PayloadSource.
+	struct PayloadChunk
+	{
+		std::shared_ptr<const PayloadSource> source;
+		size_t sourceOff;
+		size_t len;
+	};
 
 	class PayloadTemplate
 	{
 	private:
-		PayloadVector payload;
+		std::vector<PayloadChunk> chunks;
+		size_t payloadLen;
 		size_t outerMtu;
 		size_t localMtu;
 		size_t payloadIndex;
 
 		typedef PayloadTemplate SelfType;
 
+		// Call func(chunk, chunkOff, bufOff, len) for each piece of
+		// the range [off, off + len) of the payload, where chunkOff is
+		// the offset of the piece within the chunk's source and bufOff
+		// is the offset of the piece within the range.  Iteration
+		// stops early if func returns false.
+		template <typename Func>
+		bool ForEachPiece(size_t off, size_t len, Func func) const
+		{
+			if (off > payloadLen || len > payloadLen - off)
+				throw std::out_of_range("Access past end of payload");
+
+			size_t chunkStart = 0;
+			size_t bufOff = 0;
+
+			for (const auto & chunk : chunks) {
+				if (len == 0)
+					break;
+
+				size_t chunkEnd = chunkStart + chunk.len;
+				if (off < chunkEnd) {
+					size_t pieceOff = off - chunkStart;
+					size_t pieceLen = std::min(len, chunk.len - pieceOff);
+
+					if (!func(chunk, chunk.sourceOff + pieceOff,
+					    bufOff, pieceLen))
+						return false;
+
+					off += pieceLen;
+					bufOff += pieceLen;
+					len -= pieceLen;
+				}
+
+				chunkStart = chunkEnd;
+			}
+
+			return true;
+		}
+
 	public:
 		static const auto LAYER = LayerVal::PAYLOAD;
 
 		typedef DefaultOutwardFieldSetter OutwardFieldSetter;
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
 
 		PayloadTemplate()
-		  : outerMtu(DEFAULT_MTU),
+		  : payloadLen(0),
+		    outerMtu(DEFAULT_MTU),
 		    localMtu(DEFAULT_MTU),
 		    payloadIndex(0)
 		{
 		}
 
-		void SetPayload(const PayloadVector & p)
+		void SetPayload(const std::shared_ptr<const PayloadSource> & src,
+		    size_t off, size_t len)
 		{
-			payload = p;
+			chunks.clear();
+			payloadLen = 0;
 			payloadIndex = 0;
+
+			AppendPayload(src, off, len);
 		}
 
-		void AppendPayload(const PayloadVector & p)
+		void AppendPayload(const std::shared_ptr<const PayloadSource> & src,
+		    size_t off, size_t len)
 		{
-			for (auto ch : p)
-				payload.push_back(ch);
+			if (len == 0)
+				return;
+
+			chunks.push_back({src, off, len});
+			payloadLen += len;
 		}
 
 		void SetLength(size_t s)
 		{
-			if (s <= payload.size()) {
-				payload.resize(s);
+			if (s <= payloadLen) {
+				size_t chunkStart = 0;
+				auto it = chunks.begin();
+
+				while (it != chunks.end() && chunkStart + it->len <= s) {
+					chunkStart += it->len;
+					++it;
+				}
+
+				if (it != chunks.end() && chunkStart < s) {
+					it->len = s - chunkStart;
+					++it;
+				}
+
+				chunks.erase(it, chunks.end());
+				payloadLen = s;
 
 				if (s < payloadIndex)
 					payloadIndex = s;
@@ -99,7 +171,64 @@ namespace PktGen::internal
 				return;
 
 			size_t len = std::min(GetLen(), GetMtu());
-			memcpy(pl, &payload[payloadIndex], len);
+			Fill(pl, payloadIndex, len);
+		}
+
+		// Write len bytes of the payload, starting at payload offset
+		// off, into buf.
+		void Fill(uint8_t * buf, size_t off, size_t len) const
+		{
+			ForEachPiece(off, len,
+			    [buf] (const PayloadChunk & chunk, size_t chunkOff,
+			    size_t bufOff, size_t pieceLen)
+				{
+					chunk.source->Fill(buf + bufOff, chunkOff, pieceLen);
+					return true;
+				});
+		}
+
+		// Returns true if the len bytes at buf are the bytes of the
+		// payload starting at payload offset off.
+		bool Equal(const uint8_t * buf, size_t off, size_t len) const
+		{
+			return ForEachPiece(off, len,
+			    [buf] (const PayloadChunk & chunk, size_t chunkOff,
+			    size_t bufOff, size_t pieceLen)
+				{
+					return chunk.source->Equal(buf + bufOff,
+					    chunkOff, pieceLen);
+				});
+		}
+
+		// Returns the index of the first byte at buf that differs
+		// from the payload starting at offset off, or len if all
+		// bytes match.
+		size_t FindMismatch(const uint8_t * buf, size_t off, size_t len) const
+		{
+			size_t mismatch = len;
+
+			ForEachPiece(off, len,
+			    [buf, &mismatch] (const PayloadChunk & chunk,
+			    size_t chunkOff, size_t bufOff, size_t pieceLen)
+				{
+					size_t i = chunk.source->FindMismatch(
+					    buf + bufOff, chunkOff, pieceLen);
+					if (i == pieceLen)
+						return true;
+
+					mismatch = bufOff + i;
+					return false;
+				});
+
+			return mismatch;
+		}
+
+		uint8_t GetByte(size_t off) const
+		{
+			uint8_t byte;
+
+			Fill(&byte, off, 1);
+			return byte;
 		}
 
 		void SetPayloadLength(size_t len)
@@ -133,7 +262,7 @@ namespace PktGen::internal
 
 		size_t GetLen() const
 		{
-			return std::min(payload.size() - payloadIndex, localMtu);
+			return std::min(payloadLen - payloadIndex, localMtu);
 		}
 
 		size_t GetFillLen() const
@@ -141,9 +270,11 @@ namespace PktGen::internal
 			return std::min(GetLen(), outerMtu);
 		}
 
-		const PayloadVector & GetPayload() const
+		// The length of the entire payload stream, independent of
+		// the position of this template within it.
+		size_t GetStreamLen() const
 		{
-			return payload;
+			return payloadLen;
 		}
 
 		size_t GetStartIndex() const
@@ -169,22 +300,6 @@ namespace PktGen::internal
 			return *this;
 		}
 
-		static PayloadVector FillPayload(const std::string & str, size_t count)
-		{
-			PayloadVector p;
-
-			while (count > 0) {
-				for (auto ch : str) {
-					p.push_back(ch);
-					count--;
-					if (count == 0)
-						break;
-				}
-			}
-
-			return p;
-		}
-
 		void print(int depth) const
 		{
 			PrintIndent(depth, "Payload = {");
@@ -200,7 +315,10 @@ namespace PktGen
 {
 	auto inline payload(internal::PayloadVector && p)
 	{
-		return internal::PayloadField([p](auto & h) { h.SetPayload(p); });
+		size_t len = p.size();
+		auto src = std::make_shared<const internal::BytesSource>(p);
+
+		return internal::PayloadField([src, len](auto & h) { h.SetPayload(src, 0, len); });
 	}
 
 	auto inline payload()
@@ -210,39 +328,83 @@ namespace PktGen
 
 	auto inline payload(uint8_t byte, size_t count = 1)
 	{
-		return payload(internal::PayloadVector(count, byte));
+		auto src = std::make_shared<const internal::RepeatSource>(
+		    internal::PayloadVector(1, byte));
+
+		return internal::PayloadField([src, count](auto & h) { h.SetPayload(src, 0, count); });
 	}
 
+	// A payload of count bytes that repeats str.
 	auto inline payload(const std::string & str, size_t count)
 	{
-		return payload(internal::PayloadTemplate::FillPayload(str, count));
+		auto src = std::make_shared<const internal::RepeatSource>(
+		    internal::PatternBytes(str));
+
+		return internal::PayloadField([src, count](auto & h) { h.SetPayload(src, 0, count); });
 	}
 
 	auto inline payload(const char * p)
 	{
-		std::string str(p);
-		return payload(str, str.size());
+		return payload(internal::PatternBytes(p));
+	}
+
+	// A payload of count bytes where each byte is the low 8 bits of its
+	// offset, plus start.
+	auto inline counterPayload(size_t count, uint8_t start = 0)
+	{
+		auto src = internal::RepeatSource::Counter();
+
+		return internal::PayloadField([src, start, count](auto & h) { h.SetPayload(src, start, count); });
+	}
+
+	// A payload of count bytes where each 4-byte word holds the TCP
+	// sequence number of its first byte, starting from isn.  The payload is
+	// never materialized, so count may be arbitrarily large.
+	auto inline seqPayload(uint32_t isn, size_t count)
+	{
+		auto src = std::make_shared<const internal::SeqSource>(
+		    internal::SeqWordGenerator{isn});
+
+		return internal::PayloadField([src, count](auto & h) { h.SetPayload(src, 0, count); });
+	}
+
+	// A payload of count pseudo-random bytes, generated from seed.  The
+	// payload is never materialized, so count may be arbitrarily large.
+	auto inline randomPayload(uint64_t seed, size_t count)
+	{
+		auto src = std::make_shared<const internal::RandomSource>(
+		    internal::RandomWordGenerator{seed});
+
+		return internal::PayloadField([src, count](auto & h) { h.SetPayload(src, 0, count); });
 	}
 
 	auto inline appendPayload(internal::PayloadVector && p)
 	{
-		return internal::PayloadField([p](auto & h) { h.AppendPayload(p); });
+		size_t len = p.size();
+		auto src = std::make_shared<const internal::BytesSource>(p);
+
+		return internal::PayloadField([src, len](auto & h) { h.AppendPayload(src, 0, len); });
 	}
 
 	auto inline appendPayload(uint8_t byte, size_t count = 1)
 	{
-		return appendPayload(internal::PayloadVector(count, byte));
+		auto src = std::make_shared<const internal::RepeatSource>(
+		    internal::PayloadVector(1, byte));
+
+		return internal::PayloadField([src, count](auto & h) { h.AppendPayload(src, 0, count); });
 	}
 
 	auto inline appendPayload(const std::string & str, size_t count)
 	{
-		return appendPayload(internal::PayloadTemplate::FillPayload(str, count));
+		auto src = std::make_shared<const internal::RepeatSource>(
+		    internal::PatternBytes(str));
+
+		return internal::PayloadField([src, count](auto & h) { h.AppendPayload(src, 0, count); });
 	}
 
 	auto inline appendPayload(const char * p)
 	{
-		std::string str(p);
-		return appendPayload(str, str.size());
+		return appendPayload(internal::PatternBytes(p));
 	}
 
 	auto inline length(size_t size)
@@ -0,0 +1,160 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_PACKET_STREAM_H
+#define PKTGEN_PACKET_STREAM_H
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/PacketPayloadTemplate.h"
+
+#include <gmock/gmock-matchers.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace PktGen
+{
+	// A log of the packets delivered by the code under test, in the order
+	// that they were delivered.  The log does not own the mbufs.
+	typedef std::vector<struct mbuf *> PacketLog;
+
+	// An ordered list of the packets that a PacketLog is expected to
+	// contain.  Each packet is described by a packet template, which is
+	// compiled with CompiledPacketMatcher() so that long logs are cheap to
+	// verify.
+	class ExpectedPacketStream
+	{
+	private:
+		std::vector<testing::Matcher<mbuf*>> matchers;
+
+	public:
+		template <typename Template>
+		ExpectedPacketStream & Append(const Template & t)
+		{
+			matchers.push_back(CompiledPacketMatcher(t));
+			return *this;
+		}
+
+		// Append count packets to the stream, starting with the given
+		// template and calling Next() to generate each subsequent
+		// packet.
+		template <typename Template>
+		ExpectedPacketStream & AppendSequence(Template t, size_t count)
+		{
+			matchers.reserve(matchers.size() + count);
+			for (size_t i = 0; i < count; ++i) {
+				Append(t);
+				t = t.Next();
+			}
+
+			return *this;
+		}
+
+		size_t size() const
+		{
+			return matchers.size();
+		}
+
+		const testing::Matcher<mbuf*> & at(size_t i) const
+		{
+			return matchers.at(i);
+		}
+	};
+
+	namespace internal
+	{
+		class PacketStreamMatcher :
+		    public testing::MatcherInterface<const PacketLog &>
+		{
+		private:
+			ExpectedPacketStream expected;
+
+		public:
+			PacketStreamMatcher(const ExpectedPacketStream & e);
+
+			virtual bool MatchAndExplain(const PacketLog &,
+			    testing::MatchResultListener* listener) const override;
+
+			virtual void DescribeTo(::std::ostream* os) const override;
+		};
+
+		class PayloadStreamMatcher :
+		    public testing::MatcherInterface<const PacketLog &>
+		{
+		private:
+			PayloadTemplate stream;
+			size_t headerLen;
+
+		public:
+			PayloadStreamMatcher(const PayloadTemplate & p, size_t hdrlen);
+
+			virtual bool MatchAndExplain(const PacketLog &,
+			    testing::MatchResultListener* listener) const override;
+
+			virtual void DescribeTo(::std::ostream* os) const override;
+		};
+	}
+
+	// Match a PacketLog against the expected stream.  Each packet in the log
+	// is compared only against the expected packet at the same position, so
+	// verifying a log takes a single linear pass.  On failure the index of
+	// the first mismatching packet is reported.
+	inline testing::Matcher<const PacketLog &>
+	PacketStreamMatcher(const ExpectedPacketStream & expected)
+	{
+		return testing::MakeMatcher(new internal::PacketStreamMatcher(expected));
+	}
+
+	// Match the concatenated payloads of every packet in a PacketLog against
+	// an expected byte stream.  The first headerLen bytes of each packet are
+	// skipped.  This is intended to verify the data delivered for a single
+	// flow; use FilterPacketLog() to select the packets for the flow first.
+	template <typename... Headers>
+	testing::Matcher<const PacketLog &>
+	PayloadStreamMatcher(size_t headerLen,
+	    const internal::PacketTemplateWrapper<Headers...> & stream)
+	{
+		static_assert(sizeof...(Headers) == 1);
+
+		return testing::MakeMatcher(new internal::PayloadStreamMatcher(
+		    std::get<0>(stream.Unwrap()), headerLen));
+	}
+
+	template <typename Predicate>
+	PacketLog FilterPacketLog(const PacketLog & log, Predicate pred)
+	{
+		PacketLog filtered;
+
+		std::copy_if(log.begin(), log.end(), std::back_inserter(filtered), pred);
+		return filtered;
+	}
+}
+
+#endif
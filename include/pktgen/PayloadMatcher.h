@@ -37,15 +37,17 @@ struct mbuf;
 
 namespace PktGen::internal
 {
+	struct CompiledPacket;
+
 	class PayloadMatcher : public testing::MatcherInterface<mbuf*>
 	{
 	private:
 		PayloadTemplate payload;
 		size_t headerOffset;
 
-		bool TestPattern(mbuf *m, int hdroff, size_t mbufNumber,
-		    size_t & payloadIndex, const std::vector<uint8_t> & payloadBytes,
-		    size_t payloadLen, testing::MatchResultListener* listener) const;
+		void ExplainMismatch(const uint8_t * data, size_t mbufNumber,
+		    size_t mbIndex, size_t payIndex,
+		    testing::MatchResultListener* listener) const;
 
 	public:
 		PayloadMatcher(const PayloadTemplate & p, size_t off);
@@ -60,6 +62,8 @@ namespace PktGen::internal
 	{
 		return PayloadMatcher(pkt, off);
 	}
+
+	void CompilePacketMask(const PayloadTemplate &, CompiledPacket &, size_t off);
 }
 
 #endif
@@ -0,0 +1,351 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_PAYLOAD_SOURCE_H
+#define PKTGEN_PAYLOAD_SOURCE_H
+
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace PktGen::internal
+{
+	typedef std::vector<uint8_t> PayloadVector;
+
+	// A PayloadSource describes a stream of payload bytes.  Sources are
+	// immutable and are shared between copies of a PayloadTemplate, so
+	// copying a template never copies the payload itself.
+	class PayloadSource
+	{
+	public:
+		virtual ~PayloadSource() = default;
+
+		// Write len bytes of the stream, starting at offset off,
+		// into buf.
+		virtual void Fill(uint8_t * buf, size_t off, size_t len) const = 0;
+
+		// Returns true if the len bytes at buf are the bytes of the
+		// stream starting at offset off.
+		virtual bool Equal(const uint8_t * buf, size_t off, size_t len) const = 0;
+
+		// Returns the index of the first byte at buf that differs from
+		// the stream, or len if all bytes match.  This is only meant
+		// to be used after Equal() has failed, so it is implemented as
+		// a binary search over Equal().
+		size_t FindMismatch(const uint8_t * buf, size_t off, size_t len) const
+		{
+			size_t start = 0;
+
+			if (Equal(buf, off, len))
+				return len;
+
+			while (len > 1) {
+				size_t half = len / 2;
+
+				if (Equal(buf + start, off + start, half)) {
+					start += half;
+					len -= half;
+				} else {
+					len = half;
+				}
+			}
+
+			return start;
+		}
+	};
+
+	// A source that holds an explicit list of bytes.
+	class BytesSource : public PayloadSource
+	{
+	private:
+		PayloadVector bytes;
+
+		void CheckRange(size_t off, size_t len) const
+		{
+			if (off > bytes.size() || len > bytes.size() - off)
+				throw std::out_of_range("Read past end of payload");
+		}
+
+	public:
+		explicit BytesSource(const PayloadVector & b)
+		  : bytes(b)
+		{
+		}
+
+		size_t GetLen() const
+		{
+			return bytes.size();
+		}
+
+		void Fill(uint8_t * buf, size_t off, size_t len) const override
+		{
+			CheckRange(off, len);
+			memcpy(buf, bytes.data() + off, len);
+		}
+
+		bool Equal(const uint8_t * buf, size_t off, size_t len) const override
+		{
+			CheckRange(off, len);
+			return memcmp(buf, bytes.data() + off, len) == 0;
+		}
+	};
+
+	// A source that endlessly repeats a pattern.  The pattern is expanded
+	// into a buffer of several kilobytes, so that filling or comparing a
+	// packet takes a handful of memcpy()/memcmp() calls rather than one
+	// per repetition of the pattern.
+	class RepeatSource : public PayloadSource
+	{
+	private:
+		static const size_t MIN_EXPANDED_LEN = 4096;
+
+		PayloadVector expanded;
+		size_t patternLen;
+
+		// The number of bytes that can be handled from any phase of
+		// the pattern before we need to wrap back to the start of the
+		// expanded buffer.
+		size_t BlockLen() const
+		{
+			return expanded.size() - patternLen;
+		}
+
+	public:
+		explicit RepeatSource(const PayloadVector & pattern)
+		  : patternLen(pattern.size())
+		{
+			if (pattern.empty())
+				throw std::runtime_error("Cannot repeat an empty pattern");
+
+			size_t reps = MIN_EXPANDED_LEN / patternLen + 2;
+			expanded.reserve(reps * patternLen);
+			for (size_t i = 0; i < reps; ++i)
+				expanded.insert(expanded.end(), pattern.begin(), pattern.end());
+		}
+
+		void Fill(uint8_t * buf, size_t off, size_t len) const override
+		{
+			const uint8_t * src = &expanded[off % patternLen];
+
+			while (len > 0) {
+				size_t block = std::min(len, BlockLen());
+				memcpy(buf, src, block);
+				buf += block;
+				len -= block;
+			}
+		}
+
+		bool Equal(const uint8_t * buf, size_t off, size_t len) const override
+		{
+			const uint8_t * src = &expanded[off % patternLen];
+
+			while (len > 0) {
+				size_t block = std::min(len, BlockLen());
+				if (memcmp(buf, src, block) != 0)
+					return false;
+				buf += block;
+				len -= block;
+			}
+
+			return true;
+		}
+
+		// A source where the byte at offset i is (i % 256).
+		static std::shared_ptr<const RepeatSource> Counter()
+		{
+			static const auto counter =
+			    std::make_shared<const RepeatSource>(CounterPattern());
+			return counter;
+		}
+
+	private:
+		static PayloadVector CounterPattern()
+		{
+			PayloadVector p(256);
+
+			for (size_t i = 0; i < p.size(); ++i)
+				p[i] = i;
+			return p;
+		}
+	};
+
+	// A source where every byte is computed from its offset in the stream.
+	// The stream is a sequence of Words, and the Generator computes the
+	// word at a given word index, already in the byte order it has in the
+	// stream.  Fill() writes whole words straight into the destination and
+	// Equal() accumulates differences a block of words at a time, so that
+	// both loops can be vectorized and no part of the stream is ever held
+	// in memory.
+	template <typename Word, typename Generator>
+	class ProceduralSource : public PayloadSource
+	{
+	private:
+		static constexpr size_t WORD_LEN = sizeof(Word);
+		static constexpr size_t BLOCK_WORDS = 8;
+
+		Generator gen;
+
+		// Copy the bytes [skip, skip + len) of word w into buf.
+		void FillPartial(uint8_t * buf, size_t w, size_t skip, size_t len) const
+		{
+			Word x = gen(w);
+			memcpy(buf, reinterpret_cast<const uint8_t *>(&x) + skip, len);
+		}
+
+		bool EqualPartial(const uint8_t * buf, size_t w, size_t skip, size_t len) const
+		{
+			Word x = gen(w);
+			return memcmp(buf, reinterpret_cast<const uint8_t *>(&x) + skip, len) == 0;
+		}
+
+	public:
+		explicit ProceduralSource(const Generator & g)
+		  : gen(g)
+		{
+		}
+
+		void Fill(uint8_t * buf, size_t off, size_t len) const override
+		{
+			size_t w = off / WORD_LEN;
+			size_t skip = off % WORD_LEN;
+
+			if (skip != 0 && len > 0) {
+				size_t n = std::min(len, WORD_LEN - skip);
+				FillPartial(buf, w, skip, n);
+				buf += n;
+				len -= n;
+				w++;
+			}
+
+			size_t words = len / WORD_LEN;
+			for (size_t i = 0; i < words; ++i) {
+				Word x = gen(w + i);
+				memcpy(buf + i * WORD_LEN, &x, WORD_LEN);
+			}
+
+			if (len % WORD_LEN != 0)
+				FillPartial(buf + words * WORD_LEN, w + words, 0,
+				    len % WORD_LEN);
+		}
+
+		bool Equal(const uint8_t * buf, size_t off, size_t len) const override
+		{
+			size_t w = off / WORD_LEN;
+			size_t skip = off % WORD_LEN;
+
+			if (skip != 0 && len > 0) {
+				size_t n = std::min(len, WORD_LEN - skip);
+				if (!EqualPartial(buf, w, skip, n))
+					return false;
+				buf += n;
+				len -= n;
+				w++;
+			}
+
+			size_t words = len / WORD_LEN;
+			size_t i = 0;
+			Word diff = 0;
+
+			for (; i + BLOCK_WORDS <= words; i += BLOCK_WORDS) {
+				for (size_t j = i; j < i + BLOCK_WORDS; ++j) {
+					Word x;
+					memcpy(&x, buf + j * WORD_LEN, WORD_LEN);
+					diff |= x ^ gen(w + j);
+				}
+
+				if (diff != 0)
+					return false;
+			}
+
+			for (; i < words; ++i) {
+				Word x;
+				memcpy(&x, buf + i * WORD_LEN, WORD_LEN);
+				diff |= x ^ gen(w + i);
+			}
+
+			if (diff != 0)
+				return false;
+
+			if (len % WORD_LEN != 0)
+				return EqualPartial(buf + words * WORD_LEN, w + words,
+				    0, len % WORD_LEN);
+
+			return true;
+		}
+	};
+
+	// Each 4-byte word of the stream holds, in network byte order, the
+	// TCP sequence number of its first byte, given that the first byte
+	// of the stream has sequence number isn.  Every word in a 4GB window
+	// is unique, so a segment delivered at the wrong offset is always
+	// detected.
+	struct SeqWordGenerator
+	{
+		uint32_t isn;
+
+		uint32_t operator()(size_t w) const
+		{
+			return htonl(isn + uint32_t(w * sizeof(uint32_t)));
+		}
+	};
+
+	typedef ProceduralSource<uint32_t, SeqWordGenerator> SeqSource;
+
+	// A counter-based pseudo-random stream: each 8-byte word is the
+	// splitmix64 finalizer applied to the seed plus the word index, so any
+	// part of the stream can be generated without generating what comes
+	// before it.  Words are stored in host byte order.
+	struct RandomWordGenerator
+	{
+		uint64_t seed;
+
+		uint64_t operator()(size_t w) const
+		{
+			uint64_t z = seed + (w + 1) * 0x9e3779b97f4a7c15ULL;
+
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			return z ^ (z >> 31);
+		}
+	};
+
+	typedef ProceduralSource<uint64_t, RandomWordGenerator> RandomSource;
+
+	inline PayloadVector PatternBytes(const std::string & str)
+	{
+		return PayloadVector(str.begin(), str.end());
+	}
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_RSS_H
+#define PKTGEN_RSS_H
+
+extern "C" {
+#include <kern_include/sys/types.h>
+#include <kern_include/netinet/in.h>
+}
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace PktGen
+{
+	// Computes RSS hashes the way a NIC does, so that tests and benchmarks
+	// can steer generated flows to receive queues or stamp the hash that a
+	// NIC would have reported into m_pkthdr.flowid.
+
+	constexpr size_t RSS_KEY_LEN = 40;
+
+	// The key from Microsoft's RSS specification, which many drivers use
+	// as their default.
+	extern const uint8_t DEFAULT_RSS_KEY[RSS_KEY_LEN];
+
+	// The Toeplitz hash of data[0..len) under key.  The key must be at
+	// least 4 bytes longer than the data.
+	uint32_t ToeplitzHash(const uint8_t * key, size_t keyLen,
+	    const uint8_t * data, size_t len);
+
+	// Hashes over the address (and port) fields, in the order that NICs
+	// feed them to the hash function.  Ports are in host byte order.
+	uint32_t RssHashIpv4(struct in_addr src, struct in_addr dst,
+	    const uint8_t * key = DEFAULT_RSS_KEY);
+	uint32_t RssHashTcpIpv4(struct in_addr src, struct in_addr dst,
+	    uint16_t sport, uint16_t dport,
+	    const uint8_t * key = DEFAULT_RSS_KEY);
+	uint32_t RssHashIpv6(const struct in6_addr & src,
+	    const struct in6_addr & dst, const uint8_t * key = DEFAULT_RSS_KEY);
+	uint32_t RssHashTcpIpv6(const struct in6_addr & src,
+	    const struct in6_addr & dst, uint16_t sport, uint16_t dport,
+	    const uint8_t * key = DEFAULT_RSS_KEY);
+
+	// The hash that a NIC would compute for the Ethernet frame at
+	// frame[0..len): over the addresses and ports of TCP and UDP, over
+	// the addresses alone for other IP packets and fragments, and 0 for
+	// anything else.  VLAN tags are skipped; tunnels are not looked into.
+	uint32_t RssHashFrame(const uint8_t * frame, size_t len,
+	    const uint8_t * key = DEFAULT_RSS_KEY);
+}
+
+#endif
@@ -46,8 +46,111 @@ extern "C" {
 #include "pktgen/PacketParsing.h"
 #include "pktgen/PrintIndent.h"
 
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <stdexcept>
+#include <string.h>
+#include <vector>
+
 namespace PktGen::internal
 {
+	struct TcpTimestamp
+	{
+		uint32_t val;
+		uint32_t ecr;
+	};
+
+	// The options carried in a TCP header.  They are written in the order
+	// that the FreeBSD stack uses, with each option padded by NOPs to a
+	// 32-bit boundary, so a timestamp is always in the layout that tcp_lro
+	// recognizes.
+	struct TcpOptions
+	{
+		static constexpr size_t MAX_SACK_BLOCKS = 4;
+
+		std::optional<uint16_t> mss;
+		std::optional<uint8_t> wscale;
+		bool sackPermitted = false;
+		std::optional<TcpTimestamp> timestamp;
+		std::array<TcpSackBlock, MAX_SACK_BLOCKS> sackBlocks{};
+		size_t numSackBlocks = 0;
+
+		size_t GetLen() const
+		{
+			size_t len = 0;
+
+			if (mss)
+				len += TCPOLEN_MAXSEG;
+			if (wscale)
+				len += 1 + TCPOLEN_WINDOW;
+			if (sackPermitted)
+				len += 2 + TCPOLEN_SACK_PERMITTED;
+			if (timestamp)
+				len += TCPOLEN_TSTAMP_APPA;
+			if (numSackBlocks != 0)
+				len += 2 + TCPOLEN_SACKHDR +
+				    numSackBlocks * TCPOLEN_SACK;
+
+			if (len > MAX_TCPOPTLEN)
+				throw std::runtime_error("TCP options too long");
+
+			return len;
+		}
+
+		void Fill(uint8_t * opt) const
+		{
+			if (mss) {
+				*opt++ = TCPOPT_MAXSEG;
+				*opt++ = TCPOLEN_MAXSEG;
+				opt = Put(opt, *mss);
+			}
+
+			if (wscale) {
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_WINDOW;
+				*opt++ = TCPOLEN_WINDOW;
+				*opt++ = *wscale;
+			}
+
+			if (sackPermitted) {
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_SACK_PERMITTED;
+				*opt++ = TCPOLEN_SACK_PERMITTED;
+			}
+
+			if (timestamp) {
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_TIMESTAMP;
+				*opt++ = TCPOLEN_TIMESTAMP;
+				opt = Put(opt, timestamp->val);
+				opt = Put(opt, timestamp->ecr);
+			}
+
+			if (numSackBlocks != 0) {
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_NOP;
+				*opt++ = TCPOPT_SACK;
+				*opt++ = TCPOLEN_SACKHDR + numSackBlocks * TCPOLEN_SACK;
+				for (size_t i = 0; i < numSackBlocks; ++i) {
+					opt = Put(opt, sackBlocks[i].start);
+					opt = Put(opt, sackBlocks[i].end);
+				}
+			}
+		}
+
+	private:
+		template <typename T>
+		static uint8_t * Put(uint8_t * opt, T x)
+		{
+			x = hton(x);
+			memcpy(opt, &x, sizeof(x));
+			return opt + sizeof(x);
+		}
+	};
+
 	class TcpTemplate
 	{
 	private:
@@ -55,12 +158,13 @@ namespace PktGen::internal
 		uint16_t th_dport;
 		uint32_t th_seq;
 		uint32_t th_ack;
-		uint8_t th_off;
 		uint8_t th_x2;
 		uint8_t th_flags;
 		uint16_t th_win;
 		uint16_t th_sum;
 		uint16_t th_urp;
+		TcpOptions options;
+		uint32_t tsvalIncr;
 
 		bool checksumVerified;
 		bool checksumPassed;
@@ -90,17 +194,19 @@ namespace PktGen::internal
 			}
 		};
 
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
 		TcpTemplate()
 		  : th_sport(0),
 		    th_dport(0),
 		    th_seq(0),
 		    th_ack(0),
-		    th_off(sizeof(struct tcphdr) / sizeof(uint32_t)),
 		    th_x2(0),
 		    th_flags(TH_ACK),
 		    th_win(0),
 		    th_sum(0),
 		    th_urp(0),
+		    tsvalIncr(1),
 		    checksumVerified(false),
 		    checksumPassed(false),
 		    outerMtu(DEFAULT_MTU),
@@ -151,7 +257,7 @@ namespace PktGen::internal
 
 		uint8_t GetOff() const
 		{
-			return th_off;
+			return GetLen() / sizeof(uint32_t);
 		}
 
 		uint8_t GetX2() const
@@ -199,6 +305,51 @@ namespace PktGen::internal
 			th_urp = x;
 		}
 
+		const TcpOptions & GetOptions() const
+		{
+			return options;
+		}
+
+		void SetMss(uint16_t x)
+		{
+			options.mss = x;
+		}
+
+		void SetWindowScale(uint8_t x)
+		{
+			options.wscale = x;
+		}
+
+		void SetSackPermitted(bool x)
+		{
+			options.sackPermitted = x;
+		}
+
+		void SetTimestamp(uint32_t val, uint32_t ecr)
+		{
+			options.timestamp = TcpTimestamp{val, ecr};
+		}
+
+		void ClearTimestamp()
+		{
+			options.timestamp.reset();
+		}
+
+		void SetTsvalIncr(uint32_t x)
+		{
+			tsvalIncr = x;
+		}
+
+		void SetSackBlocks(const std::vector<TcpSackBlock> & blocks)
+		{
+			if (blocks.size() > TcpOptions::MAX_SACK_BLOCKS)
+				throw std::runtime_error("Too many SACK blocks");
+
+			std::copy(blocks.begin(), blocks.end(),
+			    options.sackBlocks.begin());
+			options.numSackBlocks = blocks.size();
+		}
+
 		bool GetChecksumVerified() const
 		{
 			return checksumVerified;
@@ -226,7 +377,7 @@ namespace PktGen::internal
 
 		size_t GetLen() const
 		{
-			return th_off * sizeof(uint32_t);
+			return sizeof(struct tcphdr) + options.GetLen();
 		}
 
 		size_t GetPayloadLength() const
@@ -258,6 +409,8 @@ namespace PktGen::internal
 		{
 			TcpTemplate copy(*this);
 			copy.SetSeq(th_seq + GetPayloadLength());
+			if (options.timestamp)
+				copy.options.timestamp->val += tsvalIncr;
 
 			return copy;
 		}
@@ -278,12 +431,13 @@ namespace PktGen::internal
 			tcp->th_ack = hton(th_ack);
 
 			tcp->th_x2 = hton(th_x2);
-			tcp->th_off = hton(th_off);
+			tcp->th_off = hton(GetOff());
 			tcp->th_flags = hton(th_flags);
 
 			tcp->th_win = hton(th_win);
 			tcp->th_sum = hton(th_sum);
 			tcp->th_urp = hton(th_urp);
+			options.Fill(reinterpret_cast<uint8_t *>(tcp + 1));
 
 			if (checksumVerified) {
 				m->m_pkthdr.csum_flags |= CSUM_L4_CALC;
@@ -298,6 +452,12 @@ namespace PktGen::internal
 			PrintIndent(depth, "TCP : {");
 			PrintIndent(depth + 1, "seq : %d", th_seq);
 			PrintIndent(depth + 1, "payloadLen : %d", GetPayloadLength());
+			if (options.timestamp)
+				PrintIndent(depth + 1, "ts : %u/%u",
+				    options.timestamp->val, options.timestamp->ecr);
+			if (options.numSackBlocks != 0)
+				PrintIndent(depth + 1, "sack blocks : %zd",
+				    options.numSackBlocks);
 			PrintIndent(depth, "}");
 		}
 	};
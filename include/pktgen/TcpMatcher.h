@@ -37,6 +37,8 @@ struct mbuf;
 
 namespace PktGen::internal
 {
+	struct CompiledPacket;
+
 	class TcpMatcher : public testing::MatcherInterface<mbuf*>
 	{
 	private:
@@ -56,6 +58,8 @@ namespace PktGen::internal
 	{
 		return TcpMatcher(t, off);
 	}
+
+	void CompilePacketMask(const TcpTemplate &, CompiledPacket &, size_t off);
 }
 
 #endif
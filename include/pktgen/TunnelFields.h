@@ -0,0 +1,73 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_TUNNEL_FIELDS_H
+#define PKTGEN_TUNNEL_FIELDS_H
+
+#include "pktgen/CommonFields.h"
+
+#include <stdint.h>
+
+namespace PktGen
+{
+	auto inline vni(uint32_t x)
+	{
+		return [x] (auto & h) { h.SetVni(x); };
+	}
+
+	// The UDP destination port that the VXLAN header is sent to.
+	auto inline vxlanPort(uint16_t x)
+	{
+		return [x] (auto & h) { h.SetUdpPort(x); };
+	}
+
+	// Whether the outer UDP source port is derived from a hash of the
+	// inner frame.  If not, the port set on the UDP header is used.
+	auto inline srcPortEntropy(bool x = true)
+	{
+		return [x] (auto & h) { h.SetSrcPortEntropy(x); };
+	}
+
+	auto inline greKey(uint32_t x)
+	{
+		return [x] (auto & h) { h.SetKey(x); };
+	}
+
+	// Add a GRE sequence number, which each call to Next() advances.
+	auto inline greSeq(uint32_t x)
+	{
+		return [x] (auto & h) { h.SetSeq(x); };
+	}
+
+	auto inline greChecksum(bool x = true)
+	{
+		return [x] (auto & h) { h.SetChecksumPresent(x); };
+	}
+}
+
+#endif
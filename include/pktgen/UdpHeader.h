@@ -0,0 +1,321 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_UDP_HEADER_H
+#define PKTGEN_UDP_HEADER_H
+
+#include "fake/mbuf.h"
+
+extern "C" {
+#include <kern_include/sys/types.h>
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/udp.h>
+}
+
+#include "pktgen/Checksum.h"
+#include "pktgen/FieldPropagator.h"
+#include "pktgen/Layer.h"
+#include "pktgen/L3Fields.h"
+#include "pktgen/L4Fields.h"
+#include "pktgen/PayloadLength.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PrintIndent.h"
+#include "pktgen/Rss.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace PktGen::internal
+{
+	class UdpTemplate
+	{
+	private:
+		uint16_t uh_sport;
+		uint16_t uh_dport;
+
+		// If set, uh_sum is written as-is; 0 sends the datagram with
+		// no checksum.  Otherwise the correct checksum is computed
+		// over the pseudo-header and the datagram.
+		std::optional<uint16_t> uh_sum;
+
+		// The sum of the addresses in the enclosing IP header,
+		// propagated inwards from it.
+		uint32_t pseudoHeaderSum;
+
+		// If set, the source port is taken from the hash of the frame
+		// that starts this far into the payload, as a tunnel endpoint
+		// does to give the outer header some of the inner flow's
+		// entropy (RFC 7348 section 5).
+		std::optional<size_t> entropyOffset;
+
+		bool checksumVerified;
+		bool checksumPassed;
+		size_t outerMtu;
+		size_t localMtu;
+		size_t payloadLength;
+
+		typedef UdpTemplate SelfType;
+
+		static constexpr uint64_t ENTROPY_PORT_MIN = 49152;
+		static constexpr uint64_t ENTROPY_PORT_MAX = 65535;
+
+		size_t GetMaxPayload() const
+		{
+			return GetMtu() - GetLen();
+		}
+
+	public:
+		static const auto LAYER = LayerVal::L4;
+
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const UdpTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				proto(t.GetIpProto())(h);
+			}
+		};
+
+		struct InwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(const Header & h, UdpTemplate & t) const
+			{
+				DefaultInwardFieldSetter setter;
+
+				setter(h, t);
+				if constexpr (Header::LAYER == LayerVal::L3 ||
+				    Header::LAYER == LayerVal::EXTENSION)
+					t.SetPseudoHeaderSum(h.GetPseudoHeaderSum());
+			}
+		};
+
+		UdpTemplate()
+		  : uh_sport(0),
+		    uh_dport(0),
+		    pseudoHeaderSum(0),
+		    checksumVerified(false),
+		    checksumPassed(false),
+		    outerMtu(DEFAULT_MTU),
+		    localMtu(DEFAULT_MTU),
+		    payloadLength(0)
+		{
+		}
+
+		uint16_t GetSrcPort() const
+		{
+			return uh_sport;
+		}
+
+		// The source port of a datagram with the given payload.
+		uint16_t GetSrcPort(const uint8_t * payload) const
+		{
+			if (!entropyOffset)
+				return uh_sport;
+
+			size_t off = std::min(*entropyOffset, GetPayloadLength());
+			uint64_t hash = RssHashFrame(payload + off,
+			    GetPayloadLength() - off);
+
+			return ENTROPY_PORT_MIN +
+			    ((hash * (ENTROPY_PORT_MAX - ENTROPY_PORT_MIN)) >> 32);
+		}
+
+		void SetSrcPortEntropy(std::optional<size_t> off)
+		{
+			entropyOffset = off;
+		}
+
+		void SetSrc(uint16_t x)
+		{
+			uh_sport = x;
+		}
+
+		uint16_t GetDstPort() const
+		{
+			return uh_dport;
+		}
+
+		void SetDst(uint16_t x)
+		{
+			uh_dport = x;
+		}
+
+		uint16_t GetUdpLen() const
+		{
+			return GetLen() + GetPayloadLength();
+		}
+
+		const std::optional<uint16_t> & GetFixedChecksum() const
+		{
+			return uh_sum;
+		}
+
+		void SetChecksum(uint16_t x)
+		{
+			uh_sum = x;
+		}
+
+		uint32_t GetPseudoHeaderSum() const
+		{
+			return pseudoHeaderSum;
+		}
+
+		void SetPseudoHeaderSum(uint32_t x)
+		{
+			pseudoHeaderSum = x;
+		}
+
+		// Compute the checksum of a datagram with this header and the
+		// given payload.  A computed checksum of 0 is sent as 0xffff,
+		// as 0 means that no checksum was computed.
+		uint16_t ComputeChecksum(const uint8_t * payload) const
+		{
+			uint32_t sum = pseudoHeaderSum;
+
+			sum = InetChecksumAdd(sum, GetIpProto());
+			sum = InetChecksumAdd(sum, GetUdpLen());
+			sum = InetChecksumAdd(sum,
+			    (uint32_t(GetSrcPort(payload)) << 16) | uh_dport);
+			sum = InetChecksumAdd(sum, GetUdpLen());
+			sum = InetChecksumAdd(sum, payload, GetPayloadLength());
+
+			uint16_t csum = InetChecksumFinish(sum);
+			if (csum == 0)
+				return 0xffff;
+			return csum;
+		}
+
+		bool GetChecksumVerified() const
+		{
+			return checksumVerified;
+		}
+
+		void SetChecksumVerified(bool v)
+		{
+			checksumVerified = v;
+		}
+
+		bool GetChecksumPassed() const
+		{
+			return checksumPassed;
+		}
+
+		void SetChecksumPassed(bool v)
+		{
+			checksumPassed = v;
+		}
+
+		constexpr static uint8_t GetIpProto()
+		{
+			return IPPROTO_UDP;
+		}
+
+		size_t GetLen() const
+		{
+			return sizeof(struct udphdr);
+		}
+
+		size_t GetPayloadLength() const
+		{
+			return std::min(GetMaxPayload(), payloadLength);
+		}
+
+		void SetPayloadLength(size_t len)
+		{
+			payloadLength = len;
+		}
+
+		size_t GetMtu() const
+		{
+			return std::min(localMtu, outerMtu);
+		}
+
+		void SetMtu(size_t x)
+		{
+			localMtu = x;
+		}
+
+		void SetOuterMtu(size_t x)
+		{
+			outerMtu = x;
+		}
+
+		// Datagrams are independent, so there is nothing in the UDP
+		// header to advance; successive datagrams differ only in the
+		// other layers (e.g. the IPv4 id and the payload).
+		UdpTemplate Next() const
+		{
+			return *this;
+		}
+
+		UdpTemplate Retransmission() const
+		{
+			return *this;
+		}
+
+		void FillPacket(mbuf * m, size_t offset) const
+		{
+			auto * udp = GetMbufHeader<udphdr>(m, offset);
+			// The payload has already been filled in.
+			auto * payload = reinterpret_cast<const uint8_t *>(udp + 1);
+
+			udp->uh_sport = hton(GetSrcPort(payload));
+			udp->uh_dport = hton(uh_dport);
+			udp->uh_ulen = hton(GetUdpLen());
+
+			if (uh_sum)
+				udp->uh_sum = hton(*uh_sum);
+			else
+				udp->uh_sum = hton(ComputeChecksum(payload));
+
+			if (checksumVerified) {
+				m->m_pkthdr.csum_flags |= CSUM_L4_CALC;
+				if (checksumPassed) {
+					m->m_pkthdr.csum_flags |= CSUM_L4_VALID;
+				}
+			}
+		}
+
+		void print(int depth) const
+		{
+			PrintIndent(depth, "UDP : {");
+			PrintIndent(depth + 1, "sport : %d", uh_sport);
+			PrintIndent(depth + 1, "dport : %d", uh_dport);
+			PrintIndent(depth + 1, "payloadLen : %d", GetPayloadLength());
+			if (uh_sum)
+				PrintIndent(depth + 1, "sum : %#x", *uh_sum);
+			PrintIndent(depth, "}");
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,217 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_VLAN_HEADER_H
+#define PKTGEN_VLAN_HEADER_H
+
+#include "fake/mbuf.h"
+
+extern "C" {
+#include <kern_include/net/ethernet.h>
+}
+
+#include "pktgen/FieldPropagator.h"
+#include "pktgen/Layer.h"
+#include "pktgen/L2Fields.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PrintIndent.h"
+
+#include <algorithm>
+
+namespace PktGen::internal
+{
+	// An 802.1Q tag carried in the packet itself, as received from a NIC
+	// that does not strip tags.  The tag sits between the Ethernet header
+	// and the network layer; stacking two tags gives a QinQ packet.
+	struct vlan_tag
+	{
+		uint16_t tci;
+		uint16_t proto;
+	};
+
+	class VlanTemplate
+	{
+	private:
+		uint16_t tpid;
+		uint16_t vid;
+		uint8_t pcp;
+		bool dei;
+		uint16_t ethertype;
+		size_t outerMtu;
+		size_t localMtu;
+		size_t payloadLength;
+
+		typedef VlanTemplate SelfType;
+
+	public:
+		static const auto LAYER = LayerVal::VLAN;
+
+		// Chain this tag into the enclosing Ethernet header or tag.
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const VlanTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				PktGen::ethertype(t.GetTpid())(h);
+			}
+		};
+
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
+		VlanTemplate()
+		  : tpid(ETHERTYPE_VLAN),
+		    vid(0),
+		    pcp(0),
+		    dei(false),
+		    ethertype(0),
+		    outerMtu(DEFAULT_MTU),
+		    localMtu(DEFAULT_MTU),
+		    payloadLength(0)
+		{
+		}
+
+		uint16_t GetTpid() const
+		{
+			return tpid;
+		}
+
+		void SetTpid(uint16_t x)
+		{
+			tpid = x;
+		}
+
+		uint16_t GetVid() const
+		{
+			return vid;
+		}
+
+		void SetVid(uint16_t x)
+		{
+			vid = x;
+		}
+
+		uint8_t GetPcp() const
+		{
+			return pcp;
+		}
+
+		void SetPcp(uint8_t x)
+		{
+			pcp = x;
+		}
+
+		bool GetDei() const
+		{
+			return dei;
+		}
+
+		void SetDei(bool x)
+		{
+			dei = x;
+		}
+
+		uint16_t GetTci() const
+		{
+			return ((pcp & 0x7) << 13) | (dei ? 0x1000 : 0) |
+			    (vid & 0xfff);
+		}
+
+		uint16_t GetEthertype() const
+		{
+			return ethertype;
+		}
+
+		void SetEthertype(uint16_t t)
+		{
+			ethertype = t;
+		}
+
+		size_t GetLen() const
+		{
+			return sizeof(struct vlan_tag);
+		}
+
+		size_t GetPayloadLength() const
+		{
+			return payloadLength;
+		}
+
+		void SetPayloadLength(size_t len)
+		{
+			payloadLength = len;
+		}
+
+		size_t GetMtu() const
+		{
+			return std::min(localMtu, outerMtu);
+		}
+
+		void SetMtu(size_t x)
+		{
+			localMtu = x;
+		}
+
+		void SetOuterMtu(size_t x)
+		{
+			outerMtu = x;
+		}
+
+		SelfType Next() const
+		{
+			return *this;
+		}
+
+		SelfType Retransmission() const
+		{
+			return *this;
+		}
+
+		void FillPacket(mbuf * m, size_t offset) const
+		{
+			auto * tag = GetMbufHeader<struct vlan_tag>(m, offset);
+
+			tag->tci = hton(GetTci());
+			tag->proto = hton(ethertype);
+		}
+
+		void print(int depth) const
+		{
+			PrintIndent(depth, "VLAN : {");
+			PrintIndent(depth + 1, "tpid : %#x", tpid);
+			PrintIndent(depth + 1, "vid : %d", vid);
+			PrintIndent(depth + 1, "pcp : %d", pcp);
+			PrintIndent(depth + 1, "etype : %#x", ethertype);
+			PrintIndent(depth, "}");
+		}
+	};
+}
+
+#endif
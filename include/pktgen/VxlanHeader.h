@@ -0,0 +1,202 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef PKTGEN_VXLAN_HEADER_H
+#define PKTGEN_VXLAN_HEADER_H
+
+#include "fake/mbuf.h"
+
+extern "C" {
+#include <kern_include/net/ethernet.h>
+}
+
+#include "pktgen/FieldPropagator.h"
+#include "pktgen/Layer.h"
+#include "pktgen/L4Fields.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/PrintIndent.h"
+#include "pktgen/TunnelFields.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+
+namespace PktGen::internal
+{
+	// A VXLAN header (RFC 7348), which carries an Ethernet frame over UDP.
+	struct vxlan_hdr
+	{
+		uint32_t flags;
+		uint32_t vni;
+	};
+
+	class VxlanTemplate
+	{
+	private:
+		uint32_t vni;
+		uint16_t udpPort;
+		bool srcPortEntropy;
+		size_t outerMtu;
+		size_t localMtu;
+		size_t payloadLength;
+
+		typedef VxlanTemplate SelfType;
+
+	public:
+		static const auto LAYER = LayerVal::TUNNEL;
+
+		static constexpr uint32_t FLAG_VNI = 0x08000000;
+		static constexpr int VNI_SHIFT = 8;
+		static constexpr uint16_t DEFAULT_PORT = 4789;
+
+		// Point the enclosing UDP header at the VXLAN port and, by
+		// default, derive its source port from the inner frame.
+		struct OutwardFieldSetter
+		{
+			template <typename Header>
+			void operator()(Header & h, const VxlanTemplate & t) const
+			{
+				DefaultOutwardFieldSetter setter;
+
+				setter(h, t);
+				dst(t.GetUdpPort())(h);
+				if (t.GetSrcPortEntropy())
+					h.SetSrcPortEntropy(t.GetLen());
+				else
+					h.SetSrcPortEntropy(std::nullopt);
+			}
+		};
+
+		typedef DefaultInwardFieldSetter InwardFieldSetter;
+
+		VxlanTemplate()
+		  : vni(0),
+		    udpPort(DEFAULT_PORT),
+		    srcPortEntropy(true),
+		    outerMtu(DEFAULT_MTU),
+		    localMtu(DEFAULT_MTU),
+		    payloadLength(0)
+		{
+		}
+
+		uint32_t GetVni() const
+		{
+			return vni;
+		}
+
+		void SetVni(uint32_t x)
+		{
+			vni = x;
+		}
+
+		uint16_t GetUdpPort() const
+		{
+			return udpPort;
+		}
+
+		void SetUdpPort(uint16_t x)
+		{
+			udpPort = x;
+		}
+
+		bool GetSrcPortEntropy() const
+		{
+			return srcPortEntropy;
+		}
+
+		void SetSrcPortEntropy(bool x)
+		{
+			srcPortEntropy = x;
+		}
+
+		// VXLAN has no protocol field; it can only carry Ethernet.
+		void SetEthertype(uint16_t t)
+		{
+			if (t != ETHERTYPE_TRANSETHER)
+				throw std::runtime_error("VXLAN can only encapsulate Ethernet");
+		}
+
+		size_t GetLen() const
+		{
+			return sizeof(struct vxlan_hdr);
+		}
+
+		size_t GetPayloadLength() const
+		{
+			return payloadLength;
+		}
+
+		void SetPayloadLength(size_t len)
+		{
+			payloadLength = len;
+		}
+
+		size_t GetMtu() const
+		{
+			return std::min(localMtu, outerMtu);
+		}
+
+		void SetMtu(size_t x)
+		{
+			localMtu = x;
+		}
+
+		void SetOuterMtu(size_t x)
+		{
+			outerMtu = x;
+		}
+
+		SelfType Next() const
+		{
+			return *this;
+		}
+
+		SelfType Retransmission() const
+		{
+			return *this;
+		}
+
+		void FillPacket(mbuf * m, size_t offset) const
+		{
+			auto * vxh = GetMbufHeader<struct vxlan_hdr>(m, offset);
+
+			vxh->flags = hton(FLAG_VNI);
+			vxh->vni = hton(vni << VNI_SHIFT);
+		}
+
+		void print(int depth) const
+		{
+			PrintIndent(depth, "VXLAN : {");
+			PrintIndent(depth + 1, "vni : %u", vni);
+			PrintIndent(depth + 1, "port : %d", udpPort);
+			PrintIndent(depth, "}");
+		}
+	};
+}
+
+#endif
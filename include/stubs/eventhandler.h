@@ -0,0 +1,63 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef STUBS_EVENTHANDLER_H
+#define STUBS_EVENTHANDLER_H
+
+#include <sys/cdefs.h>
+
+/*
+ * Code under test registers for events such as nmbclusters_change that never
+ * fire in a test, so registration only hands back a tag.  Like the other
+ * stubs, include this in exactly one file of each test program.
+ */
+
+extern "C" {
+
+struct eventhandler_list;
+struct eventhandler_entry;
+
+static int stub_eventhandler_tag;
+
+struct eventhandler_entry *
+eventhandler_register(struct eventhandler_list *list, const char *name,
+	void *func, void *arg, int priority)
+{
+	return (reinterpret_cast<struct eventhandler_entry *>(
+	    &stub_eventhandler_tag));
+}
+
+void
+eventhandler_deregister(struct eventhandler_list *list,
+	struct eventhandler_entry *tag)
+{
+}
+
+}
+
+#endif
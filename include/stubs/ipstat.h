@@ -0,0 +1,50 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef STUBS_IPSTAT_H
+#define STUBS_IPSTAT_H
+
+#include "fake/counter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The IPv4 statistics and the mbuf cluster limit, which ip_input.c and
+ * kern_mbuf.c own but which are not under test.  Include this after
+ * netinet/ip_var.h, and like the other stubs, in exactly one file of each
+ * test program.  Tests allocate the counters with fake_counter_array_alloc().
+ */
+uint64_t *ipstat[sizeof(struct ipstat) / sizeof(uint64_t)];
+int nmbclusters = 65536;
+
+// The current value of a field of struct ipstat, e.g. IPSTAT(ips_fragments).
+#define IPSTAT(name) \
+	counter_u64_fetch(ipstat[offsetof(struct ipstat, name) / sizeof(uint64_t)])
+
+#endif
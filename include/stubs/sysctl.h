@@ -43,6 +43,20 @@ sysctl_handle_string(struct sysctl_oid *oidp, void *arg1,
 	return (0);
 }
 
+int
+sysctl_handle_uma_zone_max(struct sysctl_oid *oidp, void *arg1,
+	intmax_t arg2, struct sysctl_req *req)
+{
+	return (0);
+}
+
+int
+sysctl_handle_uma_zone_cur(struct sysctl_oid *oidp, void *arg1,
+	intmax_t arg2, struct sysctl_req *req)
+{
+	return (0);
+}
+
 }
 
 #endif
@@ -0,0 +1,119 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_BENCHMARK_H
+#define SYSUNIT_BENCHMARK_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <string>
+
+namespace SysUnit
+{
+	// Base class for a benchmark of kernel code.  The runner (in the
+	// sysunit_bench library, which also provides main()) sets up every
+	// registered Initializer before calling BenchSetUp() and tears them
+	// down after BenchTearDown(), so the code under test runs against
+	// exactly the same fakes as it does in SysUnit::TestSuite.
+	//
+	// Each iteration runs IterationSetUp(), Iteration() and
+	// IterationTearDown(), but only Iteration() is timed.  Iteration()
+	// returns the number of items (e.g. packets) that it processed, and
+	// results are reported per item.
+	class Benchmark
+	{
+	private:
+		std::map<std::string, double> counters;
+
+	protected:
+		// Report an additional benchmark-specific result alongside the
+		// timing results.  The reported value is the average of the
+		// values set by each repetition.
+		void SetCounter(const std::string & name, double value)
+		{
+			counters[name] = value;
+		}
+
+	public:
+		virtual ~Benchmark() = default;
+
+		virtual void BenchSetUp();
+		virtual void BenchTearDown();
+
+		virtual void IterationSetUp();
+		virtual size_t Iteration() = 0;
+		virtual void IterationTearDown();
+
+		const std::map<std::string, double> & GetCounters() const
+		{
+			return counters;
+		}
+	};
+
+	typedef std::function<std::unique_ptr<Benchmark>()> BenchmarkFactory;
+
+	void RegisterBenchmark(const std::string & name, BenchmarkFactory factory);
+
+	// Registers benchmarks from a static initializer.  Use the
+	// SYSUNIT_BENCHMARK macros rather than using this directly.
+	class BenchmarkRegistrar
+	{
+	public:
+		BenchmarkRegistrar(const std::string & name, BenchmarkFactory factory)
+		{
+			RegisterBenchmark(name, factory);
+		}
+
+		explicit BenchmarkRegistrar(void (*registerFunc)())
+		{
+			registerFunc();
+		}
+	};
+}
+
+#define SYSUNIT_BENCH_CONCAT2(a, b) a##b
+#define SYSUNIT_BENCH_CONCAT(a, b) SYSUNIT_BENCH_CONCAT2(a, b)
+
+// Register the Benchmark subclass cls under its own name.
+#define SYSUNIT_BENCHMARK(cls) \
+	static SysUnit::BenchmarkRegistrar \
+	    SYSUNIT_BENCH_CONCAT(sysunit_bench_registrar_, __LINE__)(#cls, \
+		[] () -> std::unique_ptr<SysUnit::Benchmark> \
+		{ \
+			return std::make_unique<cls>(); \
+		})
+
+// Call func() at startup to register a family of benchmarks, such as one per
+// point in a parameter matrix, with SysUnit::RegisterBenchmark().
+#define SYSUNIT_BENCHMARK_FAMILY(func) \
+	static SysUnit::BenchmarkRegistrar \
+	    SYSUNIT_BENCH_CONCAT(sysunit_bench_registrar_, __LINE__)(func)
+
+#endif
@@ -61,6 +61,16 @@ namespace SysUnit {
 				return order < rhs.order;
 		}
 	};
+
+	// Run the SetUp() method of every registered Initializer, in order.
+	// SysUnit::TestSuite does this around every test case; code that runs
+	// kernel code outside of a gtest case uses these to get the same
+	// environment.
+	void SetUpInitializers();
+
+	// Run the TearDown() method of every registered Initializer, in the
+	// reverse of the order that they were set up in.
+	void TearDownInitializers();
 }
 
 #endif
@@ -0,0 +1,143 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_PERF_COUNTERS_H
+#define SYSUNIT_PERF_COUNTERS_H
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace SysUnit
+{
+	enum class PerfEvent
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		CACHE_MISSES,
+		BRANCH_MISSES,
+	};
+
+	const size_t NUM_PERF_EVENTS = 4;
+
+	const char * PerfEventName(PerfEvent event);
+
+	// Returns true if the hardware counter for the given event could be
+	// opened.  Counters are opened the first time that they are needed,
+	// through perf_event_open on Linux and through hwpmc(4) (which must be
+	// loaded) on FreeBSD; other platforms have none.  If the host does not
+	// support them, or we lack permission to use them, PerfScope still
+	// counts calls and items but no events are reported, and a notice
+	// saying why is printed to stderr once.
+	bool PerfEventAvailable(PerfEvent event);
+
+	struct PerfCounts
+	{
+		std::array<uint64_t, NUM_PERF_EVENTS> values{};
+
+		uint64_t operator[](PerfEvent event) const
+		{
+			return values[static_cast<size_t>(event)];
+		}
+
+		PerfCounts & operator+=(const PerfCounts & rhs)
+		{
+			for (size_t i = 0; i < NUM_PERF_EVENTS; ++i)
+				values[i] += rhs.values[i];
+			return *this;
+		}
+	};
+
+	// The totals accumulated by every PerfScope for one named region.
+	struct PerfRegionStats
+	{
+		uint64_t calls = 0;
+		uint64_t items = 0;
+		PerfCounts counts;
+
+		double PerItem(PerfEvent event) const
+		{
+			return items > 0 ? double(counts[event]) / items : 0;
+		}
+
+		PerfRegionStats & operator+=(const PerfRegionStats & rhs)
+		{
+			calls += rhs.calls;
+			items += rhs.items;
+			counts += rhs.counts;
+			return *this;
+		}
+	};
+
+	typedef std::map<std::string, PerfRegionStats> PerfRegionMap;
+
+	// Attributes the events counted during its lifetime to the named
+	// region, e.g.:
+	//
+	//	{
+	//		SysUnit::PerfScope scope("rx", batch.size());
+	//		for (auto * m : batch)
+	//			tcp_lro_rx(&lc, m, 0);
+	//	}
+	//
+	// items is the number of units of work (e.g. packets) done in the
+	// scope, and is used to report per-item averages.  Only user-mode
+	// events are counted, but each scope costs two reads of the counters,
+	// so scopes should be placed around loops rather than inside them
+	// when timing is also being measured.
+	class PerfScope
+	{
+	private:
+		const char * region;
+		size_t items;
+		PerfCounts start;
+
+	public:
+		explicit PerfScope(const char * region, size_t items = 1);
+		~PerfScope();
+
+		PerfScope(const PerfScope &) = delete;
+		PerfScope & operator=(const PerfScope &) = delete;
+
+		void SetItems(size_t i)
+		{
+			items = i;
+		}
+	};
+
+	const PerfRegionMap & GetPerfRegions();
+	void ResetPerfRegions();
+
+	// Print a table of per-item averages for every region.
+	void PrintPerfRegions(std::ostream & out, const PerfRegionMap & regions);
+}
+
+#endif
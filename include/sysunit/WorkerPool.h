@@ -0,0 +1,95 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_WORKER_POOL_H
+#define SYSUNIT_WORKER_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+namespace SysUnit
+{
+	// A fixed set of threads for benchmarks that model per-CPU kernel
+	// work, such as one LRO instance per receive queue.  Run() hands the
+	// same job to every worker and waits for all of them to finish, so a
+	// benchmark's Iteration() can fan out across the workers.
+	//
+	// When pinning is requested, worker i is bound to CPU i (modulo the
+	// number of CPUs), like a driver binding its queue i interrupt thread.
+	class WorkerPool
+	{
+	public:
+		typedef std::function<void(size_t worker)> Job;
+
+	private:
+		std::vector<std::thread> threads;
+		bool pinned;
+
+		std::mutex lock;
+		std::condition_variable startCv;
+		std::condition_variable doneCv;
+		const Job * job;
+		uint64_t generation;
+		size_t running;
+		bool stopping;
+		std::exception_ptr error;
+
+		void WorkerLoop(size_t worker);
+
+	public:
+		explicit WorkerPool(size_t workers, bool pin = true);
+		~WorkerPool();
+
+		WorkerPool(const WorkerPool &) = delete;
+		WorkerPool & operator=(const WorkerPool &) = delete;
+
+		size_t GetNumWorkers() const
+		{
+			return threads.size();
+		}
+
+		// Whether every worker was successfully pinned to its CPU.
+		bool IsPinned() const
+		{
+			return pinned;
+		}
+
+		// Run job(worker) on every worker concurrently and wait for
+		// all of them to return.  If any job throws, the first
+		// exception is rethrown here.
+		void Run(const Job & job);
+	};
+}
+
+#endif
@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_XML_REPORT_H
+#define SYSUNIT_XML_REPORT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// The JUnit-style XML reports written by sysunit_runner and by the fork
+// server in sysunit_main, in the same format as --gtest_output=xml.
+namespace SysUnit::internal
+{
+	struct CaseResult
+	{
+		std::string name;
+		double seconds = 0;
+		bool failed = false;
+
+		// Everything that the case printed, including gtest's messages
+		// describing failed assertions.
+		std::string output;
+	};
+
+	// Return the <testsuite> elements of a report written by
+	// --gtest_output=xml, without the enclosing <testsuites> element.
+	std::string ExtractTestSuites(const std::string & xml);
+
+	// Build a <testsuite> element named name for results that were not
+	// written out by gtest itself, e.g. those that sysunit_runner
+	// recovered from the log of a worker that crashed.  Each case's name
+	// is of the form <suite>.<case>.
+	std::string MakeTestSuite(const std::string & name,
+	    const std::vector<CaseResult> & results);
+
+	struct ReportTotals
+	{
+		size_t tests = 0;
+		size_t failures = 0;
+		double seconds = 0;
+	};
+
+	// Write a report in the same format as gtest's that contains the
+	// given <testsuite> elements.
+	void WriteXmlReport(std::ostream & out, const ReportTotals & totals,
+	    const std::vector<std::string> & suites);
+}
+
+#endif
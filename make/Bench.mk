@@ -0,0 +1,69 @@
+ifneq ($(BENCHES),)
+
+define bench_template
+
+BENCH:=$$(shell echo $1 | tr 'a-z' 'A-Z')
+BENCH_OBJS := $$(notdir $$(call src_to_obj,$$(BENCH_$$(BENCH)_SRCS)))
+
+BENCH_$$(BENCH)_WRAPFUNCS += \
+	$$(if $$(filter fake_malloc,$$(BENCH_$$(BENCH)_LIBS)),$$(MALLOC_WRAPFUNCS))
+
+BENCH_$$(BENCH)_WRAPARGS := $$(call wrap_ldflags,$$(BENCH_$$(BENCH)_WRAPFUNCS))
+
+BENCH_$$(BENCH)_OBJPATHS:=$$(addprefix $$($$(LIB)_OBJDIR)/,$$(BENCH_OBJS))
+
+BENCH_MAIN_PREFIX := $$($$(LIB)_OBJDIR)/$1.bench
+BENCH_$$(BENCH)_MAIN_OBJ := $$(BENCH_MAIN_PREFIX).o
+BENCH_$$(BENCH)_MAIN_DEPFILE := $$(call src_to_dep,$$(BENCH_MAIN_PREFIX).cpp)
+
+$$(BENCH_$$(BENCH)_MAIN_OBJ): LIB := $(LIB)
+
+-include $$(BENCH_$$(BENCH)_MAIN_DEPFILE)
+
+BENCH_$$(BENCH)_OBJPATHS := $$(BENCH_$$(BENCH)_OBJPATHS) $$(BENCH_$$(BENCH)_MAIN_OBJ)
+
+BENCH_$$(BENCH)_LIBARGS := $$(addprefix $$(LIBDIR)/lib,  $$(addsuffix .a, $$(BENCH_$$(BENCH)_LIBS)))
+
+# The fakes report errors through gtest assertions, so benchmarks still link
+# against gtest, but main() comes from the sysunit_bench library.
+BENCH_$$(BENCH)_STDLIBARGS:= \
+	$$(addprefix -l,$$(BENCH_$$(BENCH)_STDLIBS)) \
+	    -lgtest -lpthread $$(PERF_STDLIBS)
+
+BENCH_$$(BENCH)_OUTDIR := $$(BENCHDIR)/$$(CURDIR)
+BENCH_$$(BENCH)_PROG := $$(BENCH_$$(BENCH)_OUTDIR)/$1.benchprog
+
+BENCH_PROGS := $$(BENCH_PROGS) $$(BENCH_$$(BENCH)_PROG)
+
+$$(BENCH_$$(BENCH)_PROG): BENCH := $$(BENCH)
+$$(BENCH_$$(BENCH)_PROG): $$(BENCH_$$(BENCH)_OBJPATHS) $$(BENCH_$$(BENCH)_LIBARGS)
+	mkdir -p $$(dir $$@)
+	$${CXX} -Wl,-L/usr/local/lib $$(LDFLAGS) $$(BENCH_$$(BENCH)_WRAPARGS) \
+	    $$(BENCH_$$(BENCH)_OBJPATHS) \
+	    $$(BENCH_$$(BENCH)_LIBARGS) $$(BENCH_$$(BENCH)_STDLIBARGS) -o $$@
+
+.PHONY: bench.$1
+
+ifeq ($(PROFILE),bench)
+bench.$1: $$(BENCH_$$(BENCH)_OUTDIR)/$1.benchprog
+	@./$$< $$(BENCH_ARGS)
+else
+bench.$1:
+	@$$(MAKE) PROFILE=bench $$@
+endif
+
+clean:: clean_bench_$$(BENCH)
+
+.PHONY: clean_bench_$$(BENCH)
+clean_bench_$$(BENCH): BENCH := $$(BENCH)
+
+clean_bench_$$(BENCH):
+	$(RM) $$(BENCH_$$(BENCH)_MAIN_OBJ) \
+	    $$(BENCH_$$(BENCH)_MAIN_DEPFILE) \
+	    $$(BENCH_$$(BENCH)_PROG)
+
+endef
+
+$(foreach bench,$(BENCHES),$(eval $(call bench_template,$(bench))))
+
+endif
@@ -5,17 +5,37 @@ LD=c++
 
 #CWARNFLAGS.gcc += -Wno-expansion-to-defined -Wno-extra -Wno-unused-but-set-variable
 
+ifeq ($(PROFILE),bench)
+
+# The bench profile optimizes everything and compiles out INVARIANTS (and with
+# it the KASSERTs in the kernel code and the fakes' debug checks), so that
+# benchmarks measure the code under test rather than the test scaffolding.
+C_OPTIM=-O3 -fno-omit-frame-pointer
+CXX_OPTIM=-O2 -fno-omit-frame-pointer
+PROFILE_FLAGS=-DNDEBUG
+
+# Libraries are archives of LLVM bitcode, which the base system ar can't
+# index.
+LTO_FLAGS=-flto
+AR=llvm-ar
+
+else
+
 C_OPTIM=-O3 -fno-omit-frame-pointer
 
 # Compiling the UT code with optimization enabled takes several seconds per
 # test file and doesn't give a lot of benefit, so don't bother with -O
 CXX_OPTIM=-fno-omit-frame-pointer
+PROFILE_FLAGS=-DINVARIANTS -DINVARIANT_SUPPORT
+LTO_FLAGS=
+
+endif
 
 CXX_STD=-std=c++17
 CXX_WARNFLAGS=-Wall -Werror -Wno-user-defined-literals
 
 CFLAGS:=-I/usr/local/include -I$(TOPDIR)/include -g -DBSD_VISIBLE \
-    -DKLD_MODULE -DSMP -DINVARIANTS -DINVARIANT_SUPPORT -Werror \
+    -DKLD_MODULE -DSMP $(PROFILE_FLAGS) -Werror \
     -D_KERNEL_UT
 
 C_ONLY_FLAGS := -I$(TOPDIR)/include/kern_include $(C_OPTIM)  -nostdinc \
@@ -25,4 +45,35 @@ C_ONLY_FLAGS := -I$(TOPDIR)/include/kern_include $(C_OPTIM)  -nostdinc \
 
 CXXFLAGS:=$(CXX_STD) $(CXX_WARNFLAGS) $(CXX_OPTIM)
 
-LDFLAGS := -Wl,-L,/usr/local/lib
+OPSYS := $(shell uname -s)
+
+# sysunit_init reads the hardware performance counters through libpmc on
+# FreeBSD; on Linux it makes the perf_event_open system call directly.
+PERF_STDLIBS := $(if $(filter FreeBSD,$(OPSYS)),-lpmc)
+
+LDFLAGS := -Wl,-L,/usr/local/lib $(LTO_FLAGS) $(if $(LTO_FLAGS),$(CXX_OPTIM))
+
+# Tests and benchmarks substitute fakes for kernel or libc functions at link
+# time.  Each entry of a TEST_<name>_WRAPFUNCS or BENCH_<name>_WRAPFUNCS list
+# is sym=replacement, and redirects every reference to sym from the objects
+# and static libraries linked into the program to replacement.  The original
+# definition remains reachable as __real_sym, which is how a fake that wraps
+# the real function (rather than replacing it) calls through to it.  The
+# objects themselves are not modified, so they are built once and shared by
+# every program that links them.
+wrap_sym = $(word 1,$(subst =, ,$1))
+wrap_repl = $(word 2,$(subst =, ,$1))
+wrap_ldflags = $(foreach w,$1,-Wl,--wrap=$(call wrap_sym,$w) \
+    -Wl,--defsym=__wrap_$(call wrap_sym,$w)=$(call wrap_repl,$w) \
+    -Wl,--undefined=$(call wrap_repl,$w))
+
+# The substitutions applied to every test or benchmark that links fake_malloc.
+# They apply to the whole program, not just the kernel objects, so kmalloc()
+# and kfree() allocate from libc through __real_malloc and __real_free and can
+# serve the userland callers as well.  A replacement must be defined somewhere
+# in the program, so add entries here as fake_malloc grows the rest of the
+# malloc(9) family.
+MALLOC_WRAPFUNCS := \
+	free=kfree \
+	malloc=kmalloc \
+
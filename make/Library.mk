@@ -28,11 +28,11 @@ $($(LIB)_DOBJS): LIB := $(LIB)
 
 $(OBJDIR)/%.o: %.c
 	mkdir -p $(dir $@) $($(LIB)_DEPDIR)
-	$(CC) $(C_ONLY_FLAGS) -MD -MF $(call src_to_dep,$<) -c $(CFLAGS) $(LOCAL_INCLUDE) $< -o $@
+	$(CC) $(C_ONLY_FLAGS) -MD -MF $(call src_to_dep,$<) -c $(CFLAGS) $(LTO_FLAGS) $(LOCAL_INCLUDE) $< -o $@
 
 $(OBJDIR)/%.o: %.cpp
 	mkdir -p $(dir $@) $($(LIB)_DEPDIR)
-	$(CXX) -MD -MF $(call src_to_dep,$<) -c $(CFLAGS) $(CXXFLAGS) $(LOCAL_INCLUDE) $< -o $@
+	$(CXX) -MD -MF $(call src_to_dep,$<) -c $(CFLAGS) $(CXXFLAGS) $(LTO_FLAGS) $(LOCAL_INCLUDE) $< -o $@
 
 .PHONY: clean_lib_$(LIB)
 
@@ -14,6 +14,7 @@ define include_template
  PROG_STDLIBS:=
 
  TESTS :=
+ BENCHES :=
 
  SUBDIRS:=
 
@@ -22,6 +23,7 @@ define include_template
  include $$(TOPDIR)/make/Library.mk
  include $$(TOPDIR)/make/Program.mk
  include $$(TOPDIR)/make/Test.mk
+ include $$(TOPDIR)/make/Bench.mk
 
  include $$(TOPDIR)/make/Subdirs.mk
  CURDIR := $$(DIRSTACK_$$(STACK))
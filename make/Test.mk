@@ -6,40 +6,15 @@ define test_template
 TEST:=$$(shell echo $1 | tr 'a-z' 'A-Z')
 TEST_OBJS := $$(notdir $$(call src_to_obj,$$(TEST_$$(TEST)_SRCS)))
 
+# Link-time substitutions (see wrap_ldflags in Defaults.mk).  Tests that link
+# fake_malloc also get the userland allocator redirected to it.
 TEST_$$(TEST)_WRAPFUNCS += \
-	calloc=kcalloc \
-	free=kfree \
-	malloc=kmalloc \
-	mallocarray=kmallocarray \
-	realloc=krealloc \
-	reallocf=kreallocf \
+	$$(if $$(filter fake_malloc,$$(TEST_$$(TEST)_LIBS)),$$(MALLOC_WRAPFUNCS))
 
-TEST_$$(TEST)_OBJPATHS:=
-ifneq ($$(TEST_$$(TEST)_WRAPFUNCS),)
-
-TEST_$$(TEST)_REDEFINE_SYMS:=$$(addprefix --redefine-sym ,$$(TEST_$$(TEST)_WRAPFUNCS))
-
-TEST_$$(TEST)_OBJDIR := $$(TESTOBJDIR)/$$(CURDIR)
-
-TEST_$$(TEST)_OBJPATHS:=$$(addprefix $$(TEST_$$(TEST)_OBJDIR)/,$$(addsuffix .test.o,$$(basename $$(TEST_OBJS))))
-
-$$(TEST_$$(TEST)_OBJDIR)/%.test.o: $$($$(LIB)_OBJDIR)/%.o
-	mkdir -p $$(dir $$@)
-	objcopy $$(TEST_$$(TEST)_REDEFINE_SYMS) $$< $$@
-
-clean:: clean_testobjs_$$(TEST)
-
-.PHONY: clean_testobjs_$$(TEST)
-clean_testobjs_$$(TEST): TEST := $$(TEST)
-clean_testobjs_$$(TEST):
-	$(RM) $$(TEST_$$(TEST)_OBJPATHS)
-
-else
+TEST_$$(TEST)_WRAPARGS := $$(call wrap_ldflags,$$(TEST_$$(TEST)_WRAPFUNCS))
 
 TEST_$$(TEST)_OBJPATHS:=$$(addprefix $$($(LIB)_OBJDIR)/,$$(TEST_OBJS))
 
-endif
-
 TEST_GTEST_PREFIX := $$($$(LIB)_OBJDIR)/$1.gtest
 TEST_$$(TEST)_GTEST_OBJ := $$(TEST_GTEST_PREFIX).o
 TEST_$$(TEST)_GTEST_DEPFILE := $$(call src_to_dep,$$(TEST_GTEST_PREFIX).cpp)
@@ -50,11 +25,14 @@ $$(TEST_$$(TEST)_GTEST_OBJ): LIB := $(LIB)
 
 TEST_$$(TEST)_OBJPATHS := $$(TEST_$$(TEST)_OBJPATHS) $$(TEST_$$(TEST)_GTEST_OBJ)
 
-TEST_$$(TEST)_LIBARGS := $$(addprefix $$(LIBDIR)/lib,  $$(addsuffix .a, $$(TEST_$$(TEST)_LIBS)))
+# sysunit_main provides main() in place of gtest_main, adding the fork server
+# mode (--sysunit_fork or SYSUNIT_FORK=N in the environment), which writes its
+# XML report with sysunit_report.
+TEST_$$(TEST)_LIBARGS := $$(addprefix $$(LIBDIR)/lib,  $$(addsuffix .a, $$(TEST_$$(TEST)_LIBS) sysunit_main sysunit_report))
 
 TEST_$$(TEST)_STDLIBARGS:= \
 	$$(addprefix -l,$$(TEST_$$(TEST)_STDLIBS)) \
-	    -lgtest -lgtest_main -lpthread
+	    -lgtest -lpthread $$(PERF_STDLIBS)
 
 TEST_$$(TEST)_OUTDIR := $$(TESTDIR)/$$(CURDIR)
 TEST_$$(TEST)_PROG := $$(TEST_$$(TEST)_OUTDIR)/$1.testprog
@@ -64,7 +42,8 @@ TEST_PROGS := $$(TEST_PROGS) $$(TEST_$$(TEST)_PROG)
 $$(TEST_$$(TEST)_PROG): TEST := $$(TEST)
 $$(TEST_$$(TEST)_PROG): $$(TEST_$$(TEST)_OBJPATHS) $$(TEST_$$(TEST)_LIBARGS)
 	mkdir -p $$(dir $$@)
-	$${CXX} -Wl,-L/usr/local/lib $$(LDFLAGS) $$(TEST_$$(TEST)_OBJPATHS) \
+	$${CXX} -Wl,-L/usr/local/lib $$(LDFLAGS) $$(TEST_$$(TEST)_WRAPARGS) \
+	    $$(TEST_$$(TEST)_OBJPATHS) \
 	    $$(TEST_$$(TEST)_LIBARGS) $$(TEST_$$(TEST)_STDLIBARGS) -o $$@
 
 .PHONY: test.$1
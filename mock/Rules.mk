@@ -1,4 +1,5 @@
 
 SUBDIRS := \
+	icmp6 \
 	ifnet \
 	time \
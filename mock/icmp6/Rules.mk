@@ -0,0 +1,5 @@
+
+LIB := mock_icmp6
+
+SRCS := \
+	icmp6_error.cpp \
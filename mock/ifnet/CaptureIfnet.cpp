@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "mock/CaptureIfnet.h"
+#include "fake/mbuf.h"
+
+namespace SysUnit
+{
+CaptureIfnet::CaptureIfnet(const char * driver, int unit, Mode mode)
+  : mode(mode),
+    packets(0),
+    bytes(0)
+{
+	memset(&ifn, 0, sizeof(ifn));
+
+	snprintf(ifn.if_xname, sizeof(ifn.if_xname), "%s%d", driver, unit);
+	ifn.if_dname = driver;
+	ifn.if_dunit = unit;
+
+	ifn.if_llsoftc = this;
+	ifn.if_input = IfInput;
+}
+
+CaptureIfnet::~CaptureIfnet()
+{
+	Clear();
+}
+
+void
+CaptureIfnet::Clear()
+{
+	for (auto * m : log)
+		m_freem(m);
+	log.clear();
+}
+
+void
+CaptureIfnet::IfInput(struct ifnet * ifp, struct mbuf *m)
+{
+	auto * capture = static_cast<CaptureIfnet*>(ifp->if_llsoftc);
+
+	capture->packets++;
+	capture->bytes += m->m_pkthdr.len;
+
+	if (capture->mode == Mode::COUNT)
+		m_freem(m);
+	else
+		capture->log.push_back(m);
+}
+}
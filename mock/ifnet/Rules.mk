@@ -2,4 +2,6 @@
 LIB := mock_ifnet
 
 SRCS := \
-	MockUpperIfnet.cpp
+	CaptureIfnet.cpp \
+	MockUpperIfnet.cpp \
+
@@ -2,13 +2,49 @@
 LIB := netinet
 
 TESTS := \
+	ip_reass \
 	tcp_lro \
 	tcp_lro_sample \
 
+TEST_IP_REASS_SRCS := \
+	ip_reass.c \
+
+# ip_reass.c seeds its hash with arc4random().  Replace it with fake_random's
+# constant so that the hash bucket of each datagram is the same on every run.
+TEST_IP_REASS_WRAPFUNCS := \
+	arc4random=fixed_arc4random \
+
+TEST_IP_REASS_LIBS := \
+	fake_callcount \
+	fake_counter \
+	fake_malloc \
+	fake_mbuf \
+	fake_atomic \
+	fake_mib \
+	fake_mutex \
+	fake_panic \
+	fake_uma \
+	fake_phash \
+	fake_random \
+	pktgen \
+	sysunit_init \
+
+TEST_IP_REASS_STDLIBS := \
+	gmock \
+
 TEST_TCP_LRO_SRCS := \
 	tcp_lro.c \
 
+# Route the checksum routines through the counting wrappers in fake_csum so
+# that tests can check how many checksums LRO calculates.  The wrappers call
+# through to the real routines.
+TEST_TCP_LRO_WRAPFUNCS := \
+	in_cksum_hdr=counted_in_cksum_hdr \
+	in_cksum_skip=counted_in_cksum_skip \
+	in6_cksum=counted_in6_cksum \
+
 TEST_TCP_LRO_LIBS := \
+	fake_callcount \
 	fake_csum \
 	fake_malloc \
 	fake_mbuf \
@@ -28,8 +64,73 @@ TEST_TCP_LRO_STDLIBS := \
 TEST_TCP_LRO_SAMPLE_SRCS := \
 	$(TEST_TCP_LRO_SRCS) \
 
+TEST_TCP_LRO_SAMPLE_WRAPFUNCS := \
+	$(TEST_TCP_LRO_WRAPFUNCS) \
+
 TEST_TCP_LRO_SAMPLE_LIBS := \
 	$(TEST_TCP_LRO_LIBS) \
 
 TEST_TCP_LRO_SAMPLE_STDLIBS := \
 	$(TEST_TCP_LRO_STDLIBS) \
+
+BENCHES := \
+	ip_reass \
+	tcp_lro \
+	tcp_lro_mq \
+
+BENCH_IP_REASS_SRCS := \
+	$(TEST_IP_REASS_SRCS) \
+
+BENCH_IP_REASS_WRAPFUNCS := \
+	$(TEST_IP_REASS_WRAPFUNCS) \
+
+BENCH_IP_REASS_LIBS := \
+	$(TEST_IP_REASS_LIBS) \
+	sysunit_bench \
+
+BENCH_IP_REASS_STDLIBS := \
+	$(TEST_IP_REASS_STDLIBS) \
+
+BENCH_TCP_LRO_SRCS := \
+	tcp_lro.c \
+
+# Benchmarks count checksums like the tests, but calculate them with the
+# vectorized routines in fake_csum so that large payloads aren't dominated by
+# checksum time.
+BENCH_TCP_LRO_WRAPFUNCS := \
+	in_cksum_hdr=counted_in_cksum_hdr \
+	in_cksum_skip=counted_fast_in_cksum_skip \
+	in6_cksum=counted_fast_in6_cksum \
+
+# Benchmarks use fake_time rather than mock_time so that getmicrotime() does
+# not go through a gmock expectation on every packet.
+BENCH_TCP_LRO_LIBS := \
+	fake_callcount \
+	fake_csum \
+	fake_malloc \
+	fake_mbuf \
+	fake_atomic \
+	fake_mib \
+	fake_panic \
+	fake_uma \
+	fake_phash \
+	fake_time \
+	mock_ifnet \
+	pktgen \
+	sysunit_bench \
+	sysunit_init \
+
+BENCH_TCP_LRO_STDLIBS := \
+	gmock \
+
+BENCH_TCP_LRO_MQ_SRCS := \
+	$(BENCH_TCP_LRO_SRCS) \
+
+BENCH_TCP_LRO_MQ_WRAPFUNCS := \
+	$(BENCH_TCP_LRO_WRAPFUNCS) \
+
+BENCH_TCP_LRO_MQ_LIBS := \
+	$(BENCH_TCP_LRO_LIBS) \
+
+BENCH_TCP_LRO_MQ_STDLIBS := \
+	$(BENCH_TCP_LRO_STDLIBS) \
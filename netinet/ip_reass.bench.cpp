@@ -0,0 +1,403 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/CallCounts.h"
+#include "fake/counter.h"
+#include "fake/mbuf.h"
+#include "fake/random.h"
+#include "fake/uma.h"
+
+#include "pktgen/Fragmenter.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Udp.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/in_systm.h>
+#include <kern_include/netinet/ip.h>
+#include <kern_include/netinet/ip_var.h>
+#include <kern_include/vm/uma.h>
+
+// ip_var.h and sys/hash.h only declare these for the kernel.
+struct mbuf *ip_reass(struct mbuf *);
+void ipreass_init(void);
+void ipreass_drain(void);
+uint32_t jenkins_hash32(const uint32_t *, size_t, uint32_t);
+}
+
+#include <stubs/eventhandler.h>
+#include <stubs/ipstat.h>
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/PerfCounters.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace PktGen;
+
+namespace
+{
+	// The number of hash buckets in ip_reass.c.
+	const uint32_t IPREASS_NHASH = 1024;
+
+	const size_t FRAG_MTU = 1500;
+	const size_t FRAG_DATA = FRAG_MTU - sizeof(struct ip);
+
+	// Iterations reassemble at least this many datagrams, so that
+	// the timer isn't measuring single-datagram iterations.
+	const size_t DATAGRAMS_PER_ITERATION = 256;
+}
+
+namespace
+{
+	enum class Order
+	{
+		IN_ORDER,
+		REVERSE,
+		SHUFFLE,
+	};
+
+	enum class Buckets
+	{
+		// Datagrams differ only in their source address, so they are
+		// spread across the buckets by the hash.
+		SPREAD,
+
+		// Every datagram hashes to the same bucket, as an attacker
+		// who knows the hash seed could arrange.
+		COLLIDE,
+	};
+
+	struct ReassBenchConfig
+	{
+		size_t frags;
+		Order order;
+
+		// The number of datagrams whose fragments are interleaved, and
+		// so are queued for reassembly at the same time.
+		size_t datagrams;
+		Buckets buckets;
+
+		// If false, the last fragment of every datagram is lost and
+		// the datagrams stay queued until the iteration ends.
+		bool complete;
+
+		// If non-zero, a limit on the ipq zone (net.inet.ip.maxfragpackets)
+		// lower than the default.
+		size_t maxQueues;
+
+		std::string Name() const
+		{
+			static const char * const orders[] = {
+				"inorder", "reverse", "shuffle"
+			};
+			std::ostringstream name;
+
+			name << "frags=" << frags
+			    << "/" << orders[static_cast<int>(order)]
+			    << "/datagrams=" << datagrams
+			    << "/" << (buckets == Buckets::SPREAD ? "spread" : "collide");
+			if (!complete)
+				name << "/incomplete";
+			if (maxQueues != 0)
+				name << "/maxqueues=" << maxQueues;
+			return name.str();
+		}
+	};
+
+	std::string GetSrcAddr(uint32_t n)
+	{
+		std::ostringstream addr;
+
+		addr << "10." << ((n >> 16) & 0xff) << "." << ((n >> 8) & 0xff)
+		    << "." << (n & 0xff);
+		return addr.str();
+	}
+
+	auto GetDatagramTemplate(const ReassBenchConfig & config, uint32_t n)
+	{
+		size_t len = config.frags * FRAG_DATA - sizeof(struct udphdr);
+
+		return PacketTemplate(
+			Ipv4Header().With(
+				src(GetSrcAddr(n)),
+				dst("192.168.0.1"),
+				id(1)
+			),
+			UdpHeader().With(src(5000), dst(6000)),
+			PacketPayload().With(counterPayload(len))
+		);
+	}
+
+	auto GetFragments(const ReassBenchConfig & config, uint32_t n)
+	{
+		auto t = GetDatagramTemplate(config, n);
+
+		if (!config.complete)
+			return Fragment(t, FRAG_MTU, dropFragment(config.frags - 1));
+
+		switch (config.order) {
+		case Order::REVERSE:
+			return Fragment(t, FRAG_MTU, reverseFragments());
+		case Order::SHUFFLE:
+			return Fragment(t, FRAG_MTU, shuffleFragments(n + 1));
+		default:
+			return Fragment(t, FRAG_MTU);
+		}
+	}
+
+	typedef decltype(GetFragments(ReassBenchConfig(), 0)) DatagramFragments;
+
+	// The bucket that ip_reass() hashes datagram n into.  This must be kept
+	// in sync with both ip_reass.c and GetDatagramTemplate().
+	uint32_t GetBucket(uint32_t n)
+	{
+		uint32_t hashkey[3];
+
+		hashkey[0] = htonl(0x0a000000 | n);
+		hashkey[1] = htonl(0xc0a80001);
+		hashkey[2] = (uint32_t)IPPROTO_UDP << 16;
+		hashkey[2] += htons(1);
+		return (jenkins_hash32(hashkey, nitems(hashkey),
+		    FAKE_ARC4RANDOM_VALUE) & (IPREASS_NHASH - 1));
+	}
+
+	class ReassBenchmark : public SysUnit::Benchmark
+	{
+	private:
+		ReassBenchConfig config;
+		size_t groups;
+
+		std::vector<DatagramFragments> datagrams;
+		std::vector<struct mbuf *> batch;
+		std::vector<struct mbuf *> reassembled;
+
+		struct uma_zone * ipqZone;
+		struct uma_zone * mbufZone;
+
+		uint64_t fragments;
+		uint64_t fragmentBytes;
+		uint64_t sent;
+		uint64_t completed;
+
+		// The most queues and mbufs that ip_reass() held at the end of
+		// an iteration, when every datagram that will ever complete has.
+		int heldQueues;
+		int heldMbufs;
+
+		SysUnit::CallCounts iterationStart;
+		std::array<uint64_t, FAKE_NUM_CALLS> calls{};
+
+	public:
+		explicit ReassBenchmark(const ReassBenchConfig & c)
+		  : config(c),
+		    groups(std::max(DATAGRAMS_PER_ITERATION / c.datagrams, size_t(1))),
+		    ipqZone(nullptr),
+		    mbufZone(nullptr),
+		    fragments(0),
+		    fragmentBytes(0),
+		    sent(0),
+		    completed(0),
+		    heldQueues(0),
+		    heldMbufs(0)
+		{
+		}
+
+		void BenchSetUp() override
+		{
+			fake_counter_array_alloc(ipstat, nitems(ipstat));
+			ipreass_init();
+
+			ipqZone = fake_uma_find_zone("ipq");
+			mbufZone = fake_uma_find_zone("mbuf");
+			if (config.maxQueues != 0)
+				uma_zone_set_max(ipqZone, config.maxQueues);
+
+			uint32_t target = GetBucket(0);
+			for (uint32_t n = 0; datagrams.size() < config.datagrams; ++n) {
+				if (config.buckets == Buckets::COLLIDE &&
+				    GetBucket(n) != target)
+					continue;
+
+				datagrams.push_back(GetFragments(config, n));
+			}
+		}
+
+		void IterationSetUp() override
+		{
+			// Send the first fragment of every datagram, then the
+			// second, and so on.  Every group of datagrams completes
+			// before the next one starts.
+			for (size_t g = 0; g < groups; ++g) {
+				for (size_t f = 0; f < config.frags; ++f) {
+					for (const auto & frags : datagrams) {
+						if (f >= frags.size())
+							continue;
+
+						struct mbuf * m = frags.at(f).GenerateRawMbuf();
+						fragmentBytes += m->m_pkthdr.len;
+						batch.push_back(m);
+					}
+				}
+			}
+
+			iterationStart = SysUnit::GetCallCounts();
+		}
+
+		size_t Iteration() override
+		{
+			SysUnit::PerfScope scope("reass", batch.size());
+
+			for (auto * m : batch) {
+				m = ip_reass(m);
+				if (m != nullptr)
+					reassembled.push_back(m);
+			}
+
+			return batch.size();
+		}
+
+		void IterationTearDown() override
+		{
+			SysUnit::CallCounts end = SysUnit::GetCallCounts();
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i)
+				calls[i] += end.calls[i] - iterationStart.calls[i];
+
+			int passedUp = 0;
+			for (auto * m : reassembled) {
+				for (; m != nullptr; m = m->m_next)
+					passedUp++;
+			}
+
+			heldQueues = std::max(heldQueues, uma_zone_get_cur(ipqZone));
+			heldMbufs = std::max(heldMbufs,
+			    uma_zone_get_cur(mbufZone) - passedUp);
+
+			fragments += batch.size();
+			sent += groups * datagrams.size();
+			completed += reassembled.size();
+
+			// Incomplete datagrams would otherwise be taken for
+			// retransmissions in the next iteration.
+			ipreass_drain();
+
+			for (auto * m : reassembled)
+				m_freem(m);
+			reassembled.clear();
+			batch.clear();
+		}
+
+		void BenchTearDown() override
+		{
+			SetCounter("completed", double(completed) / sent);
+
+			// ip_reass() reuses the queue of another datagram once
+			// the zone is exhausted, and counts its fragments as
+			// timed out.
+			SetCounter("evicted/frag",
+			    double(IPSTAT(ips_fragtimeout)) / fragments);
+
+			if (!config.complete) {
+				double perDatagram = double(groups * datagrams.size());
+				double fragLen = double(fragmentBytes) / fragments;
+
+				// Every fragment is in its own mbuf with external
+				// storage of the fragment's length.
+				SetCounter("queues/dgram", heldQueues / perDatagram);
+				SetCounter("mbufs/dgram", heldMbufs / perDatagram);
+				SetCounter("bytes/dgram",
+				    (heldQueues * sizeof(struct ipq) +
+				    heldMbufs * (MSIZE + fragLen)) / perDatagram);
+			}
+
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+				if (calls[i] == 0)
+					continue;
+
+				std::string name(fake_call_name(static_cast<fake_call>(i)));
+				SetCounter(name + "/frag", double(calls[i]) / fragments);
+			}
+
+			ipreass_drain();
+			// BenchSetUp() creates a new ipq zone for every run.
+			uma_zdestroy(ipqZone);
+			fake_counter_array_free(ipstat, nitems(ipstat));
+			datagrams.clear();
+		}
+	};
+
+	void RegisterReassBenchmark(const ReassBenchConfig & config)
+	{
+		std::string name = "ip_reass/" + config.Name();
+
+		SysUnit::RegisterBenchmark(name,
+		    [config] () -> std::unique_ptr<SysUnit::Benchmark>
+			{
+				return std::make_unique<ReassBenchmark>(config);
+			});
+	}
+
+	void RegisterReassBenchmarks()
+	{
+		// Reassembly throughput, one datagram at a time.
+		for (size_t frags : {2, 4, 8, 16})
+		for (Order order : {Order::IN_ORDER, Order::REVERSE, Order::SHUFFLE}) {
+			RegisterReassBenchmark(ReassBenchConfig{frags, order, 1,
+			    Buckets::SPREAD, true, 0});
+		}
+
+		// The cost of the bucket lookup with many datagrams queued at
+		// once, when the hash spreads them and when they all collide.
+		for (size_t datagrams : {16, 256, 1024})
+		for (Buckets buckets : {Buckets::SPREAD, Buckets::COLLIDE}) {
+			RegisterReassBenchmark(ReassBenchConfig{4, Order::IN_ORDER,
+			    datagrams, buckets, true, 0});
+		}
+
+		// Memory held by datagrams that never complete, as in a
+		// fragment flood, with the default and a low queue limit.
+		for (size_t datagrams : {256, 1024})
+		for (size_t maxQueues : {0, 128})
+		for (Buckets buckets : {Buckets::SPREAD, Buckets::COLLIDE}) {
+			RegisterReassBenchmark(ReassBenchConfig{4, Order::IN_ORDER,
+			    datagrams, buckets, false, maxQueues});
+		}
+	}
+
+	SYSUNIT_BENCHMARK_FAMILY(RegisterReassBenchmarks);
+}
@@ -0,0 +1 @@
+../freebsd/sys/netinet/ip_reass.c
\ No newline at end of file
@@ -0,0 +1,303 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/counter.h"
+#include "fake/mbuf.h"
+#include "fake/uma.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Fragmenter.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Udp.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/in_systm.h>
+#include <kern_include/netinet/ip.h>
+#include <kern_include/netinet/ip_var.h>
+#include <kern_include/vm/uma.h>
+
+// ip_var.h only declares these for the kernel.
+struct mbuf *ip_reass(struct mbuf *);
+void ipreass_init(void);
+void ipreass_slowtimo(void);
+void ipreass_drain(void);
+}
+
+#include <stubs/eventhandler.h>
+#include <stubs/ipstat.h>
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include <gtest/gtest.h>
+
+#include "sysunit/TestSuite.h"
+
+#include <vector>
+
+using namespace PktGen;
+using namespace testing;
+
+class IpReassTestSuite : public SysUnit::TestSuite
+{
+public:
+	// The default net.inet.ip.maxfragsperpacket.
+	static constexpr uint64_t MAXFRAGSPERPACKET = 16;
+
+	struct uma_zone * ipqZone;
+
+	void TestCaseSetUp() override
+	{
+		fake_counter_array_alloc(ipstat, nitems(ipstat));
+		ipreass_init();
+
+		ipqZone = fake_uma_find_zone("ipq");
+		ASSERT_NE(ipqZone, nullptr);
+	}
+
+	void TestCaseTearDown() override
+	{
+		// Free any fragments still queued before the mbuf zone is
+		// checked for leaks.
+		ipreass_drain();
+		EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+
+		// ipreass_init() creates a new ipq zone for every test.
+		uma_zdestroy(ipqZone);
+		fake_counter_array_free(ipstat, nitems(ipstat));
+	}
+
+	static auto GetTemplate(size_t len, uint16_t ipId = 1)
+	{
+		return PacketTemplate(
+			Ipv4Header().With(
+				src("10.0.0.1"),
+				dst("10.0.0.2"),
+				id(ipId)
+			),
+			UdpHeader().With(src(5000), dst(6000)),
+			PacketPayload().With(counterPayload(len))
+		);
+	}
+
+	// Pass every fragment in the list to ip_reass(), in order.  Only the
+	// last fragment may complete the datagram, which is returned.
+	template <typename List>
+	static MbufUniquePtr Reassemble(const List & frags)
+	{
+		struct mbuf * m = nullptr;
+
+		for (size_t i = 0; i < frags.size(); ++i) {
+			EXPECT_EQ(m, nullptr) << "datagram completed early by fragment " << i - 1;
+			m = ip_reass(frags.at(i).GenerateRawMbuf());
+		}
+
+		return MbufUniquePtr(m);
+	}
+
+	template <typename List>
+	void CheckReassembly(const List & frags)
+	{
+		auto m = Reassemble(frags);
+
+		ASSERT_NE(m.get(), nullptr);
+		EXPECT_THAT(m.get(), CompiledPacketMatcher(frags.Reassembled()));
+		EXPECT_EQ(IPSTAT(ips_fragments), frags.size());
+		EXPECT_EQ(IPSTAT(ips_reassembled), 1);
+		EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+	}
+};
+
+TEST_F(IpReassTestSuite, TestInOrder)
+{
+	auto frags = Fragment(GetTemplate(1000), 300);
+
+	ASSERT_EQ(frags.size(), 4);
+	CheckReassembly(frags);
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 0);
+}
+
+TEST_F(IpReassTestSuite, TestReverse)
+{
+	CheckReassembly(Fragment(GetTemplate(1000), 300, reverseFragments()));
+}
+
+TEST_F(IpReassTestSuite, TestShuffle)
+{
+	for (uint64_t seed = 1; seed <= 8; ++seed) {
+		SCOPED_TRACE(seed);
+
+		auto frags = Fragment(GetTemplate(4000, seed), 300,
+		    shuffleFragments(seed));
+		auto m = Reassemble(frags);
+
+		ASSERT_NE(m.get(), nullptr);
+		EXPECT_THAT(m.get(), CompiledPacketMatcher(frags.Reassembled()));
+	}
+
+	EXPECT_EQ(IPSTAT(ips_reassembled), 8);
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+}
+
+TEST_F(IpReassTestSuite, TestOverlap)
+{
+	CheckReassembly(Fragment(GetTemplate(1000), 300, fragOverlap(16),
+	    reverseFragments()));
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 0);
+}
+
+TEST_F(IpReassTestSuite, TestDuplicate)
+{
+	auto frags = Fragment(GetTemplate(1000), 300, duplicateFragment(1));
+
+	// The duplicate is counted as a fragment but is dropped, as it adds
+	// no new data.
+	CheckReassembly(frags);
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 1);
+}
+
+TEST_F(IpReassTestSuite, TestTinyFirstFragment)
+{
+	CheckReassembly(Fragment(GetTemplate(1000), 300, tinyFirstFragment()));
+}
+
+TEST_F(IpReassTestSuite, TestUnalignedFragment)
+{
+	// Every fragment but the last must carry a multiple of 8 bytes.
+	auto frag = PacketTemplate(
+		Ipv4Header().With(
+			src("10.0.0.1"),
+			dst("10.0.0.2"),
+			proto(IPPROTO_UDP),
+			moreFragments()
+		),
+		PacketPayload().With(counterPayload(13))
+	);
+
+	EXPECT_EQ(ip_reass(frag.GenerateRawMbuf()), nullptr);
+	EXPECT_EQ(IPSTAT(ips_toosmall), 1);
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 1);
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+}
+
+TEST_F(IpReassTestSuite, TestTimeout)
+{
+	auto frags = Fragment(GetTemplate(1000), 300, dropFragment(3));
+
+	EXPECT_EQ(Reassemble(frags).get(), nullptr);
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 1);
+
+	for (int i = 0; i < IPFRAGTTL - 1; ++i)
+		ipreass_slowtimo();
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 1);
+	EXPECT_EQ(IPSTAT(ips_fragtimeout), 0);
+
+	ipreass_slowtimo();
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+	EXPECT_EQ(IPSTAT(ips_fragtimeout), frags.size());
+}
+
+TEST_F(IpReassTestSuite, TestMaxFragsPerPacket)
+{
+	// 20 fragments of 8 bytes each, with the first one missing so that
+	// the datagram can never complete.
+	auto frags = Fragment(GetTemplate(152), sizeof(struct ip) + 8,
+	    dropFragment(0));
+
+	ASSERT_EQ(frags.size(), 19);
+	EXPECT_EQ(Reassemble(frags).get(), nullptr);
+
+	// The whole queue is dropped once it holds more fragments than the
+	// limit.  The fragments after that start a new queue.
+	EXPECT_EQ(IPSTAT(ips_fragdropped), MAXFRAGSPERPACKET + 1);
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 1);
+}
+
+TEST_F(IpReassTestSuite, TestConcurrentDatagrams)
+{
+	std::vector<decltype(Fragment(GetTemplate(1000), 300))> datagrams;
+
+	for (uint16_t i = 0; i < 64; ++i)
+		datagrams.push_back(Fragment(GetTemplate(1000, i), 300));
+
+	// Interleave the fragments of every datagram.
+	for (size_t f = 0; f < 4; ++f) {
+		for (auto & frags : datagrams) {
+			MbufUniquePtr m(ip_reass(frags.at(f).GenerateRawMbuf()));
+
+			if (f < 3) {
+				EXPECT_EQ(m.get(), nullptr);
+				continue;
+			}
+
+			ASSERT_NE(m.get(), nullptr);
+			EXPECT_THAT(m.get(),
+			    CompiledPacketMatcher(frags.Reassembled()));
+		}
+
+		if (f < 3)
+			EXPECT_EQ(uma_zone_get_cur(ipqZone), int(datagrams.size()));
+	}
+
+	EXPECT_EQ(IPSTAT(ips_reassembled), datagrams.size());
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+}
+
+TEST_F(IpReassTestSuite, TestZoneLimit)
+{
+	const int maxQueues = 4;
+
+	uma_zone_set_max(ipqZone, maxQueues);
+
+	// Once the zone is exhausted, the queue of another incomplete
+	// datagram is reclaimed for the new one.
+	for (uint16_t i = 0; i <= maxQueues; ++i) {
+		auto frags = Fragment(GetTemplate(1000, i), 300);
+		EXPECT_EQ(ip_reass(frags.at(0).GenerateRawMbuf()), nullptr);
+	}
+
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), maxQueues);
+	EXPECT_EQ(IPSTAT(ips_fragtimeout), 1);
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 0);
+}
+
+TEST_F(IpReassTestSuite, TestDrain)
+{
+	for (uint16_t i = 0; i < 3; ++i) {
+		auto frags = Fragment(GetTemplate(1000, i), 300, dropFragment(0));
+		EXPECT_EQ(Reassemble(frags).get(), nullptr);
+	}
+
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 3);
+
+	ipreass_drain();
+	EXPECT_EQ(uma_zone_get_cur(ipqZone), 0);
+	EXPECT_EQ(IPSTAT(ips_fragdropped), 9);
+}
@@ -0,0 +1,730 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/CallCounts.h"
+#include "fake/mbuf.h"
+
+#include "pktgen/Ethernet.h"
+#include "pktgen/Gre.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Ipv6Ext.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Rss.h"
+#include "pktgen/Tcp.h"
+#include "pktgen/Udp.h"
+#include "pktgen/Vlan.h"
+#include "pktgen/Vxlan.h"
+
+extern "C" {
+#include <kern_include/net/if.h>
+#include <kern_include/net/if_var.h>
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/tcp_lro.h>
+}
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/PerfCounters.h"
+
+#include "mock/CaptureIfnet.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace PktGen;
+using SysUnit::CaptureIfnet;
+
+int ipforwarding;
+int ip6_forwarding;
+
+namespace
+{
+	// How the flows are tagged: not at all, with the tag stripped by the
+	// NIC into the mbuf header, or with one or two tags left in the frame.
+	enum class VlanMode
+	{
+		NONE,
+		STRIPPED,
+		INBAND,
+		QINQ,
+	};
+
+	const uint16_t BENCH_VID = 100;
+
+	// The tunnel the TCP flows are carried in, if any.  The outer
+	// headers use the same addresses as the inner ones.
+	enum class TunnelMode
+	{
+		NONE,
+		VXLAN,
+		GRE,
+		IPIP,
+	};
+
+	const uint32_t BENCH_VNI = 5000;
+
+	// One point in the parameter matrix.  If mbufMax is non-zero, packets
+	// are queued with tcp_lro_queue_mbuf() and LRO sorts up to mbufMax of
+	// them at a time; otherwise they are passed directly to tcp_lro_rx().
+	// udpPercent of the packets are UDP datagrams and alertPercent are TCP
+	// segments with a router alert in the network layer, both of which LRO
+	// must reject.  If tunnel is set, the TCP flows are carried inside that
+	// encapsulation.
+	struct LroBenchConfig
+	{
+		bool ipv6;
+		size_t mbufMax;
+		size_t payloadLen;
+		size_t flows;
+		bool reorder;
+		unsigned ackPercent;
+		bool timestamps;
+		VlanMode vlan;
+		unsigned udpPercent;
+		unsigned alertPercent;
+		TunnelMode tunnel;
+
+		std::string Name() const
+		{
+			std::ostringstream name;
+
+			name << (ipv6 ? "ipv6" : "ipv4");
+			if (mbufMax == 0)
+				name << "/rx";
+			else
+				name << "/queue=" << mbufMax;
+			name << "/payload=" << payloadLen
+			    << "/flows=" << flows
+			    << "/" << (reorder ? "reorder" : "inorder")
+			    << "/ack=" << ackPercent
+			    << "/" << (timestamps ? "ts" : "nots");
+
+			switch (vlan) {
+			case VlanMode::NONE:
+				break;
+			case VlanMode::STRIPPED:
+				name << "/vlan=stripped";
+				break;
+			case VlanMode::INBAND:
+				name << "/vlan=inband";
+				break;
+			case VlanMode::QINQ:
+				name << "/vlan=qinq";
+				break;
+			}
+
+			if (udpPercent != 0)
+				name << "/udp=" << udpPercent;
+			if (alertPercent != 0)
+				name << "/alert=" << alertPercent;
+
+			switch (tunnel) {
+			case TunnelMode::NONE:
+				break;
+			case TunnelMode::VXLAN:
+				name << "/tunnel=vxlan";
+				break;
+			case TunnelMode::GRE:
+				name << "/tunnel=gre";
+				break;
+			case TunnelMode::IPIP:
+				name << "/tunnel=ipip";
+				break;
+			}
+			return name.str();
+		}
+	};
+
+	struct IPv4
+	{
+		static auto GetNetworkLayerTemplate()
+		{
+			return Ipv4Header().With(
+				src("10.1.0.1"),
+				dst("10.1.0.2"),
+				checksumVerified(),
+				checksumPassed()
+			);
+		}
+
+		static size_t GetNetworkHeaderLen()
+		{
+			return sizeof(struct ip);
+		}
+
+		static auto GetRouterAlertTemplate()
+		{
+			return PacketTemplate(
+				GetNetworkLayerTemplate().With(routerAlert())
+			);
+		}
+
+		static constexpr uint8_t RSS_HASH_TYPE = M_HASHTYPE_RSS_TCP_IPV4;
+		static constexpr uint8_t RSS_UDP_HASH_TYPE = M_HASHTYPE_RSS_UDP_IPV4;
+		static constexpr uint8_t RSS_2TUPLE_HASH_TYPE = M_HASHTYPE_RSS_IPV4;
+
+		static uint32_t RssHash(uint16_t sport, uint16_t dport)
+		{
+			struct in_addr srcAddr, dstAddr;
+
+			inet_pton(AF_INET, "10.1.0.1", &srcAddr);
+			inet_pton(AF_INET, "10.1.0.2", &dstAddr);
+			return RssHashTcpIpv4(srcAddr, dstAddr, sport, dport);
+		}
+	};
+
+	struct IPv6
+	{
+		static auto GetNetworkLayerTemplate()
+		{
+			return Ipv6Header().With(
+				src("fd00::1"),
+				dst("fd00::2")
+			);
+		}
+
+		static size_t GetNetworkHeaderLen()
+		{
+			return sizeof(struct ip6_hdr);
+		}
+
+		static auto GetRouterAlertTemplate()
+		{
+			return PacketTemplate(
+				GetNetworkLayerTemplate(),
+				HopByHopHeader().With(routerAlert())
+			);
+		}
+
+		static constexpr uint8_t RSS_HASH_TYPE = M_HASHTYPE_RSS_TCP_IPV6;
+		static constexpr uint8_t RSS_UDP_HASH_TYPE = M_HASHTYPE_RSS_UDP_IPV6;
+		static constexpr uint8_t RSS_2TUPLE_HASH_TYPE = M_HASHTYPE_RSS_IPV6;
+
+		static uint32_t RssHash(uint16_t sport, uint16_t dport)
+		{
+			struct in6_addr srcAddr, dstAddr;
+
+			inet_pton(AF_INET6, "fd00::1", &srcAddr);
+			inet_pton(AF_INET6, "fd00::2", &dstAddr);
+			return RssHashTcpIpv6(srcAddr, dstAddr, sport, dport);
+		}
+	};
+
+	// The number of iterations isn't known up front, so give every flow a
+	// stream long enough that it will never be exhausted.
+	const size_t FLOW_STREAM_LEN = size_t(1) << 40;
+
+	// Every flow carries the RSS hash that a NIC would report for it, as
+	// the queued path sorts packets by hash before merging them.  Tags is
+	// the number of in-band VLAN tags and Tunnel the encapsulation, both
+	// of which change the template's type.  Tunneled flows are hashed on
+	// the outer headers only, as a NIC without inner RSS would.
+	template <typename L3Proto, int Tags, TunnelMode Tunnel>
+	auto GetFlowTemplate(const LroBenchConfig & config, size_t flow)
+	{
+		size_t headerLen = L3Proto::GetNetworkHeaderLen() +
+		    sizeof(struct tcphdr);
+		uint32_t isn = 1000000 * (flow + 1);
+		uint16_t sport = 10000 + flow;
+
+		if (config.timestamps)
+			headerLen += TCPOLEN_TSTAMP_APPA;
+
+		auto l2 = EthernetHeader().With(
+			src("02:00:00:00:00:01"),
+			dst("02:00:00:00:00:02"),
+			hashType(L3Proto::RSS_HASH_TYPE),
+			flowid(L3Proto::RssHash(sport, 80))
+		);
+
+		auto l3 = PacketTemplate(
+			L3Proto::GetNetworkLayerTemplate().With(
+				mtu(headerLen + config.payloadLen)
+			),
+			TcpHeader().With(
+				src(sport),
+				dst(80),
+				seq(isn),
+				checksumVerified(),
+				checksumPassed()
+			),
+			PacketPayload().With(
+				seqPayload(isn, FLOW_STREAM_LEN)
+			)
+		);
+
+		auto pkt = [&] ()
+			{
+				if constexpr (Tunnel == TunnelMode::VXLAN)
+					return PacketTemplate(l2,
+					    L3Proto::GetNetworkLayerTemplate(),
+					    UdpHeader().With(
+						checksumVerified(),
+						checksumPassed()
+					    ),
+					    VxlanHeader().With(vni(BENCH_VNI)),
+					    EthernetHeader().With(
+						src("02:00:00:00:01:01"),
+						dst("02:00:00:00:01:02")
+					    ),
+					    l3);
+				else if constexpr (Tunnel == TunnelMode::GRE)
+					return PacketTemplate(l2,
+					    L3Proto::GetNetworkLayerTemplate(),
+					    GreHeader(), l3);
+				else if constexpr (Tunnel == TunnelMode::IPIP)
+					return PacketTemplate(l2,
+					    L3Proto::GetNetworkLayerTemplate(), l3);
+				else if constexpr (Tags == 0)
+					return PacketTemplate(l2, l3);
+				else if constexpr (Tags == 1)
+					return PacketTemplate(l2,
+					    VlanHeader().With(vid(BENCH_VID)), l3);
+				else
+					return PacketTemplate(l2,
+					    VlanHeader().With(tpid(ETHERTYPE_QINQ),
+						vid(BENCH_VID)),
+					    VlanHeader().With(vid(BENCH_VID)), l3);
+			}();
+
+		if (config.vlan == VlanMode::STRIPPED)
+			pkt = pkt.WithHeader(Layer::L2).Fields(mbufVlan(BENCH_VID));
+
+		// TSval advances with every segment, which is faster than a real
+		// clock but exercises the same comparison in LRO.
+		if (config.timestamps)
+			pkt = pkt.WithHeader(Layer::INNER_L4).Fields(
+			    timestamp(isn, 1));
+
+		if constexpr (Tunnel != TunnelMode::NONE) {
+			MbufUniquePtr m = pkt.Generate();
+			uint32_t hash = RssHashFrame(mtod(m.get(), uint8_t *),
+			    m->m_len);
+
+			pkt = pkt.WithHeader(Layer::L2).Fields(
+			    hashType(Tunnel == TunnelMode::VXLAN ?
+				L3Proto::RSS_UDP_HASH_TYPE :
+				L3Proto::RSS_2TUPLE_HASH_TYPE),
+			    flowid(hash));
+		}
+
+		return pkt;
+	}
+
+	// A UDP flow sharing the link with the TCP flows, as QUIC traffic
+	// would.  Its datagrams are the same size as the TCP segments.
+	template <typename L3Proto>
+	auto GetDatagramTemplate(const LroBenchConfig & config)
+	{
+		size_t headerLen = L3Proto::GetNetworkHeaderLen() +
+		    sizeof(struct udphdr);
+
+		return PacketTemplate(
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			L3Proto::GetNetworkLayerTemplate().With(
+				mtu(headerLen + config.payloadLen)
+			),
+			UdpHeader().With(
+				src(20000),
+				dst(443),
+				checksumVerified(),
+				checksumPassed()
+			),
+			PacketPayload().With(
+				payload('u', FLOW_STREAM_LEN)
+			)
+		);
+	}
+
+	// A TCP flow whose segments carry a router alert, which sends them
+	// down the slow path of IP input.  Its segments are the same size as
+	// those of the other flows.
+	template <typename L3Proto>
+	auto GetRouterAlertTemplate(const LroBenchConfig & config)
+	{
+		return PacketTemplate(
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			L3Proto::GetRouterAlertTemplate(),
+			TcpHeader().With(
+				src(30000),
+				dst(80),
+				seq(1),
+				mtu(sizeof(struct tcphdr) + config.payloadLen),
+				checksumVerified(),
+				checksumPassed()
+			),
+			PacketPayload().With(
+				seqPayload(1, FLOW_STREAM_LEN)
+			)
+		);
+	}
+
+	// Generates the packets for each batch.  Packets from the flows are
+	// interleaved round-robin.  A configurable percentage of the packets
+	// of each flow are pure ACKs, and in reorder mode every second pair of
+	// consecutive packets within a flow is swapped.  A percentage of the
+	// packets may be taken from other sources instead, such as a UDP flow.
+	template <typename Template>
+	class BatchGenerator
+	{
+	private:
+		struct OtherSource
+		{
+			unsigned percent;
+			unsigned credit;
+			std::function<struct mbuf *()> next;
+		};
+
+		const LroBenchConfig & config;
+		std::vector<Template> flows;
+		std::vector<unsigned> ackCredit;
+		std::vector<OtherSource> otherSources;
+		size_t nextFlow;
+
+		struct mbuf * NextPacket(size_t f)
+		{
+			auto & flow = flows.at(f);
+
+			ackCredit[f] += config.ackPercent;
+			if (ackCredit[f] >= 100) {
+				ackCredit[f] -= 100;
+				flow = flow.WithHeader(Layer::INNER_L4)
+				    .Fields(incrAck(1));
+				return flow.WithHeader(Layer::PAYLOAD)
+				    .Fields(length(0)).GenerateRawMbuf();
+			}
+
+			struct mbuf * m = flow.GenerateRawMbuf();
+			flow = flow.Next();
+			return m;
+		}
+
+	public:
+		template <typename Factory>
+		BatchGenerator(const LroBenchConfig & c, Factory factory)
+		  : config(c),
+		    ackCredit(c.flows, 0),
+		    nextFlow(0)
+		{
+			for (size_t f = 0; f < config.flows; ++f)
+				flows.push_back(factory(f));
+		}
+
+		void AddSource(unsigned percent,
+		    std::function<struct mbuf *()> source)
+		{
+			otherSources.push_back(
+			    OtherSource{percent, 0, std::move(source)});
+		}
+
+		void Generate(std::vector<struct mbuf *> & batch, size_t count)
+		{
+			batch.clear();
+			for (size_t i = 0; i < count; ++i) {
+				struct mbuf * m = nullptr;
+
+				for (auto & source : otherSources) {
+					source.credit += source.percent;
+					if (m == nullptr && source.credit >= 100) {
+						source.credit -= 100;
+						m = source.next();
+					}
+				}
+
+				if (m != nullptr) {
+					batch.push_back(m);
+					continue;
+				}
+
+				batch.push_back(NextPacket(nextFlow));
+				nextFlow = (nextFlow + 1) % config.flows;
+			}
+
+			if (!config.reorder)
+				return;
+
+			size_t n = config.flows;
+			for (size_t i = 0; i + 2 * n <= batch.size(); i += 2 * n)
+				std::swap_ranges(batch.begin() + i,
+				    batch.begin() + i + n, batch.begin() + i + n);
+		}
+	};
+
+
+	// Each iteration passes one batch of packets through LRO and then
+	// flushes it, as a driver would at the end of an rx interrupt.
+	template <typename L3Proto, int Tags, TunnelMode Tunnel>
+	class LroBenchmark : public SysUnit::Benchmark
+	{
+	private:
+		typedef decltype(GetFlowTemplate<L3Proto, Tags, Tunnel>(LroBenchConfig(), 0)) FlowTemplate;
+
+		static constexpr size_t BATCH_SIZE = 256;
+
+		LroBenchConfig config;
+		std::unique_ptr<CaptureIfnet> sink;
+		struct lro_ctrl lc;
+		std::optional<BatchGenerator<FlowTemplate>> gen;
+		std::vector<struct mbuf *> batch;
+		uint64_t packets;
+		uint64_t batches;
+
+		// Calls to the fakes made by the code under test during the
+		// timed part of each iteration.
+		SysUnit::CallCounts iterationStart;
+		std::array<uint64_t, FAKE_NUM_CALLS> calls{};
+
+	public:
+		explicit LroBenchmark(const LroBenchConfig & c)
+		  : config(c),
+		    packets(0),
+		    batches(0)
+		{
+		}
+
+		void BenchSetUp() override
+		{
+			sink = std::make_unique<CaptureIfnet>("bench", 0,
+			    CaptureIfnet::Mode::COUNT);
+			struct ifnet * ifp = sink->GetIfp();
+
+			ifp->if_capenable |= IFCAP_LRO;
+			tcp_lro_init_args(&lc, ifp, TCP_LRO_ENTRIES,
+			    config.mbufMax);
+
+			gen.emplace(config, [this] (size_t f)
+				{
+					return GetFlowTemplate<L3Proto, Tags, Tunnel>(config, f);
+				});
+
+			if (config.udpPercent != 0)
+				AddSource(config.udpPercent,
+				    GetDatagramTemplate<L3Proto>(config));
+			if (config.alertPercent != 0)
+				AddSource(config.alertPercent,
+				    GetRouterAlertTemplate<L3Proto>(config));
+		}
+
+		template <typename Template>
+		void AddSource(unsigned percent, Template pkt)
+		{
+			gen->AddSource(percent, [pkt] () mutable
+				{
+					struct mbuf * m = pkt.GenerateRawMbuf();
+					pkt = pkt.Next();
+					return m;
+				});
+		}
+
+		void IterationSetUp() override
+		{
+			SysUnit::PerfScope scope("generate", BATCH_SIZE);
+
+			gen->Generate(batch, BATCH_SIZE);
+			iterationStart = SysUnit::GetCallCounts();
+		}
+
+		size_t Iteration() override
+		{
+			struct ifnet * ifp = sink->GetIfp();
+
+			{
+				SysUnit::PerfScope scope("rx", batch.size());
+
+				for (auto * m : batch) {
+					if (config.mbufMax != 0)
+						tcp_lro_queue_mbuf(&lc, m);
+					else if (tcp_lro_rx(&lc, m, 0) != 0)
+						(*ifp->if_input)(ifp, m);
+				}
+			}
+
+			// In queued mode, this includes the cost of sorting the
+			// queued packets as well as merging them.  If mbufMax is
+			// smaller than the batch, some of that cost is incurred
+			// under "rx" instead.
+			{
+				SysUnit::PerfScope scope("flush", batch.size());
+
+				tcp_lro_flush_all(&lc);
+			}
+
+			return batch.size();
+		}
+
+		void IterationTearDown() override
+		{
+			SysUnit::CallCounts end = SysUnit::GetCallCounts();
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i)
+				calls[i] += end.calls[i] - iterationStart.calls[i];
+
+			packets += batch.size();
+			batches++;
+		}
+
+		void BenchTearDown() override
+		{
+			tcp_lro_free(&lc);
+
+			// The number of packets received per frame passed up the
+			// stack.
+			uint64_t frames = sink->GetPacketCount();
+			SetCounter("merge_ratio", double(packets) / frames);
+			SetCounter("flushes_per_batch", double(frames) / batches);
+
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+				if (calls[i] == 0)
+					continue;
+
+				std::string name(fake_call_name(static_cast<fake_call>(i)));
+				SetCounter(name + "/pkt", double(calls[i]) / packets);
+			}
+
+			gen.reset();
+			sink.reset();
+		}
+	};
+
+	template <typename L3Proto>
+	std::unique_ptr<SysUnit::Benchmark>
+	MakeLroBenchmark(const LroBenchConfig & config)
+	{
+		switch (config.tunnel) {
+		case TunnelMode::VXLAN:
+			return std::make_unique<LroBenchmark<L3Proto, 0, TunnelMode::VXLAN>>(config);
+		case TunnelMode::GRE:
+			return std::make_unique<LroBenchmark<L3Proto, 0, TunnelMode::GRE>>(config);
+		case TunnelMode::IPIP:
+			return std::make_unique<LroBenchmark<L3Proto, 0, TunnelMode::IPIP>>(config);
+		default:
+			break;
+		}
+
+		switch (config.vlan) {
+		case VlanMode::INBAND:
+			return std::make_unique<LroBenchmark<L3Proto, 1, TunnelMode::NONE>>(config);
+		case VlanMode::QINQ:
+			return std::make_unique<LroBenchmark<L3Proto, 2, TunnelMode::NONE>>(config);
+		default:
+			return std::make_unique<LroBenchmark<L3Proto, 0, TunnelMode::NONE>>(config);
+		}
+	}
+
+	void RegisterLroBenchmark(const LroBenchConfig & config)
+	{
+		std::string name = "tcp_lro/" + config.Name();
+
+		SysUnit::RegisterBenchmark(name,
+		    [config] () -> std::unique_ptr<SysUnit::Benchmark>
+			{
+				if (config.ipv6)
+					return MakeLroBenchmark<IPv6>(config);
+				else
+					return MakeLroBenchmark<IPv4>(config);
+			});
+	}
+
+	void RegisterLroBenchmarks()
+	{
+		for (bool ipv6 : {false, true})
+		for (size_t mbufMax : {0, 32, 256})
+		for (size_t payloadLen : {128, 1448})
+		for (size_t flows : {1, 8, 64})
+		for (bool reorder : {false, true})
+		for (unsigned ackPercent : {0, 50})
+		for (bool timestamps : {false, true}) {
+			RegisterLroBenchmark(LroBenchConfig{ipv6, mbufMax,
+			    payloadLen, flows, reorder, ackPercent, timestamps,
+			    VlanMode::NONE, 0, 0, TunnelMode::NONE});
+		}
+
+		// Compare the cost of parsing tagged frames against frames whose
+		// tag was stripped by the NIC, on the common in-order path only.
+		for (bool ipv6 : {false, true})
+		for (size_t payloadLen : {128, 1448})
+		for (size_t flows : {1, 64})
+		for (VlanMode vlan : {VlanMode::STRIPPED, VlanMode::INBAND,
+		    VlanMode::QINQ}) {
+			RegisterLroBenchmark(LroBenchConfig{ipv6, 0, payloadLen,
+			    flows, false, 0, true, vlan, 0, 0, TunnelMode::NONE});
+		}
+
+		// Measure the cost of rejecting UDP datagrams mixed in with the
+		// TCP flows.  The udp=0 point is in the main matrix.
+		for (bool ipv6 : {false, true})
+		for (size_t payloadLen : {128, 1448})
+		for (size_t flows : {1, 64})
+		for (unsigned udpPercent : {10, 50, 90}) {
+			RegisterLroBenchmark(LroBenchConfig{ipv6, 0, payloadLen,
+			    flows, false, 0, true, VlanMode::NONE, udpPercent, 0,
+			    TunnelMode::NONE});
+		}
+
+		// Measure the cost of rejecting TCP segments that carry IPv4
+		// options or an IPv6 hop-by-hop header.
+		for (bool ipv6 : {false, true})
+		for (size_t payloadLen : {128, 1448})
+		for (size_t flows : {1, 64})
+		for (unsigned alertPercent : {10, 50, 90}) {
+			RegisterLroBenchmark(LroBenchConfig{ipv6, 0, payloadLen,
+			    flows, false, 0, true, VlanMode::NONE, 0, alertPercent,
+			    TunnelMode::NONE});
+		}
+
+		// Overlay traffic: the TCP flows are only visible inside the
+		// tunnel, and the NIC's RSS hash only covers the outer headers.
+		for (bool ipv6 : {false, true})
+		for (size_t payloadLen : {128, 1448})
+		for (size_t flows : {1, 64})
+		for (TunnelMode tunnel : {TunnelMode::VXLAN, TunnelMode::GRE,
+		    TunnelMode::IPIP}) {
+			RegisterLroBenchmark(LroBenchConfig{ipv6, 0, payloadLen,
+			    flows, false, 0, true, VlanMode::NONE, 0, 0, tunnel});
+		}
+	}
+
+	SYSUNIT_BENCHMARK_FAMILY(RegisterLroBenchmarks);
+}
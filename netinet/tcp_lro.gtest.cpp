@@ -29,10 +29,13 @@
 #include "pktgen/Ethernet.h"
 #include "pktgen/Ipv4.h"
 #include "pktgen/Ipv6.h"
+#include "pktgen/Ipv6Ext.h"
 #include "pktgen/Packet.h"
 #include "pktgen/PacketMatcher.h"
 #include "pktgen/PacketPayload.h"
+#include "pktgen/PacketStream.h"
 #include "pktgen/Tcp.h"
+#include "pktgen/Udp.h"
 
 extern "C" {
 #include <kern_include/net/if.h>
@@ -46,13 +49,18 @@ extern "C" {
 
 #include <gtest/gtest.h>
 
+#include "fake/CallCounts.h"
+
+#include "sysunit/PerfCounters.h"
 #include "sysunit/TestSuite.h"
 
+#include "mock/CaptureIfnet.h"
 #include "mock/UpperIfnet.h"
 #include "mock/time.h"
 
 using namespace PktGen;
 using namespace testing;
+using SysUnit::CaptureIfnet;
 using SysUnit::MockTime;
 using SysUnit::MockUpperIfnet;
 
@@ -92,6 +100,42 @@ public:
 
 	static size_t GetNetworkHeaderLen();
 
+	// The RSS hash type that a NIC would report for a TCP packet of this
+	// network protocol.
+	static uint8_t GetRssHashType();
+
+	// Generate a payload template for the same flow as GetPayloadTemplate()
+	// whose network layer carries a router alert: an IPv4 option or an
+	// IPv6 hop-by-hop header.  Both send the packet down the slow path of
+	// IP input.
+	static auto GetRouterAlertTemplate();
+
+	// The error that tcp_lro_rx() returns for a packet carrying IPv4
+	// options or IPv6 extension headers.
+	static int GetIpOptionsError();
+
+	// Reinitialize the LRO instance so that packets can be queued with
+	// tcp_lro_queue_mbuf().  Up to mbufMax packets are queued before LRO
+	// sorts and flushes them, and flushed packets are passed to ifp.
+	void EnableQueuedMode(struct ifnet * ifp, unsigned mbufMax)
+	{
+		tcp_lro_free(&lc);
+
+		ifp->if_capenable |= IFCAP_LRO;
+		ASSERT_EQ(tcp_lro_init_args(&lc, ifp, TCP_LRO_ENTRIES, mbufMax), 0);
+	}
+
+	// Generate a payload template for a flow that the NIC has hashed
+	// to the given flowid.
+	static auto GetHashedTemplate(uint32_t id)
+	{
+		return GetPayloadTemplate()
+		    .WithHeader(Layer::L2).Fields(
+			hashType(GetRssHashType()),
+			flowid(id)
+		    );
+	}
+
 	void TestUnsupportedFlag(uint8_t flag);
 
 	// For convenience, this function can be called to create a
@@ -152,6 +196,25 @@ size_t TcpLroTestSuite<IPv4>::GetNetworkHeaderLen()
 	return sizeof(struct ip);
 }
 
+template<>
+uint8_t TcpLroTestSuite<IPv4>::GetRssHashType()
+{
+	return M_HASHTYPE_RSS_TCP_IPV4;
+}
+
+template<>
+auto TcpLroTestSuite<IPv4>::GetRouterAlertTemplate()
+{
+	return GetPayloadTemplate()
+	    .WithHeader(Layer::L3).Fields(routerAlert());
+}
+
+template<>
+int TcpLroTestSuite<IPv4>::GetIpOptionsError()
+{
+	return TCP_LRO_CANNOT;
+}
+
 struct IPv6 {};
 
 // Generate a IPv6 header template.
@@ -171,6 +234,41 @@ size_t TcpLroTestSuite<IPv6>::GetNetworkHeaderLen()
 	return sizeof(struct ip6_hdr);
 }
 
+template<>
+uint8_t TcpLroTestSuite<IPv6>::GetRssHashType()
+{
+	return M_HASHTYPE_RSS_TCP_IPV6;
+}
+
+template<>
+auto TcpLroTestSuite<IPv6>::GetRouterAlertTemplate()
+{
+	return PacketTemplate(
+	    EthernetHeader()
+		.With(
+		src("02:f0:e0:d0:c0:b0"),
+		dst("02:05:04:0c:02:01")
+		),
+	    GetNetworkLayerTemplate(),
+	    HopByHopHeader().With(routerAlert()),
+	    TcpHeader()
+		.With(
+		src(6995),
+		dst(123),
+		checksumVerified(),
+		checksumPassed()
+		),
+	    PacketPayload()
+	);
+}
+
+// LRO only looks at the next header field of the IPv6 header.
+template<>
+int TcpLroTestSuite<IPv6>::GetIpOptionsError()
+{
+	return TCP_LRO_NOT_SUPPORTED;
+}
+
 typedef ::testing::Types<IPv4, IPv6> NetworkTypes;
 TYPED_TEST_CASE(TcpLroTestSuite, NetworkTypes);
 
@@ -705,6 +803,57 @@ TYPED_TEST(TcpLroTestSuite, TestTwoVlanFlows)
 	tcp_lro_flush_all(&this->lc);
 }
 
+// LRO only aggregates TCP.  Interleave a UDP datagram with a TCP flow and
+// verify that the datagram is rejected untouched, so that the driver can pass
+// it up the stack itself, while the TCP segments around it are still merged.
+TYPED_TEST(TcpLroTestSuite, TestUdpNotMerged)
+{
+	auto tcp1 = this->GetPayloadTemplate()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("Free"));
+	auto tcp2 = tcp1.Next()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("BSD"));
+	auto expected = tcp1.With(appendPayload("BSD"));
+
+	auto udp = PacketTemplate(
+	    EthernetHeader()
+		.With(
+		src("02:f0:e0:d0:c0:b0"),
+		dst("02:05:04:0c:02:01")
+		),
+	    this->GetNetworkLayerTemplate(),
+	    UdpHeader()
+		.With(
+		src(6995),
+		dst(123),
+		checksumVerified(),
+		checksumPassed()
+		),
+	    PacketPayload().With(payload("datagram"))
+	);
+
+	EXPECT_CALL(*this->mockIfp, if_input(PacketMatcher(expected)))
+	    .Times(1);
+
+	MockTime::ExpectGetMicrotime({.tv_sec = 5489, .tv_usec = 25847});
+	MockTime::ExpectGetMicrotime({.tv_sec = 5489, .tv_usec = 25979});
+
+	// Begin the testcase
+	int ret;
+
+	ret = tcp_lro_rx(&this->lc, tcp1.GenerateRawMbuf(), 0);
+	ASSERT_EQ(ret, 0);
+
+	MbufUniquePtr m = udp.Generate();
+	ret = tcp_lro_rx(&this->lc, m.get(), 0);
+	ASSERT_EQ(ret, TCP_LRO_NOT_SUPPORTED);
+	EXPECT_THAT(m.get(), PacketMatcher(udp));
+
+	ret = tcp_lro_rx(&this->lc, tcp2.GenerateRawMbuf(), 0);
+	ASSERT_EQ(ret, 0);
+
+	tcp_lro_flush_all(&this->lc);
+}
+
 // Test that tcp_lro will not accept any packets if ip[6]_forwarding is enabled.
 // LRO cannot be used on a router as it would modify packets in flight.
 TYPED_TEST(TcpLroTestSuite, TestForwardingEnabled)
@@ -889,6 +1038,340 @@ TYPED_TEST(TcpLroTestSuite, TestAutoFlush)
 	}
 }
 
+// Send a long run of in-order segments, flushing LRO after every few segments,
+// and capture every frame passed to if_input().  Each flush must produce a
+// single frame carrying the merged payload of the segments received since the
+// previous flush.  The captured frames are verified in a single pass at the
+// end of the test rather than through one gmock expectation per frame.
+TYPED_TEST(TcpLroTestSuite, TestCoalescedStream)
+{
+	const size_t ifMtu = 1500;
+	const size_t segsPerFlush = 8;
+	const size_t flushes = 64;
+	size_t headerLen = this->GetNetworkHeaderLen() + sizeof(struct tcphdr);
+	size_t segLen = ifMtu - headerLen;
+
+	CaptureIfnet capture("capture", 0);
+	capture.GetIfp()->if_mtu = ifMtu;
+	this->lc.ifp = capture.GetIfp();
+
+	const uint32_t isn = 3126770;
+
+	// Each word of the payload encodes its own sequence number, so a
+	// segment merged at the wrong offset cannot go unnoticed.
+	auto pkt = this->GetPayloadTemplate()
+	    .WithHeader(Layer::L3).Fields(mtu(ifMtu))
+	    .WithHeader(Layer::L4).Fields(seq(isn))
+	    .WithHeader(Layer::PAYLOAD).Fields(
+		seqPayload(isn, segLen * segsPerFlush * flushes)
+	    );
+
+	MockTime::AllowGetMicrotime({.tv_sec = 17, .tv_usec = 500});
+
+	ExpectedPacketStream expected;
+	for (size_t i = 0; i < flushes; ++i) {
+		// The merged frame has the headers of the first segment in the
+		// batch and the payload of every segment in the batch.
+		expected.Append(pkt
+		    .WithHeader(Layer::L3).Fields(mtu(headerLen + segLen * segsPerFlush)));
+
+		for (size_t j = 0; j < segsPerFlush; ++j) {
+			struct mbuf * m = pkt.GenerateRawMbuf();
+			int ret;
+			{
+				SysUnit::PerfScope scope("rx");
+				ret = tcp_lro_rx(&this->lc, m, 0);
+			}
+			ASSERT_EQ(ret, 0);
+
+			pkt = pkt.Next();
+		}
+
+		SysUnit::PerfScope scope("flush", segsPerFlush);
+		tcp_lro_flush_all(&this->lc);
+	}
+
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
+
+// Merge a batch of segments whose checksums were verified by the NIC and
+// check LRO's performance contract: merging and flushing must not allocate
+// or free memory, and must not calculate any checksums in software.
+TYPED_TEST(TcpLroTestSuite, TestMergeCallCounts)
+{
+	const size_t segs = 16;
+
+	CaptureIfnet capture("capture", 0);
+	this->lc.ifp = capture.GetIfp();
+
+	auto pkt = this->GetPayloadTemplate()
+	    .WithHeader(Layer::PAYLOAD).Fields(counterPayload(100));
+
+	std::vector<struct mbuf *> batch;
+	for (size_t i = 0; i < segs; ++i) {
+		batch.push_back(pkt.GenerateRawMbuf());
+		pkt = pkt.Next();
+	}
+
+	MockTime::AllowGetMicrotime({.tv_sec = 3, .tv_usec = 250});
+
+	SysUnit::ResetCallCounts();
+	for (auto * m : batch)
+		ASSERT_EQ(tcp_lro_rx(&this->lc, m, 0), 0);
+	tcp_lro_flush_all(&this->lc);
+
+	SysUnit::CallCounts calls = SysUnit::GetCallCounts();
+	EXPECT_EQ(calls[FAKE_CALL_UMA_ZALLOC], 0);
+	EXPECT_EQ(calls[FAKE_CALL_UMA_ZFREE], 0);
+	EXPECT_EQ(calls[FAKE_CALL_KMALLOC], 0);
+	EXPECT_EQ(calls[FAKE_CALL_KFREE], 0);
+	EXPECT_EQ(calls[FAKE_CALL_M_FREEM], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN_CKSUM_HDR], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN_CKSUM_SKIP], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN6_CKSUM], 0);
+
+	EXPECT_EQ(capture.GetLog().size(), 1);
+}
+
+// Send three in-order segments that carry the timestamp option, the last of
+// which also echoes a newer timestamp.  Verify that LRO merges them and that
+// the merged frame carries the TSval and TSecr of the last segment, as LRO
+// rewrites the option of the first segment when it flushes.
+TYPED_TEST(TcpLroTestSuite, TestMergeTimestamps)
+{
+	CaptureIfnet capture("capture", 0);
+	this->lc.ifp = capture.GetIfp();
+
+	auto pkt1 = this->GetPayloadTemplate()
+	    .WithHeader(Layer::L4).Fields(seq(7000), timestamp(1000, 500))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("first"));
+	auto pkt2 = pkt1.Next()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("second"));
+	auto pkt3 = pkt2.Next()
+	    .WithHeader(Layer::L4).Fields(timestamp(1002, 510))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("third"));
+
+	auto expect = pkt1
+	    .WithHeader(Layer::L4).Fields(timestamp(1002, 510))
+	    .WithHeader(Layer::PAYLOAD).Fields(appendPayload("second"))
+	    .WithHeader(Layer::PAYLOAD).Fields(appendPayload("third"));
+
+	MockTime::AllowGetMicrotime({.tv_sec = 12, .tv_usec = 3400});
+
+	ASSERT_EQ(tcp_lro_rx(&this->lc, pkt1.GenerateRawMbuf(), 0), 0);
+	ASSERT_EQ(tcp_lro_rx(&this->lc, pkt2.GenerateRawMbuf(), 0), 0);
+	ASSERT_EQ(tcp_lro_rx(&this->lc, pkt3.GenerateRawMbuf(), 0), 0);
+	tcp_lro_flush_all(&this->lc);
+
+	ExpectedPacketStream expected;
+	expected.Append(expect);
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
+
+// Send a segment whose TSval is older than that of the previous segment in
+// the flow.  LRO must not merge it, as the timestamp of the merged frame
+// could not represent both segments.
+TYPED_TEST(TcpLroTestSuite, TestTimestampBackwards)
+{
+	CaptureIfnet capture("capture", 0);
+	this->lc.ifp = capture.GetIfp();
+
+	auto pkt1 = this->GetPayloadTemplate()
+	    .WithHeader(Layer::L4).Fields(timestamp(1000, 500))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("first"));
+	auto pkt2 = pkt1.Next()
+	    .WithHeader(Layer::L4).Fields(timestamp(999, 500));
+
+	MockTime::AllowGetMicrotime({.tv_sec = 12, .tv_usec = 3400});
+
+	ASSERT_EQ(tcp_lro_rx(&this->lc, pkt1.GenerateRawMbuf(), 0), 0);
+
+	MbufUniquePtr m = pkt2.Generate();
+	EXPECT_EQ(tcp_lro_rx(&this->lc, m.get(), 0), TCP_LRO_CANNOT);
+
+	tcp_lro_flush_all(&this->lc);
+
+	ExpectedPacketStream expected;
+	expected.Append(pkt1);
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
+
+// LRO only understands the timestamp option in the layout recommended by
+// RFC 7323 appendix A.  Verify that segments carrying any other options are
+// rejected outright.
+TYPED_TEST(TcpLroTestSuite, TestOtherOptionsRejected)
+{
+	auto pkt = this->GetPayloadTemplate()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("options"));
+
+	auto sackPkt = pkt.WithHeader(Layer::L4).Fields(
+	    timestamp(1000, 500), sack({{100, 200}}));
+	MbufUniquePtr m = sackPkt.Generate();
+	EXPECT_EQ(tcp_lro_rx(&this->lc, m.get(), 0), TCP_LRO_CANNOT);
+
+	auto mssPkt = pkt.WithHeader(Layer::L4).Fields(mss(1460));
+	m = mssPkt.Generate();
+	EXPECT_EQ(tcp_lro_rx(&this->lc, m.get(), 0), TCP_LRO_CANNOT);
+}
+
+// Queue interleaved packets from three flows with tcp_lro_queue_mbuf().
+// Nothing may be passed up the stack until tcp_lro_flush_all() is called,
+// which sorts the queued packets by hash type and flowid and merges each
+// flow.  Verify that each flow is merged into a single packet and that the
+// flows are flushed in flowid order rather than arrival order.
+TYPED_TEST(TcpLroTestSuite, TestQueuedSortByFlowid)
+{
+	CaptureIfnet capture("capture", 0);
+	this->EnableQueuedMode(capture.GetIfp(), 32);
+
+	const uint32_t flowids[] = { 0x300, 0x100, 0x200 };
+	const size_t segs = 3;
+
+	std::vector<decltype(this->GetHashedTemplate(0))> flows;
+	for (size_t i = 0; i < std::size(flowids); ++i) {
+		flows.push_back(this->GetHashedTemplate(flowids[i])
+		    .WithHeader(Layer::L4).Fields(src(1000 + i), dst(80))
+		    .WithHeader(Layer::PAYLOAD).Fields(payload("seg0")));
+	}
+
+	// Each flow is expected to be merged into its first packet, with
+	// the payloads of all of its packets appended in order.
+	auto expected = flows;
+
+	MockTime::AllowGetMicrotime({.tv_sec = 91, .tv_usec = 6004});
+
+	for (size_t j = 0; j < segs; ++j) {
+		for (size_t i = 0; i < flows.size(); ++i) {
+			tcp_lro_queue_mbuf(&this->lc, flows[i].GenerateRawMbuf());
+
+			std::string next = "seg" + std::to_string(j + 1);
+			flows[i] = flows[i].Next()
+			    .WithHeader(Layer::PAYLOAD).Fields(payload(next.c_str()));
+			if (j + 1 < segs)
+				expected[i] = expected[i]
+				    .WithHeader(Layer::PAYLOAD).Fields(appendPayload(next.c_str()));
+		}
+	}
+
+	EXPECT_EQ(capture.GetLog().size(), 0);
+
+	tcp_lro_flush_all(&this->lc);
+
+	ExpectedPacketStream stream;
+	stream.Append(expected[1]);
+	stream.Append(expected[2]);
+	stream.Append(expected[0]);
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(stream));
+}
+
+// Queue interleaved packets from two flows that the NIC hashed to the same
+// flowid.  Sorting places the packets of both flows in the same run, but LRO
+// must still look up each packet's flow by its headers and keep the two flows
+// separate.  The order in which the two flows are flushed is unspecified.
+TYPED_TEST(TcpLroTestSuite, TestQueuedFlowidCollision)
+{
+	CaptureIfnet capture("capture", 0);
+	this->EnableQueuedMode(capture.GetIfp(), 32);
+
+	auto flow1_pkt1 = this->GetHashedTemplate(0x7)
+	    .WithHeader(Layer::L4).Fields(src(5), dst(6))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("flow1"));
+
+	auto flow2_pkt1 = this->GetHashedTemplate(0x7)
+	    .WithHeader(Layer::L4).Fields(src(104), dst(1028))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("flow2"));
+
+	auto flow1_pkt2 = flow1_pkt1.Next()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("more"));
+	auto flow2_pkt2 = flow2_pkt1.Next()
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("yet more"));
+
+	auto flow1_expect = flow1_pkt1
+	    .WithHeader(Layer::PAYLOAD).Fields(appendPayload("more"));
+	auto flow2_expect = flow2_pkt1
+	    .WithHeader(Layer::PAYLOAD).Fields(appendPayload("yet more"));
+
+	MockTime::AllowGetMicrotime({.tv_sec = 5489, .tv_usec = 25847});
+
+	tcp_lro_queue_mbuf(&this->lc, flow1_pkt1.GenerateRawMbuf());
+	tcp_lro_queue_mbuf(&this->lc, flow2_pkt1.GenerateRawMbuf());
+	tcp_lro_queue_mbuf(&this->lc, flow1_pkt2.GenerateRawMbuf());
+	tcp_lro_queue_mbuf(&this->lc, flow2_pkt2.GenerateRawMbuf());
+	tcp_lro_flush_all(&this->lc);
+
+	EXPECT_THAT(capture.GetLog(), UnorderedElementsAre(
+	    CompiledPacketMatcher(flow1_expect),
+	    CompiledPacketMatcher(flow2_expect)));
+}
+
+// Queue packets with tcp_lro_queue_mbuf() while LRO is disabled on the
+// interface.  Each packet must be passed up the stack immediately without
+// being queued or merged.
+TYPED_TEST(TcpLroTestSuite, TestQueuedLroDisabled)
+{
+	CaptureIfnet capture("capture", 0);
+	this->EnableQueuedMode(capture.GetIfp(), 32);
+	capture.GetIfp()->if_capenable &= ~IFCAP_LRO;
+
+	auto pkt1 = this->GetHashedTemplate(0x55)
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("bypass"));
+	auto pkt2 = pkt1.Next();
+
+	tcp_lro_queue_mbuf(&this->lc, pkt1.GenerateRawMbuf());
+	EXPECT_EQ(capture.GetLog().size(), 1);
+
+	tcp_lro_queue_mbuf(&this->lc, pkt2.GenerateRawMbuf());
+	EXPECT_EQ(capture.GetLog().size(), 2);
+
+	tcp_lro_flush_all(&this->lc);
+
+	ExpectedPacketStream expected;
+	expected.Append(pkt1);
+	expected.Append(pkt2);
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
+
+// Queue more packets than the LRO instance was configured to hold.  When the
+// queue fills, tcp_lro_queue_mbuf() must sort and flush the queued packets
+// itself; the remaining packets are flushed by tcp_lro_flush_all().
+TYPED_TEST(TcpLroTestSuite, TestQueuedMbufMax)
+{
+	const unsigned mbufMax = 4;
+	const size_t segs = 6;
+	const size_t segLen = 100;
+	size_t headerLen = this->GetNetworkHeaderLen() + sizeof(struct tcphdr);
+
+	CaptureIfnet capture("capture", 0);
+	this->EnableQueuedMode(capture.GetIfp(), mbufMax);
+
+	const uint32_t isn = 81321;
+	auto pkt = this->GetHashedTemplate(0x2a)
+	    .WithHeader(Layer::L3).Fields(mtu(headerLen + segLen))
+	    .WithHeader(Layer::L4).Fields(seq(isn))
+	    .WithHeader(Layer::PAYLOAD).Fields(seqPayload(isn, segLen * segs));
+
+	MockTime::AllowGetMicrotime({.tv_sec = 640, .tv_usec = 1});
+
+	ExpectedPacketStream expected;
+	expected.Append(pkt
+	    .WithHeader(Layer::L3).Fields(mtu(headerLen + segLen * mbufMax)));
+
+	for (size_t i = 0; i < segs; ++i) {
+		if (i == mbufMax) {
+			EXPECT_EQ(capture.GetLog().size(), 1);
+			expected.Append(pkt.WithHeader(Layer::L3).Fields(
+			    mtu(headerLen + segLen * (segs - mbufMax))));
+		}
+
+		tcp_lro_queue_mbuf(&this->lc, pkt.GenerateRawMbuf());
+		pkt = pkt.Next();
+	}
+
+	tcp_lro_flush_all(&this->lc);
+
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
+
 // Send a data packet followed by a packet with an TCP flag that LRO
 // does not support merging into other packets.  Verify that the data
 // packet is flushed up the stack and the second packet with the unsupported
@@ -958,3 +1441,45 @@ TYPED_TEST(TcpLroTestSuite, TestCwr)
 {
 	this->TestUnsupportedFlag(TH_CWR);
 }
+
+// Send a segment that carries a router alert in the network layer header after
+// a plain segment of the same flow.  LRO must reject it before doing any work
+// on it: the packet is untouched, the flow already in LRO is not flushed, and
+// no memory is allocated or checksum calculated.
+TYPED_TEST(TcpLroTestSuite, TestRouterAlertRejected)
+{
+	CaptureIfnet capture("capture", 0);
+	this->lc.ifp = capture.GetIfp();
+
+	auto pkt1 = this->GetPayloadTemplate()
+	    .WithHeader(Layer::L4).Fields(seq(1000))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("plain", 100));
+	auto pkt2 = this->GetRouterAlertTemplate()
+	    .WithHeader(Layer::L4).Fields(seq(1100))
+	    .WithHeader(Layer::PAYLOAD).Fields(payload("alert", 100));
+
+	MockTime::AllowGetMicrotime({.tv_sec = 78, .tv_usec = 1200});
+
+	ASSERT_EQ(tcp_lro_rx(&this->lc, pkt1.GenerateRawMbuf(), 0), 0);
+
+	MbufUniquePtr m = pkt2.Generate();
+	SysUnit::ResetCallCounts();
+	EXPECT_EQ(tcp_lro_rx(&this->lc, m.get(), 0), this->GetIpOptionsError());
+
+	SysUnit::CallCounts calls = SysUnit::GetCallCounts();
+	EXPECT_EQ(calls[FAKE_CALL_UMA_ZALLOC], 0);
+	EXPECT_EQ(calls[FAKE_CALL_KMALLOC], 0);
+	EXPECT_EQ(calls[FAKE_CALL_M_FREEM], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN_CKSUM_HDR], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN_CKSUM_SKIP], 0);
+	EXPECT_EQ(calls[FAKE_CALL_IN6_CKSUM], 0);
+
+	EXPECT_THAT(m.get(), PacketMatcher(pkt2));
+	EXPECT_EQ(capture.GetLog().size(), 0);
+
+	tcp_lro_flush_all(&this->lc);
+
+	ExpectedPacketStream expected;
+	expected.Append(pkt1);
+	EXPECT_THAT(capture.GetLog(), PacketStreamMatcher(expected));
+}
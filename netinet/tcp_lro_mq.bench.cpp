@@ -0,0 +1,340 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Rss.h"
+#include "pktgen/Tcp.h"
+
+extern "C" {
+#include <kern_include/net/if.h>
+#include <kern_include/net/if_var.h>
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/tcp_lro.h>
+}
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/WorkerPool.h"
+
+#include "mock/CaptureIfnet.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PktGen;
+using SysUnit::CaptureIfnet;
+
+int ipforwarding;
+int ip6_forwarding;
+
+namespace
+{
+	// Models a multi-queue NIC: every receive queue has its own lro_ctrl,
+	// processed by its own thread pinned to its own CPU, and flows are
+	// steered to queues by their RSS hash.
+	struct MqBenchConfig
+	{
+		size_t queues;
+		size_t flows;
+		bool queued;
+
+		// In the packed layout the queues' lro_ctrl structures are
+		// allocated back-to-back, so neighbouring queues can share
+		// cache lines.  In the padded layout each one starts on its
+		// own cache line, as in a driver's per-queue softc.
+		bool padded;
+
+		std::string Name() const
+		{
+			std::ostringstream name;
+
+			name << "queues=" << queues
+			    << "/flows=" << flows
+			    << "/" << (queued ? "queue" : "rx")
+			    << "/" << (padded ? "padded" : "packed");
+			return name.str();
+		}
+	};
+
+	const size_t CACHE_LINE_SIZE = 128;
+	const size_t RSS_TABLE_SIZE = 128;
+	const size_t PAYLOAD_LEN = 1448;
+	const size_t FLOW_STREAM_LEN = size_t(1) << 40;
+
+	auto GetFlowTemplate(size_t flow)
+	{
+		size_t headerLen = sizeof(struct ip) + sizeof(struct tcphdr);
+		uint32_t isn = 1000000 * (flow + 1);
+
+		return PacketTemplate(
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			Ipv4Header().With(
+				src("10.1.0.1"),
+				dst("10.1.0.2"),
+				mtu(headerLen + PAYLOAD_LEN),
+				checksumVerified(),
+				checksumPassed()
+			),
+			TcpHeader().With(
+				src(10000 + flow),
+				dst(80),
+				seq(isn),
+				checksumVerified(),
+				checksumPassed()
+			),
+			PacketPayload().With(
+				seqPayload(isn, FLOW_STREAM_LEN)
+			)
+		);
+	}
+
+	typedef decltype(GetFlowTemplate(0)) FlowTemplate;
+
+	// Per-queue results, each on its own cache line so that the
+	// measurement doesn't add false sharing of its own.
+	struct alignas(CACHE_LINE_SIZE) QueueStats
+	{
+		uint64_t packets;
+		uint64_t busyNs;
+	};
+
+	class LroMqBenchmark : public SysUnit::Benchmark
+	{
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		// Packets delivered to each queue per iteration, on average.
+		static constexpr size_t BATCH_PER_QUEUE = 256;
+
+		MqBenchConfig config;
+		std::optional<SysUnit::WorkerPool> pool;
+
+		size_t lroStride;
+		void * lroMem;
+		std::vector<std::unique_ptr<CaptureIfnet>> sinks;
+		std::vector<QueueStats> stats;
+
+		std::vector<FlowTemplate> flows;
+		std::vector<size_t> flowQueue;
+		std::vector<std::vector<struct mbuf *>> batches;
+
+		uint64_t packets;
+		uint64_t wallNs;
+
+		struct lro_ctrl * GetLro(size_t q)
+		{
+			return reinterpret_cast<struct lro_ctrl *>(
+			    static_cast<char *>(lroMem) + q * lroStride);
+		}
+
+		void Deliver(size_t q)
+		{
+			struct lro_ctrl * lc = GetLro(q);
+			struct ifnet * ifp = sinks.at(q)->GetIfp();
+			auto & batch = batches.at(q);
+
+			auto start = Clock::now();
+			for (auto * m : batch) {
+				if (config.queued)
+					tcp_lro_queue_mbuf(lc, m);
+				else if (tcp_lro_rx(lc, m, 0) != 0)
+					(*ifp->if_input)(ifp, m);
+			}
+			tcp_lro_flush_all(lc);
+			auto end = Clock::now();
+
+			stats[q].packets += batch.size();
+			stats[q].busyNs += std::chrono::duration_cast<
+			    std::chrono::nanoseconds>(end - start).count();
+		}
+
+	public:
+		explicit LroMqBenchmark(const MqBenchConfig & c)
+		  : config(c),
+		    lroStride(0),
+		    lroMem(nullptr),
+		    packets(0),
+		    wallNs(0)
+		{
+		}
+
+		void BenchSetUp() override
+		{
+			pool.emplace(config.queues);
+
+			lroStride = sizeof(struct lro_ctrl);
+			if (config.padded)
+				lroStride = (lroStride + CACHE_LINE_SIZE - 1) /
+				    CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+			lroMem = ::operator new(lroStride * config.queues,
+			    std::align_val_t(CACHE_LINE_SIZE));
+
+			stats.assign(config.queues, QueueStats{});
+			batches.resize(config.queues);
+
+			for (size_t q = 0; q < config.queues; ++q) {
+				sinks.push_back(std::make_unique<CaptureIfnet>(
+				    "mq", q, CaptureIfnet::Mode::COUNT));
+				struct ifnet * ifp = sinks.back()->GetIfp();
+
+				ifp->if_capenable |= IFCAP_LRO;
+				tcp_lro_init_args(GetLro(q), ifp, TCP_LRO_ENTRIES,
+				    config.queued ? 2 * BATCH_PER_QUEUE : 0);
+			}
+
+			// Steer each flow through an RSS indirection table, as
+			// the NIC would.
+			struct in_addr srcAddr, dstAddr;
+			inet_pton(AF_INET, "10.1.0.1", &srcAddr);
+			inet_pton(AF_INET, "10.1.0.2", &dstAddr);
+
+			for (size_t f = 0; f < config.flows; ++f) {
+				uint32_t hash = RssHashTcpIpv4(srcAddr, dstAddr,
+				    10000 + f, 80);
+
+				flows.push_back(GetFlowTemplate(f)
+				    .WithHeader(Layer::L2).Fields(
+					hashType(M_HASHTYPE_RSS_TCP_IPV4),
+					flowid(hash)
+				    ));
+				flowQueue.push_back((hash % RSS_TABLE_SIZE) %
+				    config.queues);
+			}
+		}
+
+		void IterationSetUp() override
+		{
+			for (auto & batch : batches)
+				batch.clear();
+
+			size_t count = BATCH_PER_QUEUE * config.queues;
+			for (size_t i = 0; i < count; ++i) {
+				size_t f = i % config.flows;
+				struct mbuf * m = flows[f].GenerateRawMbuf();
+				batches[flowQueue[f]].push_back(m);
+
+				flows[f] = flows[f].Next();
+			}
+		}
+
+		size_t Iteration() override
+		{
+			auto start = Clock::now();
+			pool->Run([this] (size_t q) { Deliver(q); });
+			auto end = Clock::now();
+
+			wallNs += std::chrono::duration_cast<
+			    std::chrono::nanoseconds>(end - start).count();
+
+			size_t total = BATCH_PER_QUEUE * config.queues;
+			packets += total;
+			return total;
+		}
+
+		void BenchTearDown() override
+		{
+			uint64_t frames = 0;
+			uint64_t maxPackets = 0;
+
+			for (size_t q = 0; q < config.queues; ++q) {
+				tcp_lro_free(GetLro(q));
+				frames += sinks[q]->GetPacketCount();
+
+				const QueueStats & s = stats[q];
+				std::string prefix = "q" + std::to_string(q);
+				SetCounter(prefix + "/share",
+				    double(s.packets) / packets);
+				SetCounter(prefix + "/Mpps", s.busyNs == 0 ? 0 :
+				    1000.0 * s.packets / s.busyNs);
+				maxPackets = std::max(maxPackets, s.packets);
+			}
+
+			// Aggregate throughput across all queues, over the
+			// wall-clock time of the iterations.
+			SetCounter("Mpps", 1000.0 * packets / wallNs);
+			SetCounter("merge_ratio", double(packets) / frames);
+
+			// How much more work the busiest queue got than it would
+			// have with perfectly even RSS spreading.
+			SetCounter("imbalance",
+			    double(maxPackets) * config.queues / packets);
+			SetCounter("pinned", pool->IsPinned());
+
+			pool.reset();
+			::operator delete(lroMem, std::align_val_t(CACHE_LINE_SIZE));
+			lroMem = nullptr;
+			sinks.clear();
+			flows.clear();
+		}
+	};
+
+	void RegisterLroMqBenchmarks()
+	{
+		unsigned ncpu = std::max(std::thread::hardware_concurrency(), 1U);
+
+		for (size_t queues : {1, 2, 4, 8})
+		for (size_t flows : {16, 256})
+		for (bool queued : {false, true})
+		for (bool padded : {true, false}) {
+			// Oversubscribing the CPUs would measure the scheduler
+			// rather than LRO.
+			if (queues > ncpu)
+				continue;
+
+			MqBenchConfig config{queues, flows, queued, padded};
+			std::string name = "tcp_lro_mq/" + config.Name();
+
+			SysUnit::RegisterBenchmark(name,
+			    [config] () -> std::unique_ptr<SysUnit::Benchmark>
+				{
+					return std::make_unique<LroMqBenchmark>(config);
+				});
+		}
+	}
+
+	SYSUNIT_BENCHMARK_FAMILY(RegisterLroMqBenchmarks);
+}
@@ -0,0 +1,49 @@
+
+LIB := netinet6
+
+TESTS := \
+	frag6 \
+
+TEST_FRAG6_SRCS := \
+	frag6.c \
+
+# frag6.c seeds its hash with arc4random().  Replace it with fake_random's
+# constant so that the hash bucket of each datagram is the same on every run.
+TEST_FRAG6_WRAPFUNCS := \
+	arc4random=fixed_arc4random \
+
+TEST_FRAG6_LIBS := \
+	fake_callcount \
+	fake_counter \
+	fake_inet6 \
+	fake_malloc \
+	fake_mbuf \
+	fake_atomic \
+	fake_mib \
+	fake_mutex \
+	fake_panic \
+	fake_uma \
+	fake_phash \
+	fake_random \
+	mock_icmp6 \
+	pktgen \
+	sysunit_init \
+
+TEST_FRAG6_STDLIBS := \
+	gmock \
+
+BENCHES := \
+	frag6 \
+
+BENCH_FRAG6_SRCS := \
+	$(TEST_FRAG6_SRCS) \
+
+BENCH_FRAG6_WRAPFUNCS := \
+	$(TEST_FRAG6_WRAPFUNCS) \
+
+BENCH_FRAG6_LIBS := \
+	$(TEST_FRAG6_LIBS) \
+	sysunit_bench \
+
+BENCH_FRAG6_STDLIBS := \
+	$(TEST_FRAG6_STDLIBS) \
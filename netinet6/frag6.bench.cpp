@@ -0,0 +1,362 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/CallCounts.h"
+#include "fake/counter.h"
+#include "fake/mbuf.h"
+#include "fake/uma.h"
+
+#include "pktgen/Fragmenter.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Udp.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/ip6.h>
+#include <kern_include/netinet6/ip6_var.h>
+#include <kern_include/vm/uma.h>
+
+// ip6_var.h only declares these for the kernel.
+int frag6_input(struct mbuf **, int *, int);
+void frag6_init(void);
+void frag6_drain(void);
+}
+
+#include <stubs/eventhandler.h>
+#include <stubs/ip6stat.h>
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/PerfCounters.h"
+
+#include "mock/icmp6.h"
+
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace PktGen;
+using SysUnit::MockIcmp6;
+
+namespace
+{
+	// The number of hash buckets in frag6.c.
+	const size_t IP6REASS_NHASH = 64;
+
+	// Fragments are sized for the IPv6 minimum MTU.
+	const size_t FRAG_MTU = 1280;
+	const size_t FRAG_DATA =
+	    (FRAG_MTU - sizeof(struct ip6_hdr) - sizeof(struct ip6_frag)) & ~7;
+
+	// Each iteration sends the fragments of this many datagrams in all,
+	// repeating the configured set of datagrams as often as needed.
+	const size_t DATAGRAMS_PER_ITERATION = 256;
+
+	struct Frag6BenchConfig
+	{
+		size_t frags;
+
+		// How many datagrams frag6_input() has queued at once: the
+		// fragments of this many datagrams are sent round-robin.
+		size_t datagrams;
+
+		// If false, the last fragment of every datagram is lost and
+		// the datagrams stay queued until the iteration ends, as in a
+		// fragment flood.
+		bool complete;
+
+		// net.inet6.ip6.maxfragpackets and net.inet6.ip6.maxfrags, or
+		// 0 to keep the defaults that frag6_init() derives from
+		// nmbclusters.
+		int maxFragPackets;
+		int maxFrags;
+
+		std::string Name() const
+		{
+			std::ostringstream name;
+
+			name << "frags=" << frags
+			    << "/datagrams=" << datagrams;
+			if (!complete)
+				name << "/incomplete";
+			if (maxFragPackets != 0)
+				name << "/maxfragpackets=" << maxFragPackets;
+			if (maxFrags != 0)
+				name << "/maxfrags=" << maxFrags;
+			return name.str();
+		}
+	};
+
+	auto GetFragments(const Frag6BenchConfig & config, uint32_t n)
+	{
+		size_t len = config.frags * FRAG_DATA - sizeof(struct udphdr);
+		auto t = PacketTemplate(
+			Ipv6Header().With(
+				src("fd00::1"),
+				dst("fd00::2")
+			),
+			UdpHeader().With(src(5000), dst(6000)),
+			PacketPayload().With(counterPayload(len))
+		);
+
+		if (!config.complete)
+			return Fragment(t, FRAG_MTU, fragmentId(n),
+			    dropFragment(config.frags - 1));
+		return Fragment(t, FRAG_MTU, fragmentId(n));
+	}
+
+	typedef decltype(GetFragments(Frag6BenchConfig(), 0)) DatagramFragments;
+
+	class Frag6Benchmark : public SysUnit::Benchmark
+	{
+	private:
+		Frag6BenchConfig config;
+		size_t groups;
+
+		std::vector<DatagramFragments> datagrams;
+		std::vector<struct mbuf *> batch;
+		std::vector<struct mbuf *> reassembled;
+
+		struct uma_zone * mbufZone;
+
+		uint64_t fragments;
+		uint64_t fragmentBytes;
+		uint64_t sent;
+		uint64_t completed;
+		uint64_t dropped;
+		uint64_t droppedStart;
+
+		// The most mbufs and malloc(9) allocations that frag6 held at
+		// the end of an iteration, when every datagram that will ever
+		// complete has.
+		int64_t heldMbufs;
+		int64_t heldAllocs;
+
+		SysUnit::CallCounts iterationStart;
+		std::array<uint64_t, FAKE_NUM_CALLS> calls{};
+
+		int64_t CountPassedUp() const
+		{
+			int64_t mbufs = 0;
+
+			for (auto * m : reassembled) {
+				for (; m != nullptr; m = m->m_next)
+					mbufs++;
+			}
+			return mbufs;
+		}
+
+	public:
+		explicit Frag6Benchmark(const Frag6BenchConfig & c)
+		  : config(c),
+		    groups(std::max(DATAGRAMS_PER_ITERATION / c.datagrams, size_t(1))),
+		    mbufZone(nullptr),
+		    fragments(0),
+		    fragmentBytes(0),
+		    sent(0),
+		    completed(0),
+		    dropped(0),
+		    droppedStart(0),
+		    heldMbufs(0),
+		    heldAllocs(0)
+		{
+		}
+
+		void BenchSetUp() override
+		{
+			fake_counter_array_alloc(ip6stat, nitems(ip6stat));
+			frag6_init();
+
+			if (config.maxFragPackets != 0)
+				ip6_maxfragpackets = config.maxFragPackets;
+			if (config.maxFrags != 0)
+				ip6_maxfrags = config.maxFrags;
+
+			// Draining incomplete datagrams sends time exceeded
+			// errors for those whose first fragment arrived.
+			MockIcmp6::AllowIcmp6Error();
+
+			mbufZone = fake_uma_find_zone("mbuf");
+			for (uint32_t n = 0; n < config.datagrams; ++n)
+				datagrams.push_back(GetFragments(config, n));
+		}
+
+		void IterationSetUp() override
+		{
+			// Send the first fragment of every datagram, then the
+			// second, and so on.  Every group of datagrams completes
+			// before the next one starts.
+			for (size_t g = 0; g < groups; ++g) {
+				for (size_t f = 0; f < config.frags; ++f) {
+					for (const auto & frags : datagrams) {
+						if (f >= frags.size())
+							continue;
+
+						struct mbuf * m = frags.at(f).GenerateRawMbuf();
+						fragmentBytes += m->m_pkthdr.len;
+						batch.push_back(m);
+					}
+				}
+			}
+
+			iterationStart = SysUnit::GetCallCounts();
+			droppedStart = IP6STAT(ip6s_fragdropped);
+		}
+
+		size_t Iteration() override
+		{
+			SysUnit::PerfScope scope("frag6", batch.size());
+
+			for (auto * m : batch) {
+				int off = sizeof(struct ip6_hdr);
+
+				if (frag6_input(&m, &off, IPPROTO_FRAGMENT) !=
+				    IPPROTO_DONE)
+					reassembled.push_back(m);
+			}
+
+			return batch.size();
+		}
+
+		void IterationTearDown() override
+		{
+			SysUnit::CallCounts end = SysUnit::GetCallCounts();
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i)
+				calls[i] += end.calls[i] - iterationStart.calls[i];
+
+			// Count what frag6 holds, not the datagrams that it
+			// passed up.
+			int64_t passedUp = CountPassedUp();
+			int64_t mbufs = uma_zone_get_cur(mbufZone) - passedUp;
+			heldMbufs = std::max(heldMbufs, mbufs);
+			heldAllocs = std::max(heldAllocs,
+			    int64_t(end[FAKE_CALL_KMALLOC] - end[FAKE_CALL_KFREE]) -
+			    passedUp);
+
+			fragments += batch.size();
+			sent += groups * datagrams.size();
+			completed += reassembled.size();
+			dropped += IP6STAT(ip6s_fragdropped) - droppedStart;
+
+			// Incomplete datagrams would otherwise be taken for
+			// retransmissions in the next iteration.  frag6_drain()
+			// counts each of them as dropped.
+			frag6_drain();
+
+			for (auto * m : reassembled)
+				m_freem(m);
+			reassembled.clear();
+			batch.clear();
+		}
+
+		void BenchTearDown() override
+		{
+			double inFlight = double(datagrams.size());
+
+			SetCounter("completed", double(completed) / sent);
+
+			// The share of fragments refused because the number of
+			// queued datagrams or fragments was at its limit.
+			SetCounter("dropped/frag", double(dropped) / fragments);
+
+			// The average length of the list searched in each hash
+			// bucket.
+			SetCounter("bucket_len", inFlight / IP6REASS_NHASH);
+
+			if (!config.complete) {
+				double fragLen = double(fragmentBytes) / fragments;
+
+				// Every queued fragment has a descriptor and an
+				// mbuf with external storage of the fragment's
+				// length.  Each of the other allocations is the
+				// queue of a datagram.
+				int64_t queues = heldAllocs - 2 * heldMbufs;
+
+				SetCounter("mbufs/dgram", heldMbufs / inFlight);
+				SetCounter("queues/dgram", queues / inFlight);
+				SetCounter("bytes/dgram",
+				    (queues * sizeof(struct ip6q) +
+				    heldMbufs * (sizeof(struct ip6asfrag) + MSIZE + fragLen)) /
+				    inFlight);
+			}
+
+			for (size_t i = 0; i < FAKE_NUM_CALLS; ++i) {
+				if (calls[i] == 0)
+					continue;
+
+				std::string name(fake_call_name(static_cast<fake_call>(i)));
+				SetCounter(name + "/frag", double(calls[i]) / fragments);
+			}
+
+			frag6_drain();
+			fake_counter_array_free(ip6stat, nitems(ip6stat));
+			datagrams.clear();
+		}
+	};
+
+	void RegisterFrag6Benchmark(const Frag6BenchConfig & config)
+	{
+		std::string name = "frag6/" + config.Name();
+
+		SysUnit::RegisterBenchmark(name,
+		    [config] () -> std::unique_ptr<SysUnit::Benchmark>
+			{
+				return std::make_unique<Frag6Benchmark>(config);
+			});
+	}
+
+	void RegisterFrag6Benchmarks()
+	{
+		// The cost per fragment of reassembling one datagram at a time.
+		for (size_t frags : {2, 4, 8, 16})
+			RegisterFrag6Benchmark(Frag6BenchConfig{frags, 1, true, 0, 0});
+
+		// The cost per fragment as the number of datagrams being
+		// reassembled at once, and so the length of the bucket lists,
+		// grows.
+		for (size_t datagrams : {16, 256, 1024, 4096})
+			RegisterFrag6Benchmark(Frag6BenchConfig{4, datagrams, true, 0, 0});
+
+		// A flood of datagrams that never complete, against the
+		// default limits and against lowered ones.  With the default
+		// nmbclusters, both limits are 16384.
+		for (size_t datagrams : {256, 1024, 4096, 16384})
+		for (int maxFragPackets : {0, 1024})
+		for (int maxFrags : {0, 2048}) {
+			RegisterFrag6Benchmark(Frag6BenchConfig{4, datagrams,
+			    false, maxFragPackets, maxFrags});
+		}
+	}
+
+	SYSUNIT_BENCHMARK_FAMILY(RegisterFrag6Benchmarks);
+}
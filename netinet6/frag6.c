@@ -0,0 +1 @@
+../freebsd/sys/netinet6/frag6.c
\ No newline at end of file
@@ -0,0 +1,389 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/CallCounts.h"
+#include "fake/counter.h"
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Fragmenter.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Ipv6Ext.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Udp.h"
+
+extern "C" {
+#include <kern_include/netinet/in.h>
+#include <kern_include/netinet/ip6.h>
+#include <kern_include/netinet/icmp6.h>
+#include <kern_include/netinet6/ip6_var.h>
+
+// ip6_var.h only declares these for the kernel.
+int frag6_input(struct mbuf **, int *, int);
+void frag6_init(void);
+void frag6_slowtimo(void);
+void frag6_drain(void);
+}
+
+#include <stubs/eventhandler.h>
+#include <stubs/ip6stat.h>
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include <gtest/gtest.h>
+
+#include "sysunit/TestSuite.h"
+
+#include "mock/icmp6.h"
+
+using namespace PktGen;
+using namespace testing;
+using SysUnit::MockIcmp6;
+
+class Frag6TestSuite : public SysUnit::TestSuite
+{
+public:
+	static constexpr int IP6_OFF = sizeof(struct ip6_hdr);
+
+	// Fragments of a datagram without extension headers carry 280 bytes
+	// of data each.
+	static constexpr size_t FRAG_MTU =
+	    sizeof(struct ip6_hdr) + sizeof(struct ip6_frag) + 280;
+
+	// The result of passing a fragment to frag6_input().
+	struct Result
+	{
+		int nxt;
+		int off;
+
+		// The reassembled datagram, if nxt is not IPPROTO_DONE.
+		MbufUniquePtr m;
+	};
+
+	void TestCaseSetUp() override
+	{
+		fake_counter_array_alloc(ip6stat, nitems(ip6stat));
+		frag6_init();
+	}
+
+	void TestCaseTearDown() override
+	{
+		// Freeing a datagram whose first fragment arrived sends a
+		// time exceeded error, like a timeout does.
+		MockIcmp6::AllowIcmp6Error();
+		frag6_drain();
+
+		fake_counter_array_free(ip6stat, nitems(ip6stat));
+	}
+
+	static auto GetTemplate(size_t len)
+	{
+		return PacketTemplate(
+			Ipv6Header().With(
+				src("fd00::1"),
+				dst("fd00::2")
+			),
+			UdpHeader().With(src(5000), dst(6000)),
+			PacketPayload().With(counterPayload(len))
+		);
+	}
+
+	// Pass a fragment to frag6_input() as ip6_input() would, with off
+	// the offset of its fragment header.
+	template <typename Frag>
+	static Result Input(const Frag & frag, int off = IP6_OFF)
+	{
+		struct mbuf * m = frag.GenerateRawMbuf();
+		Result r{0, off, nullptr};
+
+		r.nxt = frag6_input(&m, &r.off, IPPROTO_FRAGMENT);
+		if (r.nxt != IPPROTO_DONE)
+			r.m.reset(m);
+		return r;
+	}
+
+	// Pass every fragment in the list to frag6_input(), in order.  Only
+	// the last fragment may complete the datagram.
+	template <typename List>
+	static Result Reassemble(const List & frags, int off = IP6_OFF)
+	{
+		Result r{IPPROTO_DONE, off, nullptr};
+
+		for (size_t i = 0; i < frags.size(); ++i) {
+			EXPECT_EQ(r.nxt, IPPROTO_DONE) << "datagram completed early by fragment " << i - 1;
+			r = Input(frags.at(i), off);
+		}
+
+		return r;
+	}
+
+	// The number of malloc(9) allocations that have not been freed.
+	// This covers frag6's reassembly queues and fragment descriptors, as
+	// well as the data of every mbuf.
+	static int64_t GetOutstandingAllocs()
+	{
+		SysUnit::CallCounts counts = SysUnit::GetCallCounts();
+
+		return (counts[FAKE_CALL_KMALLOC] - counts[FAKE_CALL_KFREE]);
+	}
+
+	template <typename List>
+	void CheckReassembly(const List & frags)
+	{
+		Result r = Reassemble(frags);
+
+		ASSERT_EQ(r.nxt, IPPROTO_UDP);
+		EXPECT_EQ(r.off, IP6_OFF);
+		EXPECT_THAT(r.m.get(), CompiledPacketMatcher(frags.Reassembled()));
+		EXPECT_EQ(IP6STAT(ip6s_fragments), frags.size());
+		EXPECT_EQ(IP6STAT(ip6s_reassembled), 1);
+
+		r.m.reset();
+		EXPECT_EQ(GetOutstandingAllocs(), 0);
+	}
+};
+
+TEST_F(Frag6TestSuite, TestInOrder)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU);
+
+	ASSERT_EQ(frags.size(), 4);
+	CheckReassembly(frags);
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 0);
+}
+
+TEST_F(Frag6TestSuite, TestReverse)
+{
+	CheckReassembly(Fragment(GetTemplate(1000), FRAG_MTU, reverseFragments()));
+}
+
+TEST_F(Frag6TestSuite, TestShuffle)
+{
+	for (uint32_t seed = 1; seed <= 8; ++seed) {
+		SCOPED_TRACE(seed);
+
+		auto frags = Fragment(GetTemplate(4000), FRAG_MTU,
+		    fragmentId(seed), shuffleFragments(seed));
+		Result r = Reassemble(frags);
+
+		ASSERT_EQ(r.nxt, IPPROTO_UDP);
+		EXPECT_THAT(r.m.get(), CompiledPacketMatcher(frags.Reassembled()));
+	}
+
+	EXPECT_EQ(IP6STAT(ip6s_reassembled), 8);
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
+
+TEST_F(Frag6TestSuite, TestTinyFirstFragment)
+{
+	CheckReassembly(Fragment(GetTemplate(1000), FRAG_MTU, tinyFirstFragment()));
+}
+
+TEST_F(Frag6TestSuite, TestUnfragmentableHeaders)
+{
+	auto p = PacketTemplate(
+		Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+		HopByHopHeader().With(routerAlert()),
+		UdpHeader().With(src(5000), dst(6000)),
+		PacketPayload().With(counterPayload(1000))
+	);
+	int off = IP6_OFF + 8;
+	auto frags = Fragment(p, FRAG_MTU, shuffleFragments(1));
+
+	// The hop-by-hop header is repeated in every fragment, and its next
+	// header field is restored once the fragment header is removed.
+	Result r = Reassemble(frags, off);
+	ASSERT_EQ(r.nxt, IPPROTO_UDP);
+	EXPECT_EQ(r.off, off);
+	EXPECT_THAT(r.m.get(), CompiledPacketMatcher(p));
+}
+
+TEST_F(Frag6TestSuite, TestAtomicFragment)
+{
+	// A fragment header with an offset of 0 and no more fragments is
+	// skipped without involving a reassembly queue (RFC 6946).
+	auto frags = Fragment(GetTemplate(100), 1500);
+	ASSERT_EQ(frags.size(), 1);
+
+	Result r = Input(frags.at(0));
+	ASSERT_EQ(r.nxt, IPPROTO_UDP);
+	EXPECT_EQ(r.off, int(IP6_OFF + sizeof(struct ip6_frag)));
+	EXPECT_THAT(r.m.get(), CompiledPacketMatcher(frags.at(0)));
+	EXPECT_EQ(IP6STAT(ip6s_reassembled), 1);
+
+	r.m.reset();
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
+
+TEST_F(Frag6TestSuite, TestOverlap)
+{
+	// Overlapping fragments are dropped rather than trimmed, so this
+	// datagram can never be reassembled.  The second and fourth
+	// fragments overlap the one before them.
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, fragOverlap(16));
+
+	ASSERT_EQ(frags.size(), 4);
+	EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 2);
+	EXPECT_EQ(IP6STAT(ip6s_reassembled), 0);
+}
+
+TEST_F(Frag6TestSuite, TestDuplicate)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, duplicateFragment(1));
+
+	CheckReassembly(frags);
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 1);
+}
+
+TEST_F(Frag6TestSuite, TestUnalignedFragment)
+{
+	// Every fragment but the last must carry a multiple of 8 bytes.
+	auto frag = PacketTemplate(
+		Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+		FragmentHeader().With(proto(IPPROTO_UDP), moreFragments()),
+		PacketPayload().With(counterPayload(13))
+	);
+
+	MockIcmp6::ExpectIcmp6Error(ICMP6_PARAM_PROB, ICMP6_PARAMPROB_HEADER);
+	EXPECT_EQ(Input(frag).nxt, IPPROTO_DONE);
+	EXPECT_EQ(IP6STAT(ip6s_fragments), 0);
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
+
+TEST_F(Frag6TestSuite, TestTimeout)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, dropFragment(3));
+
+	EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+
+	for (int i = 0; i < IPV6_FRAGTTL - 1; ++i)
+		frag6_slowtimo();
+	EXPECT_EQ(IP6STAT(ip6s_fragtimeout), 0);
+
+	// The sender is told that reassembly timed out only if the first
+	// fragment arrived.
+	MockIcmp6::ExpectIcmp6Error(ICMP6_TIME_EXCEEDED,
+	    ICMP6_TIME_EXCEED_REASSEMBLY);
+	frag6_slowtimo();
+	EXPECT_EQ(IP6STAT(ip6s_fragtimeout), 1);
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
+
+TEST_F(Frag6TestSuite, TestTimeoutWithoutFirstFragment)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, dropFragment(0));
+
+	EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+
+	for (int i = 0; i < IPV6_FRAGTTL; ++i)
+		frag6_slowtimo();
+	EXPECT_EQ(IP6STAT(ip6s_fragtimeout), 1);
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
+
+TEST_F(Frag6TestSuite, TestLastFragmentBeforeTimeout)
+{
+	auto all = Fragment(GetTemplate(1000), FRAG_MTU);
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, dropFragment(3));
+
+	EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+	for (int i = 0; i < IPV6_FRAGTTL - 1; ++i)
+		frag6_slowtimo();
+
+	Result r = Input(all.at(3));
+	ASSERT_EQ(r.nxt, IPPROTO_UDP);
+	EXPECT_THAT(r.m.get(), CompiledPacketMatcher(all.Reassembled()));
+}
+
+TEST_F(Frag6TestSuite, TestMaxFragPackets)
+{
+	ip6_maxfragpackets = 2;
+
+	// Datagrams beyond the limit are dropped as their first fragment
+	// arrives.
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, fragmentId(0));
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_EQ(Input(frags.at(1)).nxt, IPPROTO_DONE);
+		frags = frags.Next();
+	}
+
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 1);
+
+	// A limit of -1 accepts any number of datagrams.
+	ip6_maxfragpackets = -1;
+	EXPECT_EQ(Input(frags.at(1)).nxt, IPPROTO_DONE);
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 1);
+}
+
+TEST_F(Frag6TestSuite, TestMaxFrags)
+{
+	ip6_maxfrags = 5;
+
+	auto frags = Fragment(GetTemplate(2000), FRAG_MTU, dropFragment(0));
+	ASSERT_EQ(frags.size(), 7);
+
+	// The limit is on the number of fragments queued across every
+	// datagram.
+	EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 2);
+}
+
+TEST_F(Frag6TestSuite, TestLoweredLimit)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, fragmentId(0),
+	    dropFragment(0));
+
+	for (int i = 0; i < 4; ++i) {
+		EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+		frags = frags.Next();
+	}
+
+	// Datagrams over a newly lowered limit are freed by the next
+	// timer tick.
+	ip6_maxfragpackets = 1;
+	frag6_slowtimo();
+	EXPECT_EQ(IP6STAT(ip6s_fragoverflow), 3);
+}
+
+TEST_F(Frag6TestSuite, TestDrain)
+{
+	auto frags = Fragment(GetTemplate(1000), FRAG_MTU, fragmentId(0),
+	    dropFragment(0));
+
+	for (int i = 0; i < 3; ++i) {
+		EXPECT_EQ(Reassemble(frags).nxt, IPPROTO_DONE);
+		frags = frags.Next();
+	}
+	EXPECT_GT(GetOutstandingAllocs(), 0);
+
+	frag6_drain();
+	EXPECT_EQ(IP6STAT(ip6s_fragdropped), 3);
+	EXPECT_EQ(GetOutstandingAllocs(), 0);
+}
@@ -1,4 +1,8 @@
 
 SUBDIRS := \
 	pktgen \
+	report \
+	runner \
+	sysunit_bench \
 	sysunit_init \
+	sysunit_main \
@@ -0,0 +1,218 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+
+#include "pktgen/PacketParsing.h"
+
+#include <string.h>
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	CompiledPacket::CompiledPacket(const mbuf * m)
+	  : image(m->m_pkthdr.len),
+	    mask(m->m_pkthdr.len, 0xff),
+	    csumFlags(m->m_pkthdr.csum_flags),
+	    csumMask(0),
+	    mbufFlags(m->m_flags),
+	    mbufFlagsMask(0),
+	    vtag(m->m_pkthdr.ether_vtag),
+	    checkVtag(false),
+	    hashType(M_HASHTYPE_GET(m)),
+	    checkHashType(false),
+	    flowid(m->m_pkthdr.flowid),
+	    checkFlowid(false)
+	{
+		size_t off = 0;
+
+		for (; m != nullptr; m = m->m_next) {
+			memcpy(&image.at(off), GetMbufHeader<uint8_t>(m), m->m_len);
+			off += m->m_len;
+		}
+	}
+
+	void CompiledPacket::IgnoreBytes(size_t off, size_t len)
+	{
+		memset(&mask.at(off), 0, len);
+	}
+
+	bool MaskedEqual(const uint8_t *a, const uint8_t *b,
+	    const uint8_t *mask, size_t len)
+	{
+		const size_t BLOCK = 8 * sizeof(uint64_t);
+		uint64_t diff = 0;
+		size_t i = 0;
+
+		// Differences are accumulated a block at a time and only tested
+		// at the end of each block so that the inner loop has no branch
+		// and can be vectorized.
+		for (; i + BLOCK <= len; i += BLOCK) {
+			for (size_t j = i; j < i + BLOCK; j += sizeof(uint64_t)) {
+				uint64_t x, y, m;
+
+				memcpy(&x, a + j, sizeof(x));
+				memcpy(&y, b + j, sizeof(y));
+				memcpy(&m, mask + j, sizeof(m));
+				diff |= (x ^ y) & m;
+			}
+
+			if (diff != 0)
+				return false;
+		}
+
+		for (; i < len; ++i)
+			diff |= (a[i] ^ b[i]) & mask[i];
+
+		return diff == 0;
+	}
+
+	CompiledMatcher::CompiledMatcher(CompiledPacket && p,
+	    const testing::Matcher<mbuf*> & d)
+	  : packet(std::move(p)),
+	    detailed(d)
+	{
+	}
+
+	bool CompiledMatcher::MatchMbufHeader(const mbuf *m) const
+	{
+		if (size_t(m->m_pkthdr.len) != packet.image.size())
+			return false;
+
+		if ((m->m_pkthdr.csum_flags ^ packet.csumFlags) & packet.csumMask)
+			return false;
+
+		if ((m->m_flags ^ packet.mbufFlags) & packet.mbufFlagsMask)
+			return false;
+
+		if (packet.checkVtag && m->m_pkthdr.ether_vtag != packet.vtag)
+			return false;
+
+		if (packet.checkHashType && M_HASHTYPE_GET(m) != packet.hashType)
+			return false;
+
+		if (packet.checkFlowid && m->m_pkthdr.flowid != packet.flowid)
+			return false;
+
+		return true;
+	}
+
+	bool CompiledMatcher::MatchData(const mbuf *m) const
+	{
+		size_t off = 0;
+
+		for (; m != nullptr; m = m->m_next) {
+			size_t len = m->m_len;
+
+			if (len > packet.image.size() - off)
+				return false;
+
+			if (!MaskedEqual(GetMbufHeader<uint8_t>(m),
+			    &packet.image[off], &packet.mask[off], len))
+				return false;
+
+			off += len;
+		}
+
+		return off == packet.image.size();
+	}
+
+	bool CompiledMatcher::MatchAndExplain(mbuf* m,
+	    MatchResultListener* listener) const
+	{
+		if (MatchMbufHeader(m) && MatchData(m))
+			return true;
+
+		if (listener->IsInterested())
+			ExplainMismatch(m, listener);
+		return false;
+	}
+
+	void CompiledMatcher::ExplainMismatch(const mbuf *m,
+	    MatchResultListener* listener) const
+	{
+		testing::StringMatchResultListener fieldListener;
+
+		// Prefer the field-by-field explanation.  The detailed matchers
+		// are more lenient than the compiled image (for example, they
+		// do not check for trailing bytes), so fall back on describing
+		// the first byte that differs if they accept the packet.
+		if (!detailed.MatchAndExplain(const_cast<mbuf *>(m), &fieldListener)) {
+			*listener << fieldListener.str();
+			return;
+		}
+
+		if (size_t(m->m_pkthdr.len) != packet.image.size()) {
+			*listener << "packet length is " << m->m_pkthdr.len
+			    << " (expected " << packet.image.size() << ")";
+			return;
+		}
+
+		if (!MatchMbufHeader(m)) {
+			*listener << "mbuf header does not match:"
+			    << std::hex << " csum_flags " << m->m_pkthdr.csum_flags
+			    << " (expected " << packet.csumFlags << " mask "
+			    << packet.csumMask << ") m_flags " << m->m_flags
+			    << " (expected " << packet.mbufFlags << " mask "
+			    << packet.mbufFlagsMask << ")";
+			return;
+		}
+
+		size_t off = 0;
+		for (size_t mbufNumber = 0; m != nullptr; m = m->m_next, ++mbufNumber) {
+			const auto * data = GetMbufHeader<uint8_t>(m);
+
+			for (int i = 0; i < m->m_len; ++i, ++off) {
+				if (off >= packet.image.size()) {
+					*listener << "mbuf " << mbufNumber
+					    << " extends past the end of the packet";
+					return;
+				}
+
+				if ((data[i] ^ packet.image[off]) & packet.mask[off]) {
+					*listener << "byte " << off << " (mbuf "
+					    << mbufNumber << " index " << i << ") is "
+					    << std::hex << int(data[i]) << " (expected "
+					    << int(packet.image[off]) << ")";
+					return;
+				}
+			}
+		}
+
+		*listener << "mbuf chain contains " << off << " bytes (expected "
+		    << packet.image.size() << ")";
+	}
+
+	void CompiledMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "compiled packet of " << packet.image.size() << " bytes";
+	}
+}
@@ -0,0 +1,264 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/CompiledMatcher.h"
+
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Tcp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+
+class CompiledMatcherTestSuite : public SysUnit::TestSuite
+{
+public:
+	static auto GetTemplate(size_t payloadLen)
+	{
+		return PacketTemplate(
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			Ipv4Header().With(
+				src("10.0.0.1"),
+				dst("10.0.0.2"),
+				checksumVerified(),
+				checksumPassed()
+			),
+			TcpHeader().With(
+				src(80),
+				dst(51234),
+				seq(1000)
+			),
+			PacketPayload().With(
+				payload("sysunit", payloadLen)
+			)
+		);
+	}
+
+	// Copy a single-mbuf packet into a chain of mbufs with the given
+	// lengths.
+	static MbufUniquePtr SplitMbuf(const MbufUniquePtr & src,
+	    const std::vector<int> & lens)
+	{
+		MbufUniquePtr head;
+		struct mbuf ** tail = nullptr;
+		int off = 0;
+
+		for (int len : lens) {
+			struct mbuf * m = alloc_mbuf(len);
+			m->m_len = len;
+			memcpy(m->m_data, src->m_data + off, len);
+			off += len;
+
+			if (!head) {
+				head.reset(m);
+				m->m_pkthdr.len = src->m_pkthdr.len;
+				m->m_pkthdr.csum_flags = src->m_pkthdr.csum_flags;
+			} else
+				*tail = m;
+			tail = &m->m_next;
+		}
+
+		EXPECT_EQ(off, src->m_pkthdr.len);
+		return head;
+	}
+
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+};
+
+TEST_F(CompiledMatcherTestSuite, TestMatchGenerated)
+{
+	auto pkt = GetTemplate(1000);
+
+	for (int i = 0; i < 4; ++i) {
+		MbufUniquePtr m = pkt.Generate();
+
+		EXPECT_THAT(m.get(), CompiledPacketMatcher(pkt));
+		pkt = pkt.Next();
+	}
+}
+
+// tcp_lro rewrites the checksums, so the compiled matcher must not check them.
+TEST_F(CompiledMatcherTestSuite, TestChecksumsIgnored)
+{
+	auto pkt = GetTemplate(100);
+	MbufUniquePtr m = pkt.Generate();
+	size_t ipOff = sizeof(struct ether_header);
+	size_t tcpOff = ipOff + sizeof(struct ip);
+
+	GetMbufHeader<struct ip>(m, ipOff)->ip_sum ^= 0xffff;
+	GetMbufHeader<struct tcphdr>(m, tcpOff)->th_sum ^= 0x5a5a;
+
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(pkt));
+}
+
+TEST_F(CompiledMatcherTestSuite, TestMbufChain)
+{
+	auto pkt = GetTemplate(1000);
+	MbufUniquePtr m = pkt.Generate();
+	MbufUniquePtr chain = SplitMbuf(m, {14, 27, 1, 500, 512});
+
+	auto matcher = CompiledPacketMatcher(pkt);
+	EXPECT_THAT(chain.get(), matcher);
+
+	// Corrupt a payload byte in the last mbuf of the chain.
+	chain->m_next->m_next->m_next->m_next->m_data[100] ^= 0x1;
+	EXPECT_FALSE(matcher.Matches(chain.get()));
+}
+
+// A header mismatch is explained by the field-by-field matchers.
+TEST_F(CompiledMatcherTestSuite, TestFieldExplanation)
+{
+	auto pkt = GetTemplate(100);
+	MbufUniquePtr m = pkt.WithHeader(Layer::L4).Fields(incrSeq(1)).Generate();
+
+	std::string explanation = Explain(CompiledPacketMatcher(pkt), m.get());
+	EXPECT_THAT(explanation, HasSubstr("th_seq"));
+}
+
+// A packet with trailing bytes is accepted by the field-by-field matchers, so
+// the compiled matcher must explain the mismatch itself.
+TEST_F(CompiledMatcherTestSuite, TestTrailingBytes)
+{
+	auto pkt = GetTemplate(100);
+	MbufUniquePtr m = pkt.Generate();
+	MbufUniquePtr chain = SplitMbuf(m, {m->m_len});
+
+	chain->m_next = alloc_mbuf(1);
+	chain->m_next->m_len = 1;
+	chain->m_pkthdr.len++;
+
+	std::string explanation = Explain(CompiledPacketMatcher(pkt), chain.get());
+	EXPECT_THAT(explanation, HasSubstr("packet length is"));
+}
+
+TEST_F(CompiledMatcherTestSuite, TestChecksumFlags)
+{
+	auto pkt = GetTemplate(100);
+	MbufUniquePtr m = pkt.Generate();
+
+	m->m_pkthdr.csum_flags &= ~CSUM_L3_VALID;
+
+	std::string explanation = Explain(CompiledPacketMatcher(pkt), m.get());
+	EXPECT_THAT(explanation, HasSubstr("l3 csum valid flag"));
+}
+
+TEST_F(CompiledMatcherTestSuite, TestRssHash)
+{
+	auto pkt = GetTemplate(100).WithHeader(Layer::L2).Fields(
+	    hashType(M_HASHTYPE_RSS_TCP_IPV4), flowid(0x1234));
+	MbufUniquePtr m = pkt.Generate();
+
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(pkt));
+
+	m->m_pkthdr.flowid = 0x4321;
+	std::string explanation = Explain(CompiledPacketMatcher(pkt), m.get());
+	EXPECT_THAT(explanation, HasSubstr("mbuf flowid"));
+
+	// A template without a hash accepts any hash on the mbuf.
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(GetTemplate(100)));
+}
+
+TEST_F(CompiledMatcherTestSuite, TestTcpTimestamp)
+{
+	auto pkt = GetTemplate(100).WithHeader(Layer::L4).Fields(
+	    timestamp(500, 600));
+	MbufUniquePtr m = pkt.Generate();
+
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(pkt));
+
+	auto later = pkt.WithHeader(Layer::L4).Fields(timestamp(501, 600));
+	std::string explanation = Explain(CompiledPacketMatcher(later), m.get());
+	EXPECT_THAT(explanation, HasSubstr("tsval is 500 (expected 501)"));
+
+	auto echo = pkt.WithHeader(Layer::L4).Fields(timestamp(500, 601));
+	explanation = Explain(CompiledPacketMatcher(echo), m.get());
+	EXPECT_THAT(explanation, HasSubstr("tsecr is 600 (expected 601)"));
+}
+
+TEST_F(CompiledMatcherTestSuite, TestMaskedEqual)
+{
+	std::vector<uint8_t> a(203), b, mask(a.size(), 0xff);
+
+	for (size_t i = 0; i < a.size(); ++i)
+		a[i] = i * 7;
+	b = a;
+
+	EXPECT_TRUE(PktGen::internal::MaskedEqual(a.data(), b.data(), mask.data(), a.size()));
+
+	// Test a difference in each position, both in the vectorized blocks
+	// and in the tail.
+	for (size_t i = 0; i < a.size(); ++i) {
+		b[i] ^= 0x10;
+		EXPECT_FALSE(PktGen::internal::MaskedEqual(a.data(), b.data(), mask.data(), a.size()));
+
+		mask[i] = 0xef;
+		EXPECT_TRUE(PktGen::internal::MaskedEqual(a.data(), b.data(), mask.data(), a.size()));
+
+		b[i] = a[i];
+		mask[i] = 0xff;
+	}
+}
+
+TEST_F(CompiledMatcherTestSuite, TestIpv4Options)
+{
+	auto pkt = GetTemplate(100).WithHeader(Layer::L3).Fields(
+	    routerAlert(), recordRoute(1));
+	MbufUniquePtr m = pkt.Generate();
+
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(pkt));
+	EXPECT_THAT(m.get(), PacketMatcher(pkt));
+
+	auto moreSlots = pkt.WithHeader(Layer::L3).Fields(
+	    noIpOptions(), routerAlert(), recordRoute(2));
+	std::string explanation = Explain(CompiledPacketMatcher(moreSlots),
+	    m.get());
+	EXPECT_THAT(explanation, HasSubstr("IPv4: ip_hl field is 8 (expected 9)"));
+
+	auto ra = pkt.WithHeader(Layer::L3).Fields(routerAlert(1));
+	explanation = Explain(CompiledPacketMatcher(ra), m.get());
+	EXPECT_THAT(explanation, HasSubstr("IPv4: option byte 3 is 0 (expected 1)"));
+}
@@ -183,3 +183,26 @@ TEST_F(EthernetHeaderTestSuite, TestPayloadSize)
 	auto p3 = p1.WithHeader(Layer::PAYLOAD).Fields(payload(0, 8000));
 	VerifyMbufChainLen(p3, 8000);
 }
+
+// Generate packets with an RSS hash and verify that the hash type and flowid
+// are set on the mbuf, and that Next() preserves them as the NIC would for
+// every packet in a flow.
+TEST_F(EthernetHeaderTestSuite, TestRssHash)
+{
+	auto p1 = PacketTemplate(EthernetHeader()
+	    .With(hashType(M_HASHTYPE_RSS_TCP_IPV4),
+		  flowid(0x51ccc178)
+	     ));
+
+	MbufUniquePtr m = p1.Generate();
+	EXPECT_EQ(M_HASHTYPE_GET(m.get()), M_HASHTYPE_RSS_TCP_IPV4);
+	EXPECT_EQ(m->m_pkthdr.flowid, 0x51ccc178U);
+
+	m = p1.Next().Generate();
+	EXPECT_EQ(M_HASHTYPE_GET(m.get()), M_HASHTYPE_RSS_TCP_IPV4);
+	EXPECT_EQ(m->m_pkthdr.flowid, 0x51ccc178U);
+
+	auto p2 = p1.WithHeader(Layer::L2).Fields(hashType(M_HASHTYPE_NONE));
+	m = p2.Generate();
+	EXPECT_EQ(M_HASHTYPE_GET(m.get()), M_HASHTYPE_NONE);
+}
@@ -28,6 +28,7 @@
 
 #include "fake/mbuf.h"
 
+#include "pktgen/CompiledMatcher.h"
 #include "pktgen/Ethernet.h"
 
 #include <netinet/in.h>
@@ -87,6 +88,25 @@ namespace PktGen::internal
 			}
 		}
 
+		// Templates without a hash leave the hash unchecked, as the
+		// stack under test may assign one of its own.
+		uint8_t hashType = header.GetHashType();
+		if (hashType == M_HASHTYPE_NONE)
+			return true;
+
+		if (M_HASHTYPE_GET(m) != hashType) {
+			*listener << "Ethernet: mbuf hash type is " << int(M_HASHTYPE_GET(m))
+			    << " (expected " << int(hashType) << ")";
+			return false;
+		}
+
+		if (m->m_pkthdr.flowid != header.GetFlowid()) {
+			*listener << "Ethernet: mbuf flowid is " << std::hex
+			    << m->m_pkthdr.flowid << " (expected "
+			    << header.GetFlowid() << ")";
+			return false;
+		}
+
 		return true;
 	}
 
@@ -94,4 +114,13 @@ namespace PktGen::internal
 	{
 		*os << "Ethernet";
 	}
+
+	void CompilePacketMask(const EthernetTemplate & header,
+	    CompiledPacket & packet, size_t off)
+	{
+		packet.mbufFlagsMask |= M_VLANTAG;
+		packet.checkVtag = (header.GetMbufVlan() != 0);
+		packet.checkHashType = (header.GetHashType() != M_HASHTYPE_NONE);
+		packet.checkFlowid = packet.checkHashType;
+	}
 }
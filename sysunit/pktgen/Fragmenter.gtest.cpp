@@ -0,0 +1,357 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Fragmenter.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Ipv6Ext.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/PacketParsing.h"
+#include "pktgen/Udp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+
+class FragmenterTestSuite : public SysUnit::TestSuite
+{
+public:
+	static constexpr size_t IP_OFF = ETHER_HDR_LEN;
+
+	static auto GetIpv4Template(size_t len)
+	{
+		return PacketTemplate(
+			EthernetHeader(),
+			Ipv4Header().With(src("10.0.0.1"), dst("10.0.0.2"), id(77)),
+			UdpHeader().With(src(1000), dst(2000)),
+			PacketPayload().With(counterPayload(len))
+		);
+	}
+
+	static auto GetIpv6Template(size_t len)
+	{
+		return PacketTemplate(
+			EthernetHeader(),
+			Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+			UdpHeader().With(src(1000), dst(2000)),
+			PacketPayload().With(counterPayload(len))
+		);
+	}
+
+	// The offset, length and more-fragments flag of each fragment, in
+	// the order that they are sent.
+	struct FragInfo
+	{
+		size_t off;
+		size_t len;
+		bool more;
+
+		bool operator==(const FragInfo & f) const
+		{
+			return off == f.off && len == f.len && more == f.more;
+		}
+	};
+
+	template <typename List>
+	static std::vector<FragInfo> GetIpv4Info(const List & frags)
+	{
+		std::vector<FragInfo> info;
+
+		for (const auto & f : frags) {
+			auto m = f.Generate();
+			auto * ip = GetMbufHeader<struct ip>(m, IP_OFF);
+			uint16_t off = ntohs(ip->ip_off);
+
+			EXPECT_EQ(ntohs(ip->ip_len), m->m_len - IP_OFF);
+			EXPECT_EQ(ip->ip_p, IPPROTO_UDP);
+			EXPECT_EQ(ntohs(ip->ip_id), 77);
+			info.push_back({size_t(off & IP_OFFMASK) * 8,
+			    m->m_len - IP_OFF - sizeof(struct ip),
+			    (off & IP_MF) != 0});
+		}
+
+		return info;
+	}
+
+	// Copy the data of each fragment into place and check that the
+	// result matches the original datagram.  Overlapping data must be
+	// identical in every fragment that carries it.
+	template <typename List>
+	static void CheckReassembly(const List & frags, size_t hdrLen)
+	{
+		auto m = frags.Reassembled().Generate();
+		const uint8_t * orig = GetMbufHeader<uint8_t>(m, hdrLen);
+		size_t dataLen = m->m_len - hdrLen;
+		std::vector<bool> seen(dataLen);
+
+		for (const auto & f : frags) {
+			auto fm = f.Generate();
+			size_t off, fragHdrLen;
+
+			if (m->m_len == fm->m_len && frags.size() == 1)
+				break;
+
+			auto * ip = GetMbufHeader<struct ip>(fm, IP_OFF);
+			if (ip->ip_v == 4) {
+				off = (ntohs(ip->ip_off) & IP_OFFMASK) * 8;
+				fragHdrLen = hdrLen;
+			} else {
+				auto * frag = GetMbufHeader<struct ip6_frag>(fm, hdrLen);
+				off = ntohs(frag->ip6f_offlg & IP6F_OFF_MASK);
+				fragHdrLen = hdrLen + sizeof(*frag);
+			}
+
+			size_t len = fm->m_len - fragHdrLen;
+			ASSERT_LE(off + len, dataLen);
+			EXPECT_EQ(memcmp(orig + off,
+			    GetMbufHeader<uint8_t>(fm, fragHdrLen), len), 0);
+			std::fill(seen.begin() + off, seen.begin() + off + len, true);
+		}
+
+		EXPECT_EQ(std::count(seen.begin(), seen.end(), false), 0);
+	}
+};
+
+TEST_F(FragmenterTestSuite, TestIpv4)
+{
+	// 8 bytes of UDP header and 100 bytes of payload, cut 48 bytes at a
+	// time.
+	auto frags = Fragment(GetIpv4Template(100),
+	    sizeof(struct ip) + 50);
+
+	std::vector<FragInfo> expected = {
+		{0, 48, true}, {48, 48, true}, {96, 12, false}
+	};
+	EXPECT_EQ(GetIpv4Info(frags), expected);
+	CheckReassembly(frags, IP_OFF + sizeof(struct ip));
+
+	// Only the first fragment carries the UDP header.
+	auto m = frags.at(0).Generate();
+	auto * uh = GetMbufHeader<struct udphdr>(m, IP_OFF + sizeof(struct ip));
+	EXPECT_EQ(ntohs(uh->uh_sport), 1000);
+	EXPECT_EQ(ntohs(uh->uh_ulen), 108);
+
+	// The reassembled datagram is the original template.
+	EXPECT_THAT(GetIpv4Template(100).Generate().get(),
+	    CompiledPacketMatcher(frags.Reassembled()));
+}
+
+TEST_F(FragmenterTestSuite, TestIpv4Ethernet)
+{
+	auto frags = Fragment(GetIpv4Template(3000), 1500);
+
+	// 1480 bytes of data fit in a 1500 byte MTU.
+	std::vector<FragInfo> expected = {
+		{0, 1480, true}, {1480, 1480, true}, {2960, 48, false}
+	};
+	EXPECT_EQ(GetIpv4Info(frags), expected);
+	CheckReassembly(frags, IP_OFF + sizeof(struct ip));
+}
+
+TEST_F(FragmenterTestSuite, TestIpv4FragmentId)
+{
+	auto frags = Fragment(GetIpv4Template(100), 100,
+	    fragmentId(1234));
+
+	for (const auto & f : frags) {
+		auto m = f.Generate();
+		EXPECT_EQ(ntohs(GetMbufHeader<struct ip>(m, IP_OFF)->ip_id), 1234);
+	}
+
+	auto m = frags.Reassembled().Generate();
+	EXPECT_EQ(ntohs(GetMbufHeader<struct ip>(m, IP_OFF)->ip_id), 1234);
+
+	auto next = frags.Next();
+	m = next.at(1).Generate();
+	EXPECT_EQ(ntohs(GetMbufHeader<struct ip>(m, IP_OFF)->ip_id), 1235);
+}
+
+TEST_F(FragmenterTestSuite, TestIpv6)
+{
+	size_t hdrLen = IP_OFF + sizeof(struct ip6_hdr);
+	auto frags = Fragment(GetIpv6Template(100),
+	    sizeof(struct ip6_hdr) + sizeof(struct ip6_frag) + 50,
+	    fragmentId(0xdeadbeef));
+
+	ASSERT_EQ(frags.size(), 3);
+
+	size_t expectedOff[] = {0, 48, 96};
+	size_t expectedLen[] = {48, 48, 12};
+	for (size_t i = 0; i < frags.size(); ++i) {
+		auto m = frags.at(i).Generate();
+		auto * ip6 = GetMbufHeader<struct ip6_hdr>(m, IP_OFF);
+		auto * frag = GetMbufHeader<struct ip6_frag>(m, hdrLen);
+
+		EXPECT_EQ(ip6->ip6_nxt, IPPROTO_FRAGMENT);
+		EXPECT_EQ(ntohs(ip6->ip6_plen),
+		    sizeof(struct ip6_frag) + expectedLen[i]);
+		EXPECT_EQ(frag->ip6f_nxt, IPPROTO_UDP);
+		EXPECT_EQ(ntohl(frag->ip6f_ident), 0xdeadbeef);
+		EXPECT_EQ(ntohs(frag->ip6f_offlg & IP6F_OFF_MASK), expectedOff[i]);
+		EXPECT_EQ((frag->ip6f_offlg & IP6F_MORE_FRAG) != 0,
+		    i != frags.size() - 1);
+	}
+	CheckReassembly(frags, hdrLen);
+
+	// Fragments can be matched like any other template.
+	auto m = frags.at(1).Generate();
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(frags.at(1)));
+	EXPECT_THAT(m.get(), Not(CompiledPacketMatcher(frags.at(0))));
+
+	auto next = frags.Next();
+	m = next.at(0).Generate();
+	EXPECT_EQ(ntohl(GetMbufHeader<struct ip6_frag>(m, hdrLen)->ip6f_ident),
+	    0xdeadbeef + 1);
+}
+
+// Extension headers that directly follow the IPv6 header are repeated in
+// each fragment, ahead of the fragment header.
+TEST_F(FragmenterTestSuite, TestIpv6Unfragmentable)
+{
+	auto p = PacketTemplate(
+		EthernetHeader(),
+		Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+		HopByHopHeader().With(routerAlert()),
+		UdpHeader(),
+		PacketPayload().With(counterPayload(100))
+	);
+	size_t hdrLen = IP_OFF + sizeof(struct ip6_hdr) + 8;
+	auto frags = Fragment(p, 100);
+
+	ASSERT_EQ(frags.size(), 3);
+	for (const auto & f : frags) {
+		auto m = f.Generate();
+		auto * hbh = GetMbufHeader<struct ip6_hbh>(m,
+		    IP_OFF + sizeof(struct ip6_hdr));
+
+		EXPECT_EQ(GetMbufHeader<struct ip6_hdr>(m, IP_OFF)->ip6_nxt,
+		    IPPROTO_HOPOPTS);
+		EXPECT_EQ(hbh->ip6h_nxt, IPPROTO_FRAGMENT);
+		EXPECT_EQ(GetMbufHeader<struct ip6_frag>(m, hdrLen)->ip6f_nxt,
+		    IPPROTO_UDP);
+	}
+	CheckReassembly(frags, hdrLen);
+}
+
+TEST_F(FragmenterTestSuite, TestOverlap)
+{
+	auto frags = Fragment(GetIpv4Template(100),
+	    sizeof(struct ip) + 48, fragOverlap(12));
+
+	// The overlap is rounded up to 16 bytes.
+	std::vector<FragInfo> expected = {
+		{0, 48, true}, {32, 48, true}, {64, 44, false}
+	};
+	EXPECT_EQ(GetIpv4Info(frags), expected);
+	CheckReassembly(frags, IP_OFF + sizeof(struct ip));
+
+	EXPECT_THROW(Fragment(GetIpv4Template(100),
+	    sizeof(struct ip) + 48, fragOverlap(48)),
+	    std::runtime_error);
+}
+
+TEST_F(FragmenterTestSuite, TestTinyFirstFragment)
+{
+	auto frags = Fragment(GetIpv4Template(100),
+	    sizeof(struct ip) + 48, tinyFirstFragment());
+
+	std::vector<FragInfo> expected = {
+		{0, 8, true}, {8, 48, true}, {56, 48, true}, {104, 4, false}
+	};
+	EXPECT_EQ(GetIpv4Info(frags), expected);
+	CheckReassembly(frags, IP_OFF + sizeof(struct ip));
+
+	auto m = frags.at(0).Generate();
+	auto * uh = GetMbufHeader<struct udphdr>(m, IP_OFF + sizeof(struct ip));
+	EXPECT_EQ(ntohs(uh->uh_dport), 2000);
+}
+
+TEST_F(FragmenterTestSuite, TestOrder)
+{
+	auto p = GetIpv4Template(100);
+	size_t mtu = sizeof(struct ip) + 16;
+	auto inOrder = GetIpv4Info(Fragment(p, mtu));
+
+	ASSERT_EQ(inOrder.size(), 7);
+
+	auto reversed = GetIpv4Info(Fragment(p, mtu, reverseFragments()));
+	EXPECT_TRUE(std::equal(reversed.begin(), reversed.end(),
+	    inOrder.rbegin(), inOrder.rend()));
+
+	auto dup = GetIpv4Info(Fragment(p, mtu, duplicateFragment(2)));
+	ASSERT_EQ(dup.size(), 8);
+	EXPECT_EQ(dup.at(2), inOrder.at(2));
+	EXPECT_EQ(dup.at(3), inOrder.at(2));
+	EXPECT_EQ(dup.at(4), inOrder.at(3));
+
+	auto dropped = Fragment(p, mtu, dropFragment(0), dropFragment(6));
+	auto info = GetIpv4Info(dropped);
+	EXPECT_EQ(info, std::vector<FragInfo>(inOrder.begin() + 1,
+	    inOrder.end() - 1));
+	EXPECT_THROW(Fragment(p, mtu, dropFragment(7)), std::runtime_error);
+
+	// A shuffle is a permutation that depends only on the seed.
+	auto shuffled = Fragment(p, mtu, shuffleFragments(42));
+	auto s1 = GetIpv4Info(shuffled);
+	auto s2 = GetIpv4Info(Fragment(p, mtu, shuffleFragments(42)));
+	auto s3 = GetIpv4Info(Fragment(p, mtu, shuffleFragments(43)));
+	EXPECT_EQ(s1, s2);
+	EXPECT_NE(s1, s3);
+	EXPECT_NE(s1, inOrder);
+	EXPECT_TRUE(std::is_permutation(s1.begin(), s1.end(), inOrder.begin()));
+	CheckReassembly(shuffled, IP_OFF + sizeof(struct ip));
+}
+
+TEST_F(FragmenterTestSuite, TestSmallDatagram)
+{
+	auto frags = Fragment(GetIpv4Template(10), 1500);
+
+	ASSERT_EQ(frags.size(), 1);
+	auto m = frags.at(0).Generate();
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(GetIpv4Template(10)));
+
+	EXPECT_THROW(Fragment(GetIpv4Template(10), sizeof(struct ip)),
+	    std::runtime_error);
+	EXPECT_THROW(Fragment(GetIpv6Template(10),
+	    sizeof(struct ip6_hdr) + sizeof(struct ip6_frag) + 7),
+	    std::runtime_error);
+}
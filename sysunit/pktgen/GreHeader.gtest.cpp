@@ -0,0 +1,173 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Gre.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Tcp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+using PktGen::internal::gre_hdr;
+using PktGen::internal::InetChecksumAdd;
+using PktGen::internal::InetChecksumFinish;
+
+class GreHeaderTestSuite : public SysUnit::TestSuite
+{
+public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+
+	// A TCP/IPv6 packet in GRE over IPv4.
+	static auto GetTemplate()
+	{
+		return PacketTemplate(
+			EthernetHeader(),
+			Ipv4Header().With(src("10.0.0.1"), dst("10.0.0.2")),
+			GreHeader(),
+			Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+			TcpHeader().With(src(1000), dst(80)),
+			PacketPayload().With(payload("inner"))
+		);
+	}
+
+	static constexpr size_t GRE_OFF = sizeof(struct ether_header) +
+	    sizeof(struct ip);
+	static constexpr size_t INNER_LEN = sizeof(struct ip6_hdr) +
+	    sizeof(struct tcphdr) + 5;
+
+	static uint32_t GetWord(const MbufUniquePtr & m, size_t off)
+	{
+		return ntohl(*GetMbufHeader<uint32_t>(m, off));
+	}
+};
+
+TEST_F(GreHeaderTestSuite, TestEncapsulation)
+{
+	MbufUniquePtr m = GetTemplate().Generate();
+
+	ASSERT_EQ(m->m_pkthdr.len, GRE_OFF + sizeof(struct gre_hdr) + INNER_LEN);
+
+	auto * ip = GetMbufHeader<struct ip>(m, sizeof(struct ether_header));
+	EXPECT_EQ(ip->ip_p, IPPROTO_GRE);
+	EXPECT_EQ(ntohs(ip->ip_len),
+	    sizeof(struct ip) + sizeof(struct gre_hdr) + INNER_LEN);
+
+	auto * gre = GetMbufHeader<struct gre_hdr>(m, GRE_OFF);
+	EXPECT_EQ(gre->flags, 0);
+	EXPECT_EQ(ntohs(gre->proto), ETHERTYPE_IPV6);
+
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m, GRE_OFF + sizeof(*gre));
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_TCP);
+}
+
+// An Ethernet frame in GRE is sent with the transparent Ethernet bridging
+// protocol type.
+TEST_F(GreHeaderTestSuite, TestEthernetOverGre)
+{
+	auto p = PacketTemplate(
+		Ipv6Header(),
+		GreHeader(),
+		EthernetHeader(),
+		Ipv4Header()
+	);
+
+	MbufUniquePtr m = p.Generate();
+	auto * gre = GetMbufHeader<struct gre_hdr>(m, sizeof(struct ip6_hdr));
+	EXPECT_EQ(ntohs(gre->proto), ETHERTYPE_TRANSETHER);
+
+	auto * eh = GetMbufHeader<struct ether_header>(m,
+	    sizeof(struct ip6_hdr) + sizeof(*gre));
+	EXPECT_EQ(ntohs(eh->ether_type), ETHERTYPE_IP);
+}
+
+// Verify the layout of the optional checksum, key and sequence number words,
+// that the checksum covers the encapsulated packet and that Next() advances
+// the sequence number.
+TEST_F(GreHeaderTestSuite, TestOptions)
+{
+	auto p = GetTemplate().WithHeader(Layer::TUNNEL).Fields(
+	    greChecksum(), greKey(0xabcd), greSeq(100));
+	size_t greLen = sizeof(struct gre_hdr) + 3 * sizeof(uint32_t);
+
+	MbufUniquePtr m = p.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, GRE_OFF + greLen + INNER_LEN);
+
+	auto * gre = GetMbufHeader<struct gre_hdr>(m, GRE_OFF);
+	EXPECT_EQ(ntohs(gre->flags), 0xb000);
+	EXPECT_EQ(GetWord(m, GRE_OFF + 8), 0xabcdU);
+	EXPECT_EQ(GetWord(m, GRE_OFF + 12), 100U);
+
+	uint32_t sum = InetChecksumAdd(0, gre, greLen + INNER_LEN);
+	EXPECT_EQ(InetChecksumFinish(sum), 0);
+	EXPECT_EQ(GetWord(m, GRE_OFF + 4) & 0xffff, 0U);
+
+	m = p.Next().Generate();
+	EXPECT_EQ(GetWord(m, GRE_OFF + 12), 101U);
+}
+
+TEST_F(GreHeaderTestSuite, TestMatcher)
+{
+	auto p = GetTemplate().WithHeader(Layer::TUNNEL).Fields(
+	    greChecksum(), greKey(6), greSeq(100));
+	MbufUniquePtr m = p.Generate();
+
+	EXPECT_THAT(m.get(), PacketMatcher(p));
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(p));
+
+	EXPECT_THAT(Explain(PacketMatcher(
+	    p.WithHeader(Layer::TUNNEL).Fields(greSeq(101))), m.get()),
+	    HasSubstr("GRE: seq is 100 (expected 101)"));
+	EXPECT_THAT(Explain(PacketMatcher(
+	    p.WithHeader(Layer::TUNNEL).Fields(greKey(5))), m.get()),
+	    HasSubstr("GRE: key is 6 (expected 5)"));
+
+	// Corrupt the inner payload.
+	GetMbufHeader<char>(m, m->m_pkthdr.len - 1)[0] = 'x';
+	EXPECT_THAT(Explain(PacketMatcher(p), m.get()),
+	    HasSubstr("GRE: checksum is"));
+}
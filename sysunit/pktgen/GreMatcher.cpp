@@ -0,0 +1,120 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Gre.h"
+
+#include <netinet/in.h>
+
+#include <string.h>
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	GreMatcher::GreMatcher(const GreTemplate & h, size_t off)
+	  : header(h),
+	    headerOffset(off)
+	{
+	}
+
+	static uint32_t GetWord(const uint8_t * p)
+	{
+		uint32_t x;
+
+		memcpy(&x, p, sizeof(x));
+		return ntoh(x);
+	}
+
+	bool GreMatcher::MatchAndExplain(mbuf* m,
+	    MatchResultListener* listener) const
+	{
+		auto * gre = GetMbufHeader<uint8_t>(m, headerOffset);
+		auto * fixed = reinterpret_cast<const struct gre_hdr *>(gre);
+		const uint8_t * opt = gre + sizeof(*fixed);
+
+		if (ntoh(fixed->flags) != header.GetFlags()) {
+			*listener << "GRE: flags are " << std::hex
+			    << ntoh(fixed->flags) << " (expected "
+			    << header.GetFlags() << ")" << std::dec;
+			return false;
+		}
+
+		if (ntoh(fixed->proto) != header.GetEthertype()) {
+			*listener << "GRE: protocol is " << std::hex
+			    << ntoh(fixed->proto) << " (expected "
+			    << header.GetEthertype() << ")" << std::dec;
+			return false;
+		}
+
+		if (header.GetChecksumPresent()) {
+			uint16_t sum = GetWord(opt) >> 16;
+			uint16_t expected = header.ComputeChecksum(gre);
+
+			if (sum != expected) {
+				*listener << "GRE: checksum is " << std::hex << sum
+				    << " (expected " << expected << ")"
+				    << std::dec;
+				return false;
+			}
+			opt += sizeof(uint32_t);
+		}
+
+		if (header.GetKey()) {
+			if (GetWord(opt) != *header.GetKey()) {
+				*listener << "GRE: key is " << GetWord(opt)
+				    << " (expected " << *header.GetKey() << ")";
+				return false;
+			}
+			opt += sizeof(uint32_t);
+		}
+
+		if (header.GetSeq()) {
+			if (GetWord(opt) != *header.GetSeq()) {
+				*listener << "GRE: seq is " << GetWord(opt)
+				    << " (expected " << *header.GetSeq() << ")";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void GreMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "GRE";
+	}
+
+	void CompilePacketMask(const GreTemplate & header,
+	    CompiledPacket & packet, size_t off)
+	{
+		// Every byte of the header is significant.
+	}
+}
@@ -243,3 +243,64 @@ TEST_F(Ipv4HeaderTestSuite, TestPayload)
 	auto p3 = p1.WithHeader(Layer::PAYLOAD).Fields(payload("ipv4", 6018));
 	VerifyMbufChainLen(p3, 6018);
 }
+
+// Add options to a template and verify that they are laid out after the
+// header, padded to a 32-bit boundary, and that ip_hl and ip_len cover them.
+TEST_F(Ipv4HeaderTestSuite, TestOptions)
+{
+	auto p1 = PacketTemplate(
+	    Ipv4Header().With(
+	        routerAlert(),
+	        sourceRoute({"10.0.0.1", "10.0.0.2"})
+	    ),
+	    PacketPayload().With(payload("opts"))
+	);
+
+	MbufUniquePtr m = p1.Generate();
+	size_t optLen = 4 + 12;
+
+	ASSERT_EQ(m->m_pkthdr.len, sizeof(struct ip) + optLen + 4);
+
+	struct ip * ip = GetMbufHeader<struct ip>(m);
+	EXPECT_EQ(ip->ip_hl, (sizeof(struct ip) + optLen) / sizeof(uint32_t));
+	EXPECT_EQ(ntoh(ip->ip_len), sizeof(struct ip) + optLen + 4);
+
+	const uint8_t expected[] = {
+		IPOPT_RA, 4, 0, 0,
+		IPOPT_LSRR, 11, 4, 10, 0, 0, 1, 10, 0, 0, 2, IPOPT_EOL,
+	};
+	const uint8_t * opt = reinterpret_cast<uint8_t *>(ip + 1);
+	EXPECT_EQ(memcmp(opt, expected, sizeof(expected)), 0);
+
+	auto p2 = p1.WithHeader(Layer::L3).Fields(
+	    noIpOptions(),
+	    recordRoute(2),
+	    ipTimestamp(1)
+	);
+	const uint8_t expected2[] = {
+		IPOPT_RR, 11, 4, 0, 0, 0, 0, 0, 0, 0, 0,
+		IPOPT_TS, 8, 5, 0, 0, 0, 0, 0,
+		IPOPT_EOL,
+	};
+	m = p2.Generate();
+	ip = GetMbufHeader<struct ip>(m);
+	optLen = sizeof(expected2);
+	EXPECT_EQ(ip->ip_hl, (sizeof(struct ip) + optLen) / sizeof(uint32_t));
+	EXPECT_EQ(ntoh(ip->ip_len), sizeof(struct ip) + optLen + 4);
+
+	opt = reinterpret_cast<uint8_t *>(ip + 1);
+	EXPECT_EQ(memcmp(opt, expected2, sizeof(expected2)), 0);
+
+	auto p3 = p2.WithHeader(Layer::L3).Fields(noIpOptions());
+	m = p3.Generate();
+	ip = GetMbufHeader<struct ip>(m);
+	EXPECT_EQ(ip->ip_hl, sizeof(struct ip) / sizeof(uint32_t));
+	EXPECT_EQ(m->m_pkthdr.len, sizeof(struct ip) + 4);
+}
+
+// The options field is at most 40 bytes long.
+TEST_F(Ipv4HeaderTestSuite, TestOptionsTooLong)
+{
+	EXPECT_THROW(Ipv4Header().With(recordRoute(10)), std::runtime_error);
+	EXPECT_NO_THROW(Ipv4Header().With(recordRoute(8), routerAlert()));
+}
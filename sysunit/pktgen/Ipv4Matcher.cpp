@@ -28,8 +28,11 @@
 
 #include "fake/mbuf.h"
 
+#include "pktgen/CompiledMatcher.h"
 #include "pktgen/Ipv4.h"
 
+#include <vector>
+
 extern "C" {
 #include "kern_include/sys/types.h"
 #include "kern_include/netinet/in.h"
@@ -85,6 +88,20 @@ namespace PktGen::internal
 			return false;
 		}
 
+		size_t optLen = header.GetLen() - sizeof(struct ip);
+		std::vector<uint8_t> expected(optLen);
+		auto * actual = reinterpret_cast<const uint8_t *>(ip + 1);
+
+		header.GetOptions().Fill(expected.data());
+		for (size_t i = 0; i < optLen; ++i) {
+			if (actual[i] != expected[i]) {
+				*listener << "IPv4: option byte " << i << " is "
+				    << (int)actual[i] << " (expected "
+				    << (int)expected[i] << ")";
+				return false;
+			}
+		}
+
 		uint32_t expectedFlag = 0;
 		if (header.GetChecksumVerified())
 			expectedFlag = CSUM_L3_CALC;
@@ -114,4 +131,14 @@ namespace PktGen::internal
 	{
 		*os << "IPv4";
 	}
+
+	void CompilePacketMask(const Ipv4Template & header, CompiledPacket & packet,
+	    size_t off)
+	{
+		// XXX tcp_lro always updates this...
+		packet.IgnoreBytes(off + offsetof(struct ip, ip_sum),
+		    sizeof(((struct ip *)0)->ip_sum));
+
+		packet.csumMask |= CSUM_L3_CALC | CSUM_L3_VALID;
+	}
 }
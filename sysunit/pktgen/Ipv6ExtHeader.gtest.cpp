@@ -0,0 +1,280 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Ipv6Ext.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Tcp.h"
+#include "pktgen/Udp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+using PktGen::internal::Ipv6Addr;
+
+class Ipv6ExtHeaderTestSuite : public SysUnit::TestSuite
+{
+public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+
+	static auto GetIpv6Template()
+	{
+		return Ipv6Header().With(src("fd00::1"), dst("fd00::2"));
+	}
+
+	static const uint8_t * GetOptions(const MbufUniquePtr & m, size_t off)
+	{
+		return GetMbufHeader<uint8_t>(m, off + sizeof(struct ip6_ext));
+	}
+
+	static constexpr size_t EXT_OFF = sizeof(struct ip6_hdr);
+};
+
+// Each extension header takes the protocol of the header that follows it,
+// and gives its own type to the header that precedes it.
+TEST_F(Ipv6ExtHeaderTestSuite, TestChain)
+{
+	auto p = PacketTemplate(
+		GetIpv6Template(),
+		HopByHopHeader().With(routerAlert()),
+		DestOptsHeader(),
+		TcpHeader(),
+		PacketPayload().With(payload("chain"))
+	);
+
+	MbufUniquePtr m = p.Generate();
+	size_t tcpOff = EXT_OFF + 16;
+
+	ASSERT_EQ(m->m_pkthdr.len, tcpOff + sizeof(struct tcphdr) + 5);
+
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m);
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_HOPOPTS);
+	EXPECT_EQ(ntohs(ip6->ip6_plen), 16 + sizeof(struct tcphdr) + 5);
+
+	auto * hbh = GetMbufHeader<struct ip6_ext>(m, EXT_OFF);
+	EXPECT_EQ(hbh->ip6e_nxt, IPPROTO_DSTOPTS);
+	EXPECT_EQ(hbh->ip6e_len, 0);
+
+	const uint8_t * opt = GetOptions(m, EXT_OFF);
+	const uint8_t expectedRa[] = { IP6OPT_ROUTER_ALERT, 2, 0, 0,
+	    IP6OPT_PADN, 0 };
+	EXPECT_EQ(memcmp(opt, expectedRa, sizeof(expectedRa)), 0);
+
+	// An empty options header is a single PadN.
+	auto * dstopts = GetMbufHeader<struct ip6_ext>(m, EXT_OFF + 8);
+	EXPECT_EQ(dstopts->ip6e_nxt, IPPROTO_TCP);
+	EXPECT_EQ(dstopts->ip6e_len, 0);
+	opt = GetOptions(m, EXT_OFF + 8);
+	EXPECT_EQ(opt[0], IP6OPT_PADN);
+	EXPECT_EQ(opt[1], 4);
+
+	// The headers can be addressed individually by nesting.
+	auto p2 = p.WithHeader(NestedLayer::EXTENSION<2>).Fields(
+	    ipOption(0x1e, {1, 2, 3}));
+	m = p2.Generate();
+	opt = GetOptions(m, EXT_OFF + 8);
+	const uint8_t expectedRaw[] = { 0x1e, 3, 1, 2, 3, IP6OPT_PAD1 };
+	EXPECT_EQ(memcmp(opt, expectedRaw, sizeof(expectedRaw)), 0);
+}
+
+// Options are padded to a multiple of 8 octets, so adding options grows the
+// header in 8-octet steps.
+TEST_F(Ipv6ExtHeaderTestSuite, TestOptionPadding)
+{
+	auto p = PacketTemplate(
+		GetIpv6Template(),
+		DestOptsHeader().With(ipOption(0x1e, std::vector<uint8_t>(8))),
+		UdpHeader()
+	);
+
+	MbufUniquePtr m = p.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, EXT_OFF + 16 + sizeof(struct udphdr));
+
+	auto * ext = GetMbufHeader<struct ip6_ext>(m, EXT_OFF);
+	EXPECT_EQ(ext->ip6e_nxt, IPPROTO_UDP);
+	EXPECT_EQ(ext->ip6e_len, 1);
+
+	const uint8_t * opt = GetOptions(m, EXT_OFF);
+	EXPECT_EQ(opt[10], IP6OPT_PADN);
+	EXPECT_EQ(opt[11], 2);
+}
+
+// A routing header carries its addresses and counts down the segments left.
+// It does not change the UDP pseudo-header, which is taken from the IPv6
+// header through the extension header.
+TEST_F(Ipv6ExtHeaderTestSuite, TestRouting)
+{
+	auto udp = PacketTemplate(
+		GetIpv6Template(),
+		UdpHeader().With(src(5000), dst(53)),
+		PacketPayload().With(payload("query"))
+	);
+	auto routed = PacketTemplate(
+		GetIpv6Template(),
+		RoutingHeader().With(
+			routingType(2),
+			sourceRoute({"fd00::10", "fd00::11"})
+		),
+		UdpHeader().With(src(5000), dst(53)),
+		PacketPayload().With(payload("query"))
+	);
+
+	MbufUniquePtr m = routed.Generate();
+	size_t rhLen = 8 + 2 * sizeof(struct in6_addr);
+
+	ASSERT_EQ(m->m_pkthdr.len, EXT_OFF + rhLen + sizeof(struct udphdr) + 5);
+
+	auto * rh = GetMbufHeader<struct ip6_rthdr>(m, EXT_OFF);
+	EXPECT_EQ(rh->ip6r_nxt, IPPROTO_UDP);
+	EXPECT_EQ(rh->ip6r_len, 4);
+	EXPECT_EQ(rh->ip6r_type, 2);
+	EXPECT_EQ(rh->ip6r_segleft, 2);
+
+	auto * addr = GetMbufHeader<struct in6_addr>(m, EXT_OFF + 8);
+	EXPECT_EQ(Ipv6Addr(addr[0]), Ipv6Addr("fd00::10"));
+	EXPECT_EQ(Ipv6Addr(addr[1]), Ipv6Addr("fd00::11"));
+
+	MbufUniquePtr plain = udp.Generate();
+	auto * uh = GetMbufHeader<struct udphdr>(m, EXT_OFF + rhLen);
+	auto * plainUh = GetMbufHeader<struct udphdr>(plain, EXT_OFF);
+	EXPECT_EQ(uh->uh_sum, plainUh->uh_sum);
+
+	m = routed.WithHeader(Layer::EXTENSION).Fields(segmentsLeft(1))
+	    .Generate();
+	rh = GetMbufHeader<struct ip6_rthdr>(m, EXT_OFF);
+	EXPECT_EQ(rh->ip6r_segleft, 1);
+}
+
+TEST_F(Ipv6ExtHeaderTestSuite, TestFragment)
+{
+	auto p = PacketTemplate(
+		GetIpv6Template(),
+		FragmentHeader().With(
+			fragOffset(1448),
+			moreFragments(),
+			id(0x12345678)
+		),
+		UdpHeader()
+	);
+
+	MbufUniquePtr m = p.Generate();
+	ASSERT_EQ(m->m_pkthdr.len,
+	    EXT_OFF + sizeof(struct ip6_frag) + sizeof(struct udphdr));
+
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m);
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_FRAGMENT);
+
+	auto * frag = GetMbufHeader<struct ip6_frag>(m, EXT_OFF);
+	EXPECT_EQ(frag->ip6f_nxt, IPPROTO_UDP);
+	EXPECT_EQ(frag->ip6f_reserved, 0);
+	EXPECT_EQ(ntohs(frag->ip6f_offlg), 1448 | 1);
+	EXPECT_EQ(ntohl(frag->ip6f_ident), 0x12345678U);
+
+	m = p.WithHeader(Layer::EXTENSION).Fields(moreFragments(false))
+	    .Generate();
+	frag = GetMbufHeader<struct ip6_frag>(m, EXT_OFF);
+	EXPECT_EQ(ntohs(frag->ip6f_offlg), 1448);
+}
+
+// An IPv6 packet tunnelled in IPv6 after a destination options header, as
+// RFC 2473 tunnel endpoints send it with the tunnel encapsulation limit.
+TEST_F(Ipv6ExtHeaderTestSuite, TestTunnel)
+{
+	auto p = PacketTemplate(
+		EthernetHeader(),
+		GetIpv6Template(),
+		DestOptsHeader().With(ipOption(IP6OPT_TUNNEL_LIMIT, {4})),
+		GetIpv6Template(),
+		TcpHeader()
+	);
+
+	MbufUniquePtr m = p.Generate();
+	auto * ext = GetMbufHeader<struct ip6_ext>(m,
+	    sizeof(struct ether_header) + EXT_OFF);
+	EXPECT_EQ(ext->ip6e_nxt, IPPROTO_IPV6);
+}
+
+TEST_F(Ipv6ExtHeaderTestSuite, TestMatcher)
+{
+	auto p = PacketTemplate(
+		EthernetHeader(),
+		GetIpv6Template(),
+		HopByHopHeader().With(routerAlert()),
+		RoutingHeader().With(sourceRoute({"fd00::10"})),
+		FragmentHeader().With(id(7)),
+		TcpHeader(),
+		PacketPayload().With(payload("match"))
+	);
+	MbufUniquePtr m = p.Generate();
+
+	EXPECT_THAT(m.get(), PacketMatcher(p));
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(p));
+
+	auto badRa = p.WithHeader(NestedLayer::EXTENSION<1>)
+	    .Fields(ipOption(0x1e, {}));
+	EXPECT_THAT(Explain(PacketMatcher(badRa), m.get()),
+	    HasSubstr("IPv6 ext: option byte 4 is 1 (expected 30)"));
+
+	auto badRoute = p.WithHeader(NestedLayer::EXTENSION<2>)
+	    .Fields(sourceRoute({"fd00::11"}));
+	EXPECT_THAT(Explain(PacketMatcher(badRoute), m.get()),
+	    HasSubstr("IPv6 ext: route address is"));
+
+	auto badId = p.WithHeader(Layer::INNER_EXTENSION).Fields(id(8));
+	EXPECT_THAT(Explain(PacketMatcher(badId), m.get()),
+	    HasSubstr("IPv6 ext: ip6f_ident field is 7 (expected 8)"));
+	EXPECT_THAT(Explain(CompiledPacketMatcher(badId), m.get()),
+	    HasSubstr("IPv6 ext: ip6f_ident field is 7 (expected 8)"));
+}
+
+// Fields that do not exist in a kind of extension header are rejected.
+TEST_F(Ipv6ExtHeaderTestSuite, TestInvalidField)
+{
+	EXPECT_THROW(FragmentHeader().With(routerAlert()), std::runtime_error);
+	EXPECT_THROW(HopByHopHeader().With(id(1)), std::runtime_error);
+	EXPECT_THROW(RoutingHeader().With(strictSourceRoute({"fd00::1"})),
+	    std::runtime_error);
+}
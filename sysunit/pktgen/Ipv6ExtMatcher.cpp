@@ -0,0 +1,127 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ipv6Ext.h"
+
+#include <vector>
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	Ipv6ExtMatcher::Ipv6ExtMatcher(const Ipv6ExtTemplate & h, size_t off)
+	  : header(h),
+	    headerOffset(off)
+	{
+	}
+
+	#define	CheckField(field, expect, name) do { \
+		if ((field) != (expect)) { \
+			*listener << "IPv6 ext: " name " field is " << (int)(field) \
+			    << " (expected " << (int)(expect) << ")"; \
+			return false; \
+		} \
+	} while (0)
+
+	bool Ipv6ExtMatcher::MatchAndExplain(mbuf* m,
+	    MatchResultListener* listener) const
+	{
+		auto * ext = GetMbufHeader<struct ip6_ext>(m, headerOffset);
+
+		CheckField(ext->ip6e_nxt, header.GetProto(), "ip6e_nxt");
+
+		if (header.GetType() == IPPROTO_FRAGMENT) {
+			auto * frag = GetMbufHeader<struct ip6_frag>(m, headerOffset);
+
+			CheckField(ntoh(frag->ip6f_offlg), header.GetOff(),
+			    "ip6f_offlg");
+
+			if (ntoh(frag->ip6f_ident) != header.GetId()) {
+				*listener << "IPv6 ext: ip6f_ident field is "
+				    << ntoh(frag->ip6f_ident) << " (expected "
+				    << header.GetId() << ")";
+				return false;
+			}
+
+			return true;
+		}
+
+		CheckField(ext->ip6e_len, header.GetLen() / 8 - 1, "ip6e_len");
+
+		if (header.GetType() == IPPROTO_ROUTING) {
+			auto * rh = GetMbufHeader<struct ip6_rthdr0>(m, headerOffset);
+			auto * addr = reinterpret_cast<const struct in6_addr *>(rh + 1);
+
+			CheckField(rh->ip6r0_type, header.GetRoutingType(),
+			    "ip6r0_type");
+			CheckField(rh->ip6r0_segleft, header.GetSegmentsLeft(),
+			    "ip6r0_segleft");
+
+			for (const auto & hop : header.GetRoute()) {
+				if (hop != *addr) {
+					*listener << "IPv6 ext: route address is "
+					    << *addr << " (expected " << hop << ")";
+					return false;
+				}
+				addr++;
+			}
+
+			return true;
+		}
+
+		size_t optLen = header.GetLen() - sizeof(struct ip6_ext);
+		std::vector<uint8_t> expected(optLen);
+		auto * actual = reinterpret_cast<const uint8_t *>(ext + 1);
+
+		header.FillOptions(expected.data());
+		for (size_t i = 0; i < optLen; ++i) {
+			if (actual[i] != expected[i]) {
+				*listener << "IPv6 ext: option byte " << i
+				    << " is " << (int)actual[i]
+				    << " (expected " << (int)expected[i] << ")";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Ipv6ExtMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "IPv6 ext";
+	}
+
+	void CompilePacketMask(const Ipv6ExtTemplate & header,
+	    CompiledPacket & packet, size_t off)
+	{
+		// Every byte of the header is significant.
+	}
+}
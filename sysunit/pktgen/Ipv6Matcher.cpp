@@ -28,6 +28,7 @@
 
 #include "fake/mbuf.h"
 
+#include "pktgen/CompiledMatcher.h"
 #include "pktgen/Ipv6.h"
 
 extern "C" {
@@ -86,4 +87,10 @@ namespace PktGen::internal
 	{
 		*os << "IPv6";
 	}
+
+	void CompilePacketMask(const Ipv6Template & header, CompiledPacket & packet,
+	    size_t off)
+	{
+		// Every byte of the IPv6 header is significant.
+	}
 }
@@ -41,12 +41,21 @@ namespace PktGen::internal
 		case LayerVal::L2:
 			shortName = "L2";
 			break;
+		case LayerVal::VLAN:
+			shortName = "VLAN";
+			break;
 		case LayerVal::L3:
 			shortName = "L3";
 			break;
+		case LayerVal::EXTENSION:
+			shortName = "EXTENSION";
+			break;
 		case LayerVal::L4:
 			shortName = "L4";
 			break;
+		case LayerVal::TUNNEL:
+			shortName = "TUNNEL";
+			break;
 		case LayerVal::PAYLOAD:
 			shortName = "PAYLOAD";
 			break;
@@ -64,15 +73,24 @@ namespace PktGen::internal
 namespace PktGen::Layer
 {
 	const internal::LayerImpl<internal::LayerVal::L2, 1> L2;
+	const internal::LayerImpl<internal::LayerVal::VLAN, 1> VLAN;
 	const internal::LayerImpl<internal::LayerVal::L3, 1> L3;
+	const internal::LayerImpl<internal::LayerVal::EXTENSION, 1> EXTENSION;
 	const internal::LayerImpl<internal::LayerVal::L4, 1> L4;
+	const internal::LayerImpl<internal::LayerVal::TUNNEL, 1> TUNNEL;
 	const internal::LayerImpl<internal::LayerVal::PAYLOAD, 1> PAYLOAD;
 
 	const internal::LayerImpl<internal::LayerVal::L2, 1> OUTER_L2;
+	const internal::LayerImpl<internal::LayerVal::VLAN, 1> OUTER_VLAN;
 	const internal::LayerImpl<internal::LayerVal::L3, 1> OUTER_L3;
+	const internal::LayerImpl<internal::LayerVal::EXTENSION, 1> OUTER_EXTENSION;
 	const internal::LayerImpl<internal::LayerVal::L4, 1> OUTER_L4;
+	const internal::LayerImpl<internal::LayerVal::TUNNEL, 1> OUTER_TUNNEL;
 
 	const internal::LayerImpl<internal::LayerVal::L2, -1> INNER_L2;
+	const internal::LayerImpl<internal::LayerVal::VLAN, -1> INNER_VLAN;
 	const internal::LayerImpl<internal::LayerVal::L3, -1> INNER_L3;
+	const internal::LayerImpl<internal::LayerVal::EXTENSION, -1> INNER_EXTENSION;
 	const internal::LayerImpl<internal::LayerVal::L4, -1> INNER_L4;
+	const internal::LayerImpl<internal::LayerVal::TUNNEL, -1> INNER_TUNNEL;
 }
@@ -283,3 +283,82 @@ TEST_F(PacketEncapsulationTestSuite, TestDoubleInner)
 
 	TestPayload(p2, expected);
 }
+
+// IP-in-IP: an L3 header directly encapsulating another L3 header must set
+// the outer protocol/next header field instead of an ethertype.
+TEST_F(PacketEncapsulationTestSuite, TestIpInIp)
+{
+	auto p1 = PacketTemplate(
+		EthernetHeader(),
+		Ipv6Header(),
+		Ipv4Header(),
+		TcpHeader(),
+		PacketPayload()
+	);
+
+	struct ExpectedHeaders {
+		struct ether_header eh;
+		struct ip6_hdr outer;
+		struct ip inner;
+		struct tcphdr tcp;
+		char payload[4];
+	} __packed expected  = {
+		.eh = {
+			.ether_shost = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05 },
+			.ether_dhost = { 0x04, 0x09, 0x16, 0x25, 0x36, 0x49 },
+			.ether_type = ntohs(ETHERTYPE_IPV6),
+		},
+		.outer = {
+			.ip6_flow = htonl(0x60000000),
+			.ip6_plen = htons(sizeof(ExpectedHeaders) - offsetof(struct ExpectedHeaders, inner)),
+			.ip6_hlim = 64,
+			.ip6_nxt = IPPROTO_IPV4,
+			.ip6_src.s6_addr = {0xde, 0xad, 0xc0, 0xde},
+			.ip6_dst.s6_addr = {0xca, 0xfe, 0xba, 0xbe},
+		},
+		.inner = {
+			.ip_v = 4,
+			.ip_hl = sizeof(struct ip) / sizeof(uint32_t),
+			.ip_len = htons(sizeof(ExpectedHeaders) - offsetof(struct ExpectedHeaders, inner)),
+			.ip_src.s_addr = htonl(0x0a010203),
+			.ip_dst.s_addr = htonl(0x0b030201),
+			.ip_ttl = 255,
+			.ip_p = IPPROTO_TCP,
+		},
+		.tcp = {
+			.th_sport = htons(11965),
+			.th_dport = htons(80),
+			.th_off = sizeof(struct tcphdr) / sizeof(uint32_t),
+			.th_seq = htonl(2568),
+			.th_ack = htonl(69541),
+			.th_flags = TH_ACK,
+			.th_win = htons(4)
+		},
+		.payload = { 'w', 'x', 'y', 'z' }
+	};
+
+	auto p2 = p1
+		.WithHeader(Layer::L2).Fields(
+			src("00:01:02:03:04:05"),
+			dst("04:09:16:25:36:49")
+		).WithHeader(Layer::OUTER_L3).Fields(
+			src("dead:c0de::"),
+			dst("cafe:babe::"),
+			hopLimit(64)
+		).WithHeader(Layer::INNER_L3).Fields(
+			src("10.1.2.3"),
+			dst("11.3.2.1"),
+			ttl(255)
+		).WithHeader(Layer::L4).Fields(
+			src(11965),
+			dst(80),
+			seq(2568),
+			ack(69541),
+			flags(TH_ACK),
+			window(4)
+		).WithHeader(Layer::PAYLOAD).Fields(
+			payload("wxyz")
+		);
+
+	TestPayload(p2, expected);
+}
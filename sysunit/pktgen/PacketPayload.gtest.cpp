@@ -198,6 +198,169 @@ TEST_F(PacketPayloadTestSuite, TestReduceLength)
 	ASSERT_EQ(m->m_pkthdr.len, 0);
 }
 
+TEST_F(PacketPayloadTestSuite, TestReduceLengthAcrossAppends)
+{
+	auto p1 = PacketTemplate(PacketPayload()
+	    .With(payload("abc"), appendPayload({1, 2, 3}), appendPayload('z', 4)));
+	auto p2 = p1.With(length(5));
+
+	MbufUniquePtr m = p2.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, 5);
+	EXPECT_EQ(m->m_data[0], 'a');
+	EXPECT_EQ(m->m_data[1], 'b');
+	EXPECT_EQ(m->m_data[2], 'c');
+	EXPECT_EQ(m->m_data[3], 1);
+	EXPECT_EQ(m->m_data[4], 2);
+
+	auto p3 = p2.With(appendPayload('y'));
+
+	m = p3.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, 6);
+	EXPECT_EQ(m->m_data[4], 2);
+	EXPECT_EQ(m->m_data[5], 'y');
+}
+
+TEST_F(PacketPayloadTestSuite, TestCounterPayload)
+{
+	auto p = PacketTemplate(PacketPayload().With(counterPayload(600, 250)));
+
+	MbufUniquePtr m = p.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, 600);
+
+	auto * data = GetMbufHeader<uint8_t>(m);
+	for (int i = 0; i < m->m_pkthdr.len; ++i)
+		ASSERT_EQ(data[i], uint8_t(250 + i)) << "Mismatch at index " << i;
+}
+
+// A repeated pattern is generated from a buffer of a few kilobytes, so
+// verify that a payload much larger than that is still generated correctly.
+TEST_F(PacketPayloadTestSuite, TestLargeStringPayload)
+{
+	std::string pattern("FreeBSD");
+	size_t len = 3 * IP_MAXPACKET;
+	auto p = PacketTemplate(PacketPayload().With(payload(pattern, len)));
+
+	MbufUniquePtr m = p.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, len);
+
+	for (size_t i = 0; i < len; ++i)
+		ASSERT_EQ(m->m_data[i], pattern[i % pattern.size()]) << "Mismatch at index " << i;
+}
+
+// Generate a sequence-numbered payload in segments that do not start on a
+// word boundary and verify every byte against the sequence number it encodes.
+TEST_F(PacketPayloadTestSuite, TestSeqPayload)
+{
+	uint32_t isn = 0xfffffff0;
+	size_t segLen = 1001;
+	size_t len = 10 * segLen;
+	auto p = PacketTemplate(PacketPayload().With(seqPayload(isn, len), mtu(segLen)));
+
+	for (size_t off = 0; off < len; off += segLen) {
+		MbufUniquePtr m = p.Generate();
+		ASSERT_EQ(m->m_pkthdr.len, segLen);
+
+		auto * data = GetMbufHeader<uint8_t>(m);
+		for (size_t i = 0; i < segLen; ++i) {
+			size_t streamOff = off + i;
+			uint32_t word = isn + uint32_t(streamOff - streamOff % 4);
+			uint8_t expected = word >> (8 * (3 - streamOff % 4));
+
+			ASSERT_EQ(data[i], expected) << "Mismatch at offset " << streamOff;
+		}
+
+		p = p.Next();
+	}
+}
+
+// Verify that a random payload is reproducible from its seed and that any
+// segment of it can be generated independently of the rest of the stream.
+TEST_F(PacketPayloadTestSuite, TestRandomPayload)
+{
+	size_t len = 8191;
+	auto whole = PacketTemplate(PacketPayload().With(randomPayload(17, len)));
+	MbufUniquePtr m = whole.Generate();
+	ASSERT_EQ(m->m_pkthdr.len, len);
+
+	MbufUniquePtr again = whole.Generate();
+	EXPECT_EQ(memcmp(m->m_data, again->m_data, len), 0);
+
+	MbufUniquePtr other = PacketTemplate(PacketPayload()
+	    .With(randomPayload(18, len))).Generate();
+	EXPECT_NE(memcmp(m->m_data, other->m_data, len), 0);
+
+	size_t segLen = 333;
+	auto seg = whole.With(mtu(segLen));
+	for (size_t off = 0; off < len; off += segLen) {
+		MbufUniquePtr s = seg.Generate();
+		size_t expectedLen = std::min(segLen, len - off);
+
+		ASSERT_EQ(s->m_pkthdr.len, expectedLen);
+		EXPECT_EQ(memcmp(s->m_data, m->m_data + off, expectedLen), 0)
+		    << "Mismatch in segment at offset " << off;
+
+		seg = seg.Next();
+	}
+}
+
+// Describe a stream far larger than memory and verify that a segment from
+// near the end of it can be generated and matched.
+TEST_F(PacketPayloadTestSuite, TestHugeSeqPayload)
+{
+	size_t segLen = 9000;
+	size_t len = size_t(64) << 30;
+	auto p = PacketTemplate(PacketPayload().With(seqPayload(1, len), mtu(segLen)));
+	const auto & payloadTemplate = std::get<0>(p.Unwrap());
+
+	EXPECT_EQ(payloadTemplate.GetStreamLen(), len);
+
+	// Equal() and FindMismatch() work on arbitrary offsets, so check
+	// the last segment of the stream directly.
+	size_t off = len - segLen;
+	std::vector<uint8_t> buf(segLen);
+	payloadTemplate.Fill(buf.data(), off, segLen);
+	EXPECT_TRUE(payloadTemplate.Equal(buf.data(), off, segLen));
+
+	buf[segLen - 3] ^= 0x80;
+	EXPECT_FALSE(payloadTemplate.Equal(buf.data(), off, segLen));
+	EXPECT_EQ(payloadTemplate.FindMismatch(buf.data(), off, segLen), segLen - 3);
+
+	// The same bytes must not match one word earlier in the stream.
+	buf[segLen - 3] ^= 0x80;
+	EXPECT_FALSE(payloadTemplate.Equal(buf.data(), off - 4, segLen));
+}
+
+// Corrupt a single byte in a segment taken from the middle of a large payload
+// and verify that PayloadMatcher reports exactly that byte.
+TEST_F(PacketPayloadTestSuite, TestPayloadMatcherMismatch)
+{
+	auto p = PacketTemplate(
+		Ipv4Header().With(mtu(9000)),
+		TcpHeader(),
+		PacketPayload().With(payload("FreeBSD", 10 * 9000))
+	);
+	size_t headerLen = sizeof(struct ip) + sizeof(struct tcphdr);
+	auto segment = p.Next().Next();
+	const auto & payloadTemplate = std::get<2>(segment.Unwrap());
+
+	internal::PayloadMatcher matcher(payloadTemplate, headerLen);
+	testing::StringMatchResultListener listener;
+
+	MbufUniquePtr m = segment.Generate();
+	EXPECT_TRUE(matcher.MatchAndExplain(m.get(), &listener));
+
+	size_t corrupt = 5000;
+	m->m_data[headerLen + corrupt] = '!';
+
+	EXPECT_FALSE(matcher.MatchAndExplain(m.get(), &listener));
+
+	std::ostringstream expected;
+	expected << "index " << headerLen + corrupt << " (payload index "
+	    << payloadTemplate.GetStartIndex() + corrupt << ")";
+	EXPECT_NE(listener.str().find(expected.str()), std::string::npos)
+	    << listener.str();
+}
+
 template <typename L3Proto>
 class EncapsulatedPayloadTestSuite : public SysUnit::TestSuite
 {
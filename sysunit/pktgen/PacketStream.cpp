@@ -0,0 +1,142 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/PacketStream.h"
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	PacketStreamMatcher::PacketStreamMatcher(const ExpectedPacketStream & e)
+	  : expected(e)
+	{
+	}
+
+	bool PacketStreamMatcher::MatchAndExplain(const PacketLog & log,
+	    MatchResultListener* listener) const
+	{
+		size_t count = std::min(log.size(), expected.size());
+
+		for (size_t i = 0; i < count; ++i) {
+			testing::StringMatchResultListener packetListener;
+
+			if (!expected.at(i).MatchAndExplain(log[i], &packetListener)) {
+				*listener << "packet " << i << " of " << log.size()
+				    << " does not match: " << packetListener.str();
+				return false;
+			}
+		}
+
+		if (log.size() != expected.size()) {
+			*listener << "log contains " << log.size()
+			    << " packets (expected " << expected.size() << ")";
+			return false;
+		}
+
+		return true;
+	}
+
+	void PacketStreamMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "stream of " << expected.size() << " packets";
+	}
+
+	PayloadStreamMatcher::PayloadStreamMatcher(const PayloadTemplate & p,
+	    size_t hdrlen)
+	  : stream(p),
+	    headerLen(hdrlen)
+	{
+	}
+
+	bool PayloadStreamMatcher::MatchAndExplain(const PacketLog & log,
+	    MatchResultListener* listener) const
+	{
+		size_t start = stream.GetStartIndex();
+		size_t streamLen = stream.GetLen();
+		size_t streamOff = 0;
+
+		for (size_t i = 0; i < log.size(); ++i) {
+			size_t skip = headerLen;
+			size_t mbufNumber = 0;
+
+			for (struct mbuf * m = log[i]; m != nullptr; m = m->m_next) {
+				size_t segLen = m->m_len;
+				const uint8_t * data = GetMbufHeader<uint8_t>(m);
+
+				if (skip >= segLen) {
+					skip -= segLen;
+					mbufNumber++;
+					continue;
+				}
+
+				data += skip;
+				segLen -= skip;
+				skip = 0;
+
+				if (segLen > streamLen - streamOff) {
+					*listener << "packet " << i << " carries stream bytes "
+					    << streamOff << "-" << streamOff + segLen
+					    << " past the end of the stream (length "
+					    << streamLen << ")";
+					return false;
+				}
+
+				if (!stream.Equal(data, start + streamOff, segLen)) {
+					size_t j = stream.FindMismatch(data,
+					    start + streamOff, segLen);
+
+					*listener << "packet " << i << " mbuf " << mbufNumber
+					    << " differs at stream offset " << streamOff + j
+					    << ": value " << std::hex << int(data[j])
+					    << " (expected "
+					    << int(stream.GetByte(start + streamOff + j))
+					    << ")" << std::dec;
+					return false;
+				}
+
+				streamOff += segLen;
+				mbufNumber++;
+			}
+		}
+
+		if (streamOff != streamLen) {
+			*listener << "log ends at stream offset " << streamOff
+			    << " (expected " << streamLen << " bytes)";
+			return false;
+		}
+
+		return true;
+	}
+
+	void PayloadStreamMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "payload stream of " << stream.GetLen() << " bytes";
+	}
+}
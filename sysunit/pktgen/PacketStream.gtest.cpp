@@ -0,0 +1,193 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/PacketStream.h"
+
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Tcp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+
+class PacketStreamTestSuite : public SysUnit::TestSuite
+{
+public:
+	std::vector<MbufUniquePtr> mbufs;
+	PacketLog log;
+
+	static constexpr size_t IF_MTU = 1500;
+	static constexpr size_t HEADER_LEN = sizeof(struct ether_header) +
+	    sizeof(struct ip) + sizeof(struct tcphdr);
+
+	void TestCaseTearDown() override
+	{
+		log.clear();
+		mbufs.clear();
+	}
+
+	static auto GetTemplate(size_t payloadLen)
+	{
+		return PacketTemplate(
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			Ipv4Header().With(
+				src("10.0.0.1"),
+				dst("10.0.0.2"),
+				mtu(IF_MTU)
+			),
+			TcpHeader().With(
+				src(80),
+				dst(51234),
+				seq(1000)
+			),
+			PacketPayload().With(
+				payload("sysunit", payloadLen)
+			)
+		);
+	}
+
+	template <typename Template>
+	void Deliver(const Template & t)
+	{
+		mbufs.push_back(t.Generate());
+		log.push_back(mbufs.back().get());
+	}
+
+	template <typename Template>
+	void DeliverSequence(Template t, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i) {
+			Deliver(t);
+			t = t.Next();
+		}
+	}
+
+	template <typename Matcher>
+	std::string Explain(const Matcher & matcher)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(log, &listener));
+		return listener.str();
+	}
+};
+
+// Deliver a segmented payload and verify the log against the same sequence
+// of templates.
+TEST_F(PacketStreamTestSuite, TestMatchSequence)
+{
+	auto pkt = GetTemplate(20 * IF_MTU);
+
+	DeliverSequence(pkt, 21);
+
+	ExpectedPacketStream expected;
+	expected.AppendSequence(pkt, 21);
+
+	EXPECT_THAT(log, PacketStreamMatcher(expected));
+}
+
+// Corrupt a packet in the middle of the stream and verify that the
+// explanation identifies it.
+TEST_F(PacketStreamTestSuite, TestFirstMismatch)
+{
+	auto pkt = GetTemplate(10 * IF_MTU);
+
+	DeliverSequence(pkt, 3);
+	Deliver(pkt.Next().Next().Next().WithHeader(Layer::L4).Fields(incrSeq(1)));
+	DeliverSequence(pkt.Next().Next().Next().Next(), 4);
+
+	ExpectedPacketStream expected;
+	expected.AppendSequence(pkt, 8);
+
+	std::string explanation = Explain(PacketStreamMatcher(expected));
+	EXPECT_THAT(explanation, HasSubstr("packet 3 of 8"));
+	EXPECT_THAT(explanation, HasSubstr("th_seq"));
+}
+
+// Verify that a log that is a strict prefix of the expected stream fails.
+TEST_F(PacketStreamTestSuite, TestMissingPackets)
+{
+	auto pkt = GetTemplate(10 * IF_MTU);
+
+	DeliverSequence(pkt, 5);
+
+	ExpectedPacketStream expected;
+	expected.AppendSequence(pkt, 6);
+
+	std::string explanation = Explain(PacketStreamMatcher(expected));
+	EXPECT_THAT(explanation, HasSubstr("log contains 5 packets (expected 6)"));
+}
+
+// Verify the concatenated payload of a segmented stream against the byte
+// stream that it was generated from.
+TEST_F(PacketStreamTestSuite, TestPayloadStream)
+{
+	size_t streamLen = 7 * IF_MTU + 93;
+	size_t segLen = IF_MTU - sizeof(struct ip) - sizeof(struct tcphdr);
+	auto pkt = GetTemplate(streamLen);
+	size_t segments = howmany(streamLen, segLen);
+
+	DeliverSequence(pkt, segments);
+
+	auto stream = PacketPayload().With(payload("sysunit", streamLen));
+	EXPECT_THAT(log, PayloadStreamMatcher(HEADER_LEN, stream));
+}
+
+// Deliver two segments of the stream out of order and verify that the
+// mismatch is reported at the right stream offset.
+TEST_F(PacketStreamTestSuite, TestPayloadStreamReordered)
+{
+	auto pkt = GetTemplate(3 * IF_MTU);
+	size_t segLen = IF_MTU - sizeof(struct ip) - sizeof(struct tcphdr);
+
+	Deliver(pkt);
+	Deliver(pkt.Next().Next());
+	Deliver(pkt.Next());
+
+	auto stream = PacketPayload().With(payload("sysunit", 3 * segLen));
+
+	std::string explanation = Explain(PayloadStreamMatcher(HEADER_LEN, stream));
+
+	// The segment length is not a multiple of the pattern length, so the
+	// first byte of the misplaced segment must differ.
+	std::ostringstream offset;
+	offset << "stream offset " << segLen;
+	EXPECT_THAT(explanation, HasSubstr(offset.str()));
+}
@@ -30,6 +30,7 @@
 
 #include "fake/mbuf.h"
 
+#include "pktgen/CompiledMatcher.h"
 #include "pktgen/PacketPayload.h"
 
 #include "pktgen/Packet.h"
@@ -46,62 +47,65 @@ namespace PktGen::internal
 	{
 	}
 
-	bool PayloadMatcher::TestPattern(mbuf *m, int hdroff, size_t mbufNumber,
-	    size_t & payloadIndex, const std::vector<uint8_t> & payloadBytes,
-	    size_t payloadLen, MatchResultListener* listener) const
+	void PayloadMatcher::ExplainMismatch(const uint8_t * data,
+	    size_t mbufNumber, size_t mbIndex, size_t payIndex,
+	    MatchResultListener* listener) const
 	{
-		auto * ptr = GetMbufHeader<uint8_t>(m, 0);
-
-		int mbIndex = hdroff;
-		size_t payIndex = payloadIndex;
-
-		while (mbIndex < m->m_len && payIndex < payloadLen) {
-			if (payloadBytes.at(payIndex) != ptr[mbIndex]) {
-				*listener << "Payload incorrect at mbuf " <<
-				    mbufNumber << " index " << mbIndex <<
-				    " (payload index " << payIndex << ")" <<
-				    " value " << std::hex << int(ptr[mbIndex]);
-				if (std::isprint(ptr[mbIndex]))
-					*listener << "('" << (char)ptr[mbIndex] << "')";
-
-				*listener << " (expected " << int(payloadBytes.at(payIndex));
-				if (std::isprint(payloadBytes.at(payIndex)))
-					*listener <<  "('" << (char)payloadBytes.at(payIndex) << "'))";
-				return false;
-			}
-
-			++mbIndex;
-			++payIndex;
-		}
-
-		payloadIndex = payIndex;
-		return true;
+		uint8_t actual = data[mbIndex];
+		uint8_t expected = payload.GetByte(payIndex);
+
+		*listener << "Payload incorrect at mbuf " <<
+		    mbufNumber << " index " << mbIndex <<
+		    " (payload index " << payIndex << ")" <<
+		    " value " << std::hex << int(actual);
+		if (std::isprint(actual))
+			*listener << "('" << (char)actual << "')";
+
+		*listener << " (expected " << int(expected);
+		if (std::isprint(expected))
+			*listener <<  "('" << (char)expected << "')";
+		*listener << ")";
 	}
 
 	bool PayloadMatcher::MatchAndExplain(mbuf* m, MatchResultListener* listener) const
 	{
-		const auto & payloadBytes = payload.GetPayload();
-
-		int hdroff = headerOffset;
+		size_t hdroff = headerOffset;
 		size_t mbufNumber = 0;
 		size_t payloadIndex = payload.GetStartIndex();
-		size_t payloadLen = payload.GetFillLen();
+		size_t remaining = payload.GetFillLen();
 
-		if ((m->m_pkthdr.len - headerOffset) < payloadLen) {
+		if ((m->m_pkthdr.len - headerOffset) < remaining) {
 			*listener << "payload len is " << m->m_pkthdr.len - headerOffset
-			    << " (expected " << payloadLen << ")";
+			    << " (expected " << remaining << ")";
 			return false;
 		}
 
-		while (m != nullptr && payloadIndex < payloadBytes.size()) {
-			bool matched = TestPattern(m, hdroff, mbufNumber, payloadIndex,
-				payloadBytes, payloadLen, listener);
-			if (!matched)
+		// Compare the payload one contiguous mbuf segment at a time.
+		// The byte-by-byte search for the first mismatch is only done
+		// once we know that a segment differs.
+		for (; m != nullptr && remaining > 0; m = m->m_next, mbufNumber++) {
+			size_t mlen = m->m_len;
+
+			if (hdroff >= mlen) {
+				hdroff -= mlen;
+				continue;
+			}
+
+			const auto * data = GetMbufHeader<uint8_t>(m);
+			size_t segLen = std::min(mlen - hdroff, remaining);
+
+			if (!payload.Equal(data + hdroff, payloadIndex, segLen)) {
+				size_t i = payload.FindMismatch(data + hdroff,
+				    payloadIndex, segLen);
+
+				ExplainMismatch(data, mbufNumber, hdroff + i,
+				    payloadIndex + i, listener);
 				return false;
+			}
 
-			mbufNumber++;
+			payloadIndex += segLen;
+			remaining -= segLen;
 			hdroff = 0;
-			m = m->m_next;
 		}
 
 		return true;
@@ -111,4 +115,10 @@ namespace PktGen::internal
 	{
 		*os << "Payload";
 	}
-}
\ No newline at end of file
+
+	void CompilePacketMask(const PayloadTemplate & pkt, CompiledPacket & packet,
+	    size_t off)
+	{
+		// Every byte of the payload is significant.
+	}
+}
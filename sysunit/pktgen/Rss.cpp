@@ -0,0 +1,188 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Rss.h"
+
+extern "C" {
+#include <kern_include/net/ethernet.h>
+#include <kern_include/netinet/ip.h>
+#include <kern_include/netinet/ip6.h>
+}
+
+#include <arpa/inet.h>
+
+#include <cstring>
+
+namespace PktGen
+{
+	const uint8_t DEFAULT_RSS_KEY[RSS_KEY_LEN] = {
+		0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+		0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+		0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+		0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+		0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+	};
+
+	uint32_t ToeplitzHash(const uint8_t * key, size_t keyLen,
+	    const uint8_t * data, size_t len)
+	{
+		uint32_t hash, window;
+		size_t next;
+
+		// window holds the 32 bits of the key starting at the current
+		// bit of the input.
+		window = (uint32_t(key[0]) << 24) | (uint32_t(key[1]) << 16) |
+		    (uint32_t(key[2]) << 8) | key[3];
+		next = 4;
+
+		hash = 0;
+		for (size_t i = 0; i < len; ++i) {
+			uint8_t keyByte = next < keyLen ? key[next] : 0;
+			next++;
+
+			for (int bit = 7; bit >= 0; --bit) {
+				if (data[i] & (1 << bit))
+					hash ^= window;
+				window = (window << 1) | ((keyByte >> bit) & 1);
+			}
+		}
+
+		return hash;
+	}
+
+	uint32_t RssHashIpv4(struct in_addr src, struct in_addr dst,
+	    const uint8_t * key)
+	{
+		uint8_t input[8];
+
+		memcpy(&input[0], &src, sizeof(src));
+		memcpy(&input[4], &dst, sizeof(dst));
+		return ToeplitzHash(key, RSS_KEY_LEN, input, sizeof(input));
+	}
+
+	uint32_t RssHashTcpIpv4(struct in_addr src, struct in_addr dst,
+	    uint16_t sport, uint16_t dport, const uint8_t * key)
+	{
+		uint8_t input[12];
+
+		sport = htons(sport);
+		dport = htons(dport);
+		memcpy(&input[0], &src, sizeof(src));
+		memcpy(&input[4], &dst, sizeof(dst));
+		memcpy(&input[8], &sport, sizeof(sport));
+		memcpy(&input[10], &dport, sizeof(dport));
+		return ToeplitzHash(key, RSS_KEY_LEN, input, sizeof(input));
+	}
+
+	uint32_t RssHashIpv6(const struct in6_addr & src,
+	    const struct in6_addr & dst, const uint8_t * key)
+	{
+		uint8_t input[32];
+
+		memcpy(&input[0], &src, sizeof(src));
+		memcpy(&input[16], &dst, sizeof(dst));
+		return ToeplitzHash(key, RSS_KEY_LEN, input, sizeof(input));
+	}
+
+	uint32_t RssHashTcpIpv6(const struct in6_addr & src,
+	    const struct in6_addr & dst, uint16_t sport, uint16_t dport,
+	    const uint8_t * key)
+	{
+		uint8_t input[36];
+
+		sport = htons(sport);
+		dport = htons(dport);
+		memcpy(&input[0], &src, sizeof(src));
+		memcpy(&input[16], &dst, sizeof(dst));
+		memcpy(&input[32], &sport, sizeof(sport));
+		memcpy(&input[34], &dport, sizeof(dport));
+		return ToeplitzHash(key, RSS_KEY_LEN, input, sizeof(input));
+	}
+
+	static uint16_t GetBe16(const uint8_t * p)
+	{
+		return (uint16_t(p[0]) << 8) | p[1];
+	}
+
+	static bool HasPorts(uint8_t proto)
+	{
+		return proto == IPPROTO_TCP || proto == IPPROTO_UDP;
+	}
+
+	uint32_t RssHashFrame(const uint8_t * frame, size_t len,
+	    const uint8_t * key)
+	{
+		size_t off = sizeof(struct ether_header);
+		uint16_t type;
+
+		if (len < off)
+			return 0;
+
+		type = GetBe16(frame + offsetof(struct ether_header, ether_type));
+		while ((type == ETHERTYPE_VLAN || type == ETHERTYPE_QINQ) &&
+		    off + 2 * sizeof(uint16_t) <= len) {
+			type = GetBe16(frame + off + sizeof(uint16_t));
+			off += 2 * sizeof(uint16_t);
+		}
+
+		if (type == ETHERTYPE_IP && off + sizeof(struct ip) <= len) {
+			struct ip ip;
+			size_t hlen;
+
+			memcpy(&ip, frame + off, sizeof(ip));
+			hlen = ip.ip_hl * sizeof(uint32_t);
+			if (HasPorts(ip.ip_p) &&
+			    (ntohs(ip.ip_off) & (IP_MF | IP_OFFMASK)) == 0 &&
+			    off + hlen + 2 * sizeof(uint16_t) <= len) {
+				const uint8_t * ports = frame + off + hlen;
+
+				return RssHashTcpIpv4(ip.ip_src, ip.ip_dst,
+				    GetBe16(ports), GetBe16(ports + 2), key);
+			}
+
+			return RssHashIpv4(ip.ip_src, ip.ip_dst, key);
+		}
+
+		if (type == ETHERTYPE_IPV6 && off + sizeof(struct ip6_hdr) <= len) {
+			struct ip6_hdr ip6;
+
+			memcpy(&ip6, frame + off, sizeof(ip6));
+			if (HasPorts(ip6.ip6_nxt) && off + sizeof(ip6) +
+			    2 * sizeof(uint16_t) <= len) {
+				const uint8_t * ports = frame + off + sizeof(ip6);
+
+				return RssHashTcpIpv6(ip6.ip6_src, ip6.ip6_dst,
+				    GetBe16(ports), GetBe16(ports + 2), key);
+			}
+
+			return RssHashIpv6(ip6.ip6_src, ip6.ip6_dst, key);
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,137 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Rss.h"
+
+#include <arpa/inet.h>
+
+#include <gtest/gtest.h>
+
+namespace
+{
+	struct in_addr Ipv4(const char * str)
+	{
+		struct in_addr addr;
+
+		EXPECT_EQ(inet_pton(AF_INET, str, &addr), 1);
+		return addr;
+	}
+
+	struct in6_addr Ipv6(const char * str)
+	{
+		struct in6_addr addr;
+
+		EXPECT_EQ(inet_pton(AF_INET6, str, &addr), 1);
+		return addr;
+	}
+}
+
+// The expected values are the verification suite from Microsoft's RSS
+// specification.
+TEST(RssTest, TestIpv4)
+{
+	EXPECT_EQ(PktGen::RssHashIpv4(Ipv4("66.9.149.187"), Ipv4("161.142.100.80")),
+	    0x323e8fc2U);
+	EXPECT_EQ(PktGen::RssHashIpv4(Ipv4("199.92.111.2"), Ipv4("65.69.140.83")),
+	    0xd718262aU);
+	EXPECT_EQ(PktGen::RssHashIpv4(Ipv4("24.19.198.95"), Ipv4("12.22.207.184")),
+	    0xd2d0a5deU);
+}
+
+TEST(RssTest, TestTcpIpv4)
+{
+	EXPECT_EQ(PktGen::RssHashTcpIpv4(Ipv4("66.9.149.187"),
+	    Ipv4("161.142.100.80"), 2794, 1766), 0x51ccc178U);
+	EXPECT_EQ(PktGen::RssHashTcpIpv4(Ipv4("199.92.111.2"),
+	    Ipv4("65.69.140.83"), 14230, 4739), 0xc626b0eaU);
+	EXPECT_EQ(PktGen::RssHashTcpIpv4(Ipv4("24.19.198.95"),
+	    Ipv4("12.22.207.184"), 12898, 38024), 0x5c2b394aU);
+}
+
+TEST(RssTest, TestIpv6)
+{
+	EXPECT_EQ(PktGen::RssHashIpv6(Ipv6("3ffe:2501:200:1fff::7"),
+	    Ipv6("3ffe:2501:200:3::1")), 0x2cc18cd5U);
+	EXPECT_EQ(PktGen::RssHashIpv6(Ipv6("3ffe:501:8::260:97ff:fe40:efab"),
+	    Ipv6("ff02::1")), 0x0f0c461cU);
+}
+
+TEST(RssTest, TestTcpIpv6)
+{
+	EXPECT_EQ(PktGen::RssHashTcpIpv6(Ipv6("3ffe:2501:200:1fff::7"),
+	    Ipv6("3ffe:2501:200:3::1"), 2794, 1766), 0x40207d3dU);
+	EXPECT_EQ(PktGen::RssHashTcpIpv6(Ipv6("3ffe:501:8::260:97ff:fe40:efab"),
+	    Ipv6("ff02::1"), 14230, 4739), 0xdde51bbfU);
+}
+
+TEST(RssTest, TestKeyDependence)
+{
+	uint8_t key[PktGen::RSS_KEY_LEN] = {};
+
+	// An all-zero key hashes everything to 0.
+	EXPECT_EQ(PktGen::RssHashTcpIpv4(Ipv4("10.0.0.1"), Ipv4("10.0.0.2"),
+	    1, 2, key), 0U);
+}
+
+// Build frames around the first TCP/IPv4 vector from the specification and
+// verify that RssHashFrame() hashes the same fields a NIC would.
+TEST(RssTest, TestFrame)
+{
+	uint8_t frame[] = {
+		// Ethernet header, with an 802.1Q tag
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x02,
+		0x02, 0x00, 0x00, 0x00, 0x00, 0x01,
+		0x81, 0x00, 0x00, 0x64, 0x08, 0x00,
+		// IPv4 header
+		0x45, 0x00, 0x00, 0x18, 0x00, 0x00, 0x00, 0x00,
+		0x40, IPPROTO_TCP, 0x00, 0x00,
+		66, 9, 149, 187,
+		161, 142, 100, 80,
+		// TCP ports
+		0x0a, 0xea, 0x06, 0xe6,
+	};
+	const size_t ipOff = 18;
+
+	EXPECT_EQ(PktGen::RssHashFrame(frame, sizeof(frame)), 0x51ccc178U);
+
+	// Without the ports, only the addresses can be hashed.
+	EXPECT_EQ(PktGen::RssHashFrame(frame, sizeof(frame) - 4), 0x323e8fc2U);
+
+	// Nor can the ports of a fragment.
+	frame[ipOff + 6] = 0x20;
+	EXPECT_EQ(PktGen::RssHashFrame(frame, sizeof(frame)), 0x323e8fc2U);
+
+	frame[ipOff + 6] = 0;
+	frame[ipOff + 9] = IPPROTO_ICMP;
+	EXPECT_EQ(PktGen::RssHashFrame(frame, sizeof(frame)), 0x323e8fc2U);
+
+	// Non-IP frames hash to 0.
+	frame[16] = 0x08;
+	frame[17] = 0x06;
+	EXPECT_EQ(PktGen::RssHashFrame(frame, sizeof(frame)), 0U);
+}
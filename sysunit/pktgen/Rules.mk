@@ -1,25 +1,43 @@
 
 LIB :=	pktgen
 SRCS := \
+	CompiledMatcher.cpp \
 	EtherAddr.cpp \
 	EthernetMatcher.cpp \
+	GreMatcher.cpp \
 	Ipv4Matcher.cpp \
 	Ipv6Addr.cpp \
+	Ipv6ExtMatcher.cpp \
 	Ipv6Matcher.cpp \
 	Layer.cpp \
+	PacketStream.cpp \
 	PayloadMatcher.cpp \
 	PrintIndent.cpp \
+	Rss.cpp \
 	TcpMatcher.cpp \
+	UdpMatcher.cpp \
+	VlanMatcher.cpp \
+	VxlanMatcher.cpp \
 
 TESTS := \
+	CompiledMatcher \
 	EthernetHeader \
+	Fragmenter \
+	GreHeader \
 	Ipv4Header \
+	Ipv6ExtHeader \
 	Ipv6Header \
 	PacketEncapsulation \
 	PacketPayload \
+	PacketStream \
+	Rss \
 	TcpHeader \
+	UdpHeader \
+	VlanHeader \
+	VxlanHeader \
 
 MBUF_LIBS := \
+	fake_callcount \
 	fake_mbuf \
 	fake_atomic \
 	fake_malloc \
@@ -28,6 +46,22 @@ MBUF_LIBS := \
 	fake_uma \
 	sysunit_init \
 
+TEST_COMPILEDMATCHER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_COMPILEDMATCHER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	TcpMatcher.cpp \
+
+TEST_COMPILEDMATCHER_STDLIBS := \
+	gmock \
+
 TEST_ETHERNETHEADER_SRCS := \
 	EtherAddr.cpp \
 	Layer.cpp \
@@ -35,12 +69,70 @@ TEST_ETHERNETHEADER_SRCS := \
 TEST_ETHERNETHEADER_LIBS := \
 	$(MBUF_LIBS) \
 
+TEST_FRAGMENTER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6ExtMatcher.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	UdpMatcher.cpp \
+
+TEST_FRAGMENTER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_FRAGMENTER_STDLIBS := \
+	gmock \
+
+TEST_GREHEADER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	GreMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	TcpMatcher.cpp \
+
+TEST_GREHEADER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_GREHEADER_STDLIBS := \
+	gmock \
+
 TEST_IPV4HEADER_SRCS := \
 	Layer.cpp \
 
 TEST_IPV4HEADER_LIBS := \
 	$(MBUF_LIBS) \
 
+TEST_IPV6EXTHEADER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6ExtMatcher.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	Rss.cpp \
+	TcpMatcher.cpp \
+	UdpMatcher.cpp \
+
+TEST_IPV6EXTHEADER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_IPV6EXTHEADER_STDLIBS := \
+	gmock \
+
 TEST_IPV6HEADER_SRCS := \
 	Ipv6Addr.cpp \
 	Layer.cpp \
@@ -60,6 +152,7 @@ TEST_PACKETPAYLOAD_LIBS := \
 	$(MBUF_LIBS) \
 
 TEST_PACKETPAYLOAD_SRCS := \
+	CompiledMatcher.cpp \
 	EtherAddr.cpp \
 	Ipv4Matcher.cpp \
 	Ipv6Addr.cpp \
@@ -69,8 +162,90 @@ TEST_PACKETPAYLOAD_SRCS := \
 	PrintIndent.cpp \
 	TcpMatcher.cpp \
 
+TEST_PACKETSTREAM_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_PACKETSTREAM_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Layer.cpp \
+	PacketStream.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	TcpMatcher.cpp \
+
+TEST_PACKETSTREAM_STDLIBS := \
+	gmock \
+
+TEST_RSS_SRCS := \
+	Rss.cpp \
+
 TEST_TCPHEADER_SRCS := \
+	CompiledMatcher.cpp \
 	Layer.cpp \
+	TcpMatcher.cpp \
 
 TEST_TCPHEADER_LIBS := \
 	$(MBUF_LIBS) \
+
+TEST_TCPHEADER_STDLIBS := \
+	gmock \
+
+TEST_UDPHEADER_SRCS := \
+	CompiledMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	Rss.cpp \
+	UdpMatcher.cpp \
+
+TEST_UDPHEADER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_UDPHEADER_STDLIBS := \
+	gmock \
+
+TEST_VLANHEADER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	TcpMatcher.cpp \
+	VlanMatcher.cpp \
+
+TEST_VLANHEADER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_VLANHEADER_STDLIBS := \
+	gmock \
+
+TEST_VXLANHEADER_SRCS := \
+	CompiledMatcher.cpp \
+	EtherAddr.cpp \
+	EthernetMatcher.cpp \
+	Ipv4Matcher.cpp \
+	Ipv6Addr.cpp \
+	Ipv6Matcher.cpp \
+	Layer.cpp \
+	PayloadMatcher.cpp \
+	PrintIndent.cpp \
+	Rss.cpp \
+	TcpMatcher.cpp \
+	UdpMatcher.cpp \
+	VxlanMatcher.cpp \
+
+TEST_VXLANHEADER_LIBS := \
+	$(MBUF_LIBS) \
+
+TEST_VXLANHEADER_STDLIBS := \
+	gmock \
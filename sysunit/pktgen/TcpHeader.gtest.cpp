@@ -40,6 +40,7 @@
 #include <stubs/uio.h>
 
 using namespace PktGen;
+using namespace testing;
 using internal::GetMbufHeader;
 using internal::hton;
 using internal::ntoh;
@@ -47,6 +48,14 @@ using internal::ntoh;
 class TcpHeaderTestSuite : public SysUnit::TestSuite
 {
 public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+
 	auto BuildHeader(struct tcphdr & tcp)
 	{
 		return PacketTemplate(TcpHeader()
@@ -305,3 +314,118 @@ TEST_F(TcpHeaderTestSuite, TestSegmentation)
 	VerifyMbufPayload(p3, 'a', lastSegLen);
 	VerifyMbufChainLen(p4, 0);
 }
+
+// Generate a packet with every supported option other than SACK blocks and
+// verify that the options are laid out as the FreeBSD stack would send them
+// in a SYN, with NOPs aligning each option to a 32-bit boundary.
+TEST_F(TcpHeaderTestSuite, TestOptions)
+{
+	const uint8_t expectedOpts[] = {
+		TCPOPT_MAXSEG, TCPOLEN_MAXSEG, 0x05, 0xb4,
+		TCPOPT_NOP, TCPOPT_WINDOW, TCPOLEN_WINDOW, 7,
+		TCPOPT_NOP, TCPOPT_NOP, TCPOPT_SACK_PERMITTED, TCPOLEN_SACK_PERMITTED,
+		TCPOPT_NOP, TCPOPT_NOP, TCPOPT_TIMESTAMP, TCPOLEN_TIMESTAMP,
+		0x01, 0x02, 0x03, 0x04,
+		0x00, 0x00, 0x00, 0x00,
+	};
+	size_t hdrlen = sizeof(struct tcphdr) + sizeof(expectedOpts);
+
+	auto p = PacketTemplate(
+		TcpHeader().With(
+			flags(TH_SYN),
+			mss(1460),
+			wscale(7),
+			sackPermitted(),
+			timestamp(0x01020304, 0)
+		),
+		PacketPayload().With(payload('z', 10))
+	);
+
+	MbufUniquePtr m = p.Generate();
+	auto * tcp = GetMbufHeader<tcphdr>(m);
+
+	ASSERT_EQ(m->m_pkthdr.len, hdrlen + 10);
+	EXPECT_EQ(tcp->th_off, hdrlen / sizeof(uint32_t));
+	EXPECT_EQ(memcmp(tcp + 1, expectedOpts, sizeof(expectedOpts)), 0);
+	EXPECT_EQ(*GetMbufHeader<char>(m, hdrlen), 'z');
+}
+
+// Verify that the SACK option is encoded with one 8-byte entry per block,
+// following the timestamp option.
+TEST_F(TcpHeaderTestSuite, TestSackBlocks)
+{
+	const uint8_t expectedOpts[] = {
+		TCPOPT_NOP, TCPOPT_NOP, TCPOPT_TIMESTAMP, TCPOLEN_TIMESTAMP,
+		0x00, 0x00, 0x00, 0x10,
+		0x00, 0x00, 0x00, 0x20,
+		TCPOPT_NOP, TCPOPT_NOP, TCPOPT_SACK, 2 + 2 * 8,
+		0x00, 0x00, 0x10, 0x00,
+		0x00, 0x00, 0x20, 0x00,
+		0x00, 0x00, 0x30, 0x00,
+		0x00, 0x00, 0x40, 0x00,
+	};
+
+	auto p = PacketTemplate(TcpHeader().With(
+		timestamp(0x10, 0x20),
+		sack({{0x1000, 0x2000}, {0x3000, 0x4000}})
+	));
+
+	MbufUniquePtr m = p.Generate();
+	auto * tcp = GetMbufHeader<tcphdr>(m);
+
+	ASSERT_EQ(m->m_pkthdr.len, sizeof(struct tcphdr) + sizeof(expectedOpts));
+	EXPECT_EQ(memcmp(tcp + 1, expectedOpts, sizeof(expectedOpts)), 0);
+
+	// A timestamp and four SACK blocks don't fit in 40 bytes of options.
+	auto tooLong = p.WithHeader(Layer::L4).Fields(
+		sack({{1, 2}, {3, 4}, {5, 6}, {7, 8}}));
+	EXPECT_THROW(tooLong.Generate(), std::runtime_error);
+}
+
+// Verify that Next() advances TSval by the configured increment while
+// leaving TSecr alone, and that the options count against the MTU.
+TEST_F(TcpHeaderTestSuite, TestTimestampNext)
+{
+	size_t mtu = 100;
+	size_t hdrlen = sizeof(struct tcphdr) + TCPOLEN_TSTAMP_APPA;
+
+	auto p1 = PacketTemplate(
+		TcpHeader().With(
+			seq(5000),
+			timestamp(1000, 77),
+			tsvalIncr(3),
+			PktGen::mtu(mtu)
+		),
+		PacketPayload().With(payload('a', 1000))
+	);
+
+	auto p2 = p1.Next();
+	auto p3 = p2.WithHeader(Layer::L4).Fields(noTimestamp());
+
+	MbufUniquePtr m = p2.Generate();
+	auto * tcp = GetMbufHeader<tcphdr>(m);
+	auto * ts = reinterpret_cast<uint32_t *>(tcp + 1);
+
+	EXPECT_EQ(m->m_pkthdr.len, mtu);
+	EXPECT_EQ(ntoh(tcp->th_seq), 5000 + mtu - hdrlen);
+	EXPECT_EQ(ntoh(ts[1]), 1003U);
+	EXPECT_EQ(ntoh(ts[2]), 77U);
+
+	m = p3.Generate();
+	tcp = GetMbufHeader<tcphdr>(m);
+	EXPECT_EQ(tcp->th_off, sizeof(struct tcphdr) / sizeof(uint32_t));
+}
+
+// Verify that the TCP matcher reports a timestamp option that the template
+// doesn't expect.  The packet matchers report the length and th_off
+// mismatches that the option causes first, so check the TCP matcher alone.
+TEST_F(TcpHeaderTestSuite, TestMatcherUnexpectedTimestamp)
+{
+	auto p = PacketTemplate(TcpHeader().With(timestamp(500, 600)));
+	MbufUniquePtr m = p.Generate();
+
+	std::string explanation = Explain(MakeMatcher(new internal::TcpMatcher(
+	    internal::TcpTemplate(), 0)), m.get());
+	EXPECT_THAT(explanation,
+	    HasSubstr("timestamp option is present (expected absent)"));
+}
@@ -30,12 +30,16 @@
 
 #include "fake/mbuf.h"
 
+#include "pktgen/CompiledMatcher.h"
 #include "pktgen/Tcp.h"
 
 #include <gtest/gtest.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 
+#include <string.h>
+#include <string>
+
 namespace PktGen::internal
 {
 	TcpMatcher::TcpMatcher(const TcpTemplate & header, size_t offset)
@@ -44,6 +48,164 @@ namespace PktGen::internal
 	{
 	}
 
+	template <typename T>
+	static T GetOptionField(const uint8_t * p)
+	{
+		T x;
+
+		memcpy(&x, p, sizeof(x));
+		return ntoh(x);
+	}
+
+	// Parse the options of a TCP header into a TcpOptions.  NOP padding is
+	// skipped, so two option lists that differ only in padding parse to the
+	// same result; the padding is checked by comparing th_off.
+	static bool ParseOptions(const uint8_t * opt, size_t len,
+	    TcpOptions & parsed, testing::MatchResultListener* listener)
+	{
+		size_t i = 0;
+
+		while (i < len) {
+			uint8_t kind = opt[i];
+
+			if (kind == TCPOPT_EOL)
+				break;
+
+			if (kind == TCPOPT_NOP) {
+				i++;
+				continue;
+			}
+
+			if (i + 1 >= len || opt[i + 1] < 2 || i + opt[i + 1] > len) {
+				*listener << "TCP: option " << (int)kind
+				    << " at offset " << i << " is truncated";
+				return false;
+			}
+
+			uint8_t optlen = opt[i + 1];
+			const uint8_t * data = &opt[i + 2];
+			bool validLen;
+
+			switch (kind) {
+			case TCPOPT_MAXSEG:
+				validLen = (optlen == TCPOLEN_MAXSEG);
+				if (validLen)
+					parsed.mss = GetOptionField<uint16_t>(data);
+				break;
+			case TCPOPT_WINDOW:
+				validLen = (optlen == TCPOLEN_WINDOW);
+				if (validLen)
+					parsed.wscale = data[0];
+				break;
+			case TCPOPT_SACK_PERMITTED:
+				validLen = (optlen == TCPOLEN_SACK_PERMITTED);
+				parsed.sackPermitted = true;
+				break;
+			case TCPOPT_TIMESTAMP:
+				validLen = (optlen == TCPOLEN_TIMESTAMP);
+				if (validLen)
+					parsed.timestamp = TcpTimestamp{
+					    GetOptionField<uint32_t>(data),
+					    GetOptionField<uint32_t>(data + 4)};
+				break;
+			case TCPOPT_SACK:
+				parsed.numSackBlocks =
+				    (optlen - TCPOLEN_SACKHDR) / TCPOLEN_SACK;
+				validLen = ((optlen - TCPOLEN_SACKHDR) % TCPOLEN_SACK) == 0 &&
+				    parsed.numSackBlocks <= TcpOptions::MAX_SACK_BLOCKS;
+				for (size_t b = 0; validLen && b < parsed.numSackBlocks; ++b) {
+					const uint8_t * block = data + b * TCPOLEN_SACK;
+					parsed.sackBlocks[b].start =
+					    GetOptionField<uint32_t>(block);
+					parsed.sackBlocks[b].end =
+					    GetOptionField<uint32_t>(block + 4);
+				}
+				break;
+			default:
+				*listener << "TCP: unexpected option " << (int)kind;
+				return false;
+			}
+
+			if (!validLen) {
+				*listener << "TCP: option " << (int)kind
+				    << " has invalid length " << (int)optlen;
+				return false;
+			}
+
+			i += optlen;
+		}
+
+		return true;
+	}
+
+	template <typename T>
+	static std::string OptionString(const std::optional<T> & x)
+	{
+		if (x)
+			return std::to_string(*x);
+		return "absent";
+	}
+
+	template <typename T>
+	static std::string OptionString(T x)
+	{
+		return std::to_string(x);
+	}
+
+	#define	CheckOption(actual, expected, field, name) do { \
+		if ((actual).field != (expected).field) { \
+			*listener << "TCP: " << name << " option is " \
+			    << OptionString((actual).field) << " (expected " \
+			    << OptionString((expected).field) << ")"; \
+			return false; \
+		} \
+	} while (0)
+
+	static bool MatchOptions(const TcpOptions & actual,
+	    const TcpOptions & expected, testing::MatchResultListener* listener)
+	{
+		CheckOption(actual, expected, mss, "MSS");
+		CheckOption(actual, expected, wscale, "window scale");
+		CheckOption(actual, expected, sackPermitted, "SACK permitted");
+
+		if (actual.timestamp.has_value() != expected.timestamp.has_value()) {
+			*listener << "TCP: timestamp option is "
+			    << (actual.timestamp ? "present" : "absent")
+			    << " (expected "
+			    << (expected.timestamp ? "present" : "absent") << ")";
+			return false;
+		}
+
+		if (expected.timestamp) {
+			if (actual.timestamp->val != expected.timestamp->val) {
+				*listener << "TCP: tsval is " << actual.timestamp->val
+				    << " (expected " << expected.timestamp->val << ")";
+				return false;
+			}
+
+			if (actual.timestamp->ecr != expected.timestamp->ecr) {
+				*listener << "TCP: tsecr is " << actual.timestamp->ecr
+				    << " (expected " << expected.timestamp->ecr << ")";
+				return false;
+			}
+		}
+
+		CheckOption(actual, expected, numSackBlocks, "SACK block count");
+		for (size_t i = 0; i < expected.numSackBlocks; ++i) {
+			const auto & a = actual.sackBlocks[i];
+			const auto & e = expected.sackBlocks[i];
+
+			if (a.start != e.start || a.end != e.end) {
+				*listener << "TCP: SACK block " << i << " is ["
+				    << a.start << ", " << a.end << ") (expected ["
+				    << e.start << ", " << e.end << "))";
+				return false;
+			}
+		}
+
+		return true;
+	}
+
 	#define	CheckField(th, field, expect) do { \
 		if (ntoh((th)->field) != (expect)) { \
 			*listener << "TCP: " << #field << " field is " << (int)ntoh((th)->field) \
@@ -61,6 +223,19 @@ namespace PktGen::internal
 		CheckField(tcp, th_dport, header.GetDstPort());
 		CheckField(tcp, th_seq, header.GetSeq());
 		CheckField(tcp, th_ack, header.GetAck());
+
+		size_t hdrlen = tcp->th_off * sizeof(uint32_t);
+		if (hdrlen >= sizeof(*tcp)) {
+			TcpOptions options;
+
+			if (!ParseOptions(reinterpret_cast<const uint8_t *>(tcp + 1),
+			    hdrlen - sizeof(*tcp), options, listener))
+				return false;
+
+			if (!MatchOptions(options, header.GetOptions(), listener))
+				return false;
+		}
+
 		CheckField(tcp, th_off, header.GetOff());
 		CheckField(tcp, th_x2, header.GetX2());
 		CheckField(tcp, th_flags, header.GetFlags());
@@ -101,4 +276,14 @@ namespace PktGen::internal
 	{
 		*os << "TCP";
 	}
-}
\ No newline at end of file
+
+	void CompilePacketMask(const TcpTemplate & header, CompiledPacket & packet,
+	    size_t off)
+	{
+		// XXX tcp_lro always updates this...
+		packet.IgnoreBytes(off + offsetof(struct tcphdr, th_sum),
+		    sizeof(((struct tcphdr *)0)->th_sum));
+
+		packet.csumMask |= CSUM_L4_CALC | CSUM_L4_VALID;
+	}
+}
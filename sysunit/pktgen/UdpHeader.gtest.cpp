@@ -0,0 +1,197 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Udp.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/PacketParsing.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+
+class UdpHeaderTestSuite : public SysUnit::TestSuite
+{
+public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+
+	static auto GetIpv4Template()
+	{
+		return PacketTemplate(
+			Ipv4Header().With(src("10.0.0.1"), dst("10.0.0.2")),
+			UdpHeader().With(src(1234), dst(53)),
+			PacketPayload().With(payload("FreeBSD"))
+		);
+	}
+};
+
+// Generate a UDP header with no enclosing IP header and a fixed checksum and
+// verify that every field is written as given.
+TEST_F(UdpHeaderTestSuite, TestHeaderFields)
+{
+	auto p = PacketTemplate(
+		UdpHeader().With(src(5001), dst(443), checksum(0x1234)),
+		PacketPayload().With(payload('q', 100))
+	);
+
+	MbufUniquePtr m = p.Generate();
+	auto * udp = GetMbufHeader<udphdr>(m);
+
+	ASSERT_EQ(m->m_pkthdr.len, sizeof(struct udphdr) + 100);
+	EXPECT_EQ(ntohs(udp->uh_sport), 5001);
+	EXPECT_EQ(ntohs(udp->uh_dport), 443);
+	EXPECT_EQ(ntohs(udp->uh_ulen), sizeof(struct udphdr) + 100);
+	EXPECT_EQ(ntohs(udp->uh_sum), 0x1234);
+	EXPECT_EQ(m->m_pkthdr.csum_flags, 0);
+}
+
+// Verify that the checksum of a UDP/IPv4 datagram covers the pseudo-header
+// and the payload, and that the IP header carries the UDP protocol number.
+TEST_F(UdpHeaderTestSuite, TestIpv4Checksum)
+{
+	MbufUniquePtr m = GetIpv4Template().Generate();
+	auto * ip = GetMbufHeader<struct ip>(m);
+	auto * udp = GetMbufHeader<udphdr>(m, sizeof(struct ip));
+
+	EXPECT_EQ(ip->ip_p, IPPROTO_UDP);
+	EXPECT_EQ(ntohs(ip->ip_len), sizeof(struct ip) + sizeof(*udp) + 7);
+	EXPECT_EQ(ntohs(udp->uh_ulen), sizeof(*udp) + 7);
+	EXPECT_EQ(ntohs(udp->uh_sum), 0xb49b);
+}
+
+TEST_F(UdpHeaderTestSuite, TestIpv6Checksum)
+{
+	auto p = PacketTemplate(
+		Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+		UdpHeader().With(src(1234), dst(53)),
+		PacketPayload().With(payload("FreeBSD"))
+	);
+
+	MbufUniquePtr m = p.Generate();
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m);
+	auto * udp = GetMbufHeader<udphdr>(m, sizeof(struct ip6_hdr));
+
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_UDP);
+	EXPECT_EQ(ntohs(udp->uh_sum), 0xce99);
+}
+
+// checksum(0) sends a datagram without a checksum, while a computed checksum
+// that comes out as 0 must be sent as 0xffff.
+TEST_F(UdpHeaderTestSuite, TestZeroChecksum)
+{
+	auto p = GetIpv4Template().WithHeader(Layer::PAYLOAD).Fields(
+	    payload(PktGen::internal::PayloadVector{0, 0}));
+
+	MbufUniquePtr m = p.WithHeader(Layer::L4).Fields(checksum(0)).Generate();
+	auto * udp = GetMbufHeader<udphdr>(m, sizeof(struct ip));
+	EXPECT_EQ(udp->uh_sum, 0);
+
+	// Adding the checksum of a datagram to its payload makes the one's
+	// complement sum 0xffff, and so the computed checksum 0.
+	m = p.Generate();
+	udp = GetMbufHeader<udphdr>(m, sizeof(struct ip));
+	uint16_t sum = ntohs(udp->uh_sum);
+
+	m = p.WithHeader(Layer::PAYLOAD).Fields(
+	    payload(PktGen::internal::PayloadVector{uint8_t(sum >> 8), uint8_t(sum)}))
+	    .Generate();
+	udp = GetMbufHeader<udphdr>(m, sizeof(struct ip));
+	EXPECT_EQ(ntohs(udp->uh_sum), 0xffff);
+}
+
+// Each datagram in a sequence keeps its ports while the layers around it
+// advance, and its checksum is recomputed to match.  With an MTU smaller than
+// the payload, successive datagrams carry successive pieces of it.
+TEST_F(UdpHeaderTestSuite, TestNext)
+{
+	auto p1 = PacketTemplate(
+		Ipv4Header().With(src("10.0.0.1"), dst("10.0.0.2"), id(7),
+		    mtu(sizeof(struct ip) + sizeof(struct udphdr) + 16)),
+		UdpHeader().With(src(1234), dst(53)),
+		PacketPayload().With(counterPayload(64))
+	);
+	auto p2 = p1.Next();
+
+	MbufUniquePtr m1 = p1.Generate();
+	MbufUniquePtr m2 = p2.Generate();
+	auto * ip = GetMbufHeader<struct ip>(m2);
+	auto * udp1 = GetMbufHeader<udphdr>(m1, sizeof(struct ip));
+	auto * udp2 = GetMbufHeader<udphdr>(m2, sizeof(struct ip));
+
+	EXPECT_EQ(ntohs(ip->ip_id), 8);
+	EXPECT_EQ(udp2->uh_sport, udp1->uh_sport);
+	EXPECT_EQ(udp2->uh_dport, udp1->uh_dport);
+	EXPECT_EQ(udp2->uh_ulen, udp1->uh_ulen);
+	EXPECT_EQ(ntohs(udp2->uh_ulen), sizeof(struct udphdr) + 16);
+	EXPECT_NE(udp2->uh_sum, udp1->uh_sum);
+	EXPECT_EQ(*GetMbufHeader<uint8_t>(m2, sizeof(struct ip) + sizeof(*udp2)),
+	    16);
+
+	EXPECT_THAT(m2.get(), PacketMatcher(p2));
+}
+
+// Verify that the detailed and compiled matchers accept a datagram generated
+// from the same template, and that the detailed matcher rejects a datagram
+// whose payload no longer matches its checksum.
+TEST_F(UdpHeaderTestSuite, TestMatcher)
+{
+	auto p1 = GetIpv4Template().WithHeader(Layer::L4).Fields(
+	    checksumVerified(), checksumPassed());
+	auto p2 = p1.WithHeader(Layer::L4).Fields(dst(54));
+
+	MbufUniquePtr m = p1.Generate();
+
+	EXPECT_THAT(m.get(), PacketMatcher(p1));
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(p1));
+
+	EXPECT_THAT(Explain(PacketMatcher(p2), m.get()),
+	    HasSubstr("UDP: uh_dport field is 53 (expected 54)"));
+
+	GetMbufHeader<char>(m, sizeof(struct ip) + sizeof(struct udphdr))[0] = 'f';
+
+	EXPECT_THAT(Explain(PacketMatcher(p1), m.get()),
+	    HasSubstr("UDP: checksum is b49b (expected"));
+}
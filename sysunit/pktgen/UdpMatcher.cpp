@@ -0,0 +1,123 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#define _KERNEL_UT 1
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Udp.h"
+
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+
+namespace PktGen::internal
+{
+	UdpMatcher::UdpMatcher(const UdpTemplate & header, size_t offset)
+	  : header(header),
+	    headerOffset(offset)
+	{
+	}
+
+	#define	CheckField(uh, field, expect) do { \
+		if (ntoh((uh)->field) != (expect)) { \
+			*listener << "UDP: " << #field << " field is " << (int)ntoh((uh)->field) \
+			    << " (expected " << (int)(expect) << ")"; \
+			return false; \
+		} \
+	} while (0)
+
+	bool UdpMatcher::MatchAndExplain(mbuf* m,
+                    testing::MatchResultListener* listener) const
+	{
+		auto * udp = GetMbufHeader<udphdr>(m, headerOffset);
+		auto * payload = reinterpret_cast<const uint8_t *>(udp + 1);
+
+		CheckField(udp, uh_ulen, header.GetUdpLen());
+
+		if (headerOffset + header.GetUdpLen() > size_t(m->m_len)) {
+			*listener << "UDP: datagram is truncated to "
+			    << (m->m_len - headerOffset) << " bytes";
+			return false;
+		}
+
+		CheckField(udp, uh_sport, header.GetSrcPort(payload));
+		CheckField(udp, uh_dport, header.GetDstPort());
+
+		// A computed checksum is checked against the payload actually
+		// in the mbuf, so a corrupted payload is caught here even if
+		// nothing matches the payload itself.
+		uint16_t expectedSum;
+		if (header.GetFixedChecksum())
+			expectedSum = *header.GetFixedChecksum();
+		else
+			expectedSum = header.ComputeChecksum(payload);
+
+		if (ntoh(udp->uh_sum) != expectedSum) {
+			*listener << "UDP: checksum is " << std::hex
+			    << ntoh(udp->uh_sum) << " (expected " << expectedSum
+			    << ")" << std::dec;
+			return false;
+		}
+
+		uint32_t expectedFlag = 0;
+		if (header.GetChecksumVerified())
+			expectedFlag = CSUM_L4_CALC;
+
+		auto actualFlag = m->m_pkthdr.csum_flags & CSUM_L4_CALC;
+		if (actualFlag != expectedFlag) {
+			*listener << "UDP: csum calc flag is " << actualFlag
+			    << " (expected " << expectedFlag << ")";
+			return false;
+		}
+
+		expectedFlag = 0;
+		if (header.GetChecksumPassed())
+			expectedFlag = CSUM_L4_VALID;
+
+		actualFlag = m->m_pkthdr.csum_flags & CSUM_L4_VALID;
+		if (actualFlag != expectedFlag) {
+			*listener << "UDP: csum valid flag is " << actualFlag
+			    << " (expected " << expectedFlag << ")";
+			return false;
+		}
+
+		return true;
+	}
+
+	void UdpMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "UDP";
+	}
+
+	void CompilePacketMask(const UdpTemplate & header, CompiledPacket & packet,
+	    size_t off)
+	{
+		packet.csumMask |= CSUM_L4_CALC | CSUM_L4_VALID;
+	}
+}
@@ -0,0 +1,153 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Vlan.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Tcp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+using PktGen::internal::vlan_tag;
+
+class VlanHeaderTestSuite : public SysUnit::TestSuite
+{
+public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+};
+
+// Generate a TCP/IPv4 packet with a single 802.1Q tag and verify that the
+// tag is inserted between the Ethernet and IP headers, and that the
+// ethertypes are chained through the tag.
+TEST_F(VlanHeaderTestSuite, TestSingleTag)
+{
+	auto p = PacketTemplate(
+		EthernetHeader(),
+		VlanHeader().With(vid(100), pcp(5)),
+		Ipv4Header(),
+		TcpHeader(),
+		PacketPayload().With(payload("tagged"))
+	);
+
+	MbufUniquePtr m = p.Generate();
+	size_t l3off = sizeof(struct ether_header) + sizeof(struct vlan_tag);
+
+	ASSERT_EQ(m->m_pkthdr.len, l3off + sizeof(struct ip) +
+	    sizeof(struct tcphdr) + strlen("tagged"));
+	EXPECT_EQ(m->m_flags & M_VLANTAG, 0);
+
+	auto * eh = GetMbufHeader<struct ether_header>(m);
+	EXPECT_EQ(ntohs(eh->ether_type), ETHERTYPE_VLAN);
+
+	auto * tag = GetMbufHeader<struct vlan_tag>(m, sizeof(*eh));
+	EXPECT_EQ(ntohs(tag->tci), (5 << 13) | 100);
+	EXPECT_EQ(ntohs(tag->proto), ETHERTYPE_IP);
+
+	auto * ip = GetMbufHeader<struct ip>(m, l3off);
+	EXPECT_EQ(ip->ip_v, 4);
+	EXPECT_EQ(ntohs(ip->ip_len), m->m_pkthdr.len - l3off);
+}
+
+// Generate a QinQ packet and verify that the outer tag is introduced with
+// the TPID given in the template and the inner tag with ETHERTYPE_VLAN.
+// Also verify that each tag can be modified via OUTER_VLAN and INNER_VLAN.
+TEST_F(VlanHeaderTestSuite, TestQinQ)
+{
+	auto p1 = PacketTemplate(
+		EthernetHeader(),
+		VlanHeader().With(tpid(ETHERTYPE_QINQ), vid(10)),
+		VlanHeader().With(vid(20)),
+		Ipv6Header(),
+		TcpHeader()
+	);
+
+	auto p2 = p1
+	    .WithHeader(Layer::OUTER_VLAN).Fields(vid(11))
+	    .WithHeader(Layer::INNER_VLAN).Fields(vid(21), dei());
+
+	MbufUniquePtr m = p2.Generate();
+	size_t off = sizeof(struct ether_header);
+
+	auto * eh = GetMbufHeader<struct ether_header>(m);
+	EXPECT_EQ(ntohs(eh->ether_type), ETHERTYPE_QINQ);
+
+	auto * outer = GetMbufHeader<struct vlan_tag>(m, off);
+	EXPECT_EQ(ntohs(outer->tci), 11);
+	EXPECT_EQ(ntohs(outer->proto), ETHERTYPE_VLAN);
+
+	auto * inner = GetMbufHeader<struct vlan_tag>(m, off + sizeof(*outer));
+	EXPECT_EQ(ntohs(inner->tci), 0x1000 | 21);
+	EXPECT_EQ(ntohs(inner->proto), ETHERTYPE_IPV6);
+
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m, off + 2 * sizeof(*outer));
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_TCP);
+}
+
+// Verify that the detailed and compiled matchers accept a tagged packet
+// generated from the same template and explain a mismatched tag.
+TEST_F(VlanHeaderTestSuite, TestMatcher)
+{
+	auto p1 = PacketTemplate(
+		EthernetHeader(),
+		VlanHeader().With(vid(100)),
+		Ipv4Header(),
+		TcpHeader(),
+		PacketPayload().With(payload("match"))
+	);
+	auto p2 = p1.WithHeader(Layer::VLAN).Fields(vid(101));
+
+	MbufUniquePtr m = p1.Generate();
+
+	EXPECT_THAT(m.get(), PacketMatcher(p1));
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(p1));
+
+	EXPECT_THAT(Explain(PacketMatcher(p2), m.get()),
+	    HasSubstr("VLAN: vid is 100 (expected 101)"));
+	EXPECT_THAT(Explain(CompiledPacketMatcher(p2), m.get()),
+	    HasSubstr("VLAN: vid is 100 (expected 101)"));
+}
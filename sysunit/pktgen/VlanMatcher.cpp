@@ -0,0 +1,84 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Vlan.h"
+
+#include <netinet/in.h>
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	VlanMatcher::VlanMatcher(const VlanTemplate & h, size_t off)
+	  : header(h),
+	    headerOffset(off)
+	{
+	}
+
+	bool VlanMatcher::MatchAndExplain(mbuf* m,
+	    MatchResultListener* listener) const
+	{
+		auto * tag = GetMbufHeader<struct vlan_tag>(m, headerOffset);
+		uint16_t tci = ntoh(tag->tci);
+
+		if ((tci & 0xfff) != header.GetVid()) {
+			*listener << "VLAN: vid is " << (tci & 0xfff)
+			    << " (expected " << header.GetVid() << ")";
+			return false;
+		}
+
+		if (tci != header.GetTci()) {
+			*listener << "VLAN: tci is " << std::hex << tci
+			    << " (expected " << header.GetTci() << ")";
+			return false;
+		}
+
+		if (ntoh(tag->proto) != header.GetEthertype()) {
+			*listener << "VLAN: ethertype is " << std::hex
+			    << ntoh(tag->proto)
+			    << " (expected " << header.GetEthertype() << ")";
+			return false;
+		}
+
+		return true;
+	}
+
+	void VlanMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "VLAN";
+	}
+
+	void CompilePacketMask(const VlanTemplate & header,
+	    CompiledPacket & packet, size_t off)
+	{
+		// Every byte of the tag is significant.
+	}
+}
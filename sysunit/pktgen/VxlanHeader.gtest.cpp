@@ -0,0 +1,190 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "pktgen/Vxlan.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Ethernet.h"
+#include "pktgen/Ipv4.h"
+#include "pktgen/Ipv6.h"
+#include "pktgen/Packet.h"
+#include "pktgen/PacketMatcher.h"
+#include "pktgen/PacketPayload.h"
+#include "pktgen/Rss.h"
+#include "pktgen/Tcp.h"
+#include "pktgen/Udp.h"
+
+#include "sysunit/TestSuite.h"
+
+#include <gtest/gtest.h>
+
+#include <stubs/sysctl.h>
+#include <stubs/uio.h>
+
+using namespace PktGen;
+using namespace testing;
+using PktGen::internal::GetMbufHeader;
+using PktGen::internal::vxlan_hdr;
+
+class VxlanHeaderTestSuite : public SysUnit::TestSuite
+{
+public:
+	static std::string Explain(const Matcher<mbuf*> & matcher, mbuf * m)
+	{
+		StringMatchResultListener listener;
+
+		EXPECT_FALSE(matcher.MatchAndExplain(m, &listener));
+		return listener.str();
+	}
+
+	// A TCP/IPv4 packet in VXLAN over UDP/IPv6.
+	static auto GetTemplate()
+	{
+		return PacketTemplate(
+			EthernetHeader(),
+			Ipv6Header().With(src("fd00::1"), dst("fd00::2")),
+			UdpHeader(),
+			VxlanHeader().With(vni(0x123456)),
+			EthernetHeader().With(
+				src("02:00:00:00:00:01"),
+				dst("02:00:00:00:00:02")
+			),
+			Ipv4Header().With(src("10.0.0.1"), dst("10.0.0.2")),
+			TcpHeader().With(src(1000), dst(80)),
+			PacketPayload().With(payload("inner"))
+		);
+	}
+
+	static constexpr size_t VXLAN_OFF = sizeof(struct ether_header) +
+	    sizeof(struct ip6_hdr) + sizeof(struct udphdr);
+	static constexpr size_t INNER_OFF = VXLAN_OFF + sizeof(struct vxlan_hdr);
+	static constexpr size_t INNER_LEN = sizeof(struct ether_header) +
+	    sizeof(struct ip) + sizeof(struct tcphdr) + 5;
+};
+
+// Verify the layout of a VXLAN packet and the fields that are propagated
+// through the tunnel.
+TEST_F(VxlanHeaderTestSuite, TestEncapsulation)
+{
+	MbufUniquePtr m = GetTemplate().Generate();
+
+	ASSERT_EQ(m->m_pkthdr.len, INNER_OFF + INNER_LEN);
+
+	auto * ip6 = GetMbufHeader<struct ip6_hdr>(m, sizeof(struct ether_header));
+	EXPECT_EQ(ip6->ip6_nxt, IPPROTO_UDP);
+	EXPECT_EQ(ntohs(ip6->ip6_plen),
+	    sizeof(struct udphdr) + sizeof(struct vxlan_hdr) + INNER_LEN);
+
+	auto * udp = GetMbufHeader<struct udphdr>(m,
+	    sizeof(struct ether_header) + sizeof(struct ip6_hdr));
+	EXPECT_EQ(ntohs(udp->uh_dport), 4789);
+	EXPECT_EQ(ntohs(udp->uh_ulen),
+	    sizeof(struct udphdr) + sizeof(struct vxlan_hdr) + INNER_LEN);
+	EXPECT_GE(ntohs(udp->uh_sport), 49152);
+
+	auto * vxh = GetMbufHeader<struct vxlan_hdr>(m, VXLAN_OFF);
+	EXPECT_EQ(ntohl(vxh->flags), 0x08000000U);
+	EXPECT_EQ(ntohl(vxh->vni), 0x12345600U);
+
+	auto * eh = GetMbufHeader<struct ether_header>(m, INNER_OFF);
+	EXPECT_EQ(ntohs(eh->ether_type), ETHERTYPE_IP);
+
+	auto * ip = GetMbufHeader<struct ip>(m, INNER_OFF + sizeof(*eh));
+	EXPECT_EQ(ip->ip_p, IPPROTO_TCP);
+	EXPECT_EQ(ntohs(ip->ip_len), INNER_LEN - sizeof(*eh));
+}
+
+// The outer source port is a hash of the inner flow, so packets of one inner
+// flow share an outer source port and different flows are spread across
+// ports and RSS queues.
+TEST_F(VxlanHeaderTestSuite, TestSrcPortEntropy)
+{
+	auto flow1 = GetTemplate();
+	auto flow2 = flow1.WithHeader(Layer::INNER_L4).Fields(src(1001));
+	auto GetSport = [] (const auto & p)
+		{
+			MbufUniquePtr m = p.Generate();
+			auto * udp = GetMbufHeader<struct udphdr>(m,
+			    VXLAN_OFF - sizeof(struct udphdr));
+			return ntohs(udp->uh_sport);
+		};
+	auto GetHash = [] (const auto & p)
+		{
+			MbufUniquePtr m = p.Generate();
+			return RssHashFrame(GetMbufHeader<uint8_t>(m),
+			    m->m_pkthdr.len);
+		};
+
+	EXPECT_EQ(GetSport(flow1), GetSport(flow1.Next()));
+	EXPECT_NE(GetSport(flow1), GetSport(flow2));
+	EXPECT_NE(GetHash(flow1), GetHash(flow2));
+
+	auto fixed = flow1
+	    .WithHeader(Layer::TUNNEL).Fields(srcPortEntropy(false))
+	    .WithHeader(Layer::OUTER_L4).Fields(src(1234));
+	EXPECT_EQ(GetSport(fixed), 1234);
+	EXPECT_EQ(GetSport(fixed.WithHeader(Layer::INNER_L4).Fields(src(1001))),
+	    1234);
+
+	auto port = flow1.WithHeader(Layer::TUNNEL).Fields(vxlanPort(8472));
+	MbufUniquePtr m = port.Generate();
+	auto * udp = GetMbufHeader<struct udphdr>(m,
+	    VXLAN_OFF - sizeof(struct udphdr));
+	EXPECT_EQ(ntohs(udp->uh_dport), 8472);
+}
+
+// Verify that the matchers check both the outer and inner headers.
+TEST_F(VxlanHeaderTestSuite, TestMatcher)
+{
+	auto p = GetTemplate();
+	MbufUniquePtr m = p.Generate();
+
+	EXPECT_THAT(m.get(), PacketMatcher(p));
+	EXPECT_THAT(m.get(), CompiledPacketMatcher(p));
+
+	auto badVni = p.WithHeader(Layer::TUNNEL).Fields(vni(7));
+	EXPECT_THAT(Explain(PacketMatcher(badVni), m.get()),
+	    HasSubstr("VXLAN: vni is 1193046 (expected 7)"));
+
+	auto badInner = p.WithHeader(Layer::INNER_L4).Fields(dst(81));
+	EXPECT_THAT(Explain(PacketMatcher(badInner), m.get()),
+	    HasSubstr("TCP: th_dport field is 80 (expected 81)"));
+	EXPECT_THAT(Explain(CompiledPacketMatcher(badInner), m.get()),
+	    HasSubstr("TCP: th_dport field is 80 (expected 81)"));
+}
+
+// VXLAN has no protocol field, so it can only carry an Ethernet frame.
+TEST_F(VxlanHeaderTestSuite, TestNonEthernet)
+{
+	EXPECT_THROW(PacketTemplate(
+		Ipv4Header(),
+		UdpHeader(),
+		VxlanHeader(),
+		Ipv4Header()
+	), std::runtime_error);
+}
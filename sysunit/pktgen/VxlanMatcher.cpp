@@ -0,0 +1,78 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "fake/mbuf.h"
+
+#include "pktgen/CompiledMatcher.h"
+#include "pktgen/Vxlan.h"
+
+#include <netinet/in.h>
+
+using testing::MatchResultListener;
+
+namespace PktGen::internal
+{
+	VxlanMatcher::VxlanMatcher(const VxlanTemplate & h, size_t off)
+	  : header(h),
+	    headerOffset(off)
+	{
+	}
+
+	bool VxlanMatcher::MatchAndExplain(mbuf* m,
+	    MatchResultListener* listener) const
+	{
+		auto * vxh = GetMbufHeader<struct vxlan_hdr>(m, headerOffset);
+
+		if (ntoh(vxh->flags) != VxlanTemplate::FLAG_VNI) {
+			*listener << "VXLAN: flags are " << std::hex
+			    << ntoh(vxh->flags) << " (expected "
+			    << VxlanTemplate::FLAG_VNI << ")" << std::dec;
+			return false;
+		}
+
+		uint32_t vni = ntoh(vxh->vni) >> VxlanTemplate::VNI_SHIFT;
+		if (vni != header.GetVni()) {
+			*listener << "VXLAN: vni is " << vni
+			    << " (expected " << header.GetVni() << ")";
+			return false;
+		}
+
+		return true;
+	}
+
+	void VxlanMatcher::DescribeTo(::std::ostream* os) const
+	{
+		*os << "VXLAN";
+	}
+
+	void CompilePacketMask(const VxlanTemplate & header,
+	    CompiledPacket & packet, size_t off)
+	{
+		// Every byte of the header is significant.
+	}
+}
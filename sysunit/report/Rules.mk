@@ -0,0 +1,5 @@
+
+LIB :=	sysunit_report
+
+SRCS := \
+	XmlReport.cpp \
@@ -0,0 +1,152 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "sysunit/XmlReport.h"
+
+#include <sstream>
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		std::string XmlEscape(const std::string & str)
+		{
+			std::string escaped;
+
+			for (char c : str) {
+				switch (c) {
+				case '<':
+					escaped += "&lt;";
+					break;
+				case '>':
+					escaped += "&gt;";
+					break;
+				case '&':
+					escaped += "&amp;";
+					break;
+				case '"':
+					escaped += "&quot;";
+					break;
+				default:
+					escaped += c;
+					break;
+				}
+			}
+
+			return escaped;
+		}
+
+		// "]]>" would end the CDATA section early, so split it across
+		// two sections.
+		std::string CdataEscape(const std::string & str)
+		{
+			std::string escaped;
+			size_t start = 0;
+			size_t end;
+
+			while ((end = str.find("]]>", start)) != std::string::npos) {
+				escaped += str.substr(start, end - start);
+				escaped += "]]]]><![CDATA[>";
+				start = end + 3;
+			}
+			escaped += str.substr(start);
+			return escaped;
+		}
+	}
+
+	std::string ExtractTestSuites(const std::string & xml)
+	{
+		// Skip the <testsuites> start tag, which has no testsuite
+		// element before it.
+		size_t start = xml.find("<testsuite ");
+		size_t end = xml.rfind("</testsuites>");
+
+		if (start == std::string::npos || end == std::string::npos ||
+		    end < start)
+			return "";
+
+		return "  " + xml.substr(start, end - start);
+	}
+
+	std::string MakeTestSuite(const std::string & name,
+	    const std::vector<CaseResult> & results)
+	{
+		std::ostringstream suite;
+		size_t failures = 0;
+		double seconds = 0;
+
+		for (const auto & r : results) {
+			if (r.failed)
+				failures++;
+			seconds += r.seconds;
+		}
+
+		suite << "  <testsuite name=\"" << XmlEscape(name)
+		    << "\" tests=\"" << results.size()
+		    << "\" failures=\"" << failures
+		    << "\" disabled=\"0\" errors=\"0\" time=\"" << seconds << "\">\n";
+
+		for (const auto & r : results) {
+			size_t dot = r.name.find('.');
+			std::string className = r.name.substr(0, dot);
+			std::string caseName = dot == std::string::npos ?
+			    r.name : r.name.substr(dot + 1);
+
+			suite << "    <testcase name=\"" << XmlEscape(caseName)
+			    << "\" status=\"run\" time=\"" << r.seconds
+			    << "\" classname=\"" << XmlEscape(className) << "\"";
+
+			if (!r.failed) {
+				suite << " />\n";
+				continue;
+			}
+
+			suite << ">\n      <failure message=\"" << XmlEscape(r.output)
+			    << "\" type=\"\"><![CDATA[" << CdataEscape(r.output)
+			    << "]]></failure>\n    </testcase>\n";
+		}
+
+		suite << "  </testsuite>\n";
+		return suite.str();
+	}
+
+	void WriteXmlReport(std::ostream & out, const ReportTotals & totals,
+	    const std::vector<std::string> & suites)
+	{
+		out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		    << "<testsuites tests=\"" << totals.tests
+		    << "\" failures=\"" << totals.failures
+		    << "\" disabled=\"0\" errors=\"0\" time=\"" << totals.seconds
+		    << "\" name=\"AllTests\">\n";
+
+		for (const auto & suite : suites)
+			out << suite;
+
+		out << "</testsuites>\n";
+	}
+}
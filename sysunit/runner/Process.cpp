@@ -0,0 +1,151 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "Process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdexcept>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		std::string Errno(const std::string & what)
+		{
+			return what + ": " + strerror(errno);
+		}
+
+		// Runs in the child after fork(), so this must not return.
+		[[noreturn]] void Exec(const std::string & program,
+		    const std::vector<std::string> & args)
+		{
+			std::vector<char *> argv;
+
+			argv.push_back(const_cast<char *>(program.c_str()));
+			for (const auto & arg : args)
+				argv.push_back(const_cast<char *>(arg.c_str()));
+			argv.push_back(NULL);
+
+			execv(program.c_str(), argv.data());
+			_exit(127);
+		}
+	}
+
+	std::string RunAndCapture(const std::string & program,
+	    const std::vector<std::string> & args)
+	{
+		int fds[2];
+
+		if (pipe(fds) != 0)
+			throw std::runtime_error(Errno("pipe"));
+
+		pid_t pid = fork();
+		if (pid < 0) {
+			close(fds[0]);
+			close(fds[1]);
+			throw std::runtime_error(Errno("fork"));
+		}
+
+		if (pid == 0) {
+			close(fds[0]);
+			dup2(fds[1], STDOUT_FILENO);
+			close(fds[1]);
+			Exec(program, args);
+		}
+
+		close(fds[1]);
+
+		std::string output;
+		char buf[4096];
+		ssize_t len;
+		while ((len = read(fds[0], buf, sizeof(buf))) != 0) {
+			if (len < 0) {
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			output.append(buf, len);
+		}
+		close(fds[0]);
+
+		int status;
+		while (waitpid(pid, &status, 0) < 0) {
+			if (errno != EINTR)
+				throw std::runtime_error(Errno("waitpid"));
+		}
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			throw std::runtime_error(program + " " + DescribeStatus(status));
+
+		return output;
+	}
+
+	pid_t SpawnWorker(const std::string & program,
+	    const std::vector<std::string> & args, const std::string & logPath)
+	{
+		int fd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0)
+			throw std::runtime_error(Errno("open " + logPath));
+
+		pid_t pid = fork();
+		if (pid < 0) {
+			close(fd);
+			throw std::runtime_error(Errno("fork"));
+		}
+
+		if (pid == 0) {
+			struct rlimit limit = {0, 0};
+
+			setrlimit(RLIMIT_CORE, &limit);
+			dup2(fd, STDOUT_FILENO);
+			dup2(fd, STDERR_FILENO);
+			close(fd);
+			Exec(program, args);
+		}
+
+		close(fd);
+		return pid;
+	}
+
+	std::string DescribeStatus(int status)
+	{
+		if (WIFEXITED(status))
+			return "exited with status " + std::to_string(WEXITSTATUS(status));
+		else if (WIFSIGNALED(status))
+			return "killed by signal " + std::to_string(WTERMSIG(status)) +
+			    " (" + strsignal(WTERMSIG(status)) + ")";
+		else
+			return "stopped with status " + std::to_string(status);
+	}
+}
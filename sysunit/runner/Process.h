@@ -0,0 +1,54 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_RUNNER_PROCESS_H
+#define SYSUNIT_RUNNER_PROCESS_H
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace SysUnit::internal
+{
+	// Run program to completion and return everything that it wrote to
+	// stdout.  Throws if the program can't be run or does not exit
+	// successfully.
+	std::string RunAndCapture(const std::string & program,
+	    const std::vector<std::string> & args);
+
+	// Start program in the background with its stdout and stderr
+	// redirected to logPath.  Like "limits -c 0", core dumps are disabled
+	// so that a crashing test does not leave a core file behind.
+	pid_t SpawnWorker(const std::string & program,
+	    const std::vector<std::string> & args, const std::string & logPath);
+
+	// Describe a status returned by waitpid(), e.g. "killed by signal 11".
+	std::string DescribeStatus(int status);
+}
+
+#endif
@@ -0,0 +1,25 @@
+
+LIB := sysunit_runner
+
+SRCS := \
+	main.cpp \
+	Process.cpp \
+	TestLog.cpp \
+	TestPlan.cpp \
+
+PROG := bin/sysunit_runner
+PROG_LIBS := sysunit_runner sysunit_report
+
+TESTS := \
+	TestLog \
+	TestPlan \
+
+TEST_TESTLOG_SRCS := \
+	TestLog.cpp \
+
+TEST_TESTPLAN_SRCS := \
+	TestPlan.cpp \
+
+TEST_TESTPLAN_STDLIBS := \
+	gmock \
+
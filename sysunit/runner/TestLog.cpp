@@ -0,0 +1,106 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "TestLog.h"
+
+#include <stdlib.h>
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		const std::string RUN_TAG = "[ RUN      ] ";
+		const std::string OK_TAG = "[       OK ] ";
+		const std::string FAILED_TAG = "[  FAILED  ] ";
+		const std::string SKIPPED_TAG = "[  SKIPPED ] ";
+
+		bool StartsWith(const std::string & line, const std::string & prefix)
+		{
+			return line.compare(0, prefix.size(), prefix) == 0;
+		}
+
+		// The case name ends at the first space, or at the comma before
+		// ", where TypeParam = ..." for typed tests.
+		std::string GetCaseName(const std::string & line, size_t start)
+		{
+			size_t end = line.find_first_of(", ", start);
+
+			return line.substr(start, end == std::string::npos ?
+			    std::string::npos : end - start);
+		}
+
+		// Parse the "(12 ms)" at the end of a line that reports that a
+		// case finished.  Returns false for the lines in gtest's final
+		// summary of failed cases, which have no time.
+		bool GetCaseTime(const std::string & line, double & seconds)
+		{
+			size_t open = line.rfind('(');
+			if (open == std::string::npos || line.size() < 4 ||
+			    line.compare(line.size() - 4, 4, " ms)") != 0)
+				return false;
+
+			seconds = strtod(line.c_str() + open + 1, NULL) / 1000;
+			return true;
+		}
+	}
+
+	LogResult ParseTestLog(std::istream & in)
+	{
+		LogResult result;
+		std::string line;
+
+		while (std::getline(in, line)) {
+			if (StartsWith(line, RUN_TAG)) {
+				result.interrupted = true;
+				result.running = CaseResult();
+				result.running.name = GetCaseName(line, RUN_TAG.size());
+				continue;
+			}
+
+			if (!result.interrupted)
+				continue;
+
+			bool ok = StartsWith(line, OK_TAG) || StartsWith(line, SKIPPED_TAG);
+			bool failed = StartsWith(line, FAILED_TAG);
+			double seconds;
+
+			if ((ok || failed) && GetCaseTime(line, seconds)) {
+				result.running.failed = failed;
+				result.running.seconds = seconds;
+				result.finished.push_back(std::move(result.running));
+				result.interrupted = false;
+				continue;
+			}
+
+			result.running.output += line;
+			result.running.output += '\n';
+		}
+
+		return result;
+	}
+}
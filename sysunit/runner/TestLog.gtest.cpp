@@ -0,0 +1,92 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "TestLog.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace SysUnit::internal;
+
+TEST(TestLogTest, TestFinished)
+{
+	std::istringstream log(
+	    "Note: Google Test filter = A.x:A.y\n"
+	    "[==========] Running 2 tests from 1 test suite.\n"
+	    "[ RUN      ] A.x\n"
+	    "[       OK ] A.x (12 ms)\n"
+	    "[ RUN      ] TcpLroTestSuite/1.TestMerge\n"
+	    "foo.cpp:10: Failure\n"
+	    "Value of: x\n"
+	    "[  FAILED  ] TcpLroTestSuite/1.TestMerge, where TypeParam = IPv6 (3 ms)\n"
+	    "[==========] 2 tests from 1 test suite ran. (15 ms total)\n"
+	    "[  FAILED  ] TcpLroTestSuite/1.TestMerge, where TypeParam = IPv6\n");
+
+	LogResult result = ParseTestLog(log);
+
+	EXPECT_FALSE(result.interrupted);
+	ASSERT_EQ(result.finished.size(), 2);
+
+	EXPECT_EQ(result.finished[0].name, "A.x");
+	EXPECT_FALSE(result.finished[0].failed);
+	EXPECT_DOUBLE_EQ(result.finished[0].seconds, 0.012);
+
+	EXPECT_EQ(result.finished[1].name, "TcpLroTestSuite/1.TestMerge");
+	EXPECT_TRUE(result.finished[1].failed);
+	EXPECT_DOUBLE_EQ(result.finished[1].seconds, 0.003);
+	EXPECT_EQ(result.finished[1].output, "foo.cpp:10: Failure\nValue of: x\n");
+}
+
+TEST(TestLogTest, TestInterrupted)
+{
+	std::istringstream log(
+	    "[ RUN      ] A.x\n"
+	    "[       OK ] A.x (0 ms)\n"
+	    "[ RUN      ] A.crash\n"
+	    "panic: bad thing\n");
+
+	LogResult result = ParseTestLog(log);
+
+	ASSERT_EQ(result.finished.size(), 1);
+	EXPECT_EQ(result.finished[0].name, "A.x");
+
+	EXPECT_TRUE(result.interrupted);
+	EXPECT_EQ(result.running.name, "A.crash");
+	EXPECT_EQ(result.running.output, "panic: bad thing\n");
+}
+
+TEST(TestLogTest, TestEmpty)
+{
+	std::istringstream log("");
+
+	LogResult result = ParseTestLog(log);
+
+	EXPECT_FALSE(result.interrupted);
+	EXPECT_TRUE(result.finished.empty());
+}
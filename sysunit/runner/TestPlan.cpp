@@ -0,0 +1,177 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "TestPlan.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		bool IsDisabled(const std::string & name)
+		{
+			return name.compare(0, 9, "DISABLED_") == 0;
+		}
+
+		// Strip the "# TypeParam = ..." comments that gtest appends to
+		// typed and parameterized tests.
+		std::string FirstWord(const std::string & line)
+		{
+			std::istringstream words(line);
+			std::string word;
+
+			words >> word;
+			return word;
+		}
+	}
+
+	std::map<std::string, std::vector<std::string>>
+	Shard::GetCasesByProgram() const
+	{
+		std::map<std::string, std::vector<std::string>> byProgram;
+
+		for (const auto & c : cases)
+			byProgram[c.program].push_back(c.name);
+		return byProgram;
+	}
+
+	std::vector<std::string> ParseTestList(std::istream & in)
+	{
+		std::vector<std::string> names;
+		std::string line;
+		std::string suite;
+
+		while (std::getline(in, line)) {
+			if (line.empty())
+				continue;
+
+			std::string word = FirstWord(line);
+			if (word.empty())
+				continue;
+
+			if (line[0] != ' ') {
+				suite = word;
+				continue;
+			}
+
+			if (suite.empty())
+				throw std::runtime_error("Test " + word + " listed before its suite");
+
+			// Typed suites are named like "Suite/0.", so check each
+			// component of the suite name for the DISABLED_ prefix.
+			if (IsDisabled(word) || IsDisabled(suite) ||
+			    suite.find("/DISABLED_") != std::string::npos)
+				continue;
+
+			names.push_back(suite + word);
+		}
+
+		return names;
+	}
+
+	DurationMap ReadDurations(std::istream & in)
+	{
+		DurationMap durations;
+		std::string line;
+
+		while (std::getline(in, line)) {
+			std::istringstream fields(line);
+			std::string program, name, seconds;
+
+			if (!std::getline(fields, program, '\t') ||
+			    !std::getline(fields, name, '\t') ||
+			    !std::getline(fields, seconds))
+				continue;
+
+			durations[{program, name}] = std::stod(seconds);
+		}
+
+		return durations;
+	}
+
+	void WriteDurations(std::ostream & out, const DurationMap & durations)
+	{
+		for (const auto & [key, seconds] : durations)
+			out << key.first << "\t" << key.second << "\t" << seconds << "\n";
+	}
+
+	void EstimateDurations(std::vector<TestCase> & cases,
+	    const DurationMap & durations)
+	{
+		double total = 0;
+		size_t known = 0;
+
+		for (auto & c : cases) {
+			auto it = durations.find({c.program, c.name});
+			if (it == durations.end()) {
+				c.duration = -1;
+				continue;
+			}
+
+			c.duration = it->second;
+			total += it->second;
+			known++;
+		}
+
+		double average = known > 0 ? total / known : 1;
+		for (auto & c : cases) {
+			if (c.duration < 0)
+				c.duration = average;
+		}
+	}
+
+	std::vector<Shard> PlanShards(std::vector<TestCase> cases, size_t numShards)
+	{
+		if (numShards == 0)
+			throw std::runtime_error("Need at least one shard");
+
+		std::vector<Shard> shards(std::min(numShards, std::max(cases.size(), size_t(1))));
+
+		std::stable_sort(cases.begin(), cases.end(),
+		    [] (const TestCase & l, const TestCase & r)
+		    {
+			    return l.duration > r.duration;
+		    });
+
+		for (auto & c : cases) {
+			auto shard = std::min_element(shards.begin(), shards.end(),
+			    [] (const Shard & l, const Shard & r)
+			    {
+				    return l.load < r.load;
+			    });
+
+			shard->load += c.duration;
+			shard->cases.push_back(std::move(c));
+		}
+
+		return shards;
+	}
+}
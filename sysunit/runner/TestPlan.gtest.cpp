@@ -0,0 +1,135 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "TestPlan.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace SysUnit::internal;
+using testing::ElementsAre;
+
+TEST(TestPlanTest, TestParseList)
+{
+	std::istringstream list(
+	    "PacketPayloadTestSuite.\n"
+	    "  TestVectorPayload\n"
+	    "  DISABLED_TestSlow\n"
+	    "TcpLroTestSuite/0.  # TypeParam = IPv4\n"
+	    "  TestMerge2Tcp\n"
+	    "DISABLED_OtherSuite.\n"
+	    "  TestFoo\n"
+	    "ParamSuite.\n"
+	    "  TestBar/1  # GetParam() = 4\n");
+
+	EXPECT_THAT(ParseTestList(list), ElementsAre(
+	    "PacketPayloadTestSuite.TestVectorPayload",
+	    "TcpLroTestSuite/0.TestMerge2Tcp",
+	    "ParamSuite.TestBar/1"));
+}
+
+TEST(TestPlanTest, TestDurationsRoundTrip)
+{
+	DurationMap durations;
+	durations[{"a.testprog", "Suite.TestA"}] = 1.5;
+	durations[{"b.testprog", "Suite/1.TestB"}] = 0.25;
+
+	std::stringstream file;
+	WriteDurations(file, durations);
+
+	EXPECT_EQ(ReadDurations(file), durations);
+}
+
+TEST(TestPlanTest, TestEstimateUnknown)
+{
+	DurationMap durations;
+	durations[{"a", "A.x"}] = 1;
+	durations[{"a", "A.y"}] = 3;
+
+	std::vector<TestCase> cases = {
+		{"a", "A.x", 0},
+		{"a", "A.y", 0},
+		{"a", "A.new", 0},
+	};
+	EstimateDurations(cases, durations);
+
+	EXPECT_EQ(cases[0].duration, 1);
+	EXPECT_EQ(cases[1].duration, 3);
+	EXPECT_EQ(cases[2].duration, 2);
+}
+
+TEST(TestPlanTest, TestPlanBalanced)
+{
+	std::vector<TestCase> cases = {
+		{"a", "A.1", 1},
+		{"a", "A.5", 5},
+		{"b", "B.2", 2},
+		{"a", "A.4", 4},
+		{"b", "B.3", 3},
+		{"b", "B.5", 5},
+	};
+
+	auto shards = PlanShards(cases, 2);
+	ASSERT_EQ(shards.size(), 2);
+	EXPECT_EQ(shards[0].load, 10);
+	EXPECT_EQ(shards[1].load, 10);
+
+	size_t total = shards[0].cases.size() + shards[1].cases.size();
+	EXPECT_EQ(total, cases.size());
+}
+
+TEST(TestPlanTest, TestLongCaseGetsOwnShard)
+{
+	std::vector<TestCase> cases = {
+		{"a", "A.long", 100},
+		{"a", "A.1", 1},
+		{"a", "A.2", 1},
+		{"b", "B.3", 1},
+	};
+
+	auto shards = PlanShards(cases, 3);
+	ASSERT_EQ(shards.size(), 3);
+	EXPECT_EQ(shards[0].load, 100);
+	ASSERT_EQ(shards[0].cases.size(), 1);
+	EXPECT_EQ(shards[0].cases[0].name, "A.long");
+
+	EXPECT_EQ(shards[1].load + shards[2].load, 3);
+}
+
+TEST(TestPlanTest, TestMoreShardsThanCases)
+{
+	std::vector<TestCase> cases = {
+		{"a", "A.1", 1},
+	};
+
+	auto shards = PlanShards(cases, 8);
+	ASSERT_EQ(shards.size(), 1);
+	EXPECT_EQ(shards[0].cases.size(), 1);
+}
@@ -0,0 +1,85 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_RUNNER_TEST_PLAN_H
+#define SYSUNIT_RUNNER_TEST_PLAN_H
+
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SysUnit::internal
+{
+	struct TestCase
+	{
+		std::string program;
+
+		// The full gtest name of the case, e.g. "TcpLroTestSuite/0.TestMerge2Tcp"
+		std::string name;
+
+		// The expected run time of the case, in seconds.
+		double duration;
+	};
+
+	// The run time of each case, in seconds, keyed by program and case name.
+	typedef std::map<std::pair<std::string, std::string>, double> DurationMap;
+
+	// A set of cases that are run one after another by a single worker.
+	struct Shard
+	{
+		double load = 0;
+		std::vector<TestCase> cases;
+
+		// The names of the cases to run from each program.
+		std::map<std::string, std::vector<std::string>> GetCasesByProgram() const;
+	};
+
+	// Parse the output of --gtest_list_tests into a list of full case names,
+	// skipping disabled cases.
+	std::vector<std::string> ParseTestList(std::istream & in);
+
+	// The durations file has one case per line: the program, the case name
+	// and its duration in seconds, separated by tabs.
+	DurationMap ReadDurations(std::istream & in);
+	void WriteDurations(std::ostream & out, const DurationMap & durations);
+
+	// Set the expected duration of every case from its historical duration.
+	// Cases with no history are assumed to take as long as the average case.
+	void EstimateDurations(std::vector<TestCase> & cases,
+	    const DurationMap & durations);
+
+	// Distribute the cases over numShards shards so that the longest shard
+	// is as short as possible, by assigning the longest remaining case to the
+	// least loaded shard.
+	std::vector<Shard> PlanShards(std::vector<TestCase> cases, size_t numShards);
+}
+
+#endif
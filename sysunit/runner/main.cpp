@@ -0,0 +1,434 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "Process.h"
+#include "TestLog.h"
+#include "TestPlan.h"
+
+#include "sysunit/XmlReport.h"
+
+#include <deque>
+#include <errno.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace SysUnit::internal;
+
+namespace
+{
+	struct RunnerOptions
+	{
+		size_t jobs = 0;
+		std::string durations;
+		std::string output;
+		std::string workDir;
+		std::vector<std::string> programs;
+	};
+
+	// One run of a test program with a --gtest_filter selecting some of
+	// its cases.
+	struct Invocation
+	{
+		std::string program;
+		std::vector<std::string> cases;
+	};
+
+	struct RunningWorker
+	{
+		size_t shard;
+		Invocation invocation;
+		std::string logPath;
+		std::string xmlPath;
+	};
+
+	struct ProgramResult
+	{
+		std::string program;
+		CaseResult result;
+	};
+
+	std::string ReadFile(const std::string & path)
+	{
+		std::ifstream file(path);
+		std::ostringstream contents;
+
+		contents << file.rdbuf();
+		return contents.str();
+	}
+
+	double Now()
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec / 1e9;
+	}
+
+	class Runner
+	{
+	private:
+		const RunnerOptions & opts;
+		std::string workDir;
+		bool ownWorkDir;
+		std::vector<std::string> tempFiles;
+		size_t nextWorker;
+
+		std::vector<std::deque<Invocation>> queues;
+		std::map<pid_t, RunningWorker> running;
+
+		DurationMap durations;
+		std::vector<ProgramResult> results;
+		std::vector<std::string> suites;
+
+		void CreateWorkDir();
+		void RemoveWorkDir();
+		std::vector<TestCase> ListCases();
+		void StartNext(size_t shard);
+		void Finish(pid_t pid, int status);
+		void Record(const std::string & program, const CaseResult & result);
+		int Report(double elapsed);
+
+	public:
+		explicit Runner(const RunnerOptions & opts)
+		  : opts(opts),
+		    ownWorkDir(false),
+		    nextWorker(0)
+		{
+		}
+
+		int Run();
+	};
+
+	void Runner::CreateWorkDir()
+	{
+		if (!opts.workDir.empty()) {
+			workDir = opts.workDir;
+			return;
+		}
+
+		const char * tmp = getenv("TMPDIR");
+		std::string path = std::string(tmp != NULL ? tmp : "/tmp") +
+		    "/sysunit_runner.XXXXXX";
+		std::vector<char> buf(path.begin(), path.end());
+		buf.push_back('\0');
+
+		if (mkdtemp(buf.data()) == NULL)
+			throw std::runtime_error("mkdtemp " + path + ": " + strerror(errno));
+
+		workDir = buf.data();
+		ownWorkDir = true;
+	}
+
+	void Runner::RemoveWorkDir()
+	{
+		for (const auto & path : tempFiles)
+			unlink(path.c_str());
+
+		if (ownWorkDir)
+			rmdir(workDir.c_str());
+	}
+
+	std::vector<TestCase> Runner::ListCases()
+	{
+		std::vector<TestCase> cases;
+
+		for (const auto & program : opts.programs) {
+			std::istringstream list(RunAndCapture(program, {"--gtest_list_tests"}));
+
+			for (auto & name : ParseTestList(list))
+				cases.push_back({program, std::move(name), 0});
+		}
+
+		return cases;
+	}
+
+	void Runner::StartNext(size_t shard)
+	{
+		auto & queue = queues.at(shard);
+		if (queue.empty())
+			return;
+
+		RunningWorker worker;
+		worker.shard = shard;
+		worker.invocation = std::move(queue.front());
+		queue.pop_front();
+
+		std::string prefix = workDir + "/worker" + std::to_string(nextWorker++);
+		worker.logPath = prefix + ".log";
+		worker.xmlPath = prefix + ".xml";
+		tempFiles.push_back(worker.logPath);
+		tempFiles.push_back(worker.xmlPath);
+
+		std::string filter = "--gtest_filter=";
+		const char * sep = "";
+		for (const auto & name : worker.invocation.cases) {
+			filter += sep + name;
+			sep = ":";
+		}
+
+		pid_t pid = SpawnWorker(worker.invocation.program, {
+			filter,
+			"--gtest_output=xml:" + worker.xmlPath,
+			"--gtest_color=no",
+		    }, worker.logPath);
+
+		running[pid] = std::move(worker);
+	}
+
+	void Runner::Record(const std::string & program, const CaseResult & result)
+	{
+		durations[{program, result.name}] = result.seconds;
+		results.push_back({program, result});
+	}
+
+	void Runner::Finish(pid_t pid, int status)
+	{
+		RunningWorker worker = std::move(running.at(pid));
+		running.erase(pid);
+
+		const std::string & program = worker.invocation.program;
+		std::ifstream log(worker.logPath);
+		LogResult logResult = ParseTestLog(log);
+
+		// gtest exits with 1 if any case failed, but in either case
+		// it will have written a complete XML report.
+		bool completed = WIFEXITED(status) &&
+		    (WEXITSTATUS(status) == 0 || WEXITSTATUS(status) == 1);
+
+		std::vector<CaseResult> caseResults(std::move(logResult.finished));
+		if (logResult.interrupted) {
+			CaseResult & crashed = logResult.running;
+
+			crashed.failed = true;
+			crashed.output += "Worker " + DescribeStatus(status) +
+			    " while running this case\n";
+			caseResults.push_back(std::move(crashed));
+		}
+
+		std::set<std::string> done;
+		for (const auto & r : caseResults) {
+			done.insert(r.name);
+			Record(program, r);
+		}
+
+		std::string xmlSuites;
+		if (completed)
+			xmlSuites = ExtractTestSuites(ReadFile(worker.xmlPath));
+		if (xmlSuites.empty() && !caseResults.empty())
+			xmlSuites = MakeTestSuite(program, caseResults);
+		suites.push_back(xmlSuites);
+
+		Invocation rest{program, {}};
+		for (const auto & name : worker.invocation.cases) {
+			if (done.count(name) == 0)
+				rest.cases.push_back(name);
+		}
+
+		if (!rest.cases.empty()) {
+			if (!completed && !caseResults.empty()) {
+				// The worker crashed partway through.  Run the
+				// cases that it never got to in a new worker.
+				queues.at(worker.shard).push_front(std::move(rest));
+			} else {
+				std::vector<CaseResult> notRun;
+
+				for (const auto & name : rest.cases) {
+					CaseResult r;
+					r.name = name;
+					r.failed = true;
+					r.output = "Case did not run; worker " +
+					    DescribeStatus(status) + "\n";
+					Record(program, r);
+					notRun.push_back(r);
+				}
+				suites.push_back(MakeTestSuite(program, notRun));
+			}
+		}
+
+		StartNext(worker.shard);
+	}
+
+	int Runner::Report(double elapsed)
+	{
+		ReportTotals totals;
+
+		for (const auto & [program, r] : results) {
+			totals.tests++;
+			totals.seconds += r.seconds;
+			if (!r.failed)
+				continue;
+
+			totals.failures++;
+			std::cout << "[  FAILED  ] " << program << ": " << r.name << "\n"
+			    << r.output;
+		}
+
+		std::cout << "[==========] " << totals.tests << " cases from "
+		    << opts.programs.size() << " programs ran in "
+		    << queues.size() << " shards (" << elapsed << " s, "
+		    << totals.seconds << " s of test time)\n"
+		    << "[  PASSED  ] " << (totals.tests - totals.failures) << " cases\n";
+		if (totals.failures > 0)
+			std::cout << "[  FAILED  ] " << totals.failures << " cases\n";
+
+		if (!opts.output.empty()) {
+			std::ofstream out(opts.output);
+			if (!out)
+				throw std::runtime_error("Could not open " + opts.output);
+			WriteXmlReport(out, totals, suites);
+		}
+
+		if (!opts.durations.empty()) {
+			std::ofstream out(opts.durations);
+			if (!out)
+				throw std::runtime_error("Could not open " + opts.durations);
+			WriteDurations(out, durations);
+		}
+
+		return totals.failures > 0 ? 1 : 0;
+	}
+
+	int Runner::Run()
+	{
+		double start = Now();
+
+		std::vector<TestCase> cases = ListCases();
+
+		if (!opts.durations.empty()) {
+			std::ifstream file(opts.durations);
+			durations = ReadDurations(file);
+		}
+		EstimateDurations(cases, durations);
+
+		for (const auto & shard : PlanShards(cases, opts.jobs)) {
+			std::deque<Invocation> queue;
+
+			for (auto & [program, names] : shard.GetCasesByProgram())
+				queue.push_back({program, std::move(names)});
+			queues.push_back(std::move(queue));
+		}
+
+		CreateWorkDir();
+
+		for (size_t shard = 0; shard < queues.size(); ++shard)
+			StartNext(shard);
+
+		while (!running.empty()) {
+			int status;
+			pid_t pid = waitpid(-1, &status, 0);
+
+			if (pid < 0) {
+				if (errno == EINTR)
+					continue;
+				throw std::runtime_error(std::string("waitpid: ") + strerror(errno));
+			}
+
+			if (running.count(pid) != 0)
+				Finish(pid, status);
+		}
+
+		int ret = Report(Now() - start);
+		if (ret == 0)
+			RemoveWorkDir();
+		else
+			std::cout << "Worker logs are in " << workDir << "\n";
+
+		return ret;
+	}
+
+	bool ParseOption(const std::string & arg, const char * name,
+	    std::string & value)
+	{
+		std::string prefix = std::string("--") + name + "=";
+
+		if (arg.compare(0, prefix.size(), prefix) != 0)
+			return false;
+
+		value = arg.substr(prefix.size());
+		return true;
+	}
+
+	RunnerOptions ParseArgs(int argc, char **argv)
+	{
+		RunnerOptions opts;
+		std::string value;
+
+		for (int i = 1; i < argc; ++i) {
+			std::string arg(argv[i]);
+
+			if (ParseOption(arg, "jobs", value))
+				opts.jobs = std::stoul(value);
+			else if (ParseOption(arg, "durations", value))
+				opts.durations = value;
+			else if (ParseOption(arg, "output", value))
+				opts.output = value;
+			else if (ParseOption(arg, "work-dir", value))
+				opts.workDir = value;
+			else if (arg.compare(0, 2, "--") == 0)
+				throw std::runtime_error("Unknown argument " + arg);
+			else
+				opts.programs.push_back(arg);
+		}
+
+		if (opts.jobs == 0) {
+			long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+			opts.jobs = cpus > 0 ? cpus : 1;
+		}
+
+		if (opts.programs.empty())
+			throw std::runtime_error("No test programs given");
+
+		return opts;
+	}
+}
+
+// Run the cases from every test program given on the command line in
+// parallel worker processes.  Options:
+//   --jobs=N   --durations=FILE   --output=FILE.xml   --work-dir=DIR
+int
+main(int argc, char **argv)
+{
+	try {
+		RunnerOptions opts = ParseArgs(argc, argv);
+		Runner runner(opts);
+
+		return runner.Run();
+	} catch (const std::exception & e) {
+		std::cerr << argv[0] << ": " << e.what() << "\n";
+		return 2;
+	}
+}
@@ -0,0 +1,89 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef SYSUNIT_BENCH_RUNNER_H
+#define SYSUNIT_BENCH_RUNNER_H
+
+#include "sysunit/Benchmark.h"
+
+#include <map>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace SysUnit::internal
+{
+	struct BenchOptions
+	{
+		std::string format = "table";
+		std::string output;
+		std::string filter;
+		bool list = false;
+		size_t repetitions = 1;
+		size_t warmupIterations = 5;
+		size_t minIterations = 10;
+		double minTimeMs = 200;
+	};
+
+	struct BenchResult
+	{
+		std::string name;
+		uint64_t iterations = 0;
+		uint64_t items = 0;
+		double totalNs = 0;
+
+		// The time taken per item by each timed iteration, sorted.
+		std::vector<double> nsPerItem;
+
+		// The throughput of each repetition.
+		std::vector<double> repItemsPerSec;
+
+		std::map<std::string, double> counters;
+
+		double ItemsPerSec() const;
+		double MeanNsPerItem() const;
+		double Percentile(double p) const;
+		double RepStddev() const;
+	};
+
+	struct BenchEntry
+	{
+		std::string name;
+		BenchmarkFactory factory;
+	};
+
+	const std::vector<BenchEntry> & GetBenchmarks();
+
+	BenchResult RunBenchmark(const BenchEntry & entry, const BenchOptions & opts);
+
+	void PrintResults(std::ostream & out, const std::string & format,
+	    const std::vector<BenchResult> & results);
+}
+
+#endif
@@ -0,0 +1,8 @@
+
+LIB :=	sysunit_bench
+
+SRCS := \
+	benchmark.cpp \
+	main.cpp \
+	WorkerPool.cpp \
+
@@ -0,0 +1,154 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "sysunit/WorkerPool.h"
+
+#if defined(__FreeBSD__)
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#include <pthread_np.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <pthread.h>
+
+#include <algorithm>
+
+namespace SysUnit
+{
+	namespace
+	{
+		bool PinThread(std::thread & thread, size_t cpu)
+		{
+#if defined(__FreeBSD__)
+			cpuset_t set;
+
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return pthread_setaffinity_np(thread.native_handle(),
+			    sizeof(set), &set) == 0;
+#elif defined(__linux__)
+			cpu_set_t set;
+
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+			return pthread_setaffinity_np(thread.native_handle(),
+			    sizeof(set), &set) == 0;
+#else
+			return false;
+#endif
+		}
+	}
+
+	WorkerPool::WorkerPool(size_t workers, bool pin)
+	  : pinned(pin),
+	    job(nullptr),
+	    generation(0),
+	    running(0),
+	    stopping(false)
+	{
+		size_t ncpu = std::max(std::thread::hardware_concurrency(), 1U);
+
+		for (size_t i = 0; i < workers; ++i) {
+			threads.emplace_back(&WorkerPool::WorkerLoop, this, i);
+			if (pin && !PinThread(threads.back(), i % ncpu))
+				pinned = false;
+		}
+	}
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		startCv.notify_all();
+
+		for (auto & thread : threads)
+			thread.join();
+	}
+
+	void WorkerPool::WorkerLoop(size_t worker)
+	{
+		uint64_t seen = 0;
+
+		for (;;) {
+			const Job * current;
+
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				startCv.wait(guard, [&]
+				    {
+					return stopping || generation != seen;
+				    });
+				if (stopping)
+					return;
+				seen = generation;
+				current = job;
+			}
+
+			std::exception_ptr caught;
+			try {
+				(*current)(worker);
+			} catch (...) {
+				caught = std::current_exception();
+			}
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				if (caught && !error)
+					error = caught;
+				running--;
+			}
+			doneCv.notify_one();
+		}
+	}
+
+	void WorkerPool::Run(const Job & j)
+	{
+		std::exception_ptr caught;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+
+			job = &j;
+			running = threads.size();
+			generation++;
+			startCv.notify_all();
+
+			doneCv.wait(guard, [this] { return running == 0; });
+			job = nullptr;
+			caught = error;
+			error = nullptr;
+		}
+
+		if (caught)
+			std::rethrow_exception(caught);
+	}
+}
@@ -0,0 +1,370 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "sysunit/Benchmark.h"
+#include "sysunit/Initializer.h"
+#include "sysunit/PerfCounters.h"
+
+#include "BenchRunner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+namespace SysUnit
+{
+	namespace
+	{
+		using internal::BenchEntry;
+
+		std::vector<BenchEntry> & GetBenchList()
+		{
+			static std::vector<BenchEntry> benchList;
+
+			return benchList;
+		}
+	}
+
+	void RegisterBenchmark(const std::string & name, BenchmarkFactory factory)
+	{
+		GetBenchList().push_back({name, factory});
+	}
+
+	void Benchmark::BenchSetUp()
+	{
+	}
+
+	void Benchmark::BenchTearDown()
+	{
+	}
+
+	void Benchmark::IterationSetUp()
+	{
+	}
+
+	void Benchmark::IterationTearDown()
+	{
+	}
+}
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		struct IterationTime
+		{
+			double ns;
+			size_t items;
+		};
+
+		IterationTime RunIteration(Benchmark & bench)
+		{
+			bench.IterationSetUp();
+
+			auto start = Clock::now();
+			size_t items = bench.Iteration();
+			auto end = Clock::now();
+
+			bench.IterationTearDown();
+
+			return {std::chrono::duration<double, std::nano>(end - start).count(),
+			    items};
+		}
+
+		// Estimate how many iterations are needed for the timed run to
+		// last for at least opts.minTimeMs.  The iterations run here
+		// also serve as additional warmup.
+		size_t Calibrate(Benchmark & bench, const BenchOptions & opts)
+		{
+			const size_t MAX_ITERATIONS = 10000000;
+			double targetNs = opts.minTimeMs * 1e6;
+			double elapsed = 0;
+			size_t iterations = 0;
+			size_t batch = 1;
+
+			while (elapsed < targetNs / 10 && iterations < MAX_ITERATIONS) {
+				for (size_t i = 0; i < batch; ++i)
+					elapsed += RunIteration(bench).ns;
+				iterations += batch;
+				batch *= 2;
+			}
+
+			double perIteration = elapsed / iterations;
+			double needed = perIteration > 0 ? targetNs / perIteration : MAX_ITERATIONS;
+
+			return std::clamp(size_t(std::ceil(needed)), opts.minIterations,
+			    MAX_ITERATIONS);
+		}
+	}
+
+	const std::vector<BenchEntry> & GetBenchmarks()
+	{
+		return GetBenchList();
+	}
+
+	double BenchResult::ItemsPerSec() const
+	{
+		return totalNs > 0 ? items * 1e9 / totalNs : 0;
+	}
+
+	double BenchResult::MeanNsPerItem() const
+	{
+		return items > 0 ? totalNs / items : 0;
+	}
+
+	// Nearest-rank percentile of the per-item iteration times.
+	double BenchResult::Percentile(double p) const
+	{
+		if (nsPerItem.empty())
+			return 0;
+
+		size_t rank = size_t(std::ceil(p / 100 * nsPerItem.size()));
+		rank = std::clamp(rank, size_t(1), nsPerItem.size());
+		return nsPerItem[rank - 1];
+	}
+
+	double BenchResult::RepStddev() const
+	{
+		size_t n = repItemsPerSec.size();
+		if (n < 2)
+			return 0;
+
+		double mean = 0;
+		for (double x : repItemsPerSec)
+			mean += x;
+		mean /= n;
+
+		double sq = 0;
+		for (double x : repItemsPerSec)
+			sq += (x - mean) * (x - mean);
+		return std::sqrt(sq / (n - 1));
+	}
+
+	namespace
+	{
+		// Report the per-item average of each hardware event in each
+		// PerfScope region as a benchmark counter.
+		void AddPerfCounters(BenchResult & result, const PerfRegionMap & regions)
+		{
+			for (const auto & [name, stats] : regions) {
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					auto event = static_cast<PerfEvent>(i);
+					if (!PerfEventAvailable(event))
+						continue;
+
+					std::string key = name + "." + PerfEventName(event) + "/item";
+					result.counters[key] = stats.PerItem(event);
+				}
+			}
+		}
+	}
+
+	BenchResult RunBenchmark(const BenchEntry & entry, const BenchOptions & opts)
+	{
+		BenchResult result;
+		PerfRegionMap perfRegions;
+		// The sum of each counter and the number of repetitions that
+		// set it.
+		std::map<std::string, std::pair<double, size_t>> counterSums;
+
+		result.name = entry.name;
+
+		for (size_t rep = 0; rep < opts.repetitions; ++rep) {
+			SetUpInitializers();
+
+			// The benchmark must be destroyed before the Initializers
+			// are torn down, as it may hold resources (mbufs, zones)
+			// that they own.
+			{
+				std::unique_ptr<Benchmark> bench(entry.factory());
+				double repNs = 0;
+				uint64_t repItems = 0;
+
+				bench->BenchSetUp();
+
+				for (size_t i = 0; i < opts.warmupIterations; ++i)
+					RunIteration(*bench);
+
+				size_t iterations = Calibrate(*bench, opts);
+				ResetPerfRegions();
+				for (size_t i = 0; i < iterations; ++i) {
+					IterationTime t = RunIteration(*bench);
+
+					result.nsPerItem.push_back(t.ns / std::max(t.items, size_t(1)));
+					repNs += t.ns;
+					repItems += t.items;
+				}
+
+				for (const auto & [name, stats] : GetPerfRegions())
+					perfRegions[name] += stats;
+
+				bench->BenchTearDown();
+
+				result.iterations += iterations;
+				result.items += repItems;
+				result.totalNs += repNs;
+				result.repItemsPerSec.push_back(repNs > 0 ? repItems * 1e9 / repNs : 0);
+				for (const auto & [name, value] : bench->GetCounters()) {
+					auto & sum = counterSums[name];
+					sum.first += value;
+					sum.second++;
+				}
+			}
+
+			TearDownInitializers();
+		}
+
+		for (const auto & [name, sum] : counterSums)
+			result.counters[name] = sum.first / sum.second;
+
+		AddPerfCounters(result, perfRegions);
+		std::sort(result.nsPerItem.begin(), result.nsPerItem.end());
+		return result;
+	}
+
+	namespace
+	{
+		void PrintTable(std::ostream & out, const std::vector<BenchResult> & results)
+		{
+			size_t width = 10;
+			for (const auto & r : results)
+				width = std::max(width, r.name.size() + 2);
+
+			out << std::left << std::setw(width) << "benchmark" << std::right
+			    << std::setw(10) << "iters"
+			    << std::setw(14) << "items/s"
+			    << std::setw(10) << "mean ns"
+			    << std::setw(10) << "p50"
+			    << std::setw(10) << "p90"
+			    << std::setw(10) << "p99"
+			    << std::setw(10) << "max"
+			    << "  counters\n";
+
+			out << std::fixed;
+			for (const auto & r : results) {
+				out << std::left << std::setw(width) << r.name << std::right
+				    << std::setw(10) << r.iterations
+				    << std::setprecision(0) << std::setw(14) << r.ItemsPerSec()
+				    << std::setprecision(1)
+				    << std::setw(10) << r.MeanNsPerItem()
+				    << std::setw(10) << r.Percentile(50)
+				    << std::setw(10) << r.Percentile(90)
+				    << std::setw(10) << r.Percentile(99)
+				    << std::setw(10) << r.Percentile(100)
+				    << " ";
+
+				out << std::setprecision(2);
+				for (const auto & [name, value] : r.counters)
+					out << " " << name << "=" << value;
+				out << "\n";
+			}
+		}
+
+		void PrintCsv(std::ostream & out, const std::vector<BenchResult> & results)
+		{
+			out << "name,iterations,items,items_per_sec,items_per_sec_stddev,"
+			    << "ns_per_item_mean,ns_per_item_p50,ns_per_item_p90,"
+			    << "ns_per_item_p99,ns_per_item_min,ns_per_item_max,counters\n";
+
+			for (const auto & r : results) {
+				out << r.name << "," << r.iterations << "," << r.items << ","
+				    << r.ItemsPerSec() << "," << r.RepStddev() << ","
+				    << r.MeanNsPerItem() << "," << r.Percentile(50) << ","
+				    << r.Percentile(90) << "," << r.Percentile(99) << ","
+				    << r.Percentile(0) << "," << r.Percentile(100) << ",";
+
+				const char * sep = "";
+				for (const auto & [name, value] : r.counters) {
+					out << sep << name << "=" << value;
+					sep = ";";
+				}
+				out << "\n";
+			}
+		}
+
+		// JSON has no representation for infinities or NaN, which a
+		// counter can easily produce (e.g. by dividing by a count of 0).
+		struct JsonNumber
+		{
+			double value;
+		};
+
+		std::ostream & operator<<(std::ostream & out, JsonNumber n)
+		{
+			if (!std::isfinite(n.value))
+				return out << "null";
+			return out << n.value;
+		}
+
+		void PrintJson(std::ostream & out, const std::vector<BenchResult> & results)
+		{
+			const char * sep = "";
+
+			out << "{\n  \"results\": [";
+			for (const auto & r : results) {
+				out << sep << "\n    {"
+				    << "\"name\": \"" << r.name << "\", "
+				    << "\"iterations\": " << r.iterations << ", "
+				    << "\"items\": " << r.items << ", "
+				    << "\"items_per_sec\": " << JsonNumber{r.ItemsPerSec()} << ", "
+				    << "\"items_per_sec_stddev\": " << JsonNumber{r.RepStddev()} << ", "
+				    << "\"ns_per_item\": {"
+				    << "\"mean\": " << JsonNumber{r.MeanNsPerItem()} << ", "
+				    << "\"p50\": " << JsonNumber{r.Percentile(50)} << ", "
+				    << "\"p90\": " << JsonNumber{r.Percentile(90)} << ", "
+				    << "\"p99\": " << JsonNumber{r.Percentile(99)} << ", "
+				    << "\"min\": " << JsonNumber{r.Percentile(0)} << ", "
+				    << "\"max\": " << JsonNumber{r.Percentile(100)} << "}, "
+				    << "\"counters\": {";
+
+				const char * csep = "";
+				for (const auto & [name, value] : r.counters) {
+					out << csep << "\"" << name << "\": " << JsonNumber{value};
+					csep = ", ";
+				}
+				out << "}}";
+				sep = ",";
+			}
+			out << "\n  ]\n}\n";
+		}
+	}
+
+	void PrintResults(std::ostream & out, const std::string & format,
+	    const std::vector<BenchResult> & results)
+	{
+		if (format == "csv")
+			PrintCsv(out, results);
+		else if (format == "json")
+			PrintJson(out, results);
+		else
+			PrintTable(out, results);
+	}
+}
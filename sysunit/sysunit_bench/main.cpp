@@ -0,0 +1,131 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "BenchRunner.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace SysUnit::internal;
+
+namespace
+{
+	bool ParseOption(const std::string & arg, const char * name,
+	    std::string & value)
+	{
+		std::string prefix = std::string("--") + name + "=";
+
+		if (arg.compare(0, prefix.size(), prefix) != 0)
+			return false;
+
+		value = arg.substr(prefix.size());
+		return true;
+	}
+
+	BenchOptions ParseArgs(int argc, char **argv)
+	{
+		BenchOptions opts;
+		std::string value;
+
+		for (int i = 1; i < argc; ++i) {
+			std::string arg(argv[i]);
+
+			if (arg == "--list")
+				opts.list = true;
+			else if (ParseOption(arg, "format", value))
+				opts.format = value;
+			else if (ParseOption(arg, "output", value))
+				opts.output = value;
+			else if (ParseOption(arg, "filter", value))
+				opts.filter = value;
+			else if (ParseOption(arg, "repetitions", value))
+				opts.repetitions = std::stoul(value);
+			else if (ParseOption(arg, "warmup", value))
+				opts.warmupIterations = std::stoul(value);
+			else if (ParseOption(arg, "min-iterations", value))
+				opts.minIterations = std::stoul(value);
+			else if (ParseOption(arg, "min-time-ms", value))
+				opts.minTimeMs = std::stod(value);
+			else
+				throw std::runtime_error("Unknown argument " + arg);
+		}
+
+		if (opts.format != "table" && opts.format != "csv" &&
+		    opts.format != "json")
+			throw std::runtime_error("Unknown format " + opts.format);
+
+		if (opts.repetitions == 0 || opts.minIterations == 0)
+			throw std::runtime_error("repetitions and min-iterations must be non-zero");
+
+		return opts;
+	}
+}
+
+// Run every registered benchmark (optionally only those whose name contains
+// --filter) and report the results.  Options:
+//   --list   --format=table|csv|json   --output=FILE   --filter=SUBSTRING
+//   --repetitions=N   --warmup=N   --min-iterations=N   --min-time-ms=MS
+int
+main(int argc, char **argv)
+{
+	try {
+		BenchOptions opts = ParseArgs(argc, argv);
+		std::vector<BenchResult> results;
+
+		for (const auto & entry : GetBenchmarks()) {
+			if (entry.name.find(opts.filter) == std::string::npos)
+				continue;
+
+			if (opts.list)
+				std::cout << entry.name << "\n";
+			else
+				results.push_back(RunBenchmark(entry, opts));
+		}
+
+		if (opts.list)
+			return 0;
+
+		std::ofstream file;
+		if (!opts.output.empty()) {
+			file.open(opts.output);
+			if (!file)
+				throw std::runtime_error("Could not open " + opts.output);
+		}
+		std::ostream & out = opts.output.empty() ? std::cout : file;
+
+		PrintResults(out, opts.format, results);
+	} catch (const std::exception & e) {
+		std::cerr << argv[0] << ": " << e.what() << "\n";
+		return 1;
+	}
+
+	return 0;
+}
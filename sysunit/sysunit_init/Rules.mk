@@ -3,3 +3,4 @@ LIB :=	sysunit_init
 
 SRCS := \
 	init.cpp \
+	perf.cpp \
@@ -27,8 +27,10 @@
  */
 
 #include "sysunit/Initializer.h"
+#include "sysunit/PerfCounters.h"
 #include "sysunit/TestSuite.h"
 
+#include <iostream>
 #include <vector>
 
 namespace SysUnit {
@@ -52,6 +54,31 @@ namespace SysUnit {
 		}
 
 		bool initialized = false;
+
+		// Report the per-item averages of any PerfScope regions that the
+		// test used, both on stdout and as properties in the test
+		// results.
+		void ReportPerfRegions()
+		{
+			const auto & regions = GetPerfRegions();
+			if (regions.empty())
+				return;
+
+			for (const auto & [name, stats] : regions) {
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					auto event = static_cast<PerfEvent>(i);
+					if (!PerfEventAvailable(event))
+						continue;
+
+					std::string key = name + "." + PerfEventName(event) +
+					    "_per_item";
+					testing::Test::RecordProperty(key,
+					    std::to_string(stats.PerItem(event)));
+				}
+			}
+
+			PrintPerfRegions(std::cout, regions);
+		}
 	}
 
 	Initializer::Initializer(int subsystem, int order)
@@ -63,7 +90,7 @@ namespace SysUnit {
 		GetInitList().push_back(this);
 	}
 
-	void TestSuite::SetUp()
+	void SetUpInitializers()
 	{
 		auto & initList(GetInitList());
 		std::sort(initList.begin(), initList.end(), InitializerComp());
@@ -71,6 +98,19 @@ namespace SysUnit {
 		for (auto * init : initList)
 			init->SetUp();
 		initialized = true;
+	}
+
+	void TearDownInitializers()
+	{
+		for (auto it = GetInitList().rbegin();
+		    it != GetInitList().rend(); ++it)
+		     (*it)->TearDown();
+	}
+
+	void TestSuite::SetUp()
+	{
+		SetUpInitializers();
+		ResetPerfRegions();
 
 		TestCaseSetUp();
 	}
@@ -79,9 +119,8 @@ namespace SysUnit {
 	{
 		TestCaseTearDown();
 
-		for (auto it = GetInitList().rbegin();
-		    it != GetInitList().rend(); ++it)
-		     (*it)->TearDown();
+		ReportPerfRegions();
+		TearDownInitializers();
 	}
 
 	void TestSuite::TestCaseSetUp()
@@ -0,0 +1,395 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "sysunit/PerfCounters.h"
+
+#include <errno.h>
+#include <iomanip>
+#include <iostream>
+#include <string.h>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__FreeBSD__)
+#include <pmc.h>
+#endif
+
+namespace SysUnit {
+
+	namespace {
+		// The hardware counters for every event that could be opened.
+		// Events that can't be opened are left out.
+		class PerfCounterGroup
+		{
+		private:
+			std::array<bool, NUM_PERF_EVENTS> available;
+			size_t numOpen;
+
+			// Why the first event that failed to open failed, for the
+			// notice printed if none could be opened.
+			std::string error;
+
+#if defined(__linux__)
+			// On Linux, the counters form a perf event group, which
+			// is scheduled onto the PMU as a whole, so that the
+			// counts for different events cover exactly the same
+			// instructions.
+			std::array<int, NUM_PERF_EVENTS> fds;
+
+			// The position of each event in the values returned by
+			// reading the group leader.
+			std::array<int, NUM_PERF_EVENTS> slots;
+
+			int leader;
+
+			static uint64_t GetConfig(size_t event)
+			{
+				switch (static_cast<PerfEvent>(event)) {
+				case PerfEvent::CYCLES:
+					return PERF_COUNT_HW_CPU_CYCLES;
+				case PerfEvent::INSTRUCTIONS:
+					return PERF_COUNT_HW_INSTRUCTIONS;
+				case PerfEvent::CACHE_MISSES:
+					return PERF_COUNT_HW_CACHE_MISSES;
+				case PerfEvent::BRANCH_MISSES:
+					return PERF_COUNT_HW_BRANCH_MISSES;
+				}
+				return 0;
+			}
+
+			void Open()
+			{
+				fds.fill(-1);
+				slots.fill(-1);
+				leader = -1;
+
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					struct perf_event_attr attr = {};
+
+					attr.type = PERF_TYPE_HARDWARE;
+					attr.size = sizeof(attr);
+					attr.config = GetConfig(i);
+					attr.read_format = PERF_FORMAT_GROUP |
+					    PERF_FORMAT_TOTAL_TIME_ENABLED |
+					    PERF_FORMAT_TOTAL_TIME_RUNNING;
+					attr.exclude_kernel = 1;
+					attr.exclude_hv = 1;
+
+					int fd = syscall(SYS_perf_event_open, &attr, 0, -1,
+					    leader, PERF_FLAG_FD_CLOEXEC);
+					if (fd < 0) {
+						if (error.empty())
+							error = std::string("perf_event_open: ") +
+							    strerror(errno);
+						continue;
+					}
+
+					if (leader < 0)
+						leader = fd;
+					fds[i] = fd;
+					slots[i] = numOpen;
+					available[i] = true;
+					numOpen++;
+				}
+			}
+
+			void Close()
+			{
+				for (int fd : fds) {
+					if (fd >= 0)
+						close(fd);
+				}
+			}
+
+			void ReadCounters(PerfCounts & counts)
+			{
+				// The layout of a PERF_FORMAT_GROUP read: the
+				// number of events, the time enabled and running,
+				// and then the value of each event.
+				uint64_t buf[3 + NUM_PERF_EVENTS];
+
+				ssize_t len = read(leader, buf, sizeof(buf));
+				if (len < ssize_t((3 + numOpen) * sizeof(uint64_t)))
+					return;
+
+				uint64_t enabled = buf[1];
+				uint64_t running = buf[2];
+
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					if (slots[i] < 0)
+						continue;
+
+					uint64_t value = buf[3 + slots[i]];
+
+					// If the group was multiplexed with other
+					// users of the PMU, extrapolate the count
+					// to the whole time that it was enabled.
+					if (running > 0 && running < enabled)
+						value = double(value) * enabled / running;
+					counts.values[i] = value;
+				}
+			}
+#elif defined(__FreeBSD__)
+			// On FreeBSD, each event is a separate process-virtual
+			// PMC from hwpmc(4), attached to this process.
+			std::array<pmc_id_t, NUM_PERF_EVENTS> pmcs;
+
+			// libpmc's aliases for the events, which it maps onto the
+			// host CPU's own events.  The "cycles" alias is the TSC,
+			// which can only be used system-wide, so use the core
+			// clock instead.
+			static const char * GetSpec(size_t event)
+			{
+				switch (static_cast<PerfEvent>(event)) {
+				case PerfEvent::CYCLES:
+					return "unhalted-cycles";
+				case PerfEvent::INSTRUCTIONS:
+					return "instructions";
+				case PerfEvent::CACHE_MISSES:
+					return "LLC-MISSES";
+				case PerfEvent::BRANCH_MISSES:
+					return "branch-mispredicts";
+				}
+				return "";
+			}
+
+			bool Allocate(const std::string & spec, pmc_id_t & id)
+			{
+				if (pmc_allocate(spec.c_str(), PMC_MODE_TC, 0,
+				    PMC_CPU_ANY, &id, 0) != 0)
+					return false;
+
+				if (pmc_attach(id, 0) != 0 || pmc_start(id) != 0) {
+					pmc_release(id);
+					return false;
+				}
+				return true;
+			}
+
+			void Open()
+			{
+				if (pmc_init() != 0) {
+					error = std::string("pmc_init: ") + strerror(errno) +
+					    "; is the hwpmc module loaded?";
+					return;
+				}
+
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					std::string spec(GetSpec(i));
+
+					// Count only user-mode events if the CPU's
+					// event accepts the qualifier.
+					if (!Allocate(spec + ",usr", pmcs[i]) &&
+					    !Allocate(spec, pmcs[i])) {
+						if (error.empty())
+							error = "pmc_allocate(" + spec + "): " +
+							    strerror(errno);
+						continue;
+					}
+
+					available[i] = true;
+					numOpen++;
+				}
+			}
+
+			void Close()
+			{
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					if (available[i])
+						pmc_release(pmcs[i]);
+				}
+			}
+
+			void ReadCounters(PerfCounts & counts)
+			{
+				// hwpmc has no equivalent of a perf event group,
+				// so the events are read one at a time.
+				for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+					pmc_value_t value;
+
+					if (available[i] && pmc_read(pmcs[i], &value) == 0)
+						counts.values[i] = value;
+				}
+			}
+#else
+			void Open()
+			{
+				error = "not supported on this platform";
+			}
+
+			void Close()
+			{
+			}
+
+			void ReadCounters(PerfCounts & counts)
+			{
+			}
+#endif
+
+		public:
+			PerfCounterGroup()
+			  : numOpen(0)
+			{
+				available.fill(false);
+				Open();
+
+				// Benchmarks and tests leave out the columns of
+				// events that aren't available, so explain why
+				// they are missing.
+				if (numOpen == 0)
+					std::cerr << "sysunit: no hardware performance "
+					    << "counters are available (" << error
+					    << "), so PerfScope regions only count calls "
+					    << "and items" << std::endl;
+			}
+
+			~PerfCounterGroup()
+			{
+				Close();
+			}
+
+			PerfCounterGroup(const PerfCounterGroup &) = delete;
+			PerfCounterGroup & operator=(const PerfCounterGroup &) = delete;
+
+			bool Available(PerfEvent event) const
+			{
+				return available[static_cast<size_t>(event)];
+			}
+
+			void Read(PerfCounts & counts)
+			{
+				counts = PerfCounts();
+				if (numOpen > 0)
+					ReadCounters(counts);
+			}
+		};
+
+		PerfCounterGroup & GetCounterGroup()
+		{
+			static PerfCounterGroup group;
+
+			return group;
+		}
+
+		PerfRegionMap & GetRegionMap()
+		{
+			static PerfRegionMap regions;
+
+			return regions;
+		}
+	}
+
+	const char * PerfEventName(PerfEvent event)
+	{
+		switch (event) {
+		case PerfEvent::CYCLES:
+			return "cycles";
+		case PerfEvent::INSTRUCTIONS:
+			return "instructions";
+		case PerfEvent::CACHE_MISSES:
+			return "cache_misses";
+		case PerfEvent::BRANCH_MISSES:
+			return "branch_misses";
+		}
+		return "unknown";
+	}
+
+	bool PerfEventAvailable(PerfEvent event)
+	{
+		return GetCounterGroup().Available(event);
+	}
+
+	PerfScope::PerfScope(const char * region, size_t items)
+	  : region(region),
+	    items(items)
+	{
+		GetCounterGroup().Read(start);
+	}
+
+	PerfScope::~PerfScope()
+	{
+		PerfCounts end;
+
+		GetCounterGroup().Read(end);
+
+		PerfRegionStats & stats = GetRegionMap()[region];
+		stats.calls++;
+		stats.items += items;
+		for (size_t i = 0; i < NUM_PERF_EVENTS; ++i)
+			stats.counts.values[i] += end.values[i] - start.values[i];
+	}
+
+	const PerfRegionMap & GetPerfRegions()
+	{
+		return GetRegionMap();
+	}
+
+	void ResetPerfRegions()
+	{
+		GetRegionMap().clear();
+	}
+
+	void PrintPerfRegions(std::ostream & out, const PerfRegionMap & regions)
+	{
+		out << std::left << std::setw(16) << "region" << std::right
+		    << std::setw(10) << "calls"
+		    << std::setw(10) << "items";
+		for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+			std::string name(PerfEventName(static_cast<PerfEvent>(i)));
+			out << std::setw(20) << (name + "/item");
+		}
+		out << "\n";
+
+		auto flags = out.flags();
+		auto precision = out.precision();
+
+		out << std::fixed << std::setprecision(1);
+		for (const auto & [name, stats] : regions) {
+			out << std::left << std::setw(16) << name << std::right
+			    << std::setw(10) << stats.calls
+			    << std::setw(10) << stats.items;
+
+			for (size_t i = 0; i < NUM_PERF_EVENTS; ++i) {
+				auto event = static_cast<PerfEvent>(i);
+
+				out << std::setw(20);
+				if (PerfEventAvailable(event))
+					out << stats.PerItem(event);
+				else
+					out << "n/a";
+			}
+			out << "\n";
+		}
+
+		out.flags(flags);
+		out.precision(precision);
+	}
+}
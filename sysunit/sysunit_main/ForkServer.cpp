@@ -0,0 +1,512 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "ForkServer.h"
+
+#include "sysunit/XmlReport.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <errno.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace SysUnit::internal
+{
+	namespace
+	{
+		enum class MessageType : uint32_t
+		{
+			CASE_START,
+			CASE_FAILURE,
+			CASE_END,
+		};
+
+		// The child reports each event to the parent as a header
+		// followed by len bytes of text.
+		struct MessageHeader
+		{
+			MessageType type;
+			uint32_t passed;
+			int64_t elapsedMs;
+			uint32_t len;
+		};
+
+		bool WriteAll(int fd, const void * buf, size_t len)
+		{
+			auto * p = static_cast<const char *>(buf);
+
+			while (len > 0) {
+				ssize_t written = write(fd, p, len);
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				p += written;
+				len -= written;
+			}
+			return true;
+		}
+
+		// Returns false at EOF.
+		bool ReadAll(int fd, void * buf, size_t len)
+		{
+			auto * p = static_cast<char *>(buf);
+
+			while (len > 0) {
+				ssize_t got = read(fd, p, len);
+				if (got < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				if (got == 0)
+					return false;
+				p += got;
+				len -= got;
+			}
+			return true;
+		}
+
+		std::string FullName(const testing::TestInfo & info)
+		{
+			return std::string(info.test_case_name()) + "." + info.name();
+		}
+
+		// Installed in each child in place of gtest's console output.
+		class PipeReporter : public testing::EmptyTestEventListener
+		{
+		private:
+			int fd;
+
+			void Send(MessageType type, const std::string & text,
+			    bool passed = false, int64_t elapsedMs = 0)
+			{
+				MessageHeader header = {type, passed, elapsedMs,
+				    uint32_t(text.size())};
+
+				// Anything that the test printed must come out
+				// before the parent prints the case's result.
+				fflush(stdout);
+				fflush(stderr);
+				std::cout.flush();
+				std::cerr.flush();
+
+				WriteAll(fd, &header, sizeof(header));
+				WriteAll(fd, text.data(), text.size());
+			}
+
+		public:
+			explicit PipeReporter(int fd)
+			  : fd(fd)
+			{
+			}
+
+			void OnTestStart(const testing::TestInfo & info) override
+			{
+				Send(MessageType::CASE_START, FullName(info));
+			}
+
+			void OnTestPartResult(const testing::TestPartResult & result) override
+			{
+				if (!result.failed())
+					return;
+
+				std::string text;
+				if (result.file_name() != NULL)
+					text = std::string(result.file_name()) + ":" +
+					    std::to_string(result.line_number()) + ": ";
+				text += "Failure\n";
+				text += result.message();
+				text += "\n";
+
+				Send(MessageType::CASE_FAILURE, text);
+			}
+
+			void OnTestEnd(const testing::TestInfo & info) override
+			{
+				Send(MessageType::CASE_END, FullName(info),
+				    info.result()->Passed(), info.result()->elapsed_time());
+			}
+		};
+
+		// gtest's filter syntax: ':'-separated positive patterns,
+		// optionally followed by '-' and ':'-separated negative patterns.
+		bool GlobMatch(const char * pattern, const char * str)
+		{
+			switch (*pattern) {
+			case '\0':
+			case ':':
+				return *str == '\0';
+			case '?':
+				return *str != '\0' && GlobMatch(pattern + 1, str + 1);
+			case '*':
+				return (*str != '\0' && GlobMatch(pattern, str + 1)) ||
+				    GlobMatch(pattern + 1, str);
+			default:
+				return *pattern == *str && GlobMatch(pattern + 1, str + 1);
+			}
+		}
+
+		bool MatchesAnyPattern(const std::string & patterns, const std::string & name)
+		{
+			size_t start = 0;
+
+			while (true) {
+				if (GlobMatch(patterns.c_str() + start, name.c_str()))
+					return true;
+
+				size_t colon = patterns.find(':', start);
+				if (colon == std::string::npos)
+					return false;
+				start = colon + 1;
+			}
+		}
+
+		bool MatchesFilter(const std::string & filter, const std::string & name)
+		{
+			size_t dash = filter.find('-');
+			std::string positive = filter.substr(0, dash);
+			std::string negative = dash == std::string::npos ?
+			    "" : filter.substr(dash + 1);
+
+			if (positive.empty())
+				positive = "*";
+
+			return MatchesAnyPattern(positive, name) &&
+			    (negative.empty() || !MatchesAnyPattern(negative, name));
+		}
+
+		bool IsDisabled(const char * name)
+		{
+			return strncmp(name, "DISABLED_", 9) == 0;
+		}
+
+		std::vector<CaseResult> GetSelectedCases()
+		{
+			const testing::UnitTest & unitTest = *testing::UnitTest::GetInstance();
+			std::string filter = ::testing::GTEST_FLAG(filter);
+			bool runDisabled = ::testing::GTEST_FLAG(also_run_disabled_tests);
+			std::vector<CaseResult> cases;
+
+			for (int i = 0; i < unitTest.total_test_case_count(); ++i) {
+				const testing::TestCase & testCase = *unitTest.GetTestCase(i);
+
+				for (int j = 0; j < testCase.total_test_count(); ++j) {
+					const testing::TestInfo & info = *testCase.GetTestInfo(j);
+
+					if (!runDisabled &&
+					    (IsDisabled(info.test_case_name()) ||
+					     IsDisabled(info.name())))
+						continue;
+
+					CaseResult c;
+					c.name = FullName(info);
+					if (MatchesFilter(filter, c.name))
+						cases.push_back(c);
+				}
+			}
+
+			return cases;
+		}
+
+		[[noreturn]] void RunChild(int fd, const std::string & filter)
+		{
+			struct rlimit limit = {0, 0};
+			setrlimit(RLIMIT_CORE, &limit);
+
+			::testing::GTEST_FLAG(filter) = filter;
+			::testing::GTEST_FLAG(output) = "";
+
+			testing::TestEventListeners & listeners =
+			    testing::UnitTest::GetInstance()->listeners();
+			delete listeners.Release(listeners.default_result_printer());
+			delete listeners.Release(listeners.default_xml_generator());
+			listeners.Append(new PipeReporter(fd));
+
+			int ret = RUN_ALL_TESTS();
+			close(fd);
+			exit(ret);
+		}
+
+		std::string DescribeStatus(int status)
+		{
+			if (WIFSIGNALED(status))
+				return "killed by signal " + std::to_string(WTERMSIG(status)) +
+				    " (" + strsignal(WTERMSIG(status)) + ")";
+			return "exited with status " + std::to_string(WEXITSTATUS(status));
+		}
+
+		void PrintEnd(const CaseResult & c)
+		{
+			std::cout << (c.failed ? "[  FAILED  ] " : "[       OK ] ")
+			    << c.name << " (" << std::llround(c.seconds * 1000) << " ms)"
+			    << std::endl;
+		}
+
+		void FailCase(CaseResult & c, const std::string & text)
+		{
+			c.failed = true;
+			c.output += text;
+			std::cout << "[ RUN      ] " << c.name << std::endl << text;
+			PrintEnd(c);
+		}
+
+		// Run the cases at the given indices in a child process, and
+		// return the indices of the cases that are finished with.  gtest
+		// may run the cases in any order (e.g. with --gtest_shuffle), or
+		// more than once (with --gtest_repeat), so each message is
+		// matched to its case by the name that it carries.
+		std::set<size_t> RunBatch(std::vector<CaseResult> & cases,
+		    const std::vector<size_t> & batch)
+		{
+			std::map<std::string, size_t> byName;
+			std::string filter;
+			for (size_t i : batch) {
+				byName[cases[i].name] = i;
+				if (!filter.empty())
+					filter += ":";
+				filter += cases[i].name;
+			}
+
+			int fds[2];
+			if (pipe(fds) != 0) {
+				perror("pipe");
+				exit(1);
+			}
+
+			std::cout.flush();
+			fflush(stdout);
+
+			pid_t pid = fork();
+			if (pid < 0) {
+				perror("fork");
+				exit(1);
+			}
+
+			if (pid == 0) {
+				close(fds[0]);
+				RunChild(fds[1], filter);
+			}
+
+			close(fds[1]);
+
+			std::set<size_t> started;
+			CaseResult * current = NULL;
+			CaseResult * last = NULL;
+			MessageHeader header;
+
+			while (ReadAll(fds[0], &header, sizeof(header))) {
+				std::string text(header.len, '\0');
+				if (!ReadAll(fds[0], &text[0], header.len))
+					break;
+
+				switch (header.type) {
+				case MessageType::CASE_START: {
+					auto it = byName.find(text);
+					if (it == byName.end()) {
+						current = NULL;
+						break;
+					}
+					current = &cases[it->second];
+					started.insert(it->second);
+					std::cout << "[ RUN      ] " << current->name << std::endl;
+					break;
+				}
+				case MessageType::CASE_FAILURE:
+					if (current == NULL)
+						break;
+					current->output += text;
+					std::cout << text;
+					break;
+				case MessageType::CASE_END:
+					if (current == NULL)
+						break;
+					// A repeated case fails if any of its runs did.
+					current->failed = current->failed || !header.passed;
+					current->seconds += header.elapsedMs / 1000.0;
+					PrintEnd(*current);
+					last = current;
+					current = NULL;
+					break;
+				}
+			}
+			close(fds[0]);
+
+			int status;
+			while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+				;
+
+			bool crashed = !WIFEXITED(status) ||
+			    (WEXITSTATUS(status) != 0 && WEXITSTATUS(status) != 1);
+
+			if (current != NULL) {
+				std::string text = "Test process " + DescribeStatus(status) +
+				    " while running this case\n";
+
+				current->failed = true;
+				current->output += text;
+				std::cout << text;
+				PrintEnd(*current);
+			} else if (started.empty()) {
+				// The child died before it could run anything,
+				// so fail the whole batch rather than retrying it
+				// forever.
+				for (size_t i : batch) {
+					FailCase(cases[i], "Test process " +
+					    DescribeStatus(status) + " before running this case\n");
+					started.insert(i);
+				}
+			} else if (!crashed) {
+				// The child exited normally, so any case that it
+				// didn't report will not be run by retrying it.
+				for (size_t i : batch) {
+					if (started.count(i) != 0)
+						continue;
+					FailCase(cases[i], "Test process " +
+					    DescribeStatus(status) + " without running this case\n");
+					started.insert(i);
+				}
+			} else if (started.size() == batch.size() && last != NULL) {
+				// Crashed after the last case finished, e.g. in a
+				// static destructor.
+				std::cout << "Test process " << DescribeStatus(status)
+				    << " after running " << last->name << std::endl;
+			}
+
+			return started;
+		}
+
+		// Write the results in the format used by --gtest_output=xml.
+		void WriteReport(const std::string & path,
+		    const std::vector<CaseResult> & cases)
+		{
+			std::map<std::string, std::vector<CaseResult>> suites;
+			ReportTotals totals;
+
+			for (const auto & c : cases) {
+				suites[c.name.substr(0, c.name.find('.'))].push_back(c);
+				totals.tests++;
+				totals.failures += c.failed;
+				totals.seconds += c.seconds;
+			}
+
+			std::vector<std::string> elements;
+			for (const auto & [suite, suiteCases] : suites)
+				elements.push_back(MakeTestSuite(suite, suiteCases));
+
+			std::ofstream out(path);
+			if (!out) {
+				std::cerr << "Could not open " << path << std::endl;
+				return;
+			}
+
+			WriteXmlReport(out, totals, elements);
+		}
+
+		std::string GetXmlPath()
+		{
+			std::string output = ::testing::GTEST_FLAG(output);
+
+			if (output == "xml")
+				return "test_detail.xml";
+			if (output.compare(0, 4, "xml:") == 0)
+				return output.substr(4);
+			return "";
+		}
+	}
+
+	int RunForkServer(size_t batchSize)
+	{
+		std::vector<CaseResult> cases = GetSelectedCases();
+
+		std::cout << "[==========] Running " << cases.size()
+		    << " tests in child processes, " << batchSize
+		    << " at a time." << std::endl;
+
+		std::deque<size_t> pending;
+		for (size_t i = 0; i < cases.size(); ++i)
+			pending.push_back(i);
+
+		while (!pending.empty()) {
+			size_t count = std::min(batchSize, pending.size());
+			std::vector<size_t> batch(pending.begin(),
+			    pending.begin() + count);
+			pending.erase(pending.begin(), pending.begin() + count);
+
+			// Cases that the child never reached go to the front of
+			// the next batch.
+			std::set<size_t> finished = RunBatch(cases, batch);
+			for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+				if (finished.count(*it) == 0)
+					pending.push_front(*it);
+			}
+		}
+
+		size_t failures = 0;
+		double totalSeconds = 0;
+		for (const auto & c : cases) {
+			failures += c.failed;
+			totalSeconds += c.seconds;
+		}
+
+		std::cout << "[==========] " << cases.size() << " tests ran. ("
+		    << std::llround(totalSeconds * 1000) << " ms total)\n"
+		    << "[  PASSED  ] " << cases.size() - failures << " tests.\n";
+		if (failures > 0) {
+			std::cout << "[  FAILED  ] " << failures << " tests, listed below:\n";
+			for (const auto & c : cases) {
+				if (c.failed)
+					std::cout << "[  FAILED  ] " << c.name << "\n";
+			}
+		}
+		std::cout.flush();
+
+		std::string xmlPath = GetXmlPath();
+		if (!xmlPath.empty())
+			WriteReport(xmlPath, cases);
+
+		return failures > 0 ? 1 : 0;
+	}
+}
@@ -0,0 +1,7 @@
+
+LIB :=	sysunit_main
+
+SRCS := \
+	ForkServer.cpp \
+	main.cpp \
+
@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * Copyright (c) 2018 Ryan Stone
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "ForkServer.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <string>
+
+namespace
+{
+	// Returns the fork server batch size requested by --sysunit_fork[=N]
+	// or the SYSUNIT_FORK environment variable, or 0 if the tests should
+	// run in this process.
+	size_t GetForkBatchSize(int argc, char **argv)
+	{
+		const std::string flag = "--sysunit_fork";
+		const char * value = getenv("SYSUNIT_FORK");
+
+		for (int i = 1; i < argc; ++i) {
+			std::string arg(argv[i]);
+
+			if (arg == flag)
+				value = "1";
+			else if (arg.compare(0, flag.size() + 1, flag + "=") == 0)
+				value = argv[i] + flag.size() + 1;
+		}
+
+		if (value == NULL)
+			return 0;
+
+		return strtoul(value, NULL, 10);
+	}
+}
+
+// Replaces gtest_main.  In addition to gtest's flags, accepts
+// --sysunit_fork[=N] to run the tests N at a time (by default, 1) in child
+// processes; see RunForkServer().
+int
+main(int argc, char **argv)
+{
+	testing::InitGoogleTest(&argc, argv);
+
+	size_t batchSize = GetForkBatchSize(argc, argv);
+	if (batchSize == 0 || ::testing::GTEST_FLAG(list_tests))
+		return RUN_ALL_TESTS();
+
+	return SysUnit::internal::RunForkServer(batchSize);
+}